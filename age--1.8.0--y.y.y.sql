@@ -40,8 +40,22 @@
 -- Issue #2449: Both load_labels_from_file and load_edges_from_file now accept
 -- an optional delimiter parameter (default ',') to support non-CSV delimiters
 -- such as pipe-delimited files.
+--
+-- Both also take an optional parallel_workers parameter (default 0, a serial
+-- load) that parses the file with that many parallel workers. The rows are
+-- still inserted by the calling backend alone.
+--
+-- And an optional deferred_indexes parameter (default false) that skips index
+-- maintenance during the load and rebuilds the label's indexes after it.
+--
+-- load_edges_from_file also takes an optional key_property parameter (default
+-- NULL) that resolves the endpoints by that property of the vertices.
+--
+-- And an optional endpoint_validation parameter (default 'none') that checks
+-- the edge endpoints against the vertices, failing ('error') or skipping
+-- ('skip') edges whose start or end vertex does not exist.
 
--- Drop and recreate load_labels_from_file with new delimiter parameter
+-- Drop and recreate load_labels_from_file with the new parameters
 DROP FUNCTION IF EXISTS ag_catalog.load_labels_from_file(name, name, text, bool, bool);
 
 CREATE FUNCTION ag_catalog.load_labels_from_file(graph_name name,
@@ -49,19 +63,391 @@ CREATE FUNCTION ag_catalog.load_labels_from_file(graph_name name,
                                                  file_path text,
                                                  id_field_exists bool default true,
                                                  load_as_agtype bool default false,
-                                                 delimiter text default ',')
+                                                 delimiter text default ',',
+                                                 parallel_workers int default 0,
+                                                 deferred_indexes bool default false)
     RETURNS void
     LANGUAGE c
     AS 'MODULE_PATHNAME';
 
--- Drop and recreate load_edges_from_file with new delimiter parameter
+-- Drop and recreate load_edges_from_file with the new parameters
 DROP FUNCTION IF EXISTS ag_catalog.load_edges_from_file(name, name, text, bool);
 
 CREATE FUNCTION ag_catalog.load_edges_from_file(graph_name name,
                                                 label_name name,
                                                 file_path text,
                                                 load_as_agtype bool default false,
-                                                delimiter text default ',')
+                                                delimiter text default ',',
+                                                parallel_workers int default 0,
+                                                deferred_indexes bool default false,
+                                                key_property text default NULL,
+                                                endpoint_validation text default 'none')
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+--
+-- Push intermediate vertex constraints into the VLE traversal
+--
+-- age_vle gains an overload taking a vertex prototype, built by
+-- age_build_vle_match_vertex, that prunes traversal through vertices that
+-- cannot satisfy an all(x IN nodes(p) WHERE ...) predicate.
+CREATE FUNCTION ag_catalog.age_build_vle_match_vertex(agtype, agtype)
+    RETURNS agtype
+    LANGUAGE C
+    IMMUTABLE
+PARALLEL SAFE
+AS 'MODULE_PATHNAME';
+
+CREATE FUNCTION ag_catalog.age_vle(IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype,
+                                   OUT edges    agtype,
+                                   OUT start_id graphid,
+                                   OUT end_id   graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE -- might be safe
+AS 'MODULE_PATHNAME';
+
+--
+-- Push the terminal vertex label of a VLE into the traversal
+--
+-- age_vle gains an overload taking the terminal vertex label, so paths that
+-- can't end on a vertex with that label are not emitted.
+CREATE FUNCTION ag_catalog.age_vle(IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype, IN agtype,
+                                   OUT edges    agtype,
+                                   OUT start_id graphid,
+                                   OUT end_id   graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE -- might be safe
+AS 'MODULE_PATHNAME';
+
+--
+-- Batched multi-source VLE
+--
+-- age_vle_multi expands every start vertex of an array with the same pattern
+-- over one shared VLE context, emitting (source_id, edges, end_id) rows.
+CREATE FUNCTION ag_catalog.age_vle_multi(IN agtype, IN agtype, IN agtype,
+                                         IN agtype, IN agtype, IN agtype,
+                                         OUT source_id graphid,
+                                         OUT edges     agtype,
+                                         OUT end_id    graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- VLE path counting without materialization
+--
+-- age_vle_count and age_vle_reachable return the number of paths, and the
+-- distinct end vertex ids, that age_vle would emit from a start vertex.
+CREATE FUNCTION ag_catalog.age_vle_count(IN agtype, IN agtype, IN agtype,
+                                         IN agtype, IN agtype, IN agtype,
+                                         IN agtype)
+    RETURNS agtype
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+CREATE FUNCTION ag_catalog.age_vle_reachable(IN agtype, IN agtype, IN agtype,
+                                             IN agtype, IN agtype, IN agtype,
+                                             IN agtype)
+    RETURNS agtype
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- In-database PageRank
+--
+-- age_pagerank runs PageRank over a CSR copy of the cached graph and returns
+-- (vertex_id, score) rows.
+CREATE FUNCTION ag_catalog.age_pagerank(IN agtype,
+                                        IN agtype DEFAULT NULL,
+                                        IN agtype DEFAULT NULL,
+                                        IN agtype DEFAULT NULL,
+                                        IN agtype DEFAULT NULL,
+                                        OUT vertex_id graphid,
+                                        OUT score     float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Weakly connected components
+--
+-- age_wcc labels every vertex with its weakly connected component, found by
+-- union-find over a CSR copy of the cached graph.
+CREATE FUNCTION ag_catalog.age_wcc(IN agtype,
+                                   IN agtype DEFAULT NULL,
+                                   OUT vertex_id    graphid,
+                                   OUT component_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Strongly connected components
+--
+-- age_scc labels every vertex with its strongly connected component, found
+-- by an iterative Tarjan search over a CSR copy of the cached graph.
+CREATE FUNCTION ag_catalog.age_scc(IN agtype,
+                                   IN agtype DEFAULT NULL,
+                                   OUT vertex_id    graphid,
+                                   OUT component_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Triangle counting and local clustering
+--
+-- age_triangle_count and age_local_clustering intersect the sorted
+-- undirected neighbor lists of a CSR copy of the cached graph.
+CREATE FUNCTION ag_catalog.age_triangle_count(IN agtype,
+                                              IN agtype DEFAULT NULL,
+                                              OUT vertex_id graphid,
+                                              OUT triangles bigint)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The local clustering coefficient of every vertex over the cached graph,
+-- ignoring edge direction: graph, edge_types.
+CREATE FUNCTION ag_catalog.age_local_clustering(IN agtype,
+                                                IN agtype DEFAULT NULL,
+                                                OUT vertex_id   graphid,
+                                                OUT coefficient float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Louvain community detection
+--
+-- age_louvain runs Louvain modularity optimization over a CSR copy of the
+-- cached graph, optionally weighting the edges by a property.
+CREATE FUNCTION ag_catalog.age_louvain(IN agtype,
+                                       IN agtype DEFAULT NULL,
+                                       IN agtype DEFAULT NULL,
+                                       IN agtype DEFAULT NULL,
+                                       OUT vertex_id    graphid,
+                                       OUT community_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Betweenness centrality
+--
+-- age_betweenness runs Brandes' algorithm over a CSR copy of the cached
+-- graph, from every vertex or from a sample of them.
+CREATE FUNCTION ag_catalog.age_betweenness(IN agtype,
+                                           IN agtype DEFAULT NULL,
+                                           IN agtype DEFAULT NULL,
+                                           OUT vertex_id graphid,
+                                           OUT score     float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Label propagation
+--
+-- age_label_propagation runs synchronous label propagation, with ties going
+-- to the smallest label, over a CSR copy of the cached graph.
+CREATE FUNCTION ag_catalog.age_label_propagation(IN agtype,
+                                                 IN agtype DEFAULT NULL,
+                                                 IN agtype DEFAULT NULL,
+                                                 OUT vertex_id    graphid,
+                                                 OUT community_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Node similarity
+--
+-- age_node_similarity scores vertices by their shared out neighbors
+-- (Jaccard, overlap, or cosine) over a CSR copy of the cached graph, keeping
+-- the top k per vertex.
+CREATE FUNCTION ag_catalog.age_node_similarity(IN agtype,
+                                               IN agtype DEFAULT NULL,
+                                               IN agtype DEFAULT NULL,
+                                               IN agtype DEFAULT NULL,
+                                               OUT vertex_id  graphid,
+                                               OUT other_id   graphid,
+                                               OUT similarity float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Random walks
+--
+-- age_random_walks streams uniform or node2vec biased random walks over a
+-- CSR copy of the cached graph.
+CREATE FUNCTION ag_catalog.age_random_walks(IN agtype,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL)
+    RETURNS SETOF graphid[]
+LANGUAGE C
+VOLATILE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Graph profile
+--
+-- age_graph_profile summarizes the cached graph in one pass: degree
+-- histograms per vertex and edge label, hubs, and fan out per label triple.
+CREATE FUNCTION ag_catalog.age_graph_profile(agtype)
+    RETURNS agtype
+    LANGUAGE c
+    STABLE
+PARALLEL SAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Vertex property write back
+--
+-- age_write_vertex_property sets one property on many vertices in bulk,
+-- applying the updates in physical order.
+CREATE FUNCTION ag_catalog.age_write_vertex_property(graph_name name,
+                                                     property_name text,
+                                                     vertex_ids graphid[],
+                                                     property_values agtype[])
+    RETURNS bigint
+LANGUAGE C
+VOLATILE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+--
+-- Binary COPY input for the loaders
+--
+-- load_labels_from_binary_file and load_edges_from_binary_file load files in
+-- PostgreSQL's binary COPY format, with the columns described by the caller.
+CREATE FUNCTION ag_catalog.load_labels_from_binary_file(graph_name name,
+                                                        label_name name,
+                                                        file_path text,
+                                                        column_names text[],
+                                                        column_types regtype[],
+                                                        id_field_exists bool default true)
     RETURNS void
     LANGUAGE c
     AS 'MODULE_PATHNAME';
+
+CREATE FUNCTION ag_catalog.load_edges_from_binary_file(graph_name name,
+                                                       label_name name,
+                                                       file_path text,
+                                                       column_names text[],
+                                                       column_types regtype[])
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+--
+-- Loading from STDIN
+--
+-- load_labels_from_stdin and load_edges_from_stdin stream the CSV data from
+-- the client over the COPY protocol instead of reading a server side file.
+CREATE FUNCTION ag_catalog.load_labels_from_stdin(graph_name name,
+                                                  label_name name,
+                                                  id_field_exists bool default true,
+                                                  load_as_agtype bool default false,
+                                                  delimiter text default ',',
+                                                  deferred_indexes bool default false)
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+CREATE FUNCTION ag_catalog.load_edges_from_stdin(graph_name name,
+                                                 label_name name,
+                                                 load_as_agtype bool default false,
+                                                 delimiter text default ',',
+                                                 deferred_indexes bool default false,
+                                                 key_property text default NULL,
+                                                 endpoint_validation text default 'none')
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+--
+-- Bulk upsert of vertices
+--
+-- upsert_labels_from_file inserts the vertices of a CSV file with a new key
+-- and updates the properties of those whose key matches a vertex.
+CREATE FUNCTION ag_catalog.upsert_labels_from_file(graph_name name,
+                                                   label_name name,
+                                                   file_path text,
+                                                   key_property text,
+                                                   load_as_agtype bool default false,
+                                                   delimiter text default ',')
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+--
+-- Graph export
+--
+-- export_graph_to_files writes each label of a graph to a file in the layout
+-- the loaders read, CSV or binary COPY, scanning the labels in parallel. Big
+-- labels are split into parts of 8192 blocks, each written to a file of its
+-- own, <label>.<n>.csv or .bin.
+CREATE FUNCTION ag_catalog.export_graph_to_files(graph_name name,
+                                                 directory text,
+                                                 format text default 'csv',
+                                                 parallel_workers int default 0)
+    RETURNS TABLE (label_name name, file_path text, row_count bigint,
+                   column_names text[])
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
@@ -179,6 +179,32 @@ SELECT * FROM drop_graph('ag_graph_1', true);
 SELECT * FROM drop_graph('ag_graph_2', true);
 SELECT * FROM drop_graph('ag_graph_3', true);
 
+--
+-- graph_profile
+--
+SELECT * FROM create_graph('ag_profile');
+SELECT * FROM cypher('ag_profile', $$ CREATE (a:Person {name: 'a'}), (b:Person {name: 'b'}), (c:Person {name: 'c'}),
+                                             (m:Movie {name: 'm'}), ({name: 'x'}),
+                                             (a)-[:KNOWS]->(b), (a)-[:KNOWS]->(c), (b)-[:KNOWS]->(c), (c)-[:KNOWS]->(c),
+                                             (a)-[:LIKES]->(m), (b)-[:LIKES]->(m) $$) AS (result agtype);
+SELECT * FROM cypher('ag_profile', $$ WITH graph_profile('ag_profile') AS p
+                                      RETURN p.graph, p.num_vertices, p.num_edges $$) AS (graph agtype, num_vertices agtype, num_edges agtype);
+-- degree histograms per vertex label and per edge label
+SELECT * FROM cypher('ag_profile', $$ WITH graph_profile('ag_profile') AS p
+                                      UNWIND p.vertex_labels AS l RETURN l $$) AS (vertex_label agtype);
+SELECT * FROM cypher('ag_profile', $$ WITH graph_profile('ag_profile') AS p
+                                      UNWIND p.edge_labels AS l RETURN l $$) AS (edge_label agtype);
+-- fan out per (start label, edge label, end label)
+SELECT * FROM cypher('ag_profile', $$ WITH graph_profile('ag_profile') AS p
+                                      UNWIND p.triples AS t RETURN t $$) AS (triple agtype);
+-- hubs, highest total degree first
+SELECT * FROM cypher('ag_profile', $$ WITH graph_profile('ag_profile') AS p
+                                      UNWIND p.hubs AS h MATCH (n) WHERE id(n) = h.id
+                                      RETURN n.name, h.label, h.degree ORDER BY h.degree DESC, n.name $$) AS (name agtype, label agtype, degree agtype);
+-- errors
+SELECT * FROM cypher('ag_profile', $$ RETURN graph_profile('ag_no_graph') $$) AS (result agtype);
+SELECT * FROM drop_graph('ag_profile', true);
+
 -----------------------------------------------------------------------------------------------------------------------------
 --
 -- VLE cache invalidation tests
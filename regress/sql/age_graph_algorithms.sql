@@ -0,0 +1,630 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+LOAD 'age';
+SET search_path TO ag_catalog;
+
+--
+-- age_pagerank
+--
+
+SELECT * FROM create_graph('pr_graph');
+
+-- A small graph:
+--
+--   A -> B, B -> C, C -> A, A -> C  (LINKS)
+--   D -> A                          (MENTIONS)
+--
+SELECT * FROM cypher('pr_graph', $$
+    CREATE (a:Page {name: 'A'}),
+           (b:Page {name: 'B'}),
+           (c:Page {name: 'C'}),
+           (d:Page {name: 'D'}),
+           (a)-[:LINKS]->(b),
+           (b)-[:LINKS]->(c),
+           (c)-[:LINKS]->(a),
+           (a)-[:LINKS]->(c),
+           (d)-[:MENTIONS]->(a)
+$$) AS (result agtype);
+
+-- all edges, the default damping of 0.85 and 20 iterations
+SELECT n.name, round(p.score::numeric, 4) AS score
+FROM age_pagerank('"pr_graph"'::agtype) AS p
+JOIN cypher('pr_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON p.vertex_id = n.id::graphid
+ORDER BY n.name;
+
+-- the scores sum to 1
+SELECT round(sum(score)::numeric, 6) AS total
+FROM age_pagerank('"pr_graph"'::agtype);
+
+-- only LINKS edges; D is isolated and its rank comes from teleporting alone
+SELECT n.name, round(p.score::numeric, 4) AS score
+FROM age_pagerank('"pr_graph"'::agtype, '"LINKS"'::agtype) AS p
+JOIN cypher('pr_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON p.vertex_id = n.id::graphid
+ORDER BY n.name;
+
+-- an array of edge types
+SELECT n.name, round(p.score::numeric, 4) AS score
+FROM age_pagerank('"pr_graph"'::agtype, '["LINKS", "MENTIONS"]'::agtype) AS p
+JOIN cypher('pr_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON p.vertex_id = n.id::graphid
+ORDER BY n.name;
+
+-- damping 0.5, run to the tolerance
+SELECT n.name, round(p.score::numeric, 4) AS score
+FROM age_pagerank('"pr_graph"'::agtype, NULL, '0.5'::agtype, '100'::agtype,
+                  '1e-9'::agtype) AS p
+JOIN cypher('pr_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON p.vertex_id = n.id::graphid
+ORDER BY n.name;
+
+-- no iterations leaves the uniform starting ranks
+SELECT count(*) AS vertices, round(min(score)::numeric, 4) AS min_score,
+       round(max(score)::numeric, 4) AS max_score
+FROM age_pagerank('"pr_graph"'::agtype, NULL, NULL, '0'::agtype);
+
+-- the same ranks with the iterations split over parallel workers, both for
+-- a fixed number of iterations and run to the tolerance
+SET age.min_parallel_graph_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT n.name, round(p.score::numeric, 4) AS score
+FROM age_pagerank('"pr_graph"'::agtype) AS p
+JOIN cypher('pr_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON p.vertex_id = n.id::graphid
+ORDER BY n.name;
+SELECT n.name, round(p.score::numeric, 4) AS score
+FROM age_pagerank('"pr_graph"'::agtype, NULL, '0.5'::agtype, '100'::agtype,
+                  '1e-9'::agtype) AS p
+JOIN cypher('pr_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON p.vertex_id = n.id::graphid
+ORDER BY n.name;
+SELECT count(*) AS vertices, round(min(score)::numeric, 4) AS min_score,
+       round(max(score)::numeric, 4) AS max_score
+FROM age_pagerank('"pr_graph"'::agtype, NULL, NULL, '0'::agtype);
+RESET max_parallel_workers_per_gather;
+RESET age.min_parallel_graph_size;
+
+-- an unknown edge type follows no edges
+SELECT round(max(score)::numeric, 4) AS max_score
+FROM age_pagerank('"pr_graph"'::agtype, '"UNKNOWN"'::agtype);
+
+-- errors
+SELECT * FROM age_pagerank('"pr_graph"'::agtype, NULL, '1.5'::agtype);
+SELECT * FROM age_pagerank('"pr_graph"'::agtype, NULL, NULL, '-1'::agtype);
+SELECT * FROM age_pagerank('"pr_graph"'::agtype, NULL, NULL, '2.5'::agtype);
+SELECT * FROM age_pagerank('"pr_graph"'::agtype, '[1]'::agtype);
+SELECT * FROM age_pagerank('"pr_missing"'::agtype);
+SELECT * FROM age_pagerank(NULL);
+
+-- cleanup
+SELECT * FROM drop_graph('pr_graph', true);
+
+--
+-- age_wcc
+--
+
+SELECT * FROM create_graph('cc_graph');
+
+-- A small graph:
+--
+--   A -> B, B -> C, C -> A, D -> E, E -> D  (FLOW)
+--   C -> D, F -> G                          (REF)
+--   H                                       (isolated)
+--
+SELECT * FROM cypher('cc_graph', $$
+    CREATE (a:Node {name: 'A'}),
+           (b:Node {name: 'B'}),
+           (c:Node {name: 'C'}),
+           (d:Node {name: 'D'}),
+           (e:Node {name: 'E'}),
+           (f:Node {name: 'F'}),
+           (g:Node {name: 'G'}),
+           (h:Node {name: 'H'}),
+           (a)-[:FLOW]->(b),
+           (b)-[:FLOW]->(c),
+           (c)-[:FLOW]->(a),
+           (d)-[:FLOW]->(e),
+           (e)-[:FLOW]->(d),
+           (c)-[:REF]->(d),
+           (f)-[:REF]->(g)
+$$) AS (result agtype);
+
+-- all edges; components are named by their smallest vertex
+WITH names AS (
+    SELECT * FROM cypher('cc_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS component
+FROM age_wcc('"cc_graph"'::agtype) AS w
+JOIN names AS n ON w.vertex_id = n.id::graphid
+JOIN names AS c ON w.component_id = c.id::graphid
+ORDER BY n.name;
+
+-- the same components with the edges split over parallel workers
+SET age.min_parallel_graph_size = 0;
+SET max_parallel_workers_per_gather = 2;
+WITH names AS (
+    SELECT * FROM cypher('cc_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS component
+FROM age_wcc('"cc_graph"'::agtype) AS w
+JOIN names AS n ON w.vertex_id = n.id::graphid
+JOIN names AS c ON w.component_id = c.id::graphid
+ORDER BY n.name;
+RESET max_parallel_workers_per_gather;
+RESET age.min_parallel_graph_size;
+
+-- only FLOW edges
+WITH names AS (
+    SELECT * FROM cypher('cc_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS component
+FROM age_wcc('"cc_graph"'::agtype, '"FLOW"'::agtype) AS w
+JOIN names AS n ON w.vertex_id = n.id::graphid
+JOIN names AS c ON w.component_id = c.id::graphid
+ORDER BY n.name;
+
+-- the number of components
+SELECT count(DISTINCT component_id) AS components
+FROM age_wcc('"cc_graph"'::agtype, '"FLOW"'::agtype);
+
+-- errors
+SELECT * FROM age_wcc('"cc_missing"'::agtype);
+
+--
+-- age_scc
+--
+
+-- all edges; A, B, C and D, E are cycles, C -> D and F -> G are not
+WITH names AS (
+    SELECT * FROM cypher('cc_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS component
+FROM age_scc('"cc_graph"'::agtype) AS s
+JOIN names AS n ON s.vertex_id = n.id::graphid
+JOIN names AS c ON s.component_id = c.id::graphid
+ORDER BY n.name;
+
+-- a cycle through REF edges joins A, B, C, D and E
+SELECT * FROM cypher('cc_graph', $$
+    MATCH (d:Node {name: 'D'}), (a:Node {name: 'A'})
+    CREATE (d)-[:REF]->(a)
+$$) AS (result agtype);
+
+WITH names AS (
+    SELECT * FROM cypher('cc_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS component
+FROM age_scc('"cc_graph"'::agtype) AS s
+JOIN names AS n ON s.vertex_id = n.id::graphid
+JOIN names AS c ON s.component_id = c.id::graphid
+ORDER BY n.name;
+
+-- only REF edges; every vertex is its own component
+SELECT count(DISTINCT component_id) AS components
+FROM age_scc('"cc_graph"'::agtype, '"REF"'::agtype);
+
+-- errors
+SELECT * FROM age_scc('"cc_missing"'::agtype);
+
+--
+-- age_triangle_count and age_local_clustering
+--
+
+-- A, B, C and A, C, D are triangles
+WITH names AS (
+    SELECT * FROM cypher('cc_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, t.triangles, round(c.coefficient::numeric, 4) AS coefficient
+FROM age_triangle_count('"cc_graph"'::agtype) AS t
+JOIN age_local_clustering('"cc_graph"'::agtype) AS c
+    ON t.vertex_id = c.vertex_id
+JOIN names AS n ON t.vertex_id = n.id::graphid
+ORDER BY n.name;
+
+-- only FLOW edges; A, B, C is the only triangle
+WITH names AS (
+    SELECT * FROM cypher('cc_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, t.triangles, round(c.coefficient::numeric, 4) AS coefficient
+FROM age_triangle_count('"cc_graph"'::agtype, '"FLOW"'::agtype) AS t
+JOIN age_local_clustering('"cc_graph"'::agtype, '"FLOW"'::agtype) AS c
+    ON t.vertex_id = c.vertex_id
+JOIN names AS n ON t.vertex_id = n.id::graphid
+WHERE t.triangles > 0
+ORDER BY n.name;
+
+-- parallel edges and self loops do not add triangles
+SELECT * FROM cypher('cc_graph', $$
+    MATCH (a:Node {name: 'A'}), (b:Node {name: 'B'})
+    CREATE (b)-[:FLOW]->(a), (a)-[:FLOW]->(a)
+$$) AS (result agtype);
+
+SELECT sum(triangles)::bigint / 3 AS triangles
+FROM age_triangle_count('"cc_graph"'::agtype);
+
+-- cleanup
+SELECT * FROM drop_graph('cc_graph', true);
+
+--
+-- age_louvain
+--
+
+SELECT * FROM create_graph('lv_graph');
+
+-- two triangles, A, B, C and D, E, F, joined by C - D; G is isolated
+SELECT * FROM cypher('lv_graph', $$
+    CREATE (a:Node {name: 'A'}),
+           (b:Node {name: 'B'}),
+           (c:Node {name: 'C'}),
+           (d:Node {name: 'D'}),
+           (e:Node {name: 'E'}),
+           (f:Node {name: 'F'}),
+           (g:Node {name: 'G'}),
+           (a)-[:LINK]->(b),
+           (b)-[:LINK {weight: 1}]->(c),
+           (c)-[:LINK {weight: 1.0}]->(a),
+           (d)-[:LINK {weight: 1}]->(e),
+           (e)-[:LINK {weight: 1}]->(f),
+           (f)-[:LINK {weight: 1}]->(d),
+           (c)-[:LINK {weight: 10, note: 'strong'}]->(d)
+$$) AS (result agtype);
+
+-- unweighted; communities are named by their smallest vertex
+WITH names AS (
+    SELECT * FROM cypher('lv_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS community
+FROM age_louvain('"lv_graph"'::agtype) AS l
+JOIN names AS n ON l.vertex_id = n.id::graphid
+JOIN names AS c ON l.community_id = c.id::graphid
+ORDER BY n.name;
+
+-- weighted; the heavy C - D edge pulls C and D together, and an edge
+-- without a weight weighs 1
+WITH names AS (
+    SELECT * FROM cypher('lv_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS community
+FROM age_louvain('"lv_graph"'::agtype, '"LINK"'::agtype,
+                 '"weight"'::agtype) AS l
+JOIN names AS n ON l.vertex_id = n.id::graphid
+JOIN names AS c ON l.community_id = c.id::graphid
+ORDER BY n.name;
+
+-- no levels leaves every vertex in a community of its own
+SELECT count(DISTINCT community_id) AS communities
+FROM age_louvain('"lv_graph"'::agtype, NULL, NULL, '0'::agtype);
+
+-- errors
+SELECT * FROM age_louvain('"lv_graph"'::agtype, NULL, '"note"'::agtype);
+SELECT * FROM age_louvain('"lv_graph"'::agtype, NULL, '1'::agtype);
+SELECT * FROM age_louvain('"lv_graph"'::agtype, NULL, NULL, '-1'::agtype);
+SELECT * FROM age_louvain('"lv_missing"'::agtype);
+
+--
+-- age_label_propagation
+--
+
+-- the two triangles become two communities
+WITH names AS (
+    SELECT * FROM cypher('lv_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS community
+FROM age_label_propagation('"lv_graph"'::agtype) AS l
+JOIN names AS n ON l.vertex_id = n.id::graphid
+JOIN names AS c ON l.community_id = c.id::graphid
+ORDER BY n.name;
+
+-- after one iteration D has taken C's old label, which no one else has kept
+WITH names AS (
+    SELECT * FROM cypher('lv_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS community
+FROM age_label_propagation('"lv_graph"'::agtype, NULL, '1'::agtype) AS l
+JOIN names AS n ON l.vertex_id = n.id::graphid
+JOIN names AS c ON l.community_id = c.id::graphid
+ORDER BY n.name;
+
+-- the same communities with each iteration split over parallel workers
+SET age.min_parallel_graph_size = 0;
+SET max_parallel_workers_per_gather = 2;
+WITH names AS (
+    SELECT * FROM cypher('lv_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS community
+FROM age_label_propagation('"lv_graph"'::agtype) AS l
+JOIN names AS n ON l.vertex_id = n.id::graphid
+JOIN names AS c ON l.community_id = c.id::graphid
+ORDER BY n.name;
+WITH names AS (
+    SELECT * FROM cypher('lv_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, c.name AS community
+FROM age_label_propagation('"lv_graph"'::agtype, NULL, '1'::agtype) AS l
+JOIN names AS n ON l.vertex_id = n.id::graphid
+JOIN names AS c ON l.community_id = c.id::graphid
+ORDER BY n.name;
+RESET max_parallel_workers_per_gather;
+RESET age.min_parallel_graph_size;
+
+-- errors
+SELECT * FROM age_label_propagation('"lv_graph"'::agtype, NULL, '-1'::agtype);
+
+-- cleanup
+SELECT * FROM drop_graph('lv_graph', true);
+
+--
+-- age_betweenness
+--
+
+SELECT * FROM create_graph('bw_graph');
+
+-- A -> B -> C -> D and the shorter A -> E -> D
+SELECT * FROM cypher('bw_graph', $$
+    CREATE (a:Node {name: 'A'}),
+           (b:Node {name: 'B'}),
+           (c:Node {name: 'C'}),
+           (d:Node {name: 'D'}),
+           (e:Node {name: 'E'}),
+           (a)-[:NEXT]->(b),
+           (b)-[:NEXT]->(c),
+           (c)-[:NEXT]->(d),
+           (a)-[:NEXT]->(e),
+           (e)-[:NEXT]->(d)
+$$) AS (result agtype);
+
+-- exact; B is between A and C, C between B and D, and E between A and D
+SELECT n.name, b.score
+FROM age_betweenness('"bw_graph"'::agtype) AS b
+JOIN cypher('bw_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON b.vertex_id = n.id::graphid
+ORDER BY n.name;
+
+-- a sample at least as large as the graph is exact
+SELECT sum(score) AS total
+FROM age_betweenness('"bw_graph"'::agtype, NULL, '100'::agtype);
+
+-- a smaller sample still scores every vertex
+SELECT count(*) AS vertices, min(score) >= 0 AS non_negative
+FROM age_betweenness('"bw_graph"'::agtype, NULL, '2'::agtype);
+
+-- the same exact scores with the sources spread over parallel workers
+SET age.min_parallel_graph_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT n.name, b.score
+FROM age_betweenness('"bw_graph"'::agtype) AS b
+JOIN cypher('bw_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+    AS n(id agtype, name agtype) ON b.vertex_id = n.id::graphid
+ORDER BY n.name;
+RESET max_parallel_workers_per_gather;
+RESET age.min_parallel_graph_size;
+
+-- errors
+SELECT * FROM age_betweenness('"bw_graph"'::agtype, NULL, '0'::agtype);
+SELECT * FROM age_betweenness('"bw_missing"'::agtype);
+
+-- cleanup
+SELECT * FROM drop_graph('bw_graph', true);
+
+--
+-- age_node_similarity
+--
+
+SELECT * FROM create_graph('ns_graph');
+
+-- customers and the devices they use
+SELECT * FROM cypher('ns_graph', $$
+    CREATE (c1:Customer {name: 'C1'}),
+           (c2:Customer {name: 'C2'}),
+           (c3:Customer {name: 'C3'}),
+           (d1:Device {name: 'D1'}),
+           (d2:Device {name: 'D2'}),
+           (d3:Device {name: 'D3'}),
+           (c1)-[:USES]->(d1),
+           (c1)-[:USES]->(d2),
+           (c1)-[:USES]->(d2),
+           (c2)-[:USES]->(d1),
+           (c2)-[:USES]->(d2),
+           (c2)-[:USES]->(d3),
+           (c3)-[:USES]->(d3)
+$$) AS (result agtype);
+
+-- Jaccard; C1 and C3 share no device
+WITH names AS (
+    SELECT * FROM cypher('ns_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, o.name AS other, round(s.similarity::numeric, 4) AS similarity
+FROM age_node_similarity('"ns_graph"'::agtype) AS s
+JOIN names AS n ON s.vertex_id = n.id::graphid
+JOIN names AS o ON s.other_id = o.id::graphid
+ORDER BY n.name, s.similarity DESC;
+
+-- overlap
+WITH names AS (
+    SELECT * FROM cypher('ns_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, o.name AS other, round(s.similarity::numeric, 4) AS similarity
+FROM age_node_similarity('"ns_graph"'::agtype, '"USES"'::agtype, NULL,
+                         '"overlap"'::agtype) AS s
+JOIN names AS n ON s.vertex_id = n.id::graphid
+JOIN names AS o ON s.other_id = o.id::graphid
+ORDER BY n.name, o.name;
+
+-- cosine, keeping only the most similar vertex
+WITH names AS (
+    SELECT * FROM cypher('ns_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, o.name AS other, round(s.similarity::numeric, 4) AS similarity
+FROM age_node_similarity('"ns_graph"'::agtype, NULL, '1'::agtype,
+                         '"cosine"'::agtype) AS s
+JOIN names AS n ON s.vertex_id = n.id::graphid
+JOIN names AS o ON s.other_id = o.id::graphid
+ORDER BY n.name;
+
+-- the same rows with the sources split over parallel workers
+SET age.min_parallel_graph_size = 0;
+SET max_parallel_workers_per_gather = 2;
+WITH names AS (
+    SELECT * FROM cypher('ns_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype))
+SELECT n.name, o.name AS other, round(s.similarity::numeric, 4) AS similarity
+FROM age_node_similarity('"ns_graph"'::agtype) AS s
+JOIN names AS n ON s.vertex_id = n.id::graphid
+JOIN names AS o ON s.other_id = o.id::graphid
+ORDER BY n.name, s.similarity DESC;
+RESET max_parallel_workers_per_gather;
+RESET age.min_parallel_graph_size;
+
+-- errors
+SELECT * FROM age_node_similarity('"ns_graph"'::agtype, NULL, '0'::agtype);
+SELECT * FROM age_node_similarity('"ns_graph"'::agtype, NULL, NULL,
+                                  '"euclidean"'::agtype);
+SELECT * FROM age_node_similarity('"ns_missing"'::agtype);
+
+-- cleanup
+SELECT * FROM drop_graph('ns_graph', true);
+
+--
+-- age_random_walks
+--
+
+SELECT * FROM create_graph('rw_graph');
+
+-- A -> B -> C -> D, so every walk is forced
+SELECT * FROM cypher('rw_graph', $$
+    CREATE (a:Node {name: 'A'})-[:NEXT]->(b:Node {name: 'B'})-[:NEXT]->
+           (c:Node {name: 'C'})-[:NEXT]->(d:Node {name: 'D'})
+$$) AS (result agtype);
+
+-- two walks of up to three vertices from A
+WITH names AS (
+    SELECT * FROM cypher('rw_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype)),
+walks AS (
+    SELECT row_number() OVER () AS walk_no, walk
+    FROM age_random_walks('"rw_graph"'::agtype,
+                          (SELECT agtype_build_list(id) FROM names
+                           WHERE name = '"A"'),
+                          '3'::agtype, '2'::agtype, NULL, NULL, '42'::agtype)
+        AS walk)
+SELECT w.walk_no, string_agg(n.name::text, ' -> ' ORDER BY u.ord) AS walk
+FROM walks AS w, unnest(w.walk) WITH ORDINALITY AS u(id, ord)
+JOIN names AS n ON u.id = n.id::graphid
+GROUP BY w.walk_no
+ORDER BY w.walk_no;
+
+-- one biased walk from every vertex; walks end where the edges do
+WITH names AS (
+    SELECT * FROM cypher('rw_graph', $$ MATCH (n) RETURN id(n), n.name $$)
+        AS (id agtype, name agtype)),
+walks AS (
+    SELECT row_number() OVER () AS walk_no, walk
+    FROM age_random_walks('"rw_graph"'::agtype, NULL, '10'::agtype,
+                          '1'::agtype, '2'::agtype, '0.5'::agtype,
+                          '7'::agtype) AS walk)
+SELECT string_agg(n.name::text, ' -> ' ORDER BY u.ord) AS walk
+FROM walks AS w, unnest(w.walk) WITH ORDINALITY AS u(id, ord)
+JOIN names AS n ON u.id = n.id::graphid
+GROUP BY w.walk_no
+ORDER BY 1;
+
+-- the default walks, ten per vertex
+SELECT count(*) AS walks
+FROM age_random_walks('"rw_graph"'::agtype);
+
+-- no walks
+SELECT count(*) AS walks
+FROM age_random_walks('"rw_graph"'::agtype, NULL, NULL, '0'::agtype);
+
+-- errors
+SELECT * FROM age_random_walks('"rw_graph"'::agtype, NULL, '0'::agtype);
+SELECT * FROM age_random_walks('"rw_graph"'::agtype, NULL, NULL, NULL,
+                               '0'::agtype);
+SELECT * FROM age_random_walks('"rw_graph"'::agtype, '1'::agtype);
+
+-- cleanup
+SELECT * FROM drop_graph('rw_graph', true);
+
+--
+-- age_write_vertex_property
+--
+SELECT * FROM create_graph('wb_graph');
+SELECT * FROM cypher('wb_graph', $$
+    CREATE (a:Page {name: 'A'})-[:LINKS]->(b:Page {name: 'B'}),
+           (b)-[:LINKS]->(c:Page {name: 'C'}),
+           (c)-[:LINKS]->(a),
+           (:Page {name: 'D', rank: 'old'})
+$$) AS (result agtype);
+
+-- write the pagerank scores back, replacing D's old rank
+SELECT age_write_vertex_property('wb_graph', 'rank', array_agg(vertex_id),
+                                 array_agg(round(score::numeric, 4)::float8::agtype))
+FROM age_pagerank('"wb_graph"'::agtype);
+SELECT * FROM cypher('wb_graph', $$ MATCH (n:Page) RETURN n.name, n.rank ORDER BY n.name $$)
+    AS (name agtype, rank agtype);
+
+-- a NULL value removes the property and the last of a repeated id wins
+WITH ids AS (
+    SELECT name, id::graphid AS id
+    FROM cypher('wb_graph', $$ MATCH (n:Page) RETURN n.name, id(n) $$)
+        AS (name agtype, id agtype))
+SELECT age_write_vertex_property('wb_graph', 'rank',
+                                 ARRAY[(SELECT id FROM ids WHERE name = '"A"'),
+                                       (SELECT id FROM ids WHERE name = '"B"'),
+                                       (SELECT id FROM ids WHERE name = '"B"'),
+                                       (SELECT id FROM ids WHERE name = '"C"')],
+                                 ARRAY[NULL, '"first"', '"last"',
+                                       '{"k": [1, 2]}']::agtype[]);
+SELECT * FROM cypher('wb_graph', $$ MATCH (n:Page) RETURN n.name, n.rank ORDER BY n.name $$)
+    AS (name agtype, rank agtype);
+
+-- the graph cache sees the written properties
+SELECT * FROM cypher('wb_graph', $$
+    MATCH p = (:Page {name: 'A'})-[:LINKS*1..2]->(x)
+    WHERE all(n IN nodes(p) WHERE n.tag = 'hub')
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+SELECT age_write_vertex_property('wb_graph', 'tag', array_agg(id::graphid),
+                                 array_agg('"hub"'::agtype))
+FROM cypher('wb_graph', $$ MATCH (n:Page) WHERE n.name <> 'D' RETURN id(n) $$)
+    AS (id agtype);
+SELECT * FROM cypher('wb_graph', $$
+    MATCH p = (:Page {name: 'A'})-[:LINKS*1..2]->(x)
+    WHERE all(n IN nodes(p) WHERE n.tag = 'hub')
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+
+-- nothing to write
+SELECT age_write_vertex_property('wb_graph', 'rank', ARRAY[]::graphid[],
+                                 ARRAY[]::agtype[]);
+
+-- errors
+SELECT age_write_vertex_property('wb_graph', 'rank', ARRAY[]::graphid[],
+                                 ARRAY['1']::agtype[]);
+SELECT age_write_vertex_property('wb_graph', '', ARRAY[]::graphid[],
+                                 ARRAY[]::agtype[]);
+SELECT age_write_vertex_property('wb_missing', 'rank', ARRAY[]::graphid[],
+                                 ARRAY[]::agtype[]);
+
+-- cleanup
+SELECT * FROM drop_graph('wb_graph', true);
@@ -137,6 +137,328 @@ SELECT * FROM cypher('agload_test_graph', $$return graph_stats('agload_test_grap
 
 SELECT drop_graph('agload_test_graph', true);
 
+--
+-- Test parallel load
+--
+
+-- Serial load to compare with
+SELECT load_labels_from_file('agload_parallel', 'City',
+                             'age_load/cities.csv', false);
+SELECT load_labels_from_file('agload_parallel', 'City2',
+                             'age_load/cities.csv', false, false, ',', 2);
+SELECT COUNT(*) FROM agload_parallel."City2";
+SELECT currval('agload_parallel."City2_id_seq"')=72485;
+
+-- Should have the same entry ids and properties as the serial load
+SELECT COUNT(*) FROM agload_parallel."City" s
+    JOIN agload_parallel."City2" p
+    ON s.id::text::bigint % 281474976710656 = p.id::text::bigint % 281474976710656
+WHERE s.properties = p.properties;
+
+-- Should keep the ids from the file and move the sequence past them
+SELECT load_labels_from_file('agload_parallel', 'Country',
+                             'age_load/countries.csv', true, false, ',', 2);
+SELECT COUNT(*) FROM agload_parallel."Country";
+SELECT currval('agload_parallel."Country_id_seq"')=248;
+
+SELECT load_edges_from_file('agload_parallel', 'has_city',
+                            'age_load/edges.csv');
+SELECT load_edges_from_file('agload_parallel', 'has_city2',
+                            'age_load/edges.csv', false, ',', 2);
+SELECT COUNT(*) FROM agload_parallel.has_city s
+    JOIN agload_parallel.has_city2 p
+    ON s.id::text::bigint % 281474976710656 = p.id::text::bigint % 281474976710656
+WHERE s.start_id = p.start_id AND s.end_id = p.end_id AND
+      s.properties = p.properties;
+
+-- Should error out on a negative worker count
+SELECT load_labels_from_file('agload_parallel', 'City',
+                             'age_load/cities.csv', false, false, ',', -1);
+
+SELECT drop_graph('agload_parallel', true);
+
+--
+-- Test deferred index build
+--
+SELECT load_labels_from_file('agload_deferred', 'Country',
+                             'age_load/countries.csv', true, false, ',', 0,
+                             true);
+SELECT load_edges_from_file('agload_deferred', 'has_city',
+                            'age_load/edges.csv', false, ',', 0, true);
+
+-- The rebuilt indexes should have every loaded row
+SET enable_seqscan = off;
+SELECT COUNT(*) FROM agload_deferred."Country" WHERE id > '0'::graphid;
+SELECT COUNT(*) FROM agload_deferred.has_city WHERE start_id > '0'::graphid;
+SELECT COUNT(*) FROM agload_deferred.has_city WHERE end_id > '0'::graphid;
+RESET enable_seqscan;
+
+-- Should error out on duplicate ids when the indexes are rebuilt
+\set VERBOSITY terse
+SELECT load_labels_from_file('agload_deferred', 'Country',
+                             'age_load/countries.csv', true, false, ',', 0,
+                             true);
+\set VERBOSITY default
+SELECT COUNT(*) FROM agload_deferred."Country";
+
+SELECT drop_graph('agload_deferred', true);
+
+--
+-- Test binary COPY input
+--
+COPY (VALUES (1::bigint, 'Alice'::text, 30, 1.5::float8, true),
+             (2::bigint, 'Bob'::text, NULL, 2.25::float8, false))
+    TO '/tmp/age/age_load/binary_vertices.bin' WITH (FORMAT binary);
+COPY (VALUES (1::bigint, 'Person'::text, 2::bigint, 'Person'::text, 2020))
+    TO '/tmp/age/age_load/binary_edges.bin' WITH (FORMAT binary);
+
+SELECT load_labels_from_binary_file('agload_binary', 'Person',
+                                    'age_load/binary_vertices.bin',
+                                    ARRAY['id', 'name', 'age', 'score', 'active'],
+                                    ARRAY['bigint', 'text', 'integer',
+                                          'float8', 'boolean']::regtype[]);
+SELECT load_edges_from_binary_file('agload_binary', 'knows',
+                                   'age_load/binary_edges.bin',
+                                   ARRAY['start_id', 'start_vertex_type',
+                                         'end_id', 'end_vertex_type', 'since'],
+                                   ARRAY['bigint', 'text', 'bigint', 'text',
+                                         'integer']::regtype[]);
+SELECT * FROM cypher('agload_binary', $$
+    MATCH (n:Person) RETURN id(n), properties(n) ORDER BY id(n)
+$$) AS (id agtype, props agtype);
+SELECT * FROM cypher('agload_binary', $$
+    MATCH (a)-[e:knows]->(b) RETURN a.name, b.name, properties(e)
+$$) AS (a agtype, b agtype, props agtype);
+
+-- Should error out on columns that do not match the file
+SELECT load_labels_from_binary_file('agload_binary', 'Person',
+                                    'age_load/binary_vertices.bin',
+                                    ARRAY['id', 'name'],
+                                    ARRAY['bigint']::regtype[]);
+SELECT load_labels_from_binary_file('agload_binary', 'Person',
+                                    'age_load/binary_vertices.bin',
+                                    ARRAY['id', 'name', 'age', 'score', 'active'],
+                                    ARRAY['bigint', 'integer', 'integer',
+                                          'float8', 'boolean']::regtype[]);
+SELECT load_labels_from_binary_file('agload_binary', 'Person',
+                                    'age_load/countries.csv',
+                                    ARRAY['id'], ARRAY['bigint']::regtype[]);
+SELECT COUNT(*) FROM agload_binary."Person";
+
+SELECT drop_graph('agload_binary', true);
+
+--
+-- Test loading from STDIN
+--
+SELECT load_labels_from_stdin('agload_stdin', 'Person');
+id,name,age
+1,Alice,30
+2,Bob,25
+\.
+SELECT load_edges_from_stdin('agload_stdin', 'knows', true, '|');
+start_id|start_vertex_type|end_id|end_vertex_type|since
+1|Person|2|Person|2020
+\.
+SELECT * FROM cypher('agload_stdin', $$
+    MATCH (n:Person) RETURN id(n), n.name, n.age ORDER BY id(n)
+$$) AS (id agtype, name agtype, age agtype);
+SELECT * FROM cypher('agload_stdin', $$
+    MATCH (a)-[e:knows]->(b) RETURN a.name, b.name, e.since
+$$) AS (a agtype, b agtype, since agtype);
+
+-- Should error out before reading any data
+SELECT load_edges_from_stdin('agload_stdin', 'knows', false, '||');
+
+SELECT drop_graph('agload_stdin', true);
+
+--
+-- Test edge endpoints given by natural keys
+--
+SELECT load_labels_from_stdin('agload_keys', 'User', false);
+email,name
+alice@example.com,Alice
+bob@example.com,Bob
+\.
+SELECT load_edges_from_stdin('agload_keys', 'follows', false, ',', false,
+                             'email');
+start_id,start_vertex_type,end_id,end_vertex_type,since
+alice@example.com,User,bob@example.com,User,2020
+bob@example.com, User ,alice@example.com,User,2021
+\.
+SELECT * FROM cypher('agload_keys', $$
+    MATCH (a)-[e:follows]->(b) RETURN a.name, b.name, e.since ORDER BY e.since
+$$) AS (a agtype, b agtype, since agtype);
+
+-- Should error out on a key with no vertex
+SELECT load_edges_from_stdin('agload_keys', 'follows', false, ',', false,
+                             'email');
+start_id,start_vertex_type,end_id,end_vertex_type
+alice@example.com,User,carol@example.com,User
+\.
+-- Should error out with parallel workers
+SELECT load_edges_from_file('agload_keys', 'follows', 'age_load/edges.csv',
+                            false, ',', 2, false, 'email');
+SELECT COUNT(*) FROM agload_keys.follows;
+
+-- Keys are probed in an index on the key property
+CREATE INDEX agload_keys_email ON agload_keys."User"
+    (ag_catalog.agtype_access_operator(properties, '"email"'::agtype));
+SELECT load_edges_from_stdin('agload_keys', 'follows', false, ',', false,
+                             'email');
+start_id,start_vertex_type,end_id,end_vertex_type,since
+alice@example.com,User,bob@example.com,User,2022
+\.
+SELECT COUNT(*) FROM agload_keys.follows;
+-- Should error out on a key with no vertex in the index
+SELECT load_edges_from_stdin('agload_keys', 'follows', false, ',', false,
+                             'email');
+start_id,start_vertex_type,end_id,end_vertex_type
+carol@example.com,User,bob@example.com,User
+\.
+
+-- The integer 5 and the string "5" are different keys
+SELECT * FROM cypher('agload_keys', $$
+    CREATE (:Item {code: 5, name: 'int'}), (:Item {code: '5', name: 'str'})
+$$) AS (a agtype);
+SELECT load_edges_from_stdin('agload_keys', 'contains', true, ',', false,
+                             'code');
+start_id,start_vertex_type,end_id,end_vertex_type
+5,Item,"""5""",Item
+\.
+SELECT * FROM cypher('agload_keys', $$
+    MATCH (a)-[:contains]->(b) RETURN a.name, b.name
+$$) AS (a agtype, b agtype);
+
+SELECT drop_graph('agload_keys', true);
+
+--
+-- Test edge endpoint validation
+--
+SELECT load_labels_from_stdin('agload_validate', 'Person');
+id,name
+1,Alice
+2,Bob
+\.
+-- Should error out on the edge to a missing vertex
+SELECT load_edges_from_stdin('agload_validate', 'knows', false, ',', false,
+                             NULL, 'error');
+start_id,start_vertex_type,end_id,end_vertex_type
+1,Person,2,Person
+2,Person,3,Person
+\.
+-- Should skip the edges with a missing vertex or a non-vertex label
+SELECT load_edges_from_stdin('agload_validate', 'knows', false, ',', false,
+                             NULL, 'skip');
+start_id,start_vertex_type,end_id,end_vertex_type
+1,Person,2,Person
+2,Person,3,Person
+4,Person,1,Person
+2,knows,1,Person
+2,Person,1,Person
+\.
+SELECT * FROM cypher('agload_validate', $$
+    MATCH (a)-[e:knows]->(b) RETURN a.name, b.name ORDER BY a.name
+$$) AS (a agtype, b agtype);
+SELECT load_edges_from_file('agload_validate', 'knows', 'age_load/edges.csv',
+                            false, ',', 0, false, NULL, 'sometimes');
+
+SELECT drop_graph('agload_validate', true);
+
+--
+-- Test upsert
+--
+SELECT upsert_labels_from_file('agload_upsert', 'Person',
+                               'age_load/upsert_people.csv', 'email');
+SELECT upsert_labels_from_file('agload_upsert', 'Person',
+                               'age_load/upsert_people_delta.csv', 'email');
+SELECT * FROM cypher('agload_upsert', $$
+    MATCH (n:Person) RETURN id(n), properties(n) ORDER BY id(n)
+$$) AS (id agtype, props agtype);
+
+-- Should error out on a key that is not in the file
+SELECT upsert_labels_from_file('agload_upsert', 'Person',
+                               'age_load/upsert_people.csv', 'phone');
+SELECT upsert_labels_from_file('agload_upsert', 'Person',
+                               'age_load/upsert_people.csv', NULL);
+
+SELECT drop_graph('agload_upsert', true);
+
+--
+-- Test graph export
+--
+\! mkdir -p /tmp/age/age_load/export /tmp/age/age_load/export_bin
+SELECT create_graph('agload_export');
+SELECT * FROM cypher('agload_export', $$
+    CREATE (a:Person {name: 'Alice', age: 30}),
+           (b:Person {name: 'Bob', note: 'says "hi", often', tags: ['x', 'y']}),
+           (c:City {name: 'Paris'}),
+           (a)-[:knows {since: 2020}]->(b),
+           (b)-[:lives_in]->(c)
+$$) AS (a agtype);
+
+SELECT label_name, row_count, column_names
+    FROM export_graph_to_files('agload_export', 'age_load/export');
+SELECT line FROM regexp_split_to_table(
+    rtrim(pg_read_file('/tmp/age/age_load/export/Person.csv'), E'\n'),
+    E'\n') AS line;
+SELECT line FROM regexp_split_to_table(
+    rtrim(pg_read_file('/tmp/age/age_load/export/knows.csv'), E'\n'),
+    E'\n') AS line;
+
+-- The CSV files load back with load_as_agtype
+SELECT load_labels_from_file('agload_export_copy', 'Person',
+                             'age_load/export/Person.csv', true, true);
+SELECT load_labels_from_file('agload_export_copy', 'City',
+                             'age_load/export/City.csv', true, true);
+SELECT load_edges_from_file('agload_export_copy', 'knows',
+                            'age_load/export/knows.csv', true);
+SELECT load_edges_from_file('agload_export_copy', 'lives_in',
+                            'age_load/export/lives_in.csv', true);
+SELECT * FROM cypher('agload_export_copy', $$
+    MATCH (n:Person) RETURN id(n), properties(n) ORDER BY id(n)
+$$) AS (id agtype, props agtype);
+SELECT * FROM cypher('agload_export_copy', $$
+    MATCH (a)-[e]->(b) RETURN a.name, type(e), properties(e), b.name
+    ORDER BY a.name
+$$) AS (a agtype, type agtype, props agtype, b agtype);
+
+-- The binary files load back with the binary loaders
+SELECT label_name, file_path, row_count
+    FROM export_graph_to_files('agload_export', 'age_load/export_bin',
+                               'binary', 2);
+SELECT load_labels_from_binary_file('agload_export_bin', 'Person',
+                                    'age_load/export_bin/Person.bin',
+                                    ARRAY['__id__', 'age', 'name', 'note',
+                                          'tags'],
+                                    ARRAY['bigint', 'agtype', 'agtype',
+                                          'agtype', 'agtype']::regtype[]);
+SELECT load_labels_from_binary_file('agload_export_bin', 'City',
+                                    'age_load/export_bin/City.bin',
+                                    ARRAY['__id__', 'name'],
+                                    ARRAY['bigint', 'agtype']::regtype[]);
+SELECT load_edges_from_binary_file('agload_export_bin', 'knows',
+                                   'age_load/export_bin/knows.bin',
+                                   ARRAY['start_id', 'start_vertex_type',
+                                         'end_id', 'end_vertex_type', 'since'],
+                                   ARRAY['bigint', 'text', 'bigint', 'text',
+                                         'agtype']::regtype[]);
+SELECT * FROM cypher('agload_export_bin', $$
+    MATCH (n:Person) RETURN id(n), properties(n) ORDER BY id(n)
+$$) AS (id agtype, props agtype);
+SELECT * FROM cypher('agload_export_bin', $$
+    MATCH (a)-[e:knows]->(b) RETURN a.name, b.name, properties(e)
+$$) AS (a agtype, b agtype, props agtype);
+
+-- Should error out
+SELECT * FROM export_graph_to_files('agload_export', 'age_load/export', 'xml');
+SELECT * FROM export_graph_to_files('agload_export', 'age_load/nowhere');
+SELECT * FROM export_graph_to_files('agload_export', '..');
+SELECT * FROM export_graph_to_files('agload_missing', 'age_load/export');
+
+SELECT drop_graph('agload_export', true);
+SELECT drop_graph('agload_export_copy', true);
+SELECT drop_graph('agload_export_bin', true);
+
 --
 -- Test property type conversion
 --
@@ -194,6 +516,18 @@ SELECT load_edges_from_file('agload_conversion', 'Edges1', '../../etc/passwd', t
 --
 SELECT drop_graph('agload_conversion', true);
 
+--
+-- Array and object values load as agtype containers
+--
+SELECT load_labels_from_file('agload_containers', 'Item', 'age_load/container_vertices.csv', true, true);
+SELECT create_elabel('agload_containers', 'Holds');
+SELECT load_edges_from_file('agload_containers', 'Holds', 'age_load/container_edges.csv', true);
+SELECT * FROM cypher('agload_containers', $$ MATCH (n:Item) RETURN properties(n) ORDER BY n.id $$) as (a agtype);
+SELECT * FROM cypher('agload_containers', $$ MATCH ()-[e:Holds]->() RETURN properties(e) $$) as (a agtype);
+-- the values are stored as containers, not as strings
+SELECT * FROM cypher('agload_containers', $$ MATCH (n:Item {id: 1}) RETURN n.list[2][0], n.map.k.n $$) as (a agtype, b agtype);
+SELECT drop_graph('agload_containers', true);
+
 --
 -- Issue 2449: mis-delimited / malformed load files must fail with a clear
 -- error instead of segfaulting or silently corrupting data. Edge files
@@ -487,6 +487,193 @@ $$) AS (person agtype, friend agtype);
 
 SELECT drop_graph('issue_2382', true);
 
+--
+-- VLE vertex constraint pushdown: all(n IN nodes(p) WHERE ...) predicates
+-- prune the traversal. The results must be the same as filtering afterwards.
+--
+SELECT create_graph('vle_pushdown');
+SELECT * FROM cypher('vle_pushdown', $$
+    CREATE (a:Node {name: 'a', active: true})-[:R]->
+           (b:Node {name: 'b', active: true})-[:R]->
+           (c:Node {name: 'c', active: false})-[:R]->
+           (d:Node {name: 'd', active: true}),
+           (a)-[:R]->(e:Node {name: 'e', active: true})-[:R]->(d),
+           (a)-[:R]->(o:Other {name: 'o', active: true})-[:R]->(d)
+$$) AS (v agtype);
+-- property constraint
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH p = (a:Node {name: 'a'})-[:R*1..3]->(x)
+    WHERE all(n IN nodes(p) WHERE n.active = true)
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+-- label constraint
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH p = (a:Node {name: 'a'})-[:R*1..3]->(x)
+    WHERE all(n IN nodes(p) WHERE label(n) = 'Node')
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+-- label and property constraint, along with other conjuncts
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH p = (a:Node {name: 'a'})-[:R*1..3]->(x)
+    WHERE x.name <> 'b' AND
+          all(n IN nodes(p) WHERE label(n) = 'Node' AND n.active = true)
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+-- a label that doesn't exist prunes everything
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH p = (a:Node {name: 'a'})-[:R*1..3]->(x)
+    WHERE all(n IN nodes(p) WHERE label(n) = 'Missing')
+    RETURN x.name
+$$) AS (name agtype);
+-- terminal vertex label
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node {name: 'a'})-[:R*1..3]->(x:Other)
+    RETURN x.name
+$$) AS (name agtype);
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node {name: 'a'})-[:R*1..3]->(x:Node)
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH ()-[:R*]->(x:Other)
+    RETURN count(*)
+$$) AS (count agtype);
+-- terminal vertex label with a vertex constraint
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH p = (a:Node {name: 'a'})-[:R*1..3]->(x:Node)
+    WHERE all(n IN nodes(p) WHERE n.active = true)
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+-- batched multi-source VLE
+SELECT count(*) FROM cypher('vle_pushdown', $$
+    MATCH (n:Node) WHERE n.name IN ['a', 'e'] RETURN collect(n)
+$$) AS (sources agtype),
+LATERAL ag_catalog.age_vle_multi('"vle_pushdown"', sources,
+                                 ag_catalog.age_build_vle_match_edge('"R"', NULL),
+                                 '1', '3', '"out"');
+SELECT count(*) FROM cypher('vle_pushdown', $$
+    MATCH (n:Node) WHERE n.name IN ['a', 'e'] RETURN collect(id(n))
+$$) AS (sources agtype),
+LATERAL ag_catalog.age_vle_multi('"vle_pushdown"', sources,
+                                 ag_catalog.age_build_vle_match_edge('"R"', NULL),
+                                 '0', '3', '"out"')
+GROUP BY source_id
+ORDER BY 1;
+-- count only aggregates over a VLE
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node {name: 'a'})-[:R*1..3]->(x)
+    RETURN count(*)
+$$) AS (count agtype);
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node {name: 'a'})-[:R*1..3]->(x)
+    RETURN count(DISTINCT x)
+$$) AS (count agtype);
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node)-[:R*1..2]-(x)
+    WHERE a.name = 'e'
+    RETURN count(*)
+$$) AS (count agtype);
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node)-[:R*1..2]-(x)
+    WHERE a.name = 'e'
+    RETURN count(DISTINCT x)
+$$) AS (count agtype);
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node)-[:R*0..1]->(x:Other)
+    RETURN count(*)
+$$) AS (count agtype);
+SELECT * FROM cypher('vle_pushdown', $$
+    MATCH (a:Node {name: 'missing'})-[:R*]->(x)
+    RETURN count(*)
+$$) AS (count agtype);
+SELECT drop_graph('vle_pushdown', true);
+-- the DAG check for counting only looks as far as the upper bound; the
+-- u, v cycle is out of reach of *1..2, but within *1..6, where the walk
+-- would repeat an edge
+SELECT create_graph('vle_count_cycle');
+SELECT * FROM cypher('vle_count_cycle', $$
+    CREATE (s:Node {name: 's'})-[:R]->(t:Node {name: 't'})-[:R]->
+           (u:Node {name: 'u'})-[:R]->(v:Node {name: 'v'}),
+           (v)-[:R]->(u)
+$$) AS (result agtype);
+SELECT * FROM cypher('vle_count_cycle', $$
+    MATCH (a:Node {name: 's'})-[:R*1..2]->(x)
+    RETURN count(*)
+$$) AS (count agtype);
+SELECT * FROM cypher('vle_count_cycle', $$
+    MATCH (a:Node {name: 's'})-[:R*1..6]->(x)
+    RETURN count(*)
+$$) AS (count agtype);
+SELECT * FROM cypher('vle_count_cycle', $$
+    MATCH (a:Node {name: 's'})-[:R*1..6]->(x)
+    RETURN count(DISTINCT x)
+$$) AS (count agtype);
+SELECT drop_graph('vle_count_cycle', true);
+
+--
+-- A cached VLE context reused after the graph cache was rebuilt must not
+-- keep edge state from the old graph cache.
+--
+SELECT create_graph('vle_rebuild');
+SELECT * FROM cypher('vle_rebuild', $$
+    CREATE (:N {name: 'a'})-[:R]->(:N {name: 'b'})-[:R]->(:N {name: 'c'})
+$$) AS (v agtype);
+PREPARE vle_rebuild_paths AS
+SELECT * FROM cypher('vle_rebuild', $$
+    MATCH p = (a:N {name: 'a'})-[:R*]->(x)
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+EXECUTE vle_rebuild_paths;
+SELECT * FROM cypher('vle_rebuild', $$
+    MATCH (c:N {name: 'c'})
+    CREATE (c)-[:R]->(:N {name: 'd'})-[:R]->(:N {name: 'e'})
+$$) AS (v agtype);
+-- another VLE rebuilds the graph cache
+SELECT * FROM cypher('vle_rebuild', $$
+    MATCH p = (b:N {name: 'b'})-[:R*]->(x)
+    RETURN count(*)
+$$) AS (count agtype);
+EXECUTE vle_rebuild_paths;
+DEALLOCATE vle_rebuild_paths;
+SELECT drop_graph('vle_rebuild', true);
+
+--
+-- A cached VLE context reused after the graph cache was rebuilt must not
+-- keep vertex constraint results for properties that have since changed.
+--
+SELECT create_graph('vle_pushdown_update');
+SELECT * FROM cypher('vle_pushdown_update', $$
+    CREATE (:Node {name: 'a', active: true})-[:R]->
+           (:Node {name: 'b', active: false})-[:R]->
+           (:Node {name: 'c', active: true})
+$$) AS (v agtype);
+PREPARE vle_pushdown_paths AS
+SELECT * FROM cypher('vle_pushdown_update', $$
+    MATCH p = (a:Node {name: 'a'})-[:R*]->(x)
+    WHERE all(n IN nodes(p) WHERE n.active = true)
+    RETURN x.name
+    ORDER BY x.name
+$$) AS (name agtype);
+EXECUTE vle_pushdown_paths;
+SELECT * FROM cypher('vle_pushdown_update', $$
+    MATCH (b:Node {name: 'b'})
+    SET b.active = true
+$$) AS (v agtype);
+-- another VLE rebuilds the graph cache
+SELECT * FROM cypher('vle_pushdown_update', $$
+    MATCH p = (b:Node {name: 'b'})-[:R*]->(x)
+    RETURN count(*)
+$$) AS (count agtype);
+EXECUTE vle_pushdown_paths;
+DEALLOCATE vle_pushdown_paths;
+SELECT drop_graph('vle_pushdown_update', true);
+
 --
 -- End
 --
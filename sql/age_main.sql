@@ -162,13 +162,28 @@ CREATE FUNCTION ag_catalog.drop_label(graph_name name, label_name name,
 --
 -- If `load_as_agtype` is true, property values are loaded as agtype; otherwise
 -- loaded as string.
+-- `parallel_workers` greater than 0 parses the file with that many parallel
+-- workers. The rows are still inserted by the calling backend alone, so the
+-- workers help most when parsing, such as of agtype values, is the cost.
+-- If `deferred_indexes` is true, the label's indexes are not maintained during
+-- the load but rebuilt after it, which checks uniqueness then. The rebuild
+-- covers the whole table and locks its indexes until the end of the
+-- transaction, so it is meant for initial and other large loads.
+-- With `key_property`, the start_id and end_id of an edge file are values of
+-- that property of the endpoint vertices (such as a UUID or an email) instead
+-- of entry ids.
+-- `endpoint_validation` checks that the start and end vertices of each edge
+-- exist: 'error' fails the load on a missing one, 'skip' leaves such edges
+-- out and reports how many, and 'none' does not check.
 --
 CREATE FUNCTION ag_catalog.load_labels_from_file(graph_name name,
                                                  label_name name,
                                                  file_path text,
                                                  id_field_exists bool default true,
                                                  load_as_agtype bool default false,
-                                                 delimiter text default ',')
+                                                 delimiter text default ',',
+                                                 parallel_workers int default 0,
+                                                 deferred_indexes bool default false)
     RETURNS void
     LANGUAGE c
     AS 'MODULE_PATHNAME';
@@ -177,11 +192,99 @@ CREATE FUNCTION ag_catalog.load_edges_from_file(graph_name name,
                                                 label_name name,
                                                 file_path text,
                                                 load_as_agtype bool default false,
-                                                delimiter text default ',')
+                                                delimiter text default ',',
+                                                parallel_workers int default 0,
+                                                deferred_indexes bool default false,
+                                                key_property text default NULL,
+                                                endpoint_validation text default 'none')
     RETURNS void
     LANGUAGE c
     AS 'MODULE_PATHNAME';
 
+--
+-- The stdin variants take the CSV data from the client over the COPY
+-- protocol, as COPY ... FROM STDIN does, so no file on the server is needed.
+--
+CREATE FUNCTION ag_catalog.load_labels_from_stdin(graph_name name,
+                                                  label_name name,
+                                                  id_field_exists bool default true,
+                                                  load_as_agtype bool default false,
+                                                  delimiter text default ',',
+                                                  deferred_indexes bool default false)
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+CREATE FUNCTION ag_catalog.load_edges_from_stdin(graph_name name,
+                                                 label_name name,
+                                                 load_as_agtype bool default false,
+                                                 delimiter text default ',',
+                                                 deferred_indexes bool default false,
+                                                 key_property text default NULL,
+                                                 endpoint_validation text default 'none')
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+--
+-- upsert_labels_from_file matches the rows of a vertex CSV file, which has no
+-- id column, to the label's vertices by `key_property`. Rows with a new key
+-- are inserted; the others update the matching vertex's properties.
+--
+CREATE FUNCTION ag_catalog.upsert_labels_from_file(graph_name name,
+                                                   label_name name,
+                                                   file_path text,
+                                                   key_property text,
+                                                   load_as_agtype bool default false,
+                                                   delimiter text default ',')
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+--
+-- Binary COPY input for the loaders. The file is in PostgreSQL's binary COPY
+-- format and has the extension .bin; column_names and column_types describe
+-- its columns, which become properties. Edge files start with start_id,
+-- start_vertex_type, end_id and end_vertex_type, as edge CSV files do.
+--
+CREATE FUNCTION ag_catalog.load_labels_from_binary_file(graph_name name,
+                                                        label_name name,
+                                                        file_path text,
+                                                        column_names text[],
+                                                        column_types regtype[],
+                                                        id_field_exists bool default true)
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+CREATE FUNCTION ag_catalog.load_edges_from_binary_file(graph_name name,
+                                                       label_name name,
+                                                       file_path text,
+                                                       column_names text[],
+                                                       column_types regtype[])
+    RETURNS void
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
+--
+-- export_graph_to_files writes each label of a graph to <label>.csv or
+-- <label>.bin in a directory under /tmp/age/, in the layout the loaders read,
+-- and returns the file, the number of rows and the columns of each label.
+-- CSV values are agtype text, to be loaded with load_as_agtype; binary files
+-- have bigint ids, text label names and agtype values. With parallel_workers,
+-- the labels are exported by the workers as well as the leader, and labels of
+-- more than 8192 blocks are split into parts of that many blocks, written to
+-- <label>.<n>.csv (or .bin) with a row each.
+--
+CREATE FUNCTION ag_catalog.export_graph_to_files(graph_name name,
+                                                 directory text,
+                                                 format text default 'csv',
+                                                 parallel_workers int default 0)
+    RETURNS TABLE (label_name name, file_path text, row_count bigint,
+                   column_names text[])
+    LANGUAGE c
+    AS 'MODULE_PATHNAME';
+
 --
 -- graphid type
 --
@@ -98,6 +98,76 @@ CALLED ON NULL INPUT
 PARALLEL UNSAFE -- might be safe
 AS 'MODULE_PATHNAME';
 
+-- This overload adds the vertex prototype that the transform pushes down from
+-- an all(x IN nodes(p) WHERE ...) predicate, for pruning during traversal.
+CREATE FUNCTION ag_catalog.age_vle(IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype,
+                                   OUT edges    agtype,
+                                   OUT start_id graphid,
+                                   OUT end_id   graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE -- might be safe
+AS 'MODULE_PATHNAME';
+
+-- This overload adds the terminal vertex label, so that only paths ending on
+-- a vertex with that label are emitted.
+CREATE FUNCTION ag_catalog.age_vle(IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype, IN agtype, IN agtype, IN agtype,
+                                   IN agtype, IN agtype,
+                                   OUT edges    agtype,
+                                   OUT start_id graphid,
+                                   OUT end_id   graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE -- might be safe
+AS 'MODULE_PATHNAME';
+
+-- Batched VLE paths-from search over an array of start vertices (or ids).
+--   (graph_name, sources, edge_prototype, lower_bound, upper_bound, direction)
+-- Each row carries the source the path was found from.
+CREATE FUNCTION ag_catalog.age_vle_multi(IN agtype, IN agtype, IN agtype,
+                                         IN agtype, IN agtype, IN agtype,
+                                         OUT source_id graphid,
+                                         OUT edges     agtype,
+                                         OUT end_id    graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The number of paths, and the distinct end vertex ids, that age_vle would
+-- emit from a start vertex, without building the paths. The transform routes
+-- count(*) and count(DISTINCT end) over a VLE to these.
+--   (graph_name, start, edge_prototype, lower_bound, upper_bound, direction,
+--    terminal_label)
+CREATE FUNCTION ag_catalog.age_vle_count(IN agtype, IN agtype, IN agtype,
+                                         IN agtype, IN agtype, IN agtype,
+                                         IN agtype)
+    RETURNS agtype
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+CREATE FUNCTION ag_catalog.age_vle_reachable(IN agtype, IN agtype, IN agtype,
+                                             IN agtype, IN agtype, IN agtype,
+                                             IN agtype)
+    RETURNS agtype
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
 -- Unweighted (hop-count) shortest path between two vertices, computed over the
 -- cached global graph adjacency via BFS. Returns a single path (0 or 1 rows).
 -- Argument order mirrors the Cypher shortestPath() pattern
@@ -129,6 +199,162 @@ CALLED ON NULL INPUT
 PARALLEL UNSAFE
 AS 'MODULE_PATHNAME';
 
+-- PageRank of every vertex over the cached graph, optionally following only
+-- the given relationship type(s): graph, edge_types, damping, iterations,
+-- tolerance.
+CREATE FUNCTION ag_catalog.age_pagerank(IN agtype,
+                                        IN agtype DEFAULT NULL,
+                                        IN agtype DEFAULT NULL,
+                                        IN agtype DEFAULT NULL,
+                                        IN agtype DEFAULT NULL,
+                                        OUT vertex_id graphid,
+                                        OUT score     float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The weakly connected component of every vertex over the cached graph,
+-- identified by its smallest vertex id: graph, edge_types.
+CREATE FUNCTION ag_catalog.age_wcc(IN agtype,
+                                   IN agtype DEFAULT NULL,
+                                   OUT vertex_id    graphid,
+                                   OUT component_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The strongly connected component of every vertex over the cached graph,
+-- identified by its smallest vertex id: graph, edge_types.
+CREATE FUNCTION ag_catalog.age_scc(IN agtype,
+                                   IN agtype DEFAULT NULL,
+                                   OUT vertex_id    graphid,
+                                   OUT component_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The number of triangles through every vertex over the cached graph,
+-- ignoring edge direction: graph, edge_types.
+CREATE FUNCTION ag_catalog.age_triangle_count(IN agtype,
+                                              IN agtype DEFAULT NULL,
+                                              OUT vertex_id graphid,
+                                              OUT triangles bigint)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The local clustering coefficient of every vertex over the cached graph,
+-- ignoring edge direction: graph, edge_types.
+CREATE FUNCTION ag_catalog.age_local_clustering(IN agtype,
+                                                IN agtype DEFAULT NULL,
+                                                OUT vertex_id   graphid,
+                                                OUT coefficient float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The Louvain community of every vertex over the cached graph, ignoring
+-- edge direction: graph, edge_types, weight_property, max_levels.
+CREATE FUNCTION ag_catalog.age_louvain(IN agtype,
+                                       IN agtype DEFAULT NULL,
+                                       IN agtype DEFAULT NULL,
+                                       IN agtype DEFAULT NULL,
+                                       OUT vertex_id    graphid,
+                                       OUT community_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The betweenness centrality of every vertex over the cached graph, exact
+-- or estimated from a sample of sources: graph, edge_types, sample_size.
+CREATE FUNCTION ag_catalog.age_betweenness(IN agtype,
+                                           IN agtype DEFAULT NULL,
+                                           IN agtype DEFAULT NULL,
+                                           OUT vertex_id graphid,
+                                           OUT score     float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The label propagation community of every vertex over the cached graph,
+-- ignoring edge direction: graph, edge_types, max_iterations.
+CREATE FUNCTION ag_catalog.age_label_propagation(IN agtype,
+                                                 IN agtype DEFAULT NULL,
+                                                 IN agtype DEFAULT NULL,
+                                                 OUT vertex_id    graphid,
+                                                 OUT community_id graphid)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- The top_k most similar vertices of every vertex over the cached graph, by
+-- shared out neighbors: graph, edge_types, top_k, metric.
+CREATE FUNCTION ag_catalog.age_node_similarity(IN agtype,
+                                               IN agtype DEFAULT NULL,
+                                               IN agtype DEFAULT NULL,
+                                               IN agtype DEFAULT NULL,
+                                               OUT vertex_id  graphid,
+                                               OUT other_id   graphid,
+                                               OUT similarity float8)
+    RETURNS SETOF record
+LANGUAGE C
+STABLE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- Random walks over the cached graph, as arrays of vertex ids: graph,
+-- start_vertices, walk_length, walks_per_node, p, q, seed.
+CREATE FUNCTION ag_catalog.age_random_walks(IN agtype,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL,
+                                            IN agtype DEFAULT NULL)
+    RETURNS SETOF graphid[]
+LANGUAGE C
+VOLATILE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
+-- bulk write back of per vertex results, e.g. from the algorithms above
+CREATE FUNCTION ag_catalog.age_write_vertex_property(graph_name name,
+                                                     property_name text,
+                                                     vertex_ids graphid[],
+                                                     property_values agtype[])
+    RETURNS bigint
+LANGUAGE C
+VOLATILE
+CALLED ON NULL INPUT
+PARALLEL UNSAFE
+AS 'MODULE_PATHNAME';
+
 -- function to build an edge for a VLE match
 CREATE FUNCTION ag_catalog.age_build_vle_match_edge(agtype, agtype)
     RETURNS agtype
@@ -137,6 +363,14 @@ CREATE FUNCTION ag_catalog.age_build_vle_match_edge(agtype, agtype)
 PARALLEL SAFE
 AS 'MODULE_PATHNAME';
 
+-- function to build a vertex for a VLE match
+CREATE FUNCTION ag_catalog.age_build_vle_match_vertex(agtype, agtype)
+    RETURNS agtype
+    LANGUAGE C
+    IMMUTABLE
+PARALLEL SAFE
+AS 'MODULE_PATHNAME';
+
 -- function to create an AGTV_PATH from a VLE_path_container
 CREATE FUNCTION ag_catalog.age_materialize_vle_path(agtype)
     RETURNS agtype
@@ -222,6 +456,13 @@ CREATE FUNCTION ag_catalog.age_graph_stats(agtype)
 PARALLEL SAFE
 AS 'MODULE_PATHNAME';
 
+CREATE FUNCTION ag_catalog.age_graph_profile(agtype)
+    RETURNS agtype
+    LANGUAGE c
+    STABLE
+PARALLEL SAFE
+AS 'MODULE_PATHNAME';
+
 CREATE FUNCTION ag_catalog.age_delete_global_graphs(agtype)
     RETURNS boolean
     LANGUAGE c
@@ -191,6 +191,590 @@ static bool is_zero_lower_bound_vle(Node *varlen)
     return lidx->val.ival.ival == 0;
 }
 
+/*
+ * VLE vertex constraint pushdown.
+ *
+ * A WHERE clause conjunct of the form
+ *
+ *     all(x IN nodes(p) WHERE x.key = <literal> AND label(x) = 'L' ...)
+ *
+ * constrains every vertex of the path p. When p contains a VLE, each vertex
+ * the VLE reaches through an edge is one of those vertices, so a vertex that
+ * fails the constraint can be pruned from the traversal instead of being
+ * expanded and filtered afterwards. The constraint is passed to age_vle as a
+ * vertex prototype built by age_build_vle_match_vertex. The WHERE clause is
+ * left untouched, so this is purely an optimization.
+ *
+ * Only string and boolean literals are pushed down. Their agtype equality
+ * and containment semantics agree, which isn't the case for numerics (an
+ * integer property equals a float literal but isn't contained by it).
+ */
+#define VLE_VERTEX_MATCH_ARG_INDEX 7
+
+static Node *unwrap_predicate_function(Node *node)
+{
+    if (node == NULL)
+        return NULL;
+
+    /* strip the NULL-list guard, CASE WHEN list IS NULL THEN NULL ELSE ... */
+    if (IsA(node, CaseExpr))
+    {
+        CaseExpr *guard = (CaseExpr *) node;
+
+        if (guard->arg != NULL || list_length(guard->args) != 1)
+            return NULL;
+        node = (Node *) guard->defresult;
+    }
+
+    /* strip the boolean to agtype conversion */
+    if (node != NULL && IsA(node, FuncCall))
+    {
+        FuncCall *fc = (FuncCall *) node;
+
+        if (list_length(fc->args) != 1)
+            return NULL;
+        node = linitial(fc->args);
+    }
+
+    if (node == NULL || !IsA(node, SubLink))
+        return NULL;
+
+    node = ((SubLink *) node)->subselect;
+    if (!is_ag_node(node, cypher_predicate_function))
+        return NULL;
+
+    return node;
+}
+
+static bool is_column_ref_to(Node *node, char *name)
+{
+    ColumnRef *cref;
+
+    if (node == NULL || !IsA(node, ColumnRef))
+        return false;
+
+    cref = (ColumnRef *) node;
+    if (list_length(cref->fields) != 1 ||
+        !IsA(linitial(cref->fields), String))
+        return false;
+
+    return strcmp(strVal(linitial(cref->fields)), name) == 0;
+}
+
+static bool is_pushable_vertex_literal(Node *node)
+{
+    A_Const *ac;
+
+    if (node == NULL || !IsA(node, A_Const))
+        return false;
+
+    ac = (A_Const *) node;
+    if (ac->isnull)
+        return false;
+
+    return (ac->val.node.type == T_String || ac->val.node.type == T_Boolean);
+}
+
+/*
+ * Collect the label and property equalities from the predicate of an
+ * all(x IN nodes(path_name) WHERE ...) function. Conjuncts that can't be
+ * pushed down are skipped; they are still enforced by the WHERE clause.
+ */
+static void collect_vle_vertex_constraint(cypher_predicate_function *pf,
+                                          char *path_name, char **label,
+                                          List **keyvals)
+{
+    FuncCall *list_fc;
+    List *conjuncts;
+    ListCell *lc;
+
+    if (pf->kind != CPFK_ALL || pf->varname == NULL ||
+        pf->expr == NULL || !IsA(pf->expr, FuncCall))
+        return;
+
+    /* the list must be nodes(path_name) */
+    list_fc = (FuncCall *) pf->expr;
+    if (list_length(list_fc->funcname) != 1 ||
+        strcasecmp(strVal(linitial(list_fc->funcname)), "nodes") != 0 ||
+        list_length(list_fc->args) != 1 ||
+        !is_column_ref_to(linitial(list_fc->args), path_name))
+        return;
+
+    if (pf->where != NULL && IsA(pf->where, BoolExpr) &&
+        ((BoolExpr *) pf->where)->boolop == AND_EXPR)
+        conjuncts = ((BoolExpr *) pf->where)->args;
+    else
+        conjuncts = list_make1(pf->where);
+
+    foreach (lc, conjuncts)
+    {
+        cypher_comparison_aexpr *cmp;
+        Node *lexpr;
+
+        if (!is_ag_node(lfirst(lc), cypher_comparison_aexpr))
+            continue;
+
+        cmp = (cypher_comparison_aexpr *) lfirst(lc);
+        if (cmp->kind != AEXPR_OP || list_length(cmp->name) != 1 ||
+            strcmp(strVal(linitial(cmp->name)), "=") != 0 ||
+            !is_pushable_vertex_literal(cmp->rexpr))
+            continue;
+
+        lexpr = cmp->lexpr;
+
+        /* x.key = literal */
+        if (IsA(lexpr, A_Indirection))
+        {
+            A_Indirection *indir = (A_Indirection *) lexpr;
+            char *key;
+            ListCell *lc2;
+            bool duplicate = false;
+
+            if (!is_column_ref_to(indir->arg, pf->varname) ||
+                list_length(indir->indirection) != 1 ||
+                !IsA(linitial(indir->indirection), String))
+                continue;
+
+            key = strVal(linitial(indir->indirection));
+
+            /* the first equality on a key wins */
+            for (lc2 = list_head(*keyvals); lc2 != NULL;
+                 lc2 = lnext(*keyvals, lnext(*keyvals, lc2)))
+            {
+                if (strcmp(strVal(lfirst(lc2)), key) == 0)
+                {
+                    duplicate = true;
+                    break;
+                }
+            }
+
+            if (!duplicate)
+            {
+                *keyvals = lappend(*keyvals, makeString(key));
+                *keyvals = lappend(*keyvals, cmp->rexpr);
+            }
+        }
+        /* label(x) = 'L' */
+        else if (IsA(lexpr, FuncCall))
+        {
+            FuncCall *fc = (FuncCall *) lexpr;
+            A_Const *ac = (A_Const *) cmp->rexpr;
+
+            if (list_length(fc->funcname) != 1 ||
+                strcasecmp(strVal(linitial(fc->funcname)), "label") != 0 ||
+                list_length(fc->args) != 1 ||
+                !is_column_ref_to(linitial(fc->args), pf->varname) ||
+                ac->val.node.type != T_String)
+                continue;
+
+            /* the first label equality wins */
+            if (*label == NULL)
+                *label = ac->val.sval.sval;
+        }
+    }
+}
+
+/*
+ * Find pushable all(x IN nodes(p) WHERE ...) predicates in the MATCH clause's
+ * WHERE and attach the resulting vertex prototype to every VLE in path p.
+ */
+static void push_vle_vertex_constraints(cypher_match *match)
+{
+    List *conjuncts;
+    ListCell *lc;
+
+    if (match->where == NULL)
+        return;
+
+    if (IsA(match->where, BoolExpr) &&
+        ((BoolExpr *) match->where)->boolop == AND_EXPR)
+        conjuncts = ((BoolExpr *) match->where)->args;
+    else
+        conjuncts = list_make1(match->where);
+
+    foreach (lc, match->pattern)
+    {
+        cypher_path *path = (cypher_path *) lfirst(lc);
+        char *label = NULL;
+        List *keyvals = NIL;
+        ListCell *lc2;
+        FuncCall *proto;
+        List *proto_args;
+
+        if (path->var_name == NULL)
+            continue;
+
+        foreach (lc2, conjuncts)
+        {
+            Node *pf = unwrap_predicate_function(lfirst(lc2));
+
+            if (pf != NULL)
+                collect_vle_vertex_constraint((cypher_predicate_function *) pf,
+                                              path->var_name, &label,
+                                              &keyvals);
+        }
+
+        if (label == NULL && keyvals == NIL)
+            continue;
+
+        /* age_build_vle_match_vertex(label, properties) */
+        if (label == NULL)
+        {
+            A_Const *n = makeNode(A_Const);
+
+            n->isnull = true;
+            n->location = -1;
+            proto_args = list_make1(n);
+        }
+        else
+        {
+            A_Const *n = makeNode(A_Const);
+
+            n->val.sval.type = T_String;
+            n->val.sval.sval = label;
+            n->location = -1;
+            proto_args = list_make1(n);
+        }
+
+        if (keyvals == NIL)
+        {
+            A_Const *n = makeNode(A_Const);
+
+            n->isnull = true;
+            n->location = -1;
+            proto_args = lappend(proto_args, n);
+        }
+        else
+        {
+            cypher_map *map = make_ag_node(cypher_map);
+
+            map->keyvals = keyvals;
+            map->keep_null = false;
+            map->location = -1;
+            proto_args = lappend(proto_args, map);
+        }
+
+        proto = makeFuncCall(list_make2(makeString("ag_catalog"),
+                                        makeString("age_build_vle_match_vertex")),
+                             proto_args, COERCE_EXPLICIT_CALL, -1);
+
+        /*
+         * Attach it to each VLE in the path. The raw node can be shared, the
+         * expression transform doesn't modify the parse tree in place.
+         */
+        foreach (lc2, path->path)
+        {
+            cypher_relationship *rel;
+            FuncCall *vle;
+
+            if (!is_ag_node(lfirst(lc2), cypher_relationship))
+                continue;
+
+            rel = (cypher_relationship *) lfirst(lc2);
+            if (rel->varlen == NULL || !IsA(rel->varlen, FuncCall))
+                continue;
+
+            vle = (FuncCall *) rel->varlen;
+            if (list_length(vle->funcname) != 1 ||
+                strcmp(strVal(linitial(vle->funcname)), "vle") != 0)
+                continue;
+
+            /* args = {start, end, edge_match, lidx, uidx, dir, uniq, ...} */
+            if (list_length(vle->args) == VLE_VERTEX_MATCH_ARG_INDEX)
+            {
+                vle->args = lappend(vle->args, proto);
+            }
+            else if (list_length(vle->args) > VLE_VERTEX_MATCH_ARG_INDEX)
+            {
+                lfirst(list_nth_cell(vle->args,
+                                     VLE_VERTEX_MATCH_ARG_INDEX)) = proto;
+            }
+        }
+    }
+}
+
+/*
+ * VLE path counting.
+ *
+ *     MATCH (a)-[:R*1..6]->(b) WHERE <only a> RETURN count(*)
+ *     MATCH (a)-[:R*1..6]->(b) WHERE <only a> RETURN count(DISTINCT b)
+ *
+ * only need the number of paths from each a, or the vertices they end on,
+ * so there is no need to build and join every path. The first is rewritten
+ * to
+ *
+ *     MATCH (a) WHERE <only a> RETURN coalesce(sum(vle_count(a.id, ...)), 0)
+ *
+ * and the second to
+ *
+ *     MATCH (a) WHERE <only a> UNWIND vle_reachable(a.id, ...) AS b
+ *     RETURN count(DISTINCT b)
+ *
+ * where vle_count and vle_reachable take the same arguments as the VLE. The
+ * rewrite only applies when nothing else can observe the path, its edges, or
+ * b: the MATCH is the only clause before the RETURN, has the single path
+ * (a)-[*]->(b) without a path or edge variable, b has no properties, and the
+ * RETURN is just the aggregate.
+ */
+#define VLE_DIRECTION_ARG_INDEX 5
+
+/*
+ * Check that an expression only references the variable name. Unknown nodes
+ * are treated as referencing something else.
+ */
+static bool expr_only_references(Node *node, char *name)
+{
+    ListCell *lc;
+
+    if (node == NULL)
+        return true;
+
+    switch (nodeTag(node))
+    {
+        case T_A_Const:
+        case T_ParamRef:
+            return true;
+        case T_ColumnRef:
+        {
+            ColumnRef *cref = (ColumnRef *) node;
+
+            return (IsA(linitial(cref->fields), String) &&
+                    strcmp(strVal(linitial(cref->fields)), name) == 0);
+        }
+        case T_A_Indirection:
+            return expr_only_references(((A_Indirection *) node)->arg, name);
+        case T_A_Expr:
+            return (expr_only_references(((A_Expr *) node)->lexpr, name) &&
+                    expr_only_references(((A_Expr *) node)->rexpr, name));
+        case T_NullTest:
+            return expr_only_references((Node *) ((NullTest *) node)->arg,
+                                        name);
+        case T_BoolExpr:
+            foreach (lc, ((BoolExpr *) node)->args)
+            {
+                if (!expr_only_references(lfirst(lc), name))
+                    return false;
+            }
+            return true;
+        case T_FuncCall:
+        {
+            FuncCall *fc = (FuncCall *) node;
+
+            if (fc->agg_star || fc->agg_distinct || fc->over != NULL ||
+                fc->agg_filter != NULL || fc->agg_order != NIL)
+                return false;
+
+            foreach (lc, fc->args)
+            {
+                if (!expr_only_references(lfirst(lc), name))
+                    return false;
+            }
+            return true;
+        }
+        case T_ExtensibleNode:
+            break;
+        default:
+            return false;
+    }
+
+    if (is_ag_node(node, cypher_bool_const) ||
+        is_ag_node(node, cypher_integer_const) ||
+        is_ag_node(node, cypher_param))
+        return true;
+
+    if (is_ag_node(node, cypher_comparison_aexpr))
+    {
+        cypher_comparison_aexpr *a = (cypher_comparison_aexpr *) node;
+
+        return (expr_only_references(a->lexpr, name) &&
+                expr_only_references(a->rexpr, name));
+    }
+
+    if (is_ag_node(node, cypher_comparison_boolexpr))
+    {
+        foreach (lc, ((cypher_comparison_boolexpr *) node)->args)
+        {
+            if (!expr_only_references(lfirst(lc), name))
+                return false;
+        }
+        return true;
+    }
+
+    if (is_ag_node(node, cypher_string_match))
+    {
+        cypher_string_match *sm = (cypher_string_match *) node;
+
+        return (expr_only_references(sm->lhs, name) &&
+                expr_only_references(sm->rhs, name));
+    }
+
+    if (is_ag_node(node, cypher_list))
+    {
+        foreach (lc, ((cypher_list *) node)->elems)
+        {
+            if (!expr_only_references(lfirst(lc), name))
+                return false;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/* is the node count(*), or count([DISTINCT] name) */
+static bool is_count_of(Node *node, char *name, bool *distinct)
+{
+    FuncCall *fc;
+
+    if (node == NULL || !IsA(node, FuncCall))
+        return false;
+
+    fc = (FuncCall *) node;
+    if (list_length(fc->funcname) != 1 ||
+        strcasecmp(strVal(linitial(fc->funcname)), "count") != 0 ||
+        fc->over != NULL || fc->agg_filter != NULL || fc->agg_order != NIL)
+        return false;
+
+    if (fc->agg_star)
+    {
+        *distinct = false;
+        return true;
+    }
+
+    if (name == NULL || list_length(fc->args) != 1 ||
+        !is_column_ref_to(linitial(fc->args), name))
+        return false;
+
+    *distinct = fc->agg_distinct;
+    return true;
+}
+
+static void rewrite_vle_count_aggregate(cypher_clause *clause)
+{
+    cypher_return *self = (cypher_return *) clause->self;
+    cypher_match *match;
+    cypher_path *path;
+    cypher_node *cnl;
+    cypher_relationship *rel;
+    cypher_node *cnr;
+    FuncCall *vle;
+    ResTarget *item;
+    FuncCall *counter;
+    List *args;
+    A_Const *label;
+    bool distinct = false;
+
+    if (clause->prev == NULL || clause->prev->prev != NULL ||
+        !is_ag_node(clause->prev->self, cypher_match))
+        return;
+
+    if (self->distinct || self->order_by != NIL || self->skip != NULL ||
+        self->limit != NULL || list_length(self->items) != 1)
+        return;
+
+    match = (cypher_match *) clause->prev->self;
+    if (match->optional || list_length(match->pattern) != 1)
+        return;
+
+    path = (cypher_path *) linitial(match->pattern);
+    if (path->var_name != NULL || list_length(path->path) != 3)
+        return;
+
+    cnl = (cypher_node *) linitial(path->path);
+    rel = (cypher_relationship *) lsecond(path->path);
+    cnr = (cypher_node *) lthird(path->path);
+
+    if (rel->name != NULL || rel->varlen == NULL ||
+        !IsA(rel->varlen, FuncCall) || cnr->props != NULL ||
+        cnl->name == NULL ||
+        (cnr->name != NULL && strcmp(cnl->name, cnr->name) == 0))
+        return;
+
+    vle = (FuncCall *) rel->varlen;
+    if (list_length(vle->funcname) != 1 ||
+        strcmp(strVal(linitial(vle->funcname)), "vle") != 0 ||
+        list_length(vle->args) <= VLE_DIRECTION_ARG_INDEX ||
+        !IsA(linitial(vle->args), ColumnRef))
+        return;
+
+    item = (ResTarget *) linitial(self->items);
+    if (!is_count_of(item->val, cnr->name, &distinct))
+        return;
+
+    /* the WHERE can't look at anything but the start vertex */
+    if (!expr_only_references(match->where, cnl->name))
+        return;
+
+    /* start, edge_match, lidx, uidx, dir, terminal label */
+    label = makeNode(A_Const);
+    label->location = -1;
+    if (cnr->label == NULL)
+    {
+        label->isnull = true;
+    }
+    else
+    {
+        label->val.sval.type = T_String;
+        label->val.sval.sval = cnr->label;
+    }
+    args = list_make5(linitial(vle->args), lthird(vle->args),
+                      list_nth(vle->args, 3), list_nth(vle->args, 4),
+                      list_nth(vle->args, VLE_DIRECTION_ARG_INDEX));
+    args = lappend(args, label);
+
+    /* the MATCH only needs to produce the start vertices now */
+    path->path = list_make1(cnl);
+
+    if (!distinct)
+    {
+        CoalesceExpr *coalesce;
+        A_Const *zero;
+
+        counter = makeFuncCall(list_make1(makeString("vle_count")), args,
+                               COERCE_EXPLICIT_CALL, -1);
+
+        zero = makeNode(A_Const);
+        zero->val.ival.type = T_Integer;
+        zero->val.ival.ival = 0;
+        zero->location = -1;
+
+        /* sum is NULL over no start vertices, where count(*) is 0 */
+        coalesce = makeNode(CoalesceExpr);
+        coalesce->args = list_make2(makeFuncCall(list_make1(makeString("sum")),
+                                                 list_make1(counter),
+                                                 COERCE_EXPLICIT_CALL, -1),
+                                    zero);
+        coalesce->location = -1;
+
+        item->val = (Node *) coalesce;
+    }
+    else
+    {
+        cypher_unwind *unwind;
+        ResTarget *target;
+        cypher_clause *unwind_clause;
+
+        counter = makeFuncCall(list_make1(makeString("vle_reachable")), args,
+                               COERCE_EXPLICIT_CALL, -1);
+
+        target = makeNode(ResTarget);
+        target->name = cnr->name;
+        target->val = (Node *) counter;
+        target->location = -1;
+
+        unwind = make_ag_node(cypher_unwind);
+        unwind->target = target;
+
+        /* MATCH -> UNWIND -> RETURN */
+        unwind_clause = palloc(sizeof(cypher_clause));
+        unwind_clause->self = (Node *) unwind;
+        unwind_clause->prev = clause->prev;
+        unwind_clause->next = clause;
+        clause->prev->next = unwind_clause;
+        clause->prev = unwind_clause;
+    }
+}
+
 static bool match_check_valid_label(cypher_match *match,
                                     cypher_parsestate *cpstate);
 static Node *make_vertex_expr(cypher_parsestate *cpstate,
@@ -3511,6 +4095,9 @@ static Query *transform_cypher_return(cypher_parsestate *cpstate,
     query = makeNode(Query);
     query->commandType = CMD_SELECT;
 
+    /* count only aggregates over a VLE don't need the paths */
+    rewrite_vle_count_aggregate(clause);
+
     if (clause->prev)
     {
         transform_prev_cypher_clause(cpstate, clause->prev, true);
@@ -3836,6 +4423,8 @@ static Query *transform_cypher_match(cypher_parsestate *cpstate,
     cypher_match *match_self = (cypher_match*) clause->self;
     Node *where = match_self->where;
 
+    /* prune VLE traversals using all(x IN nodes(p) WHERE ...) predicates */
+    push_vle_vertex_constraints(match_self);
 
     /*
      * Check label validity early unless the predecessor clause chain
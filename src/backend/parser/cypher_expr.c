@@ -2267,7 +2267,8 @@ static Node *transform_FuncCall(cypher_parsestate *cpstate, FuncCall *fn)
             /*
              * Currently these functions need the graph name passed in as the
              * first argument - in addition to the other arguments: startNode,
-             * endNode, vle, vertex_stats, shortest_path, and all_shortest_paths.
+             * endNode, vle, vle_count, vle_reachable, vertex_stats,
+             * shortest_path, and all_shortest_paths.
              * So, check for those functions here and that the arg list is not
              * empty. Then prepend the graph name if necessary.
              */
@@ -2275,6 +2276,8 @@ static Node *transform_FuncCall(cypher_parsestate *cpstate, FuncCall *fn)
                 (strcasecmp("startNode", name) == 0 ||
                  strcasecmp("endNode", name) == 0 ||
                  strcasecmp("vle", name) == 0 ||
+                 strcasecmp("vle_count", name) == 0 ||
+                 strcasecmp("vle_reachable", name) == 0 ||
                  strcasecmp("vertex_stats", name) == 0 ||
                  strcasecmp("shortest_path", name) == 0 ||
                  strcasecmp("all_shortest_paths", name) == 0))
@@ -3442,6 +3442,17 @@ static cypher_relationship *build_VLE_relation(List *left_arg,
     /* add in the unique number used to identify this VLE node */
     args = lappend(args, make_int_const(unique_number, -1));
 
+    /*
+     * If the terminal vertex has a label, pass it in so that age_vle only
+     * emits paths ending on a vertex with that label. The slot before it is
+     * for the vertex prototype the transform may push down.
+     */
+    if (cnr->label != NULL)
+    {
+        args = lappend(args, make_null_const(-1));
+        args = lappend(args, make_string_const(cnr->label, -1));
+    }
+
     /* build the VLE function node */
     cr->varlen = make_function_expr(list_make1(makeString("vle")), args,
                                     cr_location);
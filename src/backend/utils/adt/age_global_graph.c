@@ -25,6 +25,7 @@
 #include "common/hashfn.h"
 #include "commands/label_commands.h"
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "storage/lwlock.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
@@ -50,6 +51,8 @@
 #define VERTEX_HTAB_NAME "Vertex to edge lists " /* added a space at end for */
 #define VERTEX_HTAB_INITIAL_SIZE 10000
 #define EDGE_HTAB_INITIAL_SIZE 10000
+/* maximum number of shared edge match memos per GRAPH global context */
+#define MAX_EDGE_MATCH_MEMOS 16
 
 /* Maximum number of graphs tracked for version counting */
 #define AGE_MAX_GRAPHS 128
@@ -120,11 +123,16 @@ typedef struct vertex_entry
  * get_edge_entry_id(ee) when you need the id of an entry returned by
  * get_edge_entry / get_edge_entry_with_hash; that helper recovers the key
  * from the slot via agehash_key_from_payload.
+ *
+ * The edge_index fits in the alignment padding between tid and
+ * start_vertex_id, so it doesn't grow the payload either. It is assigned in
+ * load order and lets per-traversal edge state live in flat bitsets.
  */
 typedef struct edge_entry
 {
     Oid edge_label_table_oid;      /* the label table oid */
     ItemPointerData tid;           /* physical tuple location for lazy fetch */
+    uint32 edge_index;             /* dense edge number, 0 .. num_edges - 1 */
     graphid start_vertex_id;       /* start vertex */
     graphid end_vertex_id;         /* end vertex */
 } edge_entry;
@@ -142,18 +150,28 @@ typedef struct GRAPH_global_context
     AgeHashTable *edge_table;      /* edge to vertex map (Robin Hood) */
     MemoryContext edge_table_mcxt; /* private context owning edge_table */
     uint64 graph_version;          /* version counter for cache invalidation */
+    uint64 build_number;           /* which build of a context this is */
     TransactionId xmin;            /* snapshot fallback: transaction xmin */
     TransactionId xmax;            /* snapshot fallback: transaction xmax */
     CommandId curcid;              /* snapshot fallback: command id */
     int64 num_loaded_vertices;     /* number of loaded vertices in this graph */
     int64 num_loaded_edges;        /* number of loaded edges in this graph */
     ListGraphId *vertices;         /* vertices for vertex hashtable cleanup */
+    EdgeMatchMemo *edge_match_memos; /* memoized VLE edge constraint results */
+    int num_edge_match_memos;      /* number of edge match memos */
     struct GRAPH_global_context *next; /* next graph */
 } GRAPH_global_context;
 
 /* global variable to hold the per process GRAPH global contexts */
 static GRAPH_global_context *global_graph_contexts = NULL;
 
+/*
+ * Per process count of GRAPH global contexts built. A rebuilt context can be
+ * allocated at the address of the one it replaces, so holders of a context
+ * compare build numbers, not pointers, to tell whether it was rebuilt.
+ */
+static uint64 ggctx_build_count = 0;
+
 /*
  * VertexEdgeArray helpers — flat-array adjacency container used by
  * vertex_entry's edges_in / edges_out / edges_self.
@@ -551,7 +569,17 @@ static bool insert_edge_entry(GRAPH_global_context *ggctx, graphid edge_id,
      * in only the fields we care about. The hash key (edge_id) lives in the
      * slot header; recoverable via get_edge_entry_id() if needed.
      */
+    /* the dense edge index is a uint32, so don't let it wrap */
+    if (ggctx->num_loaded_edges >= PG_UINT32_MAX)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                 errmsg("insert_edge_entry: too many edges in graph \"%s\"",
+                        ggctx->graph_name)));
+    }
+
     ee->tid = tid;
+    ee->edge_index = (uint32) ggctx->num_loaded_edges;
     ee->start_vertex_id = start_vertex_id;
     ee->end_vertex_id = end_vertex_id;
     ee->edge_label_table_oid = edge_label_table_oid;
@@ -990,6 +1018,16 @@ static bool free_specific_GRAPH_global_context(GRAPH_global_context *ggctx)
     free_ListGraphId(ggctx->vertices);
     ggctx->vertices = NULL;
 
+    /* free the edge match memos */
+    while (ggctx->edge_match_memos != NULL)
+    {
+        EdgeMatchMemo *next_memo = ggctx->edge_match_memos->next;
+
+        free_edge_match_memo(ggctx->edge_match_memos);
+        ggctx->edge_match_memos = next_memo;
+    }
+    ggctx->num_edge_match_memos = 0;
+
     /* free the hashtables */
     hash_destroy(ggctx->vertex_hashtable);
     /*
@@ -1124,6 +1162,9 @@ GRAPH_global_context *manage_GRAPH_global_contexts(char *graph_name,
     new_ggctx->graph_name = pstrdup(graph_name);
     new_ggctx->graph_oid = graph_oid;
 
+    /* number this build of the context */
+    new_ggctx->build_number = ++ggctx_build_count;
+
     /* set the graph version counter for cache invalidation */
     new_ggctx->graph_version = get_graph_version(graph_oid);
 
@@ -1293,7 +1334,7 @@ edge_entry *get_edge_entry(GRAPH_global_context *ggctx, graphid edge_id)
  * Variant of get_edge_entry that uses a precomputed hash value to skip the
  * agehash internal hash callback. The caller is responsible for ensuring
  * hashvalue == graphid_hash(&edge_id, sizeof(int64)). Used by the VLE DFS
- * hot loop where the same edge_id is also looked up in edge_state_hashtable.
+ * hot loop, which computes the hashes for a batch of edges up front.
  */
 edge_entry *get_edge_entry_with_hash(GRAPH_global_context *ggctx,
                                      graphid edge_id, uint32 hashvalue)
@@ -1486,6 +1527,11 @@ Datum get_edge_entry_properties(edge_entry *ee)
     return result;
 }
 
+uint32 get_edge_entry_index(edge_entry *ee)
+{
+    return ee->edge_index;
+}
+
 graphid get_edge_entry_start_vertex_id(edge_entry *ee)
 {
     return ee->start_vertex_id;
@@ -1496,6 +1542,96 @@ graphid get_edge_entry_end_vertex_id(edge_entry *ee)
     return ee->end_vertex_id;
 }
 
+/* return the number of edges, which bounds the dense edge index */
+int64 get_graph_num_edges(GRAPH_global_context *ggctx)
+{
+    return ggctx->num_loaded_edges;
+}
+
+/* return the build number, which changes whenever the context is rebuilt */
+uint64 get_graph_build_number(GRAPH_global_context *ggctx)
+{
+    return ggctx->build_number;
+}
+
+/*
+ * Helper function to allocate an edge match memo, in TopMemoryContext, with
+ * both bitsets cleared. The constraint datum is copied.
+ */
+EdgeMatchMemo *create_edge_match_memo(int64 num_edges, Oid label_oid,
+                                      bool label_missing, Datum constraint,
+                                      uint32 constraint_hash)
+{
+    EdgeMatchMemo *memo = NULL;
+    Size nbytes = EDGE_BITSET_BYTES(num_edges);
+    MemoryContext oldctx = MemoryContextSwitchTo(TopMemoryContext);
+
+    memo = palloc0(sizeof(EdgeMatchMemo));
+    memo->label_oid = label_oid;
+    memo->label_missing = label_missing;
+    memo->constraint = datumCopy(constraint, false, -1);
+    memo->constraint_hash = constraint_hash;
+    memo->checked = palloc0(nbytes);
+    memo->matched = palloc0(nbytes);
+    memo->next = NULL;
+
+    MemoryContextSwitchTo(oldctx);
+
+    return memo;
+}
+
+void free_edge_match_memo(EdgeMatchMemo *memo)
+{
+    if (memo == NULL)
+    {
+        return;
+    }
+
+    pfree_if_not_null(DatumGetPointer(memo->constraint));
+    pfree_if_not_null(memo->checked);
+    pfree_if_not_null(memo->matched);
+    pfree(memo);
+}
+
+/*
+ * Get the shared edge match memo for a VLE edge constraint set (label and
+ * property prototype), creating it if needed. Every VLE over this GRAPH
+ * global context with the same constraint reuses the edges already tested.
+ * The memos live as long as the GRAPH global context does. Returns NULL once
+ * MAX_EDGE_MATCH_MEMOS are in use; the caller is then expected to use a
+ * private memo of its own.
+ */
+EdgeMatchMemo *get_edge_match_memo(GRAPH_global_context *ggctx, Oid label_oid,
+                                   bool label_missing, Datum constraint,
+                                   uint32 constraint_hash)
+{
+    EdgeMatchMemo *memo = NULL;
+
+    for (memo = ggctx->edge_match_memos; memo != NULL; memo = memo->next)
+    {
+        if (memo->label_oid == label_oid &&
+            memo->label_missing == label_missing &&
+            memo->constraint_hash == constraint_hash &&
+            datum_image_eq(memo->constraint, constraint, false, -1))
+        {
+            return memo;
+        }
+    }
+
+    if (ggctx->num_edge_match_memos >= MAX_EDGE_MATCH_MEMOS)
+    {
+        return NULL;
+    }
+
+    memo = create_edge_match_memo(ggctx->num_loaded_edges, label_oid,
+                                  label_missing, constraint, constraint_hash);
+    memo->next = ggctx->edge_match_memos;
+    ggctx->edge_match_memos = memo;
+    ggctx->num_edge_match_memos++;
+
+    return memo;
+}
+
 /* PostgreSQL SQL facing functions */
 
 /* PG wrapper function for age_delete_global_graphs */
@@ -1736,6 +1872,723 @@ Datum age_graph_stats(PG_FUNCTION_ARGS)
     PG_RETURN_POINTER(agtype_value_to_agtype(result.res));
 }
 
+/*
+ * Graph profile support for age_graph_profile.
+ *
+ * Degrees are summarized into power of two histogram buckets. Bucket 0 holds
+ * degree 0 and bucket b holds degrees in [2^(b-1), 2^b). The buckets are keyed
+ * by their lower bound in the output.
+ */
+#define PROFILE_HISTOGRAM_BUCKETS 65
+#define PROFILE_MAX_HUBS 10
+
+typedef struct profile_degree_stats
+{
+    int64 vertices;                /* number of vertices summarized */
+    int64 sum;                     /* sum of their degrees */
+    int64 max;                     /* maximum degree */
+    int64 histogram[PROFILE_HISTOGRAM_BUCKETS];
+} profile_degree_stats;
+
+/* per vertex label profile, keyed by the label table oid */
+typedef struct profile_vertex_label
+{
+    Oid label_table_oid;           /* hash key */
+    char *name;                    /* label name */
+    int64 count;                   /* number of vertices */
+    profile_degree_stats out_degree;
+    profile_degree_stats in_degree;
+    profile_degree_stats self_loops;
+} profile_vertex_label;
+
+/* per edge label profile, keyed by the label table oid */
+typedef struct profile_edge_label
+{
+    Oid label_table_oid;           /* hash key */
+    char *name;                    /* label name */
+    int64 count;                   /* number of edges */
+    graphid touched_by;            /* vertex currently being counted */
+    int64 current_out;             /* out degree of that vertex */
+    int64 current_in;              /* in degree of that vertex */
+    profile_degree_stats out_degree;
+    profile_degree_stats in_degree;
+} profile_edge_label;
+
+typedef struct profile_triple_key
+{
+    Oid start_label_table_oid;
+    Oid edge_label_table_oid;
+    Oid end_label_table_oid;
+} profile_triple_key;
+
+/* per (start label, edge label, end label) profile */
+typedef struct profile_triple
+{
+    profile_triple_key key;        /* hash key */
+    char *start_name;              /* start vertex label name */
+    char *edge_name;               /* edge label name */
+    char *end_name;                /* end vertex label name */
+    int64 count;                   /* number of edges */
+    int64 sources;                 /* number of distinct start vertices */
+    graphid last_source;           /* last start vertex counted */
+} profile_triple;
+
+typedef struct profile_hub
+{
+    graphid vertex_id;
+    Oid label_table_oid;
+    int64 degree;
+} profile_hub;
+
+/* map a degree to its histogram bucket */
+static int get_profile_histogram_bucket(int64 degree)
+{
+    if (degree <= 0)
+    {
+        return 0;
+    }
+
+    return pg_leftmost_one_pos64((uint64) degree) + 1;
+}
+
+static void add_profile_degree(profile_degree_stats *stats, int64 degree)
+{
+    stats->vertices++;
+    stats->sum += degree;
+
+    if (degree > stats->max)
+    {
+        stats->max = degree;
+    }
+
+    stats->histogram[get_profile_histogram_bucket(degree)]++;
+}
+
+/* the default labels are reported as an empty label, like vertices and edges */
+static char *get_profile_label_name(Oid label_table_oid)
+{
+    label_cache_data *lcd = NULL;
+    char *name = NULL;
+
+    lcd = search_label_relation_cache(label_table_oid);
+
+    if (lcd == NULL)
+    {
+        return pstrdup("");
+    }
+
+    name = NameStr(lcd->name);
+
+    if (IS_AG_DEFAULT_LABEL(name))
+    {
+        return pstrdup("");
+    }
+
+    return pstrdup(name);
+}
+
+/*
+ * Helper function to keep the hubs sorted by degree, highest first. Ties go
+ * to the smaller vertex id so that the output is deterministic.
+ */
+static void add_profile_hub(profile_hub *hubs, int *num_hubs,
+                            graphid vertex_id, Oid label_table_oid,
+                            int64 degree)
+{
+    int pos = *num_hubs;
+
+    while (pos > 0 &&
+           (hubs[pos - 1].degree < degree ||
+            (hubs[pos - 1].degree == degree &&
+             hubs[pos - 1].vertex_id > vertex_id)))
+    {
+        pos--;
+    }
+
+    if (pos >= PROFILE_MAX_HUBS)
+    {
+        return;
+    }
+
+    if (*num_hubs < PROFILE_MAX_HUBS)
+    {
+        (*num_hubs)++;
+    }
+
+    memmove(&hubs[pos + 1], &hubs[pos],
+            sizeof(profile_hub) * (*num_hubs - pos - 1));
+
+    hubs[pos].vertex_id = vertex_id;
+    hubs[pos].label_table_oid = label_table_oid;
+    hubs[pos].degree = degree;
+}
+
+static int compare_profile_vertex_labels(const void *a, const void *b)
+{
+    profile_vertex_label *la = *(profile_vertex_label **) a;
+    profile_vertex_label *lb = *(profile_vertex_label **) b;
+
+    return strcmp(la->name, lb->name);
+}
+
+static int compare_profile_edge_labels(const void *a, const void *b)
+{
+    profile_edge_label *la = *(profile_edge_label **) a;
+    profile_edge_label *lb = *(profile_edge_label **) b;
+
+    return strcmp(la->name, lb->name);
+}
+
+static int compare_profile_triples(const void *a, const void *b)
+{
+    profile_triple *ta = *(profile_triple **) a;
+    profile_triple *tb = *(profile_triple **) b;
+    int cmp = 0;
+
+    cmp = strcmp(ta->start_name, tb->start_name);
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+
+    cmp = strcmp(ta->edge_name, tb->edge_name);
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+
+    return strcmp(ta->end_name, tb->end_name);
+}
+
+/* helper functions to push key/value pairs into an object */
+static void push_profile_key(agtype_in_state *result, char *key)
+{
+    result->res = push_agtype_value(&result->parse_state, WAGT_KEY,
+                                    string_to_agtype_value(key));
+}
+
+static void push_profile_integer(agtype_in_state *result, char *key,
+                                 int64 value)
+{
+    agtype_value agtv_integer;
+
+    agtv_integer.type = AGTV_INTEGER;
+    agtv_integer.val.int_value = value;
+
+    push_profile_key(result, key);
+    result->res = push_agtype_value(&result->parse_state, WAGT_VALUE,
+                                    &agtv_integer);
+}
+
+static void push_profile_float(agtype_in_state *result, char *key,
+                               float8 value)
+{
+    agtype_value agtv_float;
+
+    agtv_float.type = AGTV_FLOAT;
+    agtv_float.val.float_value = value;
+
+    push_profile_key(result, key);
+    result->res = push_agtype_value(&result->parse_state, WAGT_VALUE,
+                                    &agtv_float);
+}
+
+static void push_profile_string(agtype_in_state *result, char *key,
+                                char *value)
+{
+    push_profile_key(result, key);
+    result->res = push_agtype_value(&result->parse_state, WAGT_VALUE,
+                                    string_to_agtype_value(value));
+}
+
+/*
+ * Push a degree summary as {"vertices", "max", "avg", "histogram"}. Only the
+ * non empty histogram buckets are stored.
+ */
+static void push_profile_degree_stats(agtype_in_state *result, char *key,
+                                      profile_degree_stats *stats)
+{
+    int i = 0;
+
+    push_profile_key(result, key);
+    result->res = push_agtype_value(&result->parse_state, WAGT_BEGIN_OBJECT,
+                                    NULL);
+
+    push_profile_integer(result, "vertices", stats->vertices);
+    push_profile_integer(result, "max", stats->max);
+    push_profile_float(result, "avg",
+                       stats->vertices > 0 ?
+                       (float8) stats->sum / (float8) stats->vertices : 0.0);
+
+    push_profile_key(result, "histogram");
+    result->res = push_agtype_value(&result->parse_state, WAGT_BEGIN_OBJECT,
+                                    NULL);
+
+    for (i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++)
+    {
+        char bucket[32];
+        uint64 lower = (i == 0) ? 0 : ((uint64) 1) << (i - 1);
+
+        if (stats->histogram[i] == 0)
+        {
+            continue;
+        }
+
+        snprintf(bucket, sizeof(bucket), UINT64_FORMAT, lower);
+        push_profile_integer(result, bucket, stats->histogram[i]);
+    }
+
+    result->res = push_agtype_value(&result->parse_state, WAGT_END_OBJECT,
+                                    NULL);
+    result->res = push_agtype_value(&result->parse_state, WAGT_END_OBJECT,
+                                    NULL);
+}
+
+/* find or create the edge label profile for an edge label table oid */
+static profile_edge_label *get_profile_edge_label(HTAB *edge_labels,
+                                                  Oid label_table_oid)
+{
+    profile_edge_label *el = NULL;
+    bool found = false;
+
+    el = (profile_edge_label *)hash_search(edge_labels,
+                                           (void *)&label_table_oid,
+                                           HASH_ENTER, &found);
+    if (!found)
+    {
+        memset(((char *) el) + sizeof(Oid), 0,
+               sizeof(profile_edge_label) - sizeof(Oid));
+        el->name = get_profile_label_name(label_table_oid);
+        el->touched_by = -1;
+    }
+
+    return el;
+}
+
+/* PG wrapper function for age_graph_profile */
+PG_FUNCTION_INFO_V1(age_graph_profile);
+
+/*
+ * Computes a profile of the graph in the cache, in one pass over its
+ * vertices and their adjacency arrays -
+ *
+ *     in, out, and self loop degree histograms per vertex label,
+ *     in and out degree histograms per edge label, over the vertices with
+ *         at least one such edge,
+ *     the highest degree vertices (hubs), and
+ *     the edge count and average fan out per (start label, edge label,
+ *         end label) triple.
+ *
+ * As with age_vertex_stats, self loops count toward both the in and out
+ * degrees. These are the numbers a cost model for MATCH and VLE needs.
+ */
+Datum age_graph_profile(PG_FUNCTION_ARGS)
+{
+    GRAPH_global_context *ggctx = NULL;
+    agtype_value *agtv_temp = NULL;
+    agtype_in_state result;
+    HASHCTL vertex_label_ctl;
+    HASHCTL edge_label_ctl;
+    HASHCTL triple_ctl;
+    HTAB *vertex_labels = NULL;
+    HTAB *edge_labels = NULL;
+    HTAB *triples = NULL;
+    HASH_SEQ_STATUS hash_seq;
+    profile_vertex_label **sorted_vertex_labels = NULL;
+    profile_edge_label **sorted_edge_labels = NULL;
+    profile_triple **sorted_triples = NULL;
+    profile_edge_label **touched = NULL;
+    profile_hub hubs[PROFILE_MAX_HUBS];
+    GraphIdNode *curr_node = NULL;
+    char *graph_name = NULL;
+    Oid graph_oid = InvalidOid;
+    int64 num_edges = 0;
+    long num_vertex_labels = 0;
+    long num_edge_labels = 0;
+    long num_triples = 0;
+    int num_touched = 0;
+    int touched_capacity = 0;
+    int num_hubs = 0;
+    long i = 0;
+
+    /* the graph name is required */
+    if (PG_ARGISNULL(0))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("graph_profile: graph name cannot be NULL")));
+    }
+
+    /* get the graph name */
+    agtv_temp = get_agtype_value("graph_profile", AG_GET_ARG_AGTYPE_P(0),
+                                 AGTV_STRING, true);
+
+    graph_name = pnstrdup(agtv_temp->val.string.val,
+                          agtv_temp->val.string.len);
+
+    /* get the graph oid */
+    graph_oid = get_graph_oid(graph_name);
+
+    if (!OidIsValid(graph_oid))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_SCHEMA),
+                 errmsg("graph \"%s\" does not exist", graph_name)));
+    }
+
+    /*
+     * Create or retrieve the GRAPH global context for this graph. This function
+     * will also purge off invalidated contexts.
+     */
+    ggctx = manage_GRAPH_global_contexts(graph_name, graph_oid);
+
+    /* free the graph name */
+    pfree_if_not_null(graph_name);
+
+    /* the profile tables live in the function's memory context */
+    MemSet(&vertex_label_ctl, 0, sizeof(vertex_label_ctl));
+    vertex_label_ctl.keysize = sizeof(Oid);
+    vertex_label_ctl.entrysize = sizeof(profile_vertex_label);
+    vertex_label_ctl.hcxt = CurrentMemoryContext;
+    vertex_labels = hash_create("graph profile vertex labels", 64,
+                                &vertex_label_ctl,
+                                HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    MemSet(&edge_label_ctl, 0, sizeof(edge_label_ctl));
+    edge_label_ctl.keysize = sizeof(Oid);
+    edge_label_ctl.entrysize = sizeof(profile_edge_label);
+    edge_label_ctl.hcxt = CurrentMemoryContext;
+    edge_labels = hash_create("graph profile edge labels", 64,
+                              &edge_label_ctl,
+                              HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    MemSet(&triple_ctl, 0, sizeof(triple_ctl));
+    triple_ctl.keysize = sizeof(profile_triple_key);
+    triple_ctl.entrysize = sizeof(profile_triple);
+    triple_ctl.hcxt = CurrentMemoryContext;
+    triples = hash_create("graph profile triples", 256, &triple_ctl,
+                          HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    touched_capacity = 16;
+    touched = palloc(sizeof(profile_edge_label *) * touched_capacity);
+
+    /* the one pass over the vertices and their edges */
+    curr_node = get_list_head(get_graph_vertices(ggctx));
+    while (curr_node != NULL)
+    {
+        vertex_entry *ve = NULL;
+        profile_vertex_label *vl = NULL;
+        VertexEdgeArray *edge_arrays[3];
+        graphid vid = get_graphid(curr_node);
+        Oid vertex_label_table_oid = InvalidOid;
+        int64 out_degree = 0;
+        int64 in_degree = 0;
+        int64 self_loops = 0;
+        bool found = false;
+        int a = 0;
+        int j = 0;
+
+        ve = get_vertex_entry(ggctx, vid);
+
+        /* the vertex label */
+        vertex_label_table_oid = ve->vertex_label_table_oid;
+        vl = (profile_vertex_label *)hash_search(vertex_labels,
+                                                (void *)&vertex_label_table_oid,
+                                                HASH_ENTER, &found);
+        if (!found)
+        {
+            memset(((char *) vl) + sizeof(Oid), 0,
+                   sizeof(profile_vertex_label) - sizeof(Oid));
+            vl->name = get_profile_label_name(vertex_label_table_oid);
+        }
+
+        self_loops = ve->edges_self.size;
+        out_degree = ve->edges_out.size + self_loops;
+        in_degree = ve->edges_in.size + self_loops;
+
+        vl->count++;
+        add_profile_degree(&vl->out_degree, out_degree);
+        add_profile_degree(&vl->in_degree, in_degree);
+        add_profile_degree(&vl->self_loops, self_loops);
+
+        add_profile_hub(hubs, &num_hubs, vid, vertex_label_table_oid,
+                        out_degree + in_degree);
+
+        /*
+         * Walk the outgoing, self loop, and incoming edges. Only the outgoing
+         * side, self loops included, counts edges and triples. That way each
+         * edge is counted exactly once.
+         */
+        edge_arrays[0] = &ve->edges_out;
+        edge_arrays[1] = &ve->edges_self;
+        edge_arrays[2] = &ve->edges_in;
+
+        for (a = 0; a < 3; a++)
+        {
+            VertexEdgeArray *edges = edge_arrays[a];
+
+            for (j = 0; j < edges->size; j++)
+            {
+                edge_entry *ee = get_edge_entry(ggctx, edges->array[j]);
+                profile_edge_label *el = NULL;
+
+                el = get_profile_edge_label(edge_labels,
+                                            ee->edge_label_table_oid);
+
+                /* remember the labels this vertex touched */
+                if (el->touched_by != vid)
+                {
+                    if (num_touched >= touched_capacity)
+                    {
+                        touched_capacity *= 2;
+                        touched = repalloc(touched,
+                                           sizeof(profile_edge_label *) *
+                                           touched_capacity);
+                    }
+
+                    el->touched_by = vid;
+                    touched[num_touched++] = el;
+                }
+
+                /* self loops count toward both degrees */
+                if (a != 2)
+                {
+                    el->current_out++;
+                }
+                if (a != 0)
+                {
+                    el->current_in++;
+                }
+
+                /* only the outgoing side counts edges and triples */
+                if (a != 2)
+                {
+                    profile_triple_key key;
+                    profile_triple *triple = NULL;
+                    vertex_entry *end_ve = ve;
+
+                    el->count++;
+                    num_edges++;
+
+                    if (a == 0)
+                    {
+                        end_ve = get_vertex_entry(ggctx,
+                                                  ee->end_vertex_id);
+                    }
+
+                    memset(&key, 0, sizeof(key));
+                    key.start_label_table_oid = vertex_label_table_oid;
+                    key.edge_label_table_oid = ee->edge_label_table_oid;
+                    key.end_label_table_oid = end_ve->vertex_label_table_oid;
+
+                    triple = (profile_triple *)hash_search(triples,
+                                                           (void *)&key,
+                                                           HASH_ENTER,
+                                                           &found);
+                    if (!found)
+                    {
+                        triple->start_name = NULL;
+                        triple->edge_name = NULL;
+                        triple->end_name = NULL;
+                        triple->count = 0;
+                        triple->sources = 0;
+                        triple->last_source = -1;
+                    }
+
+                    triple->count++;
+
+                    /* the out edges of a vertex are seen together */
+                    if (triple->last_source != vid)
+                    {
+                        triple->last_source = vid;
+                        triple->sources++;
+                    }
+                }
+            }
+        }
+
+        /* fold this vertex's per edge label degrees into the histograms */
+        for (j = 0; j < num_touched; j++)
+        {
+            profile_edge_label *el = touched[j];
+
+            if (el->current_out > 0)
+            {
+                add_profile_degree(&el->out_degree, el->current_out);
+            }
+            if (el->current_in > 0)
+            {
+                add_profile_degree(&el->in_degree, el->current_in);
+            }
+
+            el->current_out = 0;
+            el->current_in = 0;
+        }
+        num_touched = 0;
+
+        curr_node = next_GraphIdNode(curr_node);
+    }
+
+    pfree(touched);
+
+    /* sort everything by label name for stable output */
+    num_vertex_labels = hash_get_num_entries(vertex_labels);
+    sorted_vertex_labels = palloc(sizeof(profile_vertex_label *) *
+                                  (num_vertex_labels + 1));
+    hash_seq_init(&hash_seq, vertex_labels);
+    for (i = 0; i < num_vertex_labels; i++)
+    {
+        sorted_vertex_labels[i] = hash_seq_search(&hash_seq);
+    }
+    hash_seq_term(&hash_seq);
+    qsort(sorted_vertex_labels, num_vertex_labels,
+          sizeof(profile_vertex_label *), compare_profile_vertex_labels);
+
+    num_edge_labels = hash_get_num_entries(edge_labels);
+    sorted_edge_labels = palloc(sizeof(profile_edge_label *) *
+                                (num_edge_labels + 1));
+    hash_seq_init(&hash_seq, edge_labels);
+    for (i = 0; i < num_edge_labels; i++)
+    {
+        sorted_edge_labels[i] = hash_seq_search(&hash_seq);
+    }
+    hash_seq_term(&hash_seq);
+    qsort(sorted_edge_labels, num_edge_labels, sizeof(profile_edge_label *),
+          compare_profile_edge_labels);
+
+    num_triples = hash_get_num_entries(triples);
+    sorted_triples = palloc(sizeof(profile_triple *) * (num_triples + 1));
+    hash_seq_init(&hash_seq, triples);
+    for (i = 0; i < num_triples; i++)
+    {
+        profile_triple *triple = hash_seq_search(&hash_seq);
+        profile_vertex_label *vl = NULL;
+        profile_edge_label *el = NULL;
+
+        /* every label in a triple has already been profiled */
+        vl = hash_search(vertex_labels,
+                         (void *)&triple->key.start_label_table_oid,
+                         HASH_FIND, NULL);
+        triple->start_name = vl->name;
+        el = hash_search(edge_labels,
+                         (void *)&triple->key.edge_label_table_oid,
+                         HASH_FIND, NULL);
+        triple->edge_name = el->name;
+        vl = hash_search(vertex_labels,
+                         (void *)&triple->key.end_label_table_oid,
+                         HASH_FIND, NULL);
+        triple->end_name = vl->name;
+
+        sorted_triples[i] = triple;
+    }
+    hash_seq_term(&hash_seq);
+    qsort(sorted_triples, num_triples, sizeof(profile_triple *),
+          compare_profile_triples);
+
+    /* zero the state */
+    memset(&result, 0, sizeof(agtype_in_state));
+
+    /* start the object */
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                   NULL);
+    /* store the graph name */
+    result.res = push_agtype_value(&result.parse_state, WAGT_KEY,
+                                   string_to_agtype_value("graph"));
+    result.res = push_agtype_value(&result.parse_state, WAGT_VALUE, agtv_temp);
+
+    push_profile_integer(&result, "num_vertices", ggctx->num_loaded_vertices);
+    push_profile_integer(&result, "num_edges", num_edges);
+
+    /* the vertex labels */
+    push_profile_key(&result, "vertex_labels");
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_ARRAY,
+                                   NULL);
+    for (i = 0; i < num_vertex_labels; i++)
+    {
+        profile_vertex_label *vl = sorted_vertex_labels[i];
+
+        result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                       NULL);
+        push_profile_string(&result, "label", vl->name);
+        push_profile_integer(&result, "count", vl->count);
+        push_profile_degree_stats(&result, "out_degree", &vl->out_degree);
+        push_profile_degree_stats(&result, "in_degree", &vl->in_degree);
+        push_profile_degree_stats(&result, "self_loops", &vl->self_loops);
+        result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT,
+                                       NULL);
+    }
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_ARRAY, NULL);
+
+    /* the edge labels */
+    push_profile_key(&result, "edge_labels");
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_ARRAY,
+                                   NULL);
+    for (i = 0; i < num_edge_labels; i++)
+    {
+        profile_edge_label *el = sorted_edge_labels[i];
+
+        result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                       NULL);
+        push_profile_string(&result, "label", el->name);
+        push_profile_integer(&result, "count", el->count);
+        push_profile_degree_stats(&result, "out_degree", &el->out_degree);
+        push_profile_degree_stats(&result, "in_degree", &el->in_degree);
+        result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT,
+                                       NULL);
+    }
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_ARRAY, NULL);
+
+    /* the hubs */
+    push_profile_key(&result, "hubs");
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_ARRAY,
+                                   NULL);
+    for (i = 0; i < num_hubs; i++)
+    {
+        profile_vertex_label *vl = NULL;
+
+        vl = hash_search(vertex_labels, (void *)&hubs[i].label_table_oid,
+                         HASH_FIND, NULL);
+
+        result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                       NULL);
+        push_profile_integer(&result, "id", hubs[i].vertex_id);
+        push_profile_string(&result, "label", vl->name);
+        push_profile_integer(&result, "degree", hubs[i].degree);
+        result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT,
+                                       NULL);
+    }
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_ARRAY, NULL);
+
+    /* the (start label, edge label, end label) triples */
+    push_profile_key(&result, "triples");
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_ARRAY,
+                                   NULL);
+    for (i = 0; i < num_triples; i++)
+    {
+        profile_triple *triple = sorted_triples[i];
+
+        result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                       NULL);
+        push_profile_string(&result, "start_label", triple->start_name);
+        push_profile_string(&result, "edge_label", triple->edge_name);
+        push_profile_string(&result, "end_label", triple->end_name);
+        push_profile_integer(&result, "count", triple->count);
+        push_profile_integer(&result, "sources", triple->sources);
+        push_profile_float(&result, "avg_fan_out",
+                           (float8) triple->count / (float8) triple->sources);
+        result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT,
+                                       NULL);
+    }
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_ARRAY, NULL);
+
+    /* close the object */
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT, NULL);
+
+    result.res->type = AGTV_OBJECT;
+
+    PG_RETURN_POINTER(agtype_value_to_agtype(result.res));
+}
+
 /*
  * ============================================================================
  * Graph Version Counter Implementation
@@ -0,0 +1,4212 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Whole-graph algorithms over the cached graph.
+ *
+ * Each algorithm builds a GraphCSR copy of the graph's cache (see
+ * age_graph_csr.c), filtered by an optional edge type, runs to completion
+ * over its dense arrays in the first call, and then returns one row per
+ * vertex from the stored results.
+ *
+ * Some of the algorithms can also run in parallel workers. The graph cache
+ * is backend-local, but the CSR copy is nothing but flat arrays, so the
+ * leader copies it into dynamic shared memory and the workers read it in
+ * place. The work is handed out in blocks claimed from a shared atomic
+ * counter, and the leader takes blocks too, so the algorithm still finishes
+ * if no worker can be launched. Graphs of fewer than
+ * age.min_parallel_graph_size vertices plus edges, and sessions with
+ * max_parallel_workers_per_gather or max_parallel_workers set to 0, run
+ * serially in the calling backend.
+ *
+ * Results are returned as rows keyed by vertex id so that they may be joined
+ * back to the graph or written to a property by the caller.
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/htup_details.h"
+#include "access/parallel.h"
+#include "access/xact.h"
+#include "common/pg_prng.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "optimizer/cost.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
+#include "storage/latch.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "utils/array.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "utils/ag_guc.h"
+#include "utils/age_graph_csr.h"
+
+/* defaults for the optional algorithm arguments */
+#define PAGERANK_DEFAULT_DAMPING 0.85
+#define PAGERANK_DEFAULT_ITERATIONS 20
+#define PAGERANK_DEFAULT_TOLERANCE 1e-6
+#define LOUVAIN_DEFAULT_MAX_LEVELS 10
+#define LOUVAIN_MIN_MODULARITY_GAIN 1e-7
+
+#define LABEL_PROPAGATION_DEFAULT_MAX_ITERATIONS 10
+#define NODE_SIMILARITY_DEFAULT_TOP_K 10
+#define RANDOM_WALK_DEFAULT_LENGTH 80
+#define RANDOM_WALK_DEFAULT_WALKS_PER_NODE 10
+
+/* sampled betweenness picks its sources with a fixed seed, for repeatability */
+#define BETWEENNESS_SAMPLE_SEED 0
+
+/* keys for the parallel algorithms' DSM table of contents */
+#define GRAPH_ALGORITHM_KEY_SHARED UINT64CONST(0xA6E0000000000021)
+#define GRAPH_ALGORITHM_KEY_CSR UINT64CONST(0xA6E0000000000022)
+#define GRAPH_ALGORITHM_KEY_STATE UINT64CONST(0xA6E0000000000023)
+#define GRAPH_ALGORITHM_KEY_QUEUES UINT64CONST(0xA6E0000000000024)
+
+/* size of each worker's queue to the leader, for algorithms that have them */
+#define GRAPH_ALGORITHM_QUEUE_SIZE 65536
+
+/* the leader's wait event while its queues are empty */
+#if PG_VERSION_NUM >= 170000
+#define GRAPH_ALGORITHM_WAIT_EVENT WAIT_EVENT_MESSAGE_QUEUE_RECEIVE
+#else
+#define GRAPH_ALGORITHM_WAIT_EVENT WAIT_EVENT_MQ_RECEIVE
+#endif
+
+/* vertices per block of parallel work */
+#define GRAPH_ALGORITHM_BLOCK_SIZE 4096
+
+/* sources per block of parallel betweenness work */
+#define BETWEENNESS_SOURCE_BLOCK_SIZE 8
+
+/* sources per block, and rows per message, of parallel node similarity */
+#define SIMILARITY_SOURCE_BLOCK_SIZE 256
+#define SIMILARITY_MESSAGE_ROWS 4096
+
+/*
+ * The block counters of a phased parallel algorithm; phase p claims its
+ * blocks from next_block[p % GRAPH_ALGORITHM_PHASE_COUNTERS]. See
+ * advance_algorithm_phase.
+ */
+#define GRAPH_ALGORITHM_PHASE_COUNTERS 3
+
+/* the algorithms that have a parallel path */
+typedef enum graph_algorithm_kind
+{
+    GRAPH_ALGORITHM_PAGERANK,
+    GRAPH_ALGORITHM_WCC,
+    GRAPH_ALGORITHM_BETWEENNESS,
+    GRAPH_ALGORITHM_NODE_SIMILARITY,
+    GRAPH_ALGORITHM_LABEL_PROPAGATION
+} graph_algorithm_kind;
+
+/*
+ * The state shared by the leader and the workers of a parallel algorithm.
+ * The CSR copy and the algorithm's own arrays are in chunks of their own.
+ * The leader is the last participant, numbered num_participants - 1; the
+ * workers are numbered by ParallelWorkerNumber.
+ *
+ * Iterative algorithms run in phases, separated by the barrier. Participants
+ * attach to the barrier whenever they start and work out what to do from
+ * the phase they find, so a worker that starts late simply joins in.
+ */
+typedef struct graph_algorithm_shared
+{
+    graph_algorithm_kind kind;
+    int num_participants;          /* workers requested, plus the leader */
+    int64 num_blocks;              /* number of blocks of work per phase */
+
+    /* the algorithm's arguments */
+    int32 num_sources;             /* betweenness sources */
+    int64 max_iterations;
+    float8 damping;
+    float8 tolerance;
+    int32 heap_size;               /* node similarity top_k */
+    int metric;                    /* node similarity metric */
+    int64 max_neighbors;           /* label propagation's largest degree */
+
+    Barrier barrier;
+
+    /* the next block of work to be claimed, per phase */
+    pg_atomic_uint64 next_block[GRAPH_ALGORITHM_PHASE_COUNTERS];
+} graph_algorithm_shared;
+
+/* a parallel run of an algorithm, as set up by the leader */
+typedef struct graph_algorithm_parallel
+{
+    ParallelContext *pcxt;
+    graph_algorithm_shared *shared;
+    char *state;                   /* the algorithm's own arrays */
+    shm_mq_handle **queues;        /* from each worker, or NULL */
+} graph_algorithm_parallel;
+
+PGDLLEXPORT void age_graph_algorithm_worker_main(dsm_segment *seg,
+                                                 shm_toc *toc);
+
+/*
+ * The results of an algorithm, returned one row at a time. Row r is the
+ * vertex id vertex_ids[r] followed by the num_columns values
+ * values[r * num_columns] .. values[(r + 1) * num_columns - 1]. Most
+ * algorithms have one row per vertex, in vertex index order, but a result
+ * may also be grown a row at a time with append_algorithm_result_row.
+ */
+typedef struct graph_algorithm_result
+{
+    int64 num_rows;                /* number of rows */
+    int64 capacity;                /* number of rows allocated */
+    int64 next_row;                /* next row to return */
+    int32 num_columns;             /* number of value columns per row */
+    graphid *vertex_ids;           /* vertex id of each row */
+    Datum *values;                 /* the value columns of each row */
+} graph_algorithm_result;
+
+/* helper function to get the required graph name argument */
+static char *get_graph_name_arg(FunctionCallInfo fcinfo, char *fname)
+{
+    agtype_value *agtv_temp = NULL;
+
+    if (PG_ARGISNULL(0) || is_agtype_null(AG_GET_ARG_AGTYPE_P(0)))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("%s: graph name cannot be NULL", fname)));
+    }
+
+    agtv_temp = get_agtype_value(fname, AG_GET_ARG_AGTYPE_P(0), AGTV_STRING,
+                                 true);
+
+    return pnstrdup(agtv_temp->val.string.val, agtv_temp->val.string.len);
+}
+
+/* helper function to get an optional agtype argument, NULL if absent */
+static agtype *get_optional_arg(FunctionCallInfo fcinfo, int argno)
+{
+    agtype *agt_arg = NULL;
+
+    if (PG_NARGS() <= argno || PG_ARGISNULL(argno))
+    {
+        return NULL;
+    }
+
+    agt_arg = AG_GET_ARG_AGTYPE_P(argno);
+
+    return is_agtype_null(agt_arg) ? NULL : agt_arg;
+}
+
+/* helper function to get an optional string argument, NULL if absent */
+static char *get_string_arg(agtype *agt_arg, char *fname, char *arg_name)
+{
+    agtype_value *agtv_temp = NULL;
+
+    if (agt_arg == NULL)
+    {
+        return NULL;
+    }
+
+    if (AGT_ROOT_IS_SCALAR(agt_arg))
+    {
+        agtv_temp = get_ith_agtype_value_from_container(&agt_arg->root, 0);
+
+        if (agtv_temp->type == AGTV_STRING)
+        {
+            return pnstrdup(agtv_temp->val.string.val,
+                            agtv_temp->val.string.len);
+        }
+    }
+
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("%s: %s must be a string", fname, arg_name)));
+
+    return NULL;
+}
+
+/* helper function to get an optional numeric argument as a float8 */
+static float8 get_float8_arg(agtype *agt_arg, float8 default_value,
+                             char *fname, char *arg_name)
+{
+    agtype_value *agtv_temp = NULL;
+
+    if (agt_arg == NULL)
+    {
+        return default_value;
+    }
+
+    if (AGT_ROOT_IS_SCALAR(agt_arg))
+    {
+        agtv_temp = get_ith_agtype_value_from_container(&agt_arg->root, 0);
+
+        if (agtv_temp->type == AGTV_FLOAT)
+        {
+            return agtv_temp->val.float_value;
+        }
+        if (agtv_temp->type == AGTV_INTEGER)
+        {
+            return (float8) agtv_temp->val.int_value;
+        }
+    }
+
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("%s: %s must be a number", fname, arg_name)));
+
+    return default_value;
+}
+
+/* helper function to get an optional integer argument as an int64 */
+static int64 get_int64_arg(agtype *agt_arg, int64 default_value, char *fname,
+                           char *arg_name)
+{
+    agtype_value *agtv_temp = NULL;
+
+    if (agt_arg == NULL)
+    {
+        return default_value;
+    }
+
+    if (AGT_ROOT_IS_SCALAR(agt_arg))
+    {
+        agtv_temp = get_ith_agtype_value_from_container(&agt_arg->root, 0);
+
+        if (agtv_temp->type == AGTV_INTEGER)
+        {
+            return agtv_temp->val.int_value;
+        }
+    }
+
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("%s: %s must be an integer", fname, arg_name)));
+
+    return default_value;
+}
+
+/*
+ * Helper function to create the result rows for every vertex of a CSR. The
+ * result is allocated in the current memory context.
+ */
+static graph_algorithm_result *create_algorithm_result(GraphCSR *csr,
+                                                       int32 num_columns)
+{
+    graph_algorithm_result *result = NULL;
+
+    result = palloc0(sizeof(graph_algorithm_result));
+    result->num_rows = csr->num_vertices;
+    result->capacity = Max(csr->num_vertices, 1);
+    result->next_row = 0;
+    result->num_columns = num_columns;
+    result->vertex_ids = palloc_extended(sizeof(graphid) *
+                                         Max(csr->num_vertices, 1),
+                                         MCXT_ALLOC_HUGE);
+    memcpy(result->vertex_ids, csr->vertex_ids,
+           sizeof(graphid) * csr->num_vertices);
+    result->values = palloc_extended(sizeof(Datum) * num_columns *
+                                     Max(csr->num_vertices, 1),
+                                     MCXT_ALLOC_HUGE);
+
+    return result;
+}
+
+/*
+ * Helper function to append a row to a result, growing it in the memory
+ * context it was created in.
+ */
+static void append_algorithm_result_row(graph_algorithm_result *result,
+                                        graphid vertex_id, Datum *values)
+{
+    if (result->num_rows == result->capacity)
+    {
+        result->capacity = result->capacity * 2;
+        result->vertex_ids = repalloc_huge(result->vertex_ids,
+                                           sizeof(graphid) *
+                                           result->capacity);
+        result->values = repalloc_huge(result->values,
+                                       sizeof(Datum) * result->num_columns *
+                                       result->capacity);
+    }
+
+    result->vertex_ids[result->num_rows] = vertex_id;
+    memcpy(&result->values[result->num_rows * result->num_columns], values,
+           sizeof(Datum) * result->num_columns);
+    result->num_rows++;
+}
+
+/*
+ * Helper function to return the next result row of an algorithm SRF, or
+ * NULL when there are no more rows.
+ */
+static HeapTuple next_algorithm_result_row(FuncCallContext *funcctx)
+{
+    graph_algorithm_result *result = NULL;
+    Datum values[8];
+    bool nulls[8];
+    int64 row;
+    int32 i;
+
+    result = (graph_algorithm_result *) funcctx->user_fctx;
+    if (result == NULL || result->next_row >= result->num_rows)
+    {
+        return NULL;
+    }
+
+    Assert(result->num_columns < 8);
+
+    row = result->next_row;
+    result->next_row++;
+
+    values[0] = GRAPHID_GET_DATUM(result->vertex_ids[row]);
+    nulls[0] = false;
+    for (i = 0; i < result->num_columns; i++)
+    {
+        values[i + 1] = result->values[row * result->num_columns + i];
+        nulls[i + 1] = false;
+    }
+
+    return heap_form_tuple(funcctx->tuple_desc, values, nulls);
+}
+
+/*
+ * Helper function to set up the first call of an algorithm SRF. It checks
+ * the result type and creates the child memory context that the CSR copy
+ * and the algorithm's working state are built in, so that they can be freed
+ * in one go once the results are stored.
+ */
+static MemoryContext init_algorithm_srf(FunctionCallInfo fcinfo,
+                                        FuncCallContext *funcctx, char *fname)
+{
+    TupleDesc tupdesc;
+
+    if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("%s: function returning record called in context that cannot accept type record",
+                        fname)));
+    }
+    funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+    return AllocSetContextCreate(CurrentMemoryContext, "graph algorithm",
+                                 ALLOCSET_DEFAULT_SIZES);
+}
+
+/*
+ * Helper function to decide how many parallel workers to ask for to run an
+ * algorithm over a CSR copy, 0 to run it serially.
+ */
+static int plan_graph_algorithm_workers(GraphCSR *csr)
+{
+    int nworkers;
+
+    /* the algorithm SRFs are parallel unsafe, but be careful anyway */
+    if (IsInParallelMode() || csr->num_vertices == 0)
+    {
+        return 0;
+    }
+
+    if ((int64) csr->num_vertices + csr->num_edges <
+        (int64) age_min_parallel_graph_size)
+    {
+        return 0;
+    }
+
+    nworkers = Min(max_parallel_workers_per_gather, max_parallel_workers);
+
+    return Max(nworkers, 0);
+}
+
+/*
+ * Helper function to set up a parallel run of an algorithm over a CSR copy.
+ * It enters parallel mode and creates the DSM with the shared state, the CSR
+ * copy, and state_size bytes for the algorithm's own arrays, which the
+ * caller fills in before launching the workers. The work is num_blocks
+ * blocks. With with_queues, each worker also gets a queue to send its
+ * results to the leader through.
+ */
+static graph_algorithm_parallel *begin_parallel_graph_algorithm(
+    GraphCSR *csr, graph_algorithm_kind kind, int nworkers, int64 num_blocks,
+    Size state_size, bool with_queues)
+{
+    graph_algorithm_parallel *pg = NULL;
+    Size csr_size;
+    char *csr_space;
+    int i;
+
+    csr_size = estimate_graph_csr_shared(csr);
+
+    pg = palloc0(sizeof(graph_algorithm_parallel));
+
+    EnterParallelMode();
+
+    pg->pcxt = CreateParallelContext("age", "age_graph_algorithm_worker_main",
+                                     nworkers);
+
+    shm_toc_estimate_chunk(&pg->pcxt->estimator,
+                           sizeof(graph_algorithm_shared));
+    shm_toc_estimate_chunk(&pg->pcxt->estimator, csr_size);
+    shm_toc_estimate_chunk(&pg->pcxt->estimator, Max(state_size, 1));
+    if (with_queues)
+    {
+        shm_toc_estimate_chunk(&pg->pcxt->estimator,
+                               mul_size(GRAPH_ALGORITHM_QUEUE_SIZE,
+                                        nworkers));
+    }
+    shm_toc_estimate_keys(&pg->pcxt->estimator, 4);
+
+    InitializeParallelDSM(pg->pcxt);
+
+    /* the DSM may be private memory, and then no workers are launched */
+    pg->shared = shm_toc_allocate(pg->pcxt->toc,
+                                  sizeof(graph_algorithm_shared));
+    MemSet(pg->shared, 0, sizeof(graph_algorithm_shared));
+    pg->shared->kind = kind;
+    pg->shared->num_participants = nworkers + 1;
+    pg->shared->num_blocks = num_blocks;
+    BarrierInit(&pg->shared->barrier, 0);
+    for (i = 0; i < GRAPH_ALGORITHM_PHASE_COUNTERS; i++)
+    {
+        pg_atomic_init_u64(&pg->shared->next_block[i], 0);
+    }
+    shm_toc_insert(pg->pcxt->toc, GRAPH_ALGORITHM_KEY_SHARED, pg->shared);
+
+    csr_space = shm_toc_allocate(pg->pcxt->toc, csr_size);
+    store_graph_csr_shared(csr, csr_space);
+    shm_toc_insert(pg->pcxt->toc, GRAPH_ALGORITHM_KEY_CSR, csr_space);
+
+    pg->state = shm_toc_allocate(pg->pcxt->toc, Max(state_size, 1));
+    shm_toc_insert(pg->pcxt->toc, GRAPH_ALGORITHM_KEY_STATE, pg->state);
+
+    if (with_queues)
+    {
+        char *queue_space;
+
+        queue_space = shm_toc_allocate(pg->pcxt->toc,
+                                       mul_size(GRAPH_ALGORITHM_QUEUE_SIZE,
+                                                nworkers));
+        shm_toc_insert(pg->pcxt->toc, GRAPH_ALGORITHM_KEY_QUEUES,
+                       queue_space);
+
+        pg->queues = palloc0(sizeof(shm_mq_handle *) * nworkers);
+        for (i = 0; i < pg->pcxt->nworkers; i++)
+        {
+            shm_mq *mq;
+
+            mq = shm_mq_create(queue_space +
+                               (Size) i * GRAPH_ALGORITHM_QUEUE_SIZE,
+                               GRAPH_ALGORITHM_QUEUE_SIZE);
+            shm_mq_set_receiver(mq, MyProc);
+            pg->queues[i] = shm_mq_attach(mq, pg->pcxt->seg, NULL);
+        }
+    }
+
+    return pg;
+}
+
+/*
+ * Helper function to launch the workers of a parallel run, once the caller
+ * has filled in the algorithm's state. The queues of the workers that could
+ * not be launched are let go of, and those of the others are tied to their
+ * workers, so that the leader notices if one fails to start.
+ */
+static void launch_parallel_graph_algorithm(graph_algorithm_parallel *pg)
+{
+    int i;
+
+    LaunchParallelWorkers(pg->pcxt);
+
+    if (pg->queues == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < pg->pcxt->nworkers; i++)
+    {
+        if (i < pg->pcxt->nworkers_launched)
+        {
+            shm_mq_set_handle(pg->queues[i], pg->pcxt->worker[i].bgwhandle);
+        }
+        else
+        {
+            shm_mq_detach(pg->queues[i]);
+            pg->queues[i] = NULL;
+        }
+    }
+}
+
+/* helper function to tear down a parallel run once its results are read */
+static void end_parallel_graph_algorithm(graph_algorithm_parallel *pg)
+{
+    DestroyParallelContext(pg->pcxt);
+    ExitParallelMode();
+    pfree(pg);
+}
+
+/*
+ * Helper function to claim the next block of work of a parallel algorithm.
+ * Returns false once all of the blocks have been claimed.
+ */
+static bool claim_algorithm_block(pg_atomic_uint64 *next_block,
+                                  int64 num_blocks, int64 *block)
+{
+    *block = (int64) pg_atomic_fetch_add_u64(next_block, 1);
+
+    return *block < num_blocks;
+}
+
+/* helper function to find the vertices of a block of parallel work */
+static void get_vertex_block(int64 block, int32 n, int32 *first, int32 *last)
+{
+    int64 start = block * GRAPH_ALGORITHM_BLOCK_SIZE;
+
+    *first = (int32) start;
+    *last = (int32) Min(start + GRAPH_ALGORITHM_BLOCK_SIZE, (int64) n);
+}
+
+/* helper function to count the blocks of parallel work over n vertices */
+static int64 count_vertex_blocks(int32 n)
+{
+    return ((int64) n + GRAPH_ALGORITHM_BLOCK_SIZE - 1) /
+           GRAPH_ALGORITHM_BLOCK_SIZE;
+}
+
+/*
+ * Helper function to end the current phase of a phased parallel algorithm:
+ * wait for every attached participant to finish it, and return the next
+ * phase.
+ *
+ * The counters are recycled. The participant that the barrier elects on
+ * entering phase p resets the counter of phase p + 1. That counter was last
+ * used in phase p - 2, which everyone has finished, and phase p + 1 can't
+ * start before the elected participant arrives at the end of phase p.
+ */
+static int advance_algorithm_phase(graph_algorithm_shared *shared)
+{
+    int phase;
+
+    if (BarrierArriveAndWait(&shared->barrier, PG_WAIT_EXTENSION))
+    {
+        phase = BarrierPhase(&shared->barrier);
+        pg_atomic_write_u64(&shared->next_block[(phase + 1) %
+                                                GRAPH_ALGORITHM_PHASE_COUNTERS],
+                            0);
+    }
+
+    return BarrierPhase(&shared->barrier);
+}
+
+/*
+ * Helper function for the first step of a PageRank iteration: store what
+ * each vertex first .. last - 1 passes along each of its out edges in
+ * contrib, and return the total rank of those without out edges.
+ */
+static float8 pagerank_contributions(GraphCSR *csr, float8 *scores,
+                                     float8 *contrib, int32 first, int32 last)
+{
+    float8 dangling = 0.0;
+    int32 v;
+
+    for (v = first; v < last; v++)
+    {
+        int64 degree = GRAPH_CSR_OUT_DEGREE(csr, v);
+
+        if (degree == 0)
+        {
+            dangling += scores[v];
+            contrib[v] = 0.0;
+        }
+        else
+        {
+            contrib[v] = scores[v] / degree;
+        }
+    }
+
+    return dangling;
+}
+
+/*
+ * Helper function for the second step of a PageRank iteration: pull the
+ * new rank of each vertex first .. last - 1 from its in neighbors into
+ * next, and return the L1 change from scores.
+ */
+static float8 pagerank_ranks(GraphCSR *csr, float8 *contrib, float8 base,
+                             float8 damping, float8 *scores, float8 *next,
+                             int32 first, int32 last)
+{
+    float8 delta = 0.0;
+    int32 v;
+
+    for (v = first; v < last; v++)
+    {
+        float8 sum = 0.0;
+        int64 i;
+
+        for (i = csr->in_offsets[v]; i < csr->in_offsets[v + 1]; i++)
+        {
+            sum += contrib[csr->in_sources[i]];
+        }
+
+        next[v] = base + damping * sum;
+        delta += fabs(next[v] - scores[v]);
+    }
+
+    return delta;
+}
+
+/*
+ * PageRank by power iteration over the CSR in edges. Each iteration pulls
+ * the rank of every vertex from its in neighbors,
+ *
+ *     pr'[v] = (1 - d) / N + d * (dangling / N + sum(pr[u] / outdeg(u)))
+ *
+ * where dangling is the total rank of the vertices without out edges, which
+ * is spread evenly so that the ranks keep summing to 1. Iteration stops
+ * after max_iterations, or once the L1 change of an iteration falls below
+ * the tolerance. Parallel edges count once each. The ranks are stored in
+ * scores, which must hold csr->num_vertices values.
+ */
+static void compute_pagerank(GraphCSR *csr, float8 damping,
+                             int64 max_iterations, float8 tolerance,
+                             float8 *scores)
+{
+    float8 *contrib = NULL;
+    float8 *next = NULL;
+    int32 n = csr->num_vertices;
+    int64 iteration;
+    int32 v;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    contrib = palloc_extended(sizeof(float8) * n, MCXT_ALLOC_HUGE);
+    next = palloc_extended(sizeof(float8) * n, MCXT_ALLOC_HUGE);
+
+    for (v = 0; v < n; v++)
+    {
+        scores[v] = 1.0 / n;
+    }
+
+    for (iteration = 0; iteration < max_iterations; iteration++)
+    {
+        float8 dangling = 0.0;
+        float8 base = 0.0;
+        float8 delta = 0.0;
+
+        CHECK_FOR_INTERRUPTS();
+
+        dangling = pagerank_contributions(csr, scores, contrib, 0, n);
+        base = (1.0 - damping) / n + damping * dangling / n;
+        delta = pagerank_ranks(csr, contrib, base, damping, scores, next, 0,
+                               n);
+
+        memcpy(scores, next, sizeof(float8) * n);
+
+        if (delta < tolerance)
+        {
+            break;
+        }
+    }
+
+    pfree(contrib);
+    pfree(next);
+}
+
+/*
+ * The parallel PageRank state: two rank arrays, used in turn, the
+ * contributions, and the dangling rank and the L1 change of each block.
+ */
+typedef struct pagerank_state
+{
+    float8 *ranks[2];              /* iteration i reads ranks[i % 2] */
+    float8 *contrib;
+    float8 *dangling_sums;         /* per block, of the current iteration */
+    float8 *delta_sums;            /* per block, of the last iteration */
+} pagerank_state;
+
+/* helper function to find the parallel PageRank arrays in the state chunk */
+static void get_pagerank_state(char *state, int32 n, int64 num_blocks,
+                               pagerank_state *prs)
+{
+    float8 *values = (float8 *) state;
+
+    prs->ranks[0] = values;
+    prs->ranks[1] = values + n;
+    prs->contrib = values + 2 * (Size) n;
+    prs->dangling_sums = values + 3 * (Size) n;
+    prs->delta_sums = values + 3 * (Size) n + num_blocks;
+}
+
+/* helper function to sum per block values in block order */
+static float8 sum_block_values(float8 *values, int64 num_blocks)
+{
+    float8 sum = 0.0;
+    int64 b;
+
+    for (b = 0; b < num_blocks; b++)
+    {
+        sum += values[b];
+    }
+
+    return sum;
+}
+
+/*
+ * Take part in a parallel PageRank run. Iteration i is two phases: in phase
+ * 2i the participants compute the contributions of their blocks from
+ * ranks[i % 2], and in phase 2i + 1 the new ranks of their blocks into
+ * ranks[(i + 1) % 2]. The dangling rank and the L1 change are kept per
+ * block and summed in block order, so every participant gets the same
+ * totals and they don't depend on who did which block. At the start of each
+ * iteration every participant makes the same decision to stop. Returns the
+ * number of iterations run.
+ */
+static int64 run_pagerank_participant(GraphCSR *csr,
+                                      graph_algorithm_shared *shared,
+                                      char *state)
+{
+    pagerank_state prs;
+    int32 n = csr->num_vertices;
+    int phase;
+
+    get_pagerank_state(state, n, shared->num_blocks, &prs);
+
+    phase = BarrierAttach(&shared->barrier);
+
+    for (;;)
+    {
+        pg_atomic_uint64 *next_block = NULL;
+        int64 iteration = phase / 2;
+        float8 *scores = prs.ranks[iteration % 2];
+        int64 block;
+
+        next_block = &shared->next_block[phase %
+                                         GRAPH_ALGORITHM_PHASE_COUNTERS];
+
+        if (phase % 2 == 0)
+        {
+            if (iteration >= shared->max_iterations ||
+                (iteration > 0 &&
+                 sum_block_values(prs.delta_sums, shared->num_blocks) <
+                 shared->tolerance))
+            {
+                break;
+            }
+
+            while (claim_algorithm_block(next_block, shared->num_blocks,
+                                         &block))
+            {
+                int32 first;
+                int32 last;
+
+                CHECK_FOR_INTERRUPTS();
+
+                get_vertex_block(block, n, &first, &last);
+                prs.dangling_sums[block] = pagerank_contributions(
+                    csr, scores, prs.contrib, first, last);
+            }
+        }
+        else
+        {
+            float8 dangling = sum_block_values(prs.dangling_sums,
+                                               shared->num_blocks);
+            float8 base = (1.0 - shared->damping) / n +
+                          shared->damping * dangling / n;
+
+            while (claim_algorithm_block(next_block, shared->num_blocks,
+                                         &block))
+            {
+                int32 first;
+                int32 last;
+
+                CHECK_FOR_INTERRUPTS();
+
+                get_vertex_block(block, n, &first, &last);
+                prs.delta_sums[block] = pagerank_ranks(
+                    csr, prs.contrib, base, shared->damping, scores,
+                    prs.ranks[(iteration + 1) % 2], first, last);
+            }
+        }
+
+        phase = advance_algorithm_phase(shared);
+    }
+
+    BarrierDetach(&shared->barrier);
+
+    return phase / 2;
+}
+
+/*
+ * PageRank as compute_pagerank, with each iteration's vertex ranges spread
+ * over nworkers parallel workers and the leader, and a barrier between the
+ * steps. For graphs of more than one block, the totals are summed in a
+ * different order than the serial loop does, so the ranks can differ from
+ * the serial ones in the last bits.
+ */
+static void compute_pagerank_parallel(GraphCSR *csr, float8 damping,
+                                      int64 max_iterations, float8 tolerance,
+                                      int nworkers, float8 *scores)
+{
+    graph_algorithm_parallel *pg = NULL;
+    pagerank_state prs;
+    int32 n = csr->num_vertices;
+    int64 num_blocks = count_vertex_blocks(n);
+    int64 iterations;
+    Size state_size;
+    int32 v;
+
+    state_size = mul_size(sizeof(float8),
+                          add_size(mul_size(3, (Size) n), 2 * num_blocks));
+
+    pg = begin_parallel_graph_algorithm(csr, GRAPH_ALGORITHM_PAGERANK,
+                                        nworkers, num_blocks, state_size,
+                                        false);
+    pg->shared->max_iterations = max_iterations;
+    pg->shared->damping = damping;
+    pg->shared->tolerance = tolerance;
+
+    get_pagerank_state(pg->state, n, num_blocks, &prs);
+    for (v = 0; v < n; v++)
+    {
+        prs.ranks[0][v] = 1.0 / n;
+    }
+
+    launch_parallel_graph_algorithm(pg);
+
+    iterations = run_pagerank_participant(csr, pg->shared, pg->state);
+
+    WaitForParallelWorkersToFinish(pg->pcxt);
+
+    memcpy(scores, prs.ranks[iterations % 2], sizeof(float8) * n);
+
+    end_parallel_graph_algorithm(pg);
+}
+
+/*
+ * age_pagerank(graph, edge_types, damping, iterations, tolerance) returns
+ * the PageRank score of every vertex of the graph as (vertex_id, score)
+ * rows. Only the edges of edge_types, a relationship type or an array of
+ * them, are followed; NULL follows every edge. The damping factor defaults
+ * to 0.85, the iteration limit to 20, and the tolerance to 1e-6. Each
+ * iteration is split over parallel workers when the graph is large enough.
+ */
+PG_FUNCTION_INFO_V1(age_pagerank);
+
+Datum age_pagerank(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        float8 *scores = NULL;
+        float8 damping;
+        int64 iterations;
+        float8 tolerance;
+        int nworkers;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_pagerank");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_pagerank");
+        damping = get_float8_arg(get_optional_arg(fcinfo, 2),
+                                 PAGERANK_DEFAULT_DAMPING, "age_pagerank",
+                                 "damping");
+        iterations = get_int64_arg(get_optional_arg(fcinfo, 3),
+                                   PAGERANK_DEFAULT_ITERATIONS, "age_pagerank",
+                                   "iterations");
+        tolerance = get_float8_arg(get_optional_arg(fcinfo, 4),
+                                   PAGERANK_DEFAULT_TOLERANCE, "age_pagerank",
+                                   "tolerance");
+
+        if (isnan(damping) || damping < 0.0 || damping > 1.0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_pagerank: damping must be between 0 and 1")));
+        }
+        if (iterations < 0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_pagerank: iterations cannot be negative")));
+        }
+        if (isnan(tolerance) || tolerance < 0.0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_pagerank: tolerance cannot be negative")));
+        }
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_pagerank");
+        scores = palloc_extended(sizeof(float8) * Max(csr->num_vertices, 1),
+                                 MCXT_ALLOC_HUGE);
+        nworkers = plan_graph_algorithm_workers(csr);
+        if (nworkers > 0)
+        {
+            compute_pagerank_parallel(csr, damping, iterations, tolerance,
+                                      nworkers, scores);
+        }
+        else
+        {
+            compute_pagerank(csr, damping, iterations, tolerance, scores);
+        }
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            result->values[v] = Float8GetDatum(scores[v]);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/* helper function to find the root of a union-find set, halving the path */
+static int32 union_find_root(int32 *parent, int32 v)
+{
+    while (parent[v] != v)
+    {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+
+    return v;
+}
+
+/*
+ * Weakly connected components by union-find over the CSR out edges, with
+ * union by size and path halving. Each component is identified by the
+ * smallest vertex id in it, which is stored in component_ids for every
+ * vertex; component_ids must hold csr->num_vertices values.
+ */
+static void compute_wcc(GraphCSR *csr, graphid *component_ids)
+{
+    int32 *parent = NULL;
+    int32 *size = NULL;
+    int32 n = csr->num_vertices;
+    int32 v;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    parent = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    size = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+
+    for (v = 0; v < n; v++)
+    {
+        parent[v] = v;
+        size[v] = 1;
+    }
+
+    for (v = 0; v < n; v++)
+    {
+        int64 i;
+
+        if ((v & 0xFFFF) == 0)
+        {
+            CHECK_FOR_INTERRUPTS();
+        }
+
+        for (i = csr->out_offsets[v]; i < csr->out_offsets[v + 1]; i++)
+        {
+            int32 root_a = union_find_root(parent, v);
+            int32 root_b = union_find_root(parent, csr->out_targets[i]);
+
+            if (root_a == root_b)
+            {
+                continue;
+            }
+
+            /* hang the smaller set under the larger */
+            if (size[root_a] < size[root_b])
+            {
+                int32 temp = root_a;
+
+                root_a = root_b;
+                root_b = temp;
+            }
+            parent[root_b] = root_a;
+            size[root_a] += size[root_b];
+        }
+    }
+
+    /* find the smallest vertex id of each set, keyed by its root */
+    for (v = 0; v < n; v++)
+    {
+        component_ids[v] = csr->vertex_ids[v];
+    }
+    for (v = 0; v < n; v++)
+    {
+        int32 root = union_find_root(parent, v);
+
+        if (csr->vertex_ids[v] < component_ids[root])
+        {
+            component_ids[root] = csr->vertex_ids[v];
+        }
+    }
+    for (v = 0; v < n; v++)
+    {
+        component_ids[v] = component_ids[union_find_root(parent, v)];
+    }
+
+    pfree(parent);
+    pfree(size);
+}
+
+/*
+ * Helper function to find the root of a concurrent union-find set. Every
+ * parent is at most its child, since sets are only ever linked under the
+ * smaller root, so halving the path with a compare and swap can't create a
+ * cycle, and losing the race to another participant is harmless.
+ */
+static uint32 concurrent_union_find_root(pg_atomic_uint32 *parent, uint32 v)
+{
+    for (;;)
+    {
+        uint32 p = pg_atomic_read_u32(&parent[v]);
+        uint32 gp;
+
+        if (p == v)
+        {
+            return v;
+        }
+
+        gp = pg_atomic_read_u32(&parent[p]);
+        if (gp != p)
+        {
+            (void) pg_atomic_compare_exchange_u32(&parent[v], &p, gp);
+        }
+        v = gp;
+    }
+}
+
+/*
+ * Helper function to join the concurrent union-find sets of a and b. The
+ * larger root is linked under the smaller one with a compare and swap,
+ * which fails, and is retried, if another participant linked it first.
+ */
+static void concurrent_union_find_link(pg_atomic_uint32 *parent, uint32 a,
+                                       uint32 b)
+{
+    for (;;)
+    {
+        uint32 root_a = concurrent_union_find_root(parent, a);
+        uint32 root_b = concurrent_union_find_root(parent, b);
+        uint32 expected;
+
+        if (root_a == root_b)
+        {
+            return;
+        }
+
+        if (root_a < root_b)
+        {
+            uint32 temp = root_a;
+
+            root_a = root_b;
+            root_b = temp;
+        }
+
+        expected = root_a;
+        if (pg_atomic_compare_exchange_u32(&parent[root_a], &expected,
+                                           root_b))
+        {
+            return;
+        }
+    }
+}
+
+/*
+ * Take part in a parallel weakly connected components run: claim blocks of
+ * vertices until there are none left, joining the sets of the ends of each
+ * of their out edges. The joins can happen in any order, so there are no
+ * phases.
+ */
+static void run_wcc_participant(GraphCSR *csr, graph_algorithm_shared *shared,
+                                char *state)
+{
+    pg_atomic_uint32 *parent = (pg_atomic_uint32 *) state;
+    int64 block;
+
+    while (claim_algorithm_block(&shared->next_block[0], shared->num_blocks,
+                                 &block))
+    {
+        int32 first;
+        int32 last;
+        int32 v;
+
+        CHECK_FOR_INTERRUPTS();
+
+        get_vertex_block(block, csr->num_vertices, &first, &last);
+        for (v = first; v < last; v++)
+        {
+            int64 i;
+
+            for (i = csr->out_offsets[v]; i < csr->out_offsets[v + 1]; i++)
+            {
+                concurrent_union_find_link(parent, (uint32) v,
+                                           (uint32) csr->out_targets[i]);
+            }
+        }
+    }
+}
+
+/*
+ * Weakly connected components as compute_wcc, with the out edges spread
+ * over nworkers parallel workers and the leader, which all join sets of one
+ * union-find forest in shared memory. Once they are done, the leader names
+ * each component by its smallest vertex id, so the components are the same
+ * as the serial ones.
+ */
+static void compute_wcc_parallel(GraphCSR *csr, int nworkers,
+                                 graphid *component_ids)
+{
+    graph_algorithm_parallel *pg = NULL;
+    pg_atomic_uint32 *parent = NULL;
+    int32 n = csr->num_vertices;
+    int32 v;
+
+    pg = begin_parallel_graph_algorithm(csr, GRAPH_ALGORITHM_WCC, nworkers,
+                                        count_vertex_blocks(n),
+                                        mul_size(sizeof(pg_atomic_uint32),
+                                                 (Size) n),
+                                        false);
+
+    parent = (pg_atomic_uint32 *) pg->state;
+    for (v = 0; v < n; v++)
+    {
+        pg_atomic_init_u32(&parent[v], (uint32) v);
+    }
+
+    launch_parallel_graph_algorithm(pg);
+
+    run_wcc_participant(csr, pg->shared, pg->state);
+
+    WaitForParallelWorkersToFinish(pg->pcxt);
+
+    /* find the smallest vertex id of each set, keyed by its root */
+    for (v = 0; v < n; v++)
+    {
+        component_ids[v] = csr->vertex_ids[v];
+    }
+    for (v = 0; v < n; v++)
+    {
+        uint32 root = concurrent_union_find_root(parent, (uint32) v);
+
+        if (csr->vertex_ids[v] < component_ids[root])
+        {
+            component_ids[root] = csr->vertex_ids[v];
+        }
+    }
+    for (v = 0; v < n; v++)
+    {
+        component_ids[v] =
+            component_ids[concurrent_union_find_root(parent, (uint32) v)];
+    }
+
+    end_parallel_graph_algorithm(pg);
+}
+
+/*
+ * age_wcc(graph, edge_types) returns the weakly connected component of
+ * every vertex of the graph as (vertex_id, component_id) rows, following
+ * only the edges of edge_types, in either direction. A component is
+ * identified by the smallest vertex id in it. The edges are split over
+ * parallel workers when the graph is large enough.
+ */
+PG_FUNCTION_INFO_V1(age_wcc);
+
+Datum age_wcc(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        graphid *component_ids = NULL;
+        int nworkers;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_wcc");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_wcc");
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_wcc");
+        component_ids = palloc_extended(sizeof(graphid) *
+                                        Max(csr->num_vertices, 1),
+                                        MCXT_ALLOC_HUGE);
+
+        nworkers = plan_graph_algorithm_workers(csr);
+        if (nworkers > 0)
+        {
+            compute_wcc_parallel(csr, nworkers, component_ids);
+        }
+        else
+        {
+            compute_wcc(csr, component_ids);
+        }
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            result->values[v] = GRAPHID_GET_DATUM(component_ids[v]);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/* an explicit stack frame of the iterative Tarjan search */
+typedef struct scc_frame
+{
+    int32 vertex;                  /* the vertex being visited */
+    int64 next_edge;               /* its next out edge to follow */
+} scc_frame;
+
+/*
+ * Strongly connected components by Tarjan's algorithm over the CSR out
+ * edges. The depth-first search keeps its own stack of frames instead of
+ * recursing, so that long paths can't overflow the C stack. Each component
+ * is identified by the smallest vertex id in it, which is stored in
+ * component_ids for every vertex; component_ids must hold csr->num_vertices
+ * values.
+ */
+static void compute_scc(GraphCSR *csr, graphid *component_ids)
+{
+    scc_frame *frames = NULL;
+    int32 *index = NULL;
+    int32 *lowlink = NULL;
+    int32 *scc_stack = NULL;
+    bool *on_stack = NULL;
+    int32 n = csr->num_vertices;
+    int32 next_index = 0;
+    int32 scc_top = 0;
+    int32 root;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    frames = palloc_extended(sizeof(scc_frame) * n, MCXT_ALLOC_HUGE);
+    index = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    lowlink = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    scc_stack = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    on_stack = palloc_extended(sizeof(bool) * n,
+                               MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+
+    for (root = 0; root < n; root++)
+    {
+        index[root] = -1;
+    }
+
+    for (root = 0; root < n; root++)
+    {
+        int32 frame_top = 0;
+
+        if (index[root] != -1)
+        {
+            continue;
+        }
+
+        /* visit the root */
+        index[root] = lowlink[root] = next_index++;
+        scc_stack[scc_top++] = root;
+        on_stack[root] = true;
+        frames[frame_top].vertex = root;
+        frames[frame_top].next_edge = csr->out_offsets[root];
+        frame_top++;
+
+        while (frame_top > 0)
+        {
+            scc_frame *frame = &frames[frame_top - 1];
+            int32 v = frame->vertex;
+
+            CHECK_FOR_INTERRUPTS();
+
+            if (frame->next_edge < csr->out_offsets[v + 1])
+            {
+                int32 w = csr->out_targets[frame->next_edge];
+
+                frame->next_edge++;
+
+                if (index[w] == -1)
+                {
+                    /* descend into w */
+                    index[w] = lowlink[w] = next_index++;
+                    scc_stack[scc_top++] = w;
+                    on_stack[w] = true;
+                    frames[frame_top].vertex = w;
+                    frames[frame_top].next_edge = csr->out_offsets[w];
+                    frame_top++;
+                }
+                else if (on_stack[w] && index[w] < lowlink[v])
+                {
+                    lowlink[v] = index[w];
+                }
+
+                continue;
+            }
+
+            /* all of v's edges are done; if v is a component root, pop it */
+            if (lowlink[v] == index[v])
+            {
+                graphid min_id = csr->vertex_ids[v];
+                int32 start = scc_top;
+                int32 i;
+
+                do
+                {
+                    start--;
+                    on_stack[scc_stack[start]] = false;
+                    if (csr->vertex_ids[scc_stack[start]] < min_id)
+                    {
+                        min_id = csr->vertex_ids[scc_stack[start]];
+                    }
+                } while (scc_stack[start] != v);
+
+                for (i = start; i < scc_top; i++)
+                {
+                    component_ids[scc_stack[i]] = min_id;
+                }
+                scc_top = start;
+            }
+
+            /* return to the parent */
+            frame_top--;
+            if (frame_top > 0)
+            {
+                int32 parent = frames[frame_top - 1].vertex;
+
+                if (lowlink[v] < lowlink[parent])
+                {
+                    lowlink[parent] = lowlink[v];
+                }
+            }
+        }
+    }
+
+    pfree(frames);
+    pfree(index);
+    pfree(lowlink);
+    pfree(scc_stack);
+    pfree(on_stack);
+}
+
+/*
+ * age_scc(graph, edge_types) returns the strongly connected component of
+ * every vertex of the graph as (vertex_id, component_id) rows, following
+ * only the edges of edge_types. A component is identified by the smallest
+ * vertex id in it.
+ */
+PG_FUNCTION_INFO_V1(age_scc);
+
+Datum age_scc(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        graphid *component_ids = NULL;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_scc");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_scc");
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_scc");
+        component_ids = palloc_extended(sizeof(graphid) *
+                                        Max(csr->num_vertices, 1),
+                                        MCXT_ALLOC_HUGE);
+        compute_scc(csr, component_ids);
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            result->values[v] = GRAPHID_GET_DATUM(component_ids[v]);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/*
+ * Count the triangles through every vertex, treating the graph as simple
+ * and undirected. Each triangle v < u < w is found once, from its smallest
+ * vertex v, by a merge intersection of the sorted neighbor lists of v and
+ * u, and is then credited to all three vertices. The counts are stored in
+ * triangles, which must hold csr->num_vertices values.
+ */
+static void compute_triangles(GraphCSR *csr, int64 *triangles)
+{
+    int32 n = csr->num_vertices;
+    int32 v;
+
+    build_graph_csr_neighbors(csr);
+
+    memset(triangles, 0, sizeof(int64) * n);
+
+    for (v = 0; v < n; v++)
+    {
+        int64 i;
+
+        CHECK_FOR_INTERRUPTS();
+
+        for (i = csr->neighbor_offsets[v]; i < csr->neighbor_offsets[v + 1];
+             i++)
+        {
+            int32 u = csr->neighbors[i];
+            int64 a;
+            int64 b;
+
+            if (u <= v)
+            {
+                continue;
+            }
+
+            /* the common neighbors w > u of v and u */
+            a = i + 1;
+            b = csr->neighbor_offsets[u];
+            while (a < csr->neighbor_offsets[v + 1] &&
+                   b < csr->neighbor_offsets[u + 1])
+            {
+                int32 wa = csr->neighbors[a];
+                int32 wb = csr->neighbors[b];
+
+                if (wb <= u || wb < wa)
+                {
+                    b++;
+                }
+                else if (wa < wb)
+                {
+                    a++;
+                }
+                else
+                {
+                    triangles[v]++;
+                    triangles[u]++;
+                    triangles[wa]++;
+                    a++;
+                    b++;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * age_triangle_count(graph, edge_types) returns the number of triangles
+ * through every vertex of the graph as (vertex_id, triangles) rows. Edge
+ * direction, parallel edges, and self loops are ignored.
+ */
+PG_FUNCTION_INFO_V1(age_triangle_count);
+
+Datum age_triangle_count(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        int64 *triangles = NULL;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_triangle_count");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_triangle_count");
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_triangle_count");
+        triangles = palloc_extended(sizeof(int64) * Max(csr->num_vertices, 1),
+                                    MCXT_ALLOC_HUGE);
+        compute_triangles(csr, triangles);
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            result->values[v] = Int64GetDatum(triangles[v]);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/*
+ * age_local_clustering(graph, edge_types) returns the local clustering
+ * coefficient of every vertex of the graph as (vertex_id, coefficient)
+ * rows: the fraction of the pairs of its neighbors that are themselves
+ * adjacent, or 0 for vertices with fewer than two neighbors. Like
+ * age_triangle_count, the graph is treated as simple and undirected.
+ */
+PG_FUNCTION_INFO_V1(age_local_clustering);
+
+Datum age_local_clustering(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        int64 *triangles = NULL;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_local_clustering");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_local_clustering");
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_local_clustering");
+        triangles = palloc_extended(sizeof(int64) * Max(csr->num_vertices, 1),
+                                    MCXT_ALLOC_HUGE);
+        compute_triangles(csr, triangles);
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            float8 degree = (float8) GRAPH_CSR_NEIGHBOR_COUNT(csr, v);
+            float8 coefficient = 0.0;
+
+            if (degree > 1)
+            {
+                coefficient = (2.0 * triangles[v]) / (degree * (degree - 1));
+            }
+            result->values[v] = Float8GetDatum(coefficient);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/*
+ * The undirected weighted graph of one Louvain level. The entries of node i
+ * are targets[offsets[i]] .. targets[offsets[i + 1] - 1], with their
+ * weights. An edge between two nodes is listed at both of them and a self
+ * loop is listed once, so the weighted degree of a node is the sum of its
+ * entries' weights and the total of all the degrees is 2m.
+ */
+typedef struct louvain_graph
+{
+    int32 num_nodes;               /* number of nodes */
+    int64 *offsets;                /* num_nodes + 1 entry offsets */
+    int32 *targets;                /* the node at the other end of an entry */
+    float8 *weights;               /* the weight of an entry */
+} louvain_graph;
+
+/* helper function to free the arrays of a Louvain level graph */
+static void free_louvain_graph(louvain_graph *lg)
+{
+    pfree_if_not_null(lg->offsets);
+    pfree_if_not_null(lg->targets);
+    pfree_if_not_null(lg->weights);
+    lg->offsets = NULL;
+    lg->targets = NULL;
+    lg->weights = NULL;
+}
+
+/* helper function to build the first Louvain level from a CSR copy */
+static void build_louvain_graph(GraphCSR *csr, louvain_graph *lg)
+{
+    int64 *next = NULL;
+    int32 n = csr->num_vertices;
+    int64 i;
+    int32 v;
+
+    lg->num_nodes = n;
+    lg->offsets = palloc_extended(sizeof(int64) * (n + 1),
+                                  MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+
+    /* count the entries of each node */
+    for (v = 0; v < n; v++)
+    {
+        for (i = csr->out_offsets[v]; i < csr->out_offsets[v + 1]; i++)
+        {
+            lg->offsets[v + 1]++;
+            if (csr->out_targets[i] != v)
+            {
+                lg->offsets[csr->out_targets[i] + 1]++;
+            }
+        }
+    }
+    for (v = 0; v < n; v++)
+    {
+        lg->offsets[v + 1] += lg->offsets[v];
+    }
+
+    lg->targets = palloc_extended(sizeof(int32) * Max(lg->offsets[n], 1),
+                                  MCXT_ALLOC_HUGE);
+    lg->weights = palloc_extended(sizeof(float8) * Max(lg->offsets[n], 1),
+                                  MCXT_ALLOC_HUGE);
+    next = palloc_extended(sizeof(int64) * Max(n, 1), MCXT_ALLOC_HUGE);
+    memcpy(next, lg->offsets, sizeof(int64) * n);
+
+    for (v = 0; v < n; v++)
+    {
+        for (i = csr->out_offsets[v]; i < csr->out_offsets[v + 1]; i++)
+        {
+            int32 target = csr->out_targets[i];
+            float8 weight = (csr->out_weights == NULL) ? 1.0 :
+                            csr->out_weights[i];
+
+            lg->targets[next[v]] = target;
+            lg->weights[next[v]] = weight;
+            next[v]++;
+            if (target != v)
+            {
+                lg->targets[next[target]] = v;
+                lg->weights[next[target]] = weight;
+                next[target]++;
+            }
+        }
+    }
+
+    pfree(next);
+}
+
+/*
+ * Helper function to run the local moving phase of one Louvain level. Each
+ * node, in turn, is moved to the neighboring community with the largest
+ * modularity gain, and passes repeat until a pass moves nothing or gains
+ * less than LOUVAIN_MIN_MODULARITY_GAIN. The community of each node is left
+ * in n2c. Returns true if any node moved.
+ */
+static bool louvain_one_level(louvain_graph *lg, float8 m2, int32 *n2c)
+{
+    float8 *degree = NULL;
+    float8 *self_loops = NULL;
+    float8 *tot = NULL;
+    float8 *in = NULL;
+    float8 *neighbor_weight = NULL;
+    int32 *neighbor_communities = NULL;
+    int32 n = lg->num_nodes;
+    float8 modularity = 0.0;
+    bool improved = false;
+    int32 moves;
+    int32 i;
+
+    degree = palloc_extended(sizeof(float8) * n,
+                             MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    self_loops = palloc_extended(sizeof(float8) * n,
+                                 MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    tot = palloc_extended(sizeof(float8) * n, MCXT_ALLOC_HUGE);
+    in = palloc_extended(sizeof(float8) * n, MCXT_ALLOC_HUGE);
+    neighbor_weight = palloc_extended(sizeof(float8) * n, MCXT_ALLOC_HUGE);
+    neighbor_communities = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+
+    /* every node starts in a community of its own */
+    for (i = 0; i < n; i++)
+    {
+        int64 e;
+
+        for (e = lg->offsets[i]; e < lg->offsets[i + 1]; e++)
+        {
+            degree[i] += lg->weights[e];
+            if (lg->targets[e] == i)
+            {
+                self_loops[i] += lg->weights[e];
+            }
+        }
+
+        n2c[i] = i;
+        tot[i] = degree[i];
+        in[i] = self_loops[i];
+        neighbor_weight[i] = -1.0;
+
+        if (tot[i] > 0.0)
+        {
+            modularity += in[i] / m2 - (tot[i] / m2) * (tot[i] / m2);
+        }
+    }
+
+    do
+    {
+        float8 new_modularity = 0.0;
+
+        moves = 0;
+
+        for (i = 0; i < n; i++)
+        {
+            int32 node_community = n2c[i];
+            int32 best_community = node_community;
+            int32 num_neighbor_communities = 0;
+            float8 best_gain;
+            int64 e;
+            int32 c;
+
+            if ((i & 0xFFFF) == 0)
+            {
+                CHECK_FOR_INTERRUPTS();
+            }
+
+            /* the weight from i to each neighboring community */
+            neighbor_weight[node_community] = 0.0;
+            neighbor_communities[num_neighbor_communities++] = node_community;
+            for (e = lg->offsets[i]; e < lg->offsets[i + 1]; e++)
+            {
+                int32 community = n2c[lg->targets[e]];
+
+                if (lg->targets[e] == i)
+                {
+                    continue;
+                }
+                if (neighbor_weight[community] < 0.0)
+                {
+                    neighbor_weight[community] = 0.0;
+                    neighbor_communities[num_neighbor_communities++] =
+                        community;
+                }
+                neighbor_weight[community] += lg->weights[e];
+            }
+
+            /* take i out of its community */
+            tot[node_community] -= degree[i];
+            in[node_community] -= 2.0 * neighbor_weight[node_community] +
+                                  self_loops[i];
+
+            /* and put it in the best one, staying put on a tie */
+            best_gain = neighbor_weight[node_community] -
+                        tot[node_community] * degree[i] / m2;
+            for (c = 0; c < num_neighbor_communities; c++)
+            {
+                int32 community = neighbor_communities[c];
+                float8 gain = neighbor_weight[community] -
+                              tot[community] * degree[i] / m2;
+
+                if (gain > best_gain)
+                {
+                    best_community = community;
+                    best_gain = gain;
+                }
+            }
+
+            tot[best_community] += degree[i];
+            in[best_community] += 2.0 * neighbor_weight[best_community] +
+                                  self_loops[i];
+            n2c[i] = best_community;
+
+            if (best_community != node_community)
+            {
+                moves++;
+            }
+
+            for (c = 0; c < num_neighbor_communities; c++)
+            {
+                neighbor_weight[neighbor_communities[c]] = -1.0;
+            }
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            if (tot[i] > 0.0)
+            {
+                new_modularity += in[i] / m2 - (tot[i] / m2) * (tot[i] / m2);
+            }
+        }
+
+        if (moves > 0)
+        {
+            improved = true;
+        }
+
+        if (new_modularity - modularity <= LOUVAIN_MIN_MODULARITY_GAIN)
+        {
+            break;
+        }
+        modularity = new_modularity;
+    } while (moves > 0);
+
+    pfree(degree);
+    pfree(self_loops);
+    pfree(tot);
+    pfree(in);
+    pfree(neighbor_weight);
+    pfree(neighbor_communities);
+
+    return improved;
+}
+
+/*
+ * Helper function to collapse each of the num_communities communities of a
+ * Louvain level into one node of the next level. n2c must hold dense
+ * community numbers. The entries between two communities are summed, and
+ * the entries inside a community become its self loop.
+ */
+static void aggregate_louvain_graph(louvain_graph *lg, int32 *n2c,
+                                    int32 num_communities)
+{
+    louvain_graph next_level;
+    int64 *member_offsets = NULL;
+    int32 *members = NULL;
+    int32 *member_next = NULL;
+    float8 *weight = NULL;
+    int32 *touched = NULL;
+    int64 write = 0;
+    int32 i;
+    int32 c;
+
+    /* group the nodes by community */
+    member_offsets = palloc_extended(sizeof(int64) * (num_communities + 1),
+                                     MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    for (i = 0; i < lg->num_nodes; i++)
+    {
+        member_offsets[n2c[i] + 1]++;
+    }
+    for (c = 0; c < num_communities; c++)
+    {
+        member_offsets[c + 1] += member_offsets[c];
+    }
+    members = palloc_extended(sizeof(int32) * lg->num_nodes, MCXT_ALLOC_HUGE);
+    member_next = palloc_extended(sizeof(int32) * num_communities,
+                                  MCXT_ALLOC_HUGE);
+    for (c = 0; c < num_communities; c++)
+    {
+        member_next[c] = (int32) member_offsets[c];
+    }
+    for (i = 0; i < lg->num_nodes; i++)
+    {
+        members[member_next[n2c[i]]++] = i;
+    }
+
+    /* there can't be more entries than there were */
+    next_level.num_nodes = num_communities;
+    next_level.offsets = palloc_extended(sizeof(int64) *
+                                         (num_communities + 1),
+                                         MCXT_ALLOC_HUGE);
+    next_level.targets = palloc_extended(sizeof(int32) *
+                                         Max(lg->offsets[lg->num_nodes], 1),
+                                         MCXT_ALLOC_HUGE);
+    next_level.weights = palloc_extended(sizeof(float8) *
+                                         Max(lg->offsets[lg->num_nodes], 1),
+                                         MCXT_ALLOC_HUGE);
+
+    weight = palloc_extended(sizeof(float8) * num_communities,
+                             MCXT_ALLOC_HUGE);
+    touched = palloc_extended(sizeof(int32) * num_communities,
+                              MCXT_ALLOC_HUGE);
+    for (c = 0; c < num_communities; c++)
+    {
+        weight[c] = -1.0;
+    }
+
+    for (c = 0; c < num_communities; c++)
+    {
+        int32 num_touched = 0;
+        int64 m;
+        int32 t;
+
+        CHECK_FOR_INTERRUPTS();
+
+        for (m = member_offsets[c]; m < member_offsets[c + 1]; m++)
+        {
+            int32 member = members[m];
+            int64 e;
+
+            for (e = lg->offsets[member]; e < lg->offsets[member + 1]; e++)
+            {
+                int32 community = n2c[lg->targets[e]];
+
+                if (weight[community] < 0.0)
+                {
+                    weight[community] = 0.0;
+                    touched[num_touched++] = community;
+                }
+                weight[community] += lg->weights[e];
+            }
+        }
+
+        next_level.offsets[c] = write;
+        for (t = 0; t < num_touched; t++)
+        {
+            next_level.targets[write] = touched[t];
+            next_level.weights[write] = weight[touched[t]];
+            weight[touched[t]] = -1.0;
+            write++;
+        }
+    }
+    next_level.offsets[num_communities] = write;
+
+    pfree(member_offsets);
+    pfree(members);
+    pfree(member_next);
+    pfree(weight);
+    pfree(touched);
+
+    free_louvain_graph(lg);
+    *lg = next_level;
+}
+
+/*
+ * Louvain community detection. Each level moves nodes between communities
+ * to raise modularity, then collapses the communities into the nodes of the
+ * next level, until a level moves nothing or max_levels levels have run.
+ * Only the CSR copy and arrays of its size are held, so memory stays
+ * bounded by the CSR. Each community is identified by the smallest vertex
+ * id in it, which is stored in community_ids for every vertex;
+ * community_ids must hold csr->num_vertices values.
+ */
+static void compute_louvain(GraphCSR *csr, int64 max_levels,
+                            graphid *community_ids)
+{
+    louvain_graph lg;
+    graphid *community_min = NULL;
+    int32 *vertex_community = NULL;
+    int32 *n2c = NULL;
+    int32 *renumber = NULL;
+    int32 n = csr->num_vertices;
+    float8 m2 = 0.0;
+    int64 level;
+    int64 e;
+    int32 v;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    build_louvain_graph(csr, &lg);
+
+    /* every vertex starts as a node of its own */
+    vertex_community = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    for (v = 0; v < n; v++)
+    {
+        vertex_community[v] = v;
+    }
+
+    for (e = 0; e < lg.offsets[n]; e++)
+    {
+        m2 += lg.weights[e];
+    }
+
+    for (level = 0; level < max_levels && m2 > 0.0; level++)
+    {
+        int32 num_communities = 0;
+        int32 i;
+
+        n2c = palloc_extended(sizeof(int32) * lg.num_nodes, MCXT_ALLOC_HUGE);
+        if (!louvain_one_level(&lg, m2, n2c))
+        {
+            pfree(n2c);
+            break;
+        }
+
+        /* number the communities densely, in node order */
+        renumber = palloc_extended(sizeof(int32) * lg.num_nodes,
+                                   MCXT_ALLOC_HUGE);
+        for (i = 0; i < lg.num_nodes; i++)
+        {
+            renumber[i] = -1;
+        }
+        for (i = 0; i < lg.num_nodes; i++)
+        {
+            if (renumber[n2c[i]] == -1)
+            {
+                renumber[n2c[i]] = num_communities++;
+            }
+            n2c[i] = renumber[n2c[i]];
+        }
+
+        for (v = 0; v < n; v++)
+        {
+            vertex_community[v] = n2c[vertex_community[v]];
+        }
+
+        aggregate_louvain_graph(&lg, n2c, num_communities);
+
+        pfree(renumber);
+        pfree(n2c);
+    }
+
+    /* name each community by the smallest vertex id in it */
+    community_min = palloc_extended(sizeof(graphid) * n, MCXT_ALLOC_HUGE);
+    for (v = 0; v < n; v++)
+    {
+        community_min[v] = PG_INT64_MAX;
+    }
+    for (v = 0; v < n; v++)
+    {
+        if (csr->vertex_ids[v] < community_min[vertex_community[v]])
+        {
+            community_min[vertex_community[v]] = csr->vertex_ids[v];
+        }
+    }
+    for (v = 0; v < n; v++)
+    {
+        community_ids[v] = community_min[vertex_community[v]];
+    }
+
+    free_louvain_graph(&lg);
+    pfree(vertex_community);
+    pfree(community_min);
+}
+
+/*
+ * age_louvain(graph, edge_types, weight_property, max_levels) returns the
+ * Louvain community of every vertex of the graph as (vertex_id,
+ * community_id) rows, treating the edges of edge_types as undirected. Edges
+ * are weighted by weight_property if it is given, and by 1 otherwise. At
+ * most max_levels levels, 10 by default, are run. A community is
+ * identified by the smallest vertex id in it.
+ */
+PG_FUNCTION_INFO_V1(age_louvain);
+
+Datum age_louvain(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        char *weight_property = NULL;
+        graphid *community_ids = NULL;
+        int64 max_levels;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_louvain");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_louvain");
+        weight_property = get_string_arg(get_optional_arg(fcinfo, 2),
+                                         "age_louvain", "weight property");
+        max_levels = get_int64_arg(get_optional_arg(fcinfo, 3),
+                                   LOUVAIN_DEFAULT_MAX_LEVELS, "age_louvain",
+                                   "max_levels");
+
+        if (max_levels < 0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_louvain: max_levels cannot be negative")));
+        }
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1),
+                              weight_property, "age_louvain");
+        community_ids = palloc_extended(sizeof(graphid) *
+                                        Max(csr->num_vertices, 1),
+                                        MCXT_ALLOC_HUGE);
+        compute_louvain(csr, max_levels, community_ids);
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            result->values[v] = GRAPHID_GET_DATUM(community_ids[v]);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+        pfree_if_not_null(weight_property);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/* the work arrays of one Brandes participant */
+typedef struct betweenness_work
+{
+    int32 *order;                  /* BFS order, and the BFS queue */
+    int32 *distance;               /* hops from the source, -1 if unseen */
+    float8 *sigma;                 /* number of shortest paths */
+    float8 *delta;                 /* dependency on the source */
+} betweenness_work;
+
+/*
+ * Helper function to pick the sources of betweenness centrality: every
+ * vertex, or, if sample_size is less than the number of vertices, that
+ * many of them chosen at random with a fixed seed by a partial shuffle.
+ */
+static int32 *choose_betweenness_sources(int32 n, int64 sample_size,
+                                         int32 *num_sources)
+{
+    int32 *sources = NULL;
+    int32 i;
+
+    sources = palloc_extended(sizeof(int32) * Max(n, 1), MCXT_ALLOC_HUGE);
+    for (i = 0; i < n; i++)
+    {
+        sources[i] = i;
+    }
+
+    *num_sources = n;
+    if (sample_size < n)
+    {
+        pg_prng_state prng;
+
+        pg_prng_seed(&prng, BETWEENNESS_SAMPLE_SEED);
+        *num_sources = (int32) sample_size;
+        for (i = 0; i < *num_sources; i++)
+        {
+            int32 j = (int32) pg_prng_uint64_range(&prng, i, n - 1);
+            int32 temp = sources[i];
+
+            sources[i] = sources[j];
+            sources[j] = temp;
+        }
+    }
+
+    return sources;
+}
+
+/* helper function to allocate the work arrays of a Brandes participant */
+static betweenness_work *create_betweenness_work(int32 n)
+{
+    betweenness_work *work = NULL;
+    int32 v;
+
+    work = palloc(sizeof(betweenness_work));
+    work->order = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    work->distance = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    work->sigma = palloc_extended(sizeof(float8) * n,
+                                  MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    work->delta = palloc_extended(sizeof(float8) * n,
+                                  MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    for (v = 0; v < n; v++)
+    {
+        work->distance[v] = -1;
+    }
+
+    return work;
+}
+
+static void free_betweenness_work(betweenness_work *work)
+{
+    pfree(work->order);
+    pfree(work->distance);
+    pfree(work->sigma);
+    pfree(work->delta);
+    pfree(work);
+}
+
+/*
+ * The single source step of Brandes' algorithm, unweighted, over the CSR
+ * out edges. A breadth-first search from source counts the shortest paths
+ * to every vertex, then the dependencies are accumulated in reverse BFS
+ * order, walking the CSR in edges to find each vertex's predecessors
+ * instead of keeping predecessor lists, and added to scores. The work
+ * arrays are reset to their initial state before returning, touching only
+ * the vertices that the search reached.
+ */
+static void accumulate_betweenness(GraphCSR *csr, int32 source,
+                                   betweenness_work *work, float8 *scores)
+{
+    int32 *order = work->order;
+    int32 *distance = work->distance;
+    float8 *sigma = work->sigma;
+    float8 *delta = work->delta;
+    int32 head = 0;
+    int32 tail = 0;
+    int32 k;
+
+    /* count the shortest paths; order doubles as the BFS queue */
+    distance[source] = 0;
+    sigma[source] = 1.0;
+    order[tail++] = source;
+    while (head < tail)
+    {
+        int32 u = order[head++];
+        int64 e;
+
+        for (e = csr->out_offsets[u]; e < csr->out_offsets[u + 1]; e++)
+        {
+            int32 w = csr->out_targets[e];
+
+            if (distance[w] == -1)
+            {
+                distance[w] = distance[u] + 1;
+                order[tail++] = w;
+            }
+            if (distance[w] == distance[u] + 1)
+            {
+                sigma[w] += sigma[u];
+            }
+        }
+    }
+
+    /* accumulate the dependencies, farthest vertices first */
+    for (k = tail - 1; k > 0; k--)
+    {
+        int32 w = order[k];
+        float8 coefficient = (1.0 + delta[w]) / sigma[w];
+        int64 e;
+
+        for (e = csr->in_offsets[w]; e < csr->in_offsets[w + 1]; e++)
+        {
+            int32 u = csr->in_sources[e];
+
+            if (distance[u] == distance[w] - 1)
+            {
+                delta[u] += sigma[u] * coefficient;
+            }
+        }
+
+        scores[w] += delta[w];
+    }
+
+    /* reset only what this search touched */
+    for (k = 0; k < tail; k++)
+    {
+        distance[order[k]] = -1;
+        sigma[order[k]] = 0.0;
+        delta[order[k]] = 0.0;
+    }
+}
+
+/* helper function to scale sampled betweenness scores up to estimates */
+static void scale_betweenness(float8 *scores, int32 n, int32 num_sources)
+{
+    float8 scale;
+    int32 v;
+
+    if (num_sources >= n)
+    {
+        return;
+    }
+
+    scale = (float8) n / num_sources;
+    for (v = 0; v < n; v++)
+    {
+        scores[v] *= scale;
+    }
+}
+
+/*
+ * Betweenness centrality by Brandes' algorithm over the CSR out edges,
+ * unweighted, in the calling backend.
+ *
+ * If sample_size is less than the number of vertices, only that many
+ * sources, chosen at random with a fixed seed, are searched and the scores
+ * are scaled up by num_vertices / sample_size to estimate the exact ones.
+ * The scores are stored in scores, which must hold csr->num_vertices values.
+ */
+static void compute_betweenness(GraphCSR *csr, int64 sample_size,
+                                float8 *scores)
+{
+    betweenness_work *work = NULL;
+    int32 *sources = NULL;
+    int32 n = csr->num_vertices;
+    int32 num_sources;
+    int32 i;
+
+    memset(scores, 0, sizeof(float8) * n);
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    sources = choose_betweenness_sources(n, sample_size, &num_sources);
+    work = create_betweenness_work(n);
+
+    for (i = 0; i < num_sources; i++)
+    {
+        CHECK_FOR_INTERRUPTS();
+
+        accumulate_betweenness(csr, sources[i], work, scores);
+    }
+
+    scale_betweenness(scores, n, num_sources);
+
+    pfree(sources);
+    free_betweenness_work(work);
+}
+
+/*
+ * The parallel betweenness state is the sources, followed by a score array
+ * of num_vertices values for each participant.
+ */
+#define BETWEENNESS_SCORES_OFFSET(num_sources) \
+    MAXALIGN(sizeof(int32) * (Size) (num_sources))
+
+/*
+ * Run the betweenness sources as one participant: claim blocks of sources
+ * until there are none left, accumulating the dependencies into the
+ * participant's own score array.
+ */
+static void run_betweenness_participant(GraphCSR *csr,
+                                        graph_algorithm_shared *shared,
+                                        char *state, int participant)
+{
+    betweenness_work *work = NULL;
+    int32 *sources = (int32 *) state;
+    float8 *scores = NULL;
+    int64 block;
+
+    scores = (float8 *) (state +
+                         BETWEENNESS_SCORES_OFFSET(shared->num_sources)) +
+             (Size) participant * csr->num_vertices;
+
+    work = create_betweenness_work(csr->num_vertices);
+
+    while (claim_algorithm_block(&shared->next_block[0], shared->num_blocks,
+                                 &block))
+    {
+        int64 first = block * BETWEENNESS_SOURCE_BLOCK_SIZE;
+        int64 last = Min(first + BETWEENNESS_SOURCE_BLOCK_SIZE,
+                         (int64) shared->num_sources);
+        int64 i;
+
+        for (i = first; i < last; i++)
+        {
+            CHECK_FOR_INTERRUPTS();
+
+            accumulate_betweenness(csr, sources[i], work, scores);
+        }
+    }
+
+    free_betweenness_work(work);
+}
+
+/*
+ * Betweenness centrality as compute_betweenness, with the sources spread
+ * over nworkers parallel workers and the leader. Each participant claims
+ * blocks of sources from a shared counter and adds their dependencies into
+ * a score array of its own, so no locking is needed; the leader sums the
+ * arrays once every participant is done. Since the sources that each
+ * participant ends up with vary, the scores can differ from the serial ones
+ * in the last bits.
+ */
+static void compute_betweenness_parallel(GraphCSR *csr, int64 sample_size,
+                                         int nworkers, float8 *scores)
+{
+    graph_algorithm_parallel *pg = NULL;
+    int32 *sources = NULL;
+    float8 *participant_scores = NULL;
+    int32 n = csr->num_vertices;
+    int32 num_sources;
+    int64 num_blocks;
+    Size state_size;
+    int p;
+    int32 v;
+
+    sources = choose_betweenness_sources(n, sample_size, &num_sources);
+    num_blocks = ((int64) num_sources + BETWEENNESS_SOURCE_BLOCK_SIZE - 1) /
+                 BETWEENNESS_SOURCE_BLOCK_SIZE;
+
+    state_size = add_size(BETWEENNESS_SCORES_OFFSET(num_sources),
+                          mul_size(sizeof(float8),
+                                   mul_size((Size) n, nworkers + 1)));
+
+    pg = begin_parallel_graph_algorithm(csr, GRAPH_ALGORITHM_BETWEENNESS,
+                                        nworkers, num_blocks, state_size,
+                                        false);
+    pg->shared->num_sources = num_sources;
+
+    memcpy(pg->state, sources, sizeof(int32) * num_sources);
+    participant_scores = (float8 *) (pg->state +
+                                     BETWEENNESS_SCORES_OFFSET(num_sources));
+    memset(participant_scores, 0,
+           sizeof(float8) * (Size) n * (nworkers + 1));
+
+    launch_parallel_graph_algorithm(pg);
+
+    run_betweenness_participant(csr, pg->shared, pg->state,
+                                pg->shared->num_participants - 1);
+
+    WaitForParallelWorkersToFinish(pg->pcxt);
+
+    /* merge the participants' scores */
+    memset(scores, 0, sizeof(float8) * n);
+    for (p = 0; p < pg->shared->num_participants; p++)
+    {
+        float8 *from = participant_scores + (Size) p * n;
+
+        for (v = 0; v < n; v++)
+        {
+            scores[v] += from[v];
+        }
+    }
+
+    end_parallel_graph_algorithm(pg);
+
+    scale_betweenness(scores, n, num_sources);
+
+    pfree(sources);
+}
+
+/*
+ * age_betweenness(graph, edge_types, sample_size) returns the betweenness
+ * centrality of every vertex of the graph as (vertex_id, score) rows,
+ * following only the edges of edge_types, in their direction. With no
+ * sample_size, or one of at least the number of vertices, the scores are
+ * exact; otherwise they are estimated from sample_size sources. The sources
+ * are searched in parallel workers when the graph is large enough.
+ */
+PG_FUNCTION_INFO_V1(age_betweenness);
+
+Datum age_betweenness(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        float8 *scores = NULL;
+        int64 sample_size;
+        int nworkers;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_betweenness");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_betweenness");
+        sample_size = get_int64_arg(get_optional_arg(fcinfo, 2), PG_INT64_MAX,
+                                    "age_betweenness", "sample_size");
+
+        if (sample_size < 1)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_betweenness: sample_size must be positive")));
+        }
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_betweenness");
+        scores = palloc_extended(sizeof(float8) * Max(csr->num_vertices, 1),
+                                 MCXT_ALLOC_HUGE);
+        nworkers = plan_graph_algorithm_workers(csr);
+        if (nworkers > 0)
+        {
+            compute_betweenness_parallel(csr, sample_size, nworkers, scores);
+        }
+        else
+        {
+            compute_betweenness(csr, sample_size, scores);
+        }
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            result->values[v] = Float8GetDatum(scores[v]);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/* label to community map entry of label propagation */
+typedef struct label_community_entry
+{
+    graphid label;                 /* final label, it is also the hash key */
+    graphid community_id;          /* smallest vertex id with the label */
+} label_community_entry;
+
+/* qsort comparator for graphids */
+static int compare_graphid(const void *a, const void *b)
+{
+    graphid lhs = *(const graphid *) a;
+    graphid rhs = *(const graphid *) b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+/*
+ * Helper function for a label propagation iteration: give each vertex
+ * first .. last - 1 in next the most frequent label in labels among its
+ * neighbors and itself, the smallest label winning a tie. histogram must
+ * hold one more value than the largest neighbor count. Returns true if any
+ * of the labels changed.
+ */
+static bool propagate_labels(GraphCSR *csr, graphid *labels, graphid *next,
+                             graphid *histogram, int32 first, int32 last)
+{
+    bool changed = false;
+    int32 v;
+
+    for (v = first; v < last; v++)
+    {
+        int64 count = 0;
+        int64 best_run = 0;
+        int64 run = 0;
+        int64 i;
+
+        if ((v & 0xFFFF) == 0)
+        {
+            CHECK_FOR_INTERRUPTS();
+        }
+
+        /* sort the labels so that equal labels form runs */
+        histogram[count++] = labels[v];
+        for (i = csr->neighbor_offsets[v]; i < csr->neighbor_offsets[v + 1];
+             i++)
+        {
+            histogram[count++] = labels[csr->neighbors[i]];
+        }
+        if (count > 1)
+        {
+            qsort(histogram, count, sizeof(graphid), compare_graphid);
+        }
+
+        /* the longest run wins; the first, smallest, one on a tie */
+        next[v] = histogram[0];
+        for (i = 0; i < count; i++)
+        {
+            run = (i > 0 && histogram[i] == histogram[i - 1]) ? run + 1 : 1;
+            if (run > best_run)
+            {
+                best_run = run;
+                next[v] = histogram[i];
+            }
+        }
+
+        if (next[v] != labels[v])
+        {
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/* helper function to find the largest neighbor count of the CSR */
+static int64 get_max_neighbor_count(GraphCSR *csr)
+{
+    int64 max_neighbors = 0;
+    int32 v;
+
+    for (v = 0; v < csr->num_vertices; v++)
+    {
+        max_neighbors = Max(max_neighbors, GRAPH_CSR_NEIGHBOR_COUNT(csr, v));
+    }
+
+    return max_neighbors;
+}
+
+/*
+ * Helper function to name each label propagation community by the smallest
+ * vertex id with its label, storing it in community_ids for every vertex.
+ */
+static void name_label_communities(GraphCSR *csr, graphid *labels,
+                                   graphid *community_ids)
+{
+    HTAB *label_min = NULL;
+    HASHCTL label_min_ctl;
+    int32 n = csr->num_vertices;
+    int32 v;
+
+    MemSet(&label_min_ctl, 0, sizeof(label_min_ctl));
+    label_min_ctl.keysize = sizeof(int64);
+    label_min_ctl.entrysize = sizeof(label_community_entry);
+    label_min_ctl.hash = graphid_hash;
+    label_min_ctl.hcxt = CurrentMemoryContext;
+    label_min = hash_create("label propagation communities", 1024,
+                            &label_min_ctl,
+                            HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+
+    for (v = 0; v < n; v++)
+    {
+        label_community_entry *entry = NULL;
+        bool found = false;
+
+        entry = hash_search(label_min, &labels[v], HASH_ENTER, &found);
+        if (!found || csr->vertex_ids[v] < entry->community_id)
+        {
+            entry->community_id = csr->vertex_ids[v];
+        }
+    }
+    for (v = 0; v < n; v++)
+    {
+        label_community_entry *entry = NULL;
+
+        entry = hash_search(label_min, &labels[v], HASH_FIND, NULL);
+        community_ids[v] = entry->community_id;
+    }
+
+    hash_destroy(label_min);
+}
+
+/*
+ * Label propagation over the undirected neighbor lists. Every vertex starts
+ * with its own id as its label. In each iteration all of the vertices take,
+ * at once, the most frequent label among their neighbors and themselves,
+ * the smallest label winning a tie. Counting a vertex's own label keeps
+ * synchronous updates from oscillating between two labels. Iteration stops
+ * when nothing changes or after max_iterations. The vertices that end with
+ * the same label form a community, identified by the smallest vertex id in
+ * it, which is stored in community_ids for every vertex; community_ids must
+ * hold csr->num_vertices values. The neighbor lists must have been built.
+ */
+static void compute_label_propagation(GraphCSR *csr, int64 max_iterations,
+                                      graphid *community_ids)
+{
+    graphid *labels = NULL;
+    graphid *next = NULL;
+    graphid *histogram = NULL;
+    int64 iteration;
+    int32 n = csr->num_vertices;
+    int32 v;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    labels = palloc_extended(sizeof(graphid) * n, MCXT_ALLOC_HUGE);
+    next = palloc_extended(sizeof(graphid) * n, MCXT_ALLOC_HUGE);
+    for (v = 0; v < n; v++)
+    {
+        labels[v] = csr->vertex_ids[v];
+    }
+    histogram = palloc_extended(sizeof(graphid) *
+                                (get_max_neighbor_count(csr) + 1),
+                                MCXT_ALLOC_HUGE);
+
+    for (iteration = 0; iteration < max_iterations; iteration++)
+    {
+        bool changed = propagate_labels(csr, labels, next, histogram, 0, n);
+
+        /* swap in the new labels */
+        {
+            graphid *temp = labels;
+
+            labels = next;
+            next = temp;
+        }
+
+        if (!changed)
+        {
+            break;
+        }
+    }
+
+    name_label_communities(csr, labels, community_ids);
+
+    pfree(labels);
+    pfree(next);
+    pfree(histogram);
+}
+
+/*
+ * The parallel label propagation state: two label arrays, used in turn, and
+ * whether each block changed, for the last two iterations.
+ */
+typedef struct label_propagation_state
+{
+    graphid *labels[2];            /* iteration i reads labels[i % 2] */
+    bool *changed[2];              /* per block, written by iteration i */
+} label_propagation_state;
+
+/* helper function to find the label propagation arrays in the state chunk */
+static void get_label_propagation_state(char *state, int32 n,
+                                        int64 num_blocks,
+                                        label_propagation_state *lps)
+{
+    graphid *labels = (graphid *) state;
+    bool *changed = (bool *) (labels + 2 * (Size) n);
+
+    lps->labels[0] = labels;
+    lps->labels[1] = labels + n;
+    lps->changed[0] = changed;
+    lps->changed[1] = changed + num_blocks;
+}
+
+/* helper function to see if any block changed its labels */
+static bool any_block_changed(bool *changed, int64 num_blocks)
+{
+    int64 b;
+
+    for (b = 0; b < num_blocks; b++)
+    {
+        if (changed[b])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Take part in a parallel label propagation run. Iteration i is phase i: the
+ * participants read labels[i % 2] and write the new labels of the blocks
+ * they claim into labels[(i + 1) % 2], so the update stays synchronous. At
+ * the start of each iteration every participant makes the same decision to
+ * stop, from whether any block changed in the last one. Returns the number
+ * of iterations run.
+ */
+static int64 run_label_propagation_participant(GraphCSR *csr,
+                                               graph_algorithm_shared *shared,
+                                               char *state)
+{
+    label_propagation_state lps;
+    graphid *histogram = NULL;
+    int32 n = csr->num_vertices;
+    int phase;
+
+    get_label_propagation_state(state, n, shared->num_blocks, &lps);
+    histogram = palloc_extended(sizeof(graphid) * (shared->max_neighbors + 1),
+                                MCXT_ALLOC_HUGE);
+
+    phase = BarrierAttach(&shared->barrier);
+
+    for (;;)
+    {
+        pg_atomic_uint64 *next_block = NULL;
+        int64 iteration = phase;
+        int64 block;
+
+        if (iteration >= shared->max_iterations ||
+            (iteration > 0 &&
+             !any_block_changed(lps.changed[(iteration - 1) % 2],
+                                shared->num_blocks)))
+        {
+            break;
+        }
+
+        next_block = &shared->next_block[phase %
+                                         GRAPH_ALGORITHM_PHASE_COUNTERS];
+        while (claim_algorithm_block(next_block, shared->num_blocks, &block))
+        {
+            int32 first;
+            int32 last;
+
+            CHECK_FOR_INTERRUPTS();
+
+            get_vertex_block(block, n, &first, &last);
+            lps.changed[iteration % 2][block] = propagate_labels(
+                csr, lps.labels[iteration % 2],
+                lps.labels[(iteration + 1) % 2], histogram, first, last);
+        }
+
+        phase = advance_algorithm_phase(shared);
+    }
+
+    BarrierDetach(&shared->barrier);
+    pfree(histogram);
+
+    return phase;
+}
+
+/*
+ * Label propagation as compute_label_propagation, with each iteration's
+ * vertex ranges spread over nworkers parallel workers and the leader, and a
+ * barrier between iterations. Every vertex's new label depends only on the
+ * labels of the last iteration, so the communities are the same as the
+ * serial ones. The neighbor lists must have been built.
+ */
+static void compute_label_propagation_parallel(GraphCSR *csr,
+                                               int64 max_iterations,
+                                               int nworkers,
+                                               graphid *community_ids)
+{
+    graph_algorithm_parallel *pg = NULL;
+    label_propagation_state lps;
+    int32 n = csr->num_vertices;
+    int64 num_blocks = count_vertex_blocks(n);
+    int64 iterations;
+    Size state_size;
+    int32 v;
+
+    state_size = add_size(mul_size(sizeof(graphid), mul_size(2, (Size) n)),
+                          mul_size(sizeof(bool), 2 * num_blocks));
+
+    pg = begin_parallel_graph_algorithm(csr,
+                                        GRAPH_ALGORITHM_LABEL_PROPAGATION,
+                                        nworkers, num_blocks, state_size,
+                                        false);
+    pg->shared->max_iterations = max_iterations;
+    pg->shared->max_neighbors = get_max_neighbor_count(csr);
+
+    get_label_propagation_state(pg->state, n, num_blocks, &lps);
+    for (v = 0; v < n; v++)
+    {
+        lps.labels[0][v] = csr->vertex_ids[v];
+    }
+
+    launch_parallel_graph_algorithm(pg);
+
+    iterations = run_label_propagation_participant(csr, pg->shared,
+                                                   pg->state);
+
+    WaitForParallelWorkersToFinish(pg->pcxt);
+
+    name_label_communities(csr, lps.labels[iterations % 2], community_ids);
+
+    end_parallel_graph_algorithm(pg);
+}
+
+/*
+ * age_label_propagation(graph, edge_types, max_iterations) returns the
+ * label propagation community of every vertex of the graph as (vertex_id,
+ * community_id) rows, treating the edges of edge_types as undirected. At
+ * most max_iterations iterations, 10 by default, are run. A community is
+ * identified by the smallest vertex id in it. Each iteration is split over
+ * parallel workers when the graph is large enough.
+ */
+PG_FUNCTION_INFO_V1(age_label_propagation);
+
+Datum age_label_propagation(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        graphid *community_ids = NULL;
+        int64 max_iterations;
+        int nworkers;
+        int32 v;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_label_propagation");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_label_propagation");
+        max_iterations = get_int64_arg(get_optional_arg(fcinfo, 2),
+                                       LABEL_PROPAGATION_DEFAULT_MAX_ITERATIONS,
+                                       "age_label_propagation",
+                                       "max_iterations");
+
+        if (max_iterations < 0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_label_propagation: max_iterations cannot be negative")));
+        }
+
+        /* build the CSR and run the algorithm in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_label_propagation");
+        build_graph_csr_neighbors(csr);
+        community_ids = palloc_extended(sizeof(graphid) *
+                                        Max(csr->num_vertices, 1),
+                                        MCXT_ALLOC_HUGE);
+
+        nworkers = plan_graph_algorithm_workers(csr);
+        if (nworkers > 0)
+        {
+            compute_label_propagation_parallel(csr, max_iterations, nworkers,
+                                               community_ids);
+        }
+        else
+        {
+            compute_label_propagation(csr, max_iterations, community_ids);
+        }
+
+        /* store the results across calls */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 1);
+        for (v = 0; v < csr->num_vertices; v++)
+        {
+            result->values[v] = GRAPHID_GET_DATUM(community_ids[v]);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/* the neighborhood similarity metrics of age_node_similarity */
+typedef enum similarity_metric
+{
+    SIMILARITY_JACCARD,            /* |A & B| / |A | B| */
+    SIMILARITY_OVERLAP,            /* |A & B| / min(|A|, |B|) */
+    SIMILARITY_COSINE              /* |A & B| / sqrt(|A| * |B|) */
+} similarity_metric;
+
+/* a vertex similar to the one being scored */
+typedef struct similarity_candidate
+{
+    float8 similarity;             /* its similarity */
+    graphid vertex_id;             /* its vertex id */
+} similarity_candidate;
+
+/* helper function to rank candidates: lower similarity, then higher id */
+static bool is_worse_candidate(similarity_candidate *a,
+                               similarity_candidate *b)
+{
+    return a->similarity < b->similarity ||
+           (a->similarity == b->similarity && a->vertex_id > b->vertex_id);
+}
+
+/* qsort comparator to order candidates best first */
+static int compare_candidates(const void *a, const void *b)
+{
+    similarity_candidate *lhs = (similarity_candidate *) a;
+    similarity_candidate *rhs = (similarity_candidate *) b;
+
+    if (is_worse_candidate(rhs, lhs))
+    {
+        return -1;
+    }
+    if (is_worse_candidate(lhs, rhs))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Helper function to offer a candidate to a bounded heap of the best
+ * heap_size candidates, the worst kept candidate at the top.
+ */
+static void offer_candidate(similarity_candidate *heap, int32 *heap_count,
+                            int32 heap_size, similarity_candidate *candidate)
+{
+    int32 i;
+
+    if (*heap_count < heap_size)
+    {
+        /* add it at the bottom and sift it up */
+        i = (*heap_count)++;
+        while (i > 0 && is_worse_candidate(candidate, &heap[(i - 1) / 2]))
+        {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = *candidate;
+        return;
+    }
+
+    if (!is_worse_candidate(&heap[0], candidate))
+    {
+        return;
+    }
+
+    /* replace the worst and sift it down */
+    i = 0;
+    for (;;)
+    {
+        int32 child = 2 * i + 1;
+
+        if (child >= *heap_count)
+        {
+            break;
+        }
+        if (child + 1 < *heap_count &&
+            is_worse_candidate(&heap[child + 1], &heap[child]))
+        {
+            child++;
+        }
+        if (!is_worse_candidate(&heap[child], candidate))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = *candidate;
+}
+
+/* a result row of node similarity, as sent from a worker to the leader */
+typedef struct similarity_row
+{
+    int32 source;                  /* the vertex index being scored */
+    similarity_candidate candidate;
+} similarity_row;
+
+/* node similarity result rows, in no particular order */
+typedef struct similarity_rows
+{
+    similarity_row *rows;
+    int64 num_rows;
+    int64 capacity;
+} similarity_rows;
+
+/* the work arrays of one node similarity participant */
+typedef struct similarity_work
+{
+    int32 *shared;                 /* neighbors shared with u, per vertex */
+    int32 *touched;                /* the vertices with shared[x] > 0 */
+    similarity_candidate *heap;    /* the best candidates so far */
+} similarity_work;
+
+/*
+ * Helper function to build the CSR that node similarity works on: the
+ * sorted, duplicate free out neighborhoods of a CSR copy, and from them,
+ * who points at each vertex. Only the vertex ids and the out and in edges
+ * are set; the vertex ids are those of csr, not a copy.
+ */
+static GraphCSR *build_similarity_csr(GraphCSR *csr)
+{
+    GraphCSR *simple = NULL;
+    int64 *in_next = NULL;
+    int64 write = 0;
+    int32 n = csr->num_vertices;
+    int32 u;
+
+    simple = palloc0(sizeof(GraphCSR));
+    simple->num_vertices = n;
+    simple->vertex_ids = csr->vertex_ids;
+
+    /* the sorted, duplicate free out neighborhoods */
+    simple->out_offsets = palloc_extended(sizeof(int64) * (n + 1),
+                                          MCXT_ALLOC_HUGE);
+    simple->out_targets = palloc_extended(sizeof(int32) *
+                                          Max(csr->num_edges, 1),
+                                          MCXT_ALLOC_HUGE);
+    for (u = 0; u < n; u++)
+    {
+        int64 start = csr->out_offsets[u];
+        int64 count = GRAPH_CSR_OUT_DEGREE(csr, u);
+        int64 i;
+
+        memcpy(&simple->out_targets[start], &csr->out_targets[start],
+               sizeof(int32) * count);
+        if (count > 1)
+        {
+            qsort(&simple->out_targets[start], count, sizeof(int32),
+                  compare_graph_csr_vertex_index);
+        }
+
+        simple->out_offsets[u] = write;
+        for (i = 0; i < count; i++)
+        {
+            if (i == 0 || simple->out_targets[start + i] !=
+                          simple->out_targets[start + i - 1])
+            {
+                simple->out_targets[write++] = simple->out_targets[start + i];
+            }
+        }
+    }
+    simple->out_offsets[n] = write;
+    simple->num_edges = write;
+
+    /* and who points at each vertex, from them */
+    simple->in_offsets = palloc_extended(sizeof(int64) * (n + 1),
+                                         MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    simple->in_sources = palloc_extended(sizeof(int32) * Max(write, 1),
+                                         MCXT_ALLOC_HUGE);
+    for (u = 0; u < n; u++)
+    {
+        int64 i;
+
+        for (i = simple->out_offsets[u]; i < simple->out_offsets[u + 1]; i++)
+        {
+            simple->in_offsets[simple->out_targets[i] + 1]++;
+        }
+    }
+    for (u = 0; u < n; u++)
+    {
+        simple->in_offsets[u + 1] += simple->in_offsets[u];
+    }
+
+    in_next = palloc_extended(sizeof(int64) * Max(n, 1), MCXT_ALLOC_HUGE);
+    memcpy(in_next, simple->in_offsets, sizeof(int64) * n);
+    for (u = 0; u < n; u++)
+    {
+        int64 i;
+
+        for (i = simple->out_offsets[u]; i < simple->out_offsets[u + 1]; i++)
+        {
+            simple->in_sources[in_next[simple->out_targets[i]]++] = u;
+        }
+    }
+    pfree(in_next);
+
+    return simple;
+}
+
+/* helper function to free the CSR built by build_similarity_csr */
+static void free_similarity_csr(GraphCSR *simple)
+{
+    /* the vertex ids are borrowed */
+    simple->vertex_ids = NULL;
+    free_graph_csr(simple);
+}
+
+/* helper function to allocate the work arrays of a similarity participant */
+static similarity_work *create_similarity_work(int32 n, int32 heap_size)
+{
+    similarity_work *work = NULL;
+
+    work = palloc(sizeof(similarity_work));
+    work->shared = palloc_extended(sizeof(int32) * n,
+                                   MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    work->touched = palloc_extended(sizeof(int32) * n, MCXT_ALLOC_HUGE);
+    work->heap = palloc_extended(sizeof(similarity_candidate) * heap_size,
+                                 MCXT_ALLOC_HUGE);
+
+    return work;
+}
+
+static void free_similarity_work(similarity_work *work)
+{
+    pfree(work->shared);
+    pfree(work->touched);
+    pfree(work->heap);
+    pfree(work);
+}
+
+/*
+ * Find the heap_size vertices most similar to u, over the CSR built by
+ * build_similarity_csr. The vertices sharing an out neighbor with u are
+ * found by walking back along the in edges of its neighbors, counting the
+ * shared neighbors in a dense array. Each is scored by the metric and
+ * offered to a bounded heap of the best, which is left in work->heap, best
+ * first. Returns the number of candidates kept.
+ */
+static int32 find_similar_vertices(GraphCSR *simple, int32 u,
+                                   similarity_metric metric, int32 heap_size,
+                                   similarity_work *work)
+{
+    float8 u_degree = (float8) GRAPH_CSR_OUT_DEGREE(simple, u);
+    int32 *shared = work->shared;
+    int32 *touched = work->touched;
+    int32 num_touched = 0;
+    int32 heap_count = 0;
+    int64 i;
+    int32 t;
+
+    /* count the neighbors u shares with every other vertex */
+    for (i = simple->out_offsets[u]; i < simple->out_offsets[u + 1]; i++)
+    {
+        int32 w = simple->out_targets[i];
+        int64 j;
+
+        for (j = simple->in_offsets[w]; j < simple->in_offsets[w + 1]; j++)
+        {
+            int32 x = simple->in_sources[j];
+
+            if (x == u)
+            {
+                continue;
+            }
+            if (shared[x] == 0)
+            {
+                touched[num_touched++] = x;
+            }
+            shared[x]++;
+        }
+    }
+
+    /* score them, keeping the best */
+    for (t = 0; t < num_touched; t++)
+    {
+        int32 x = touched[t];
+        float8 x_degree = (float8) GRAPH_CSR_OUT_DEGREE(simple, x);
+        float8 common = (float8) shared[x];
+        similarity_candidate candidate;
+
+        switch (metric)
+        {
+        case SIMILARITY_JACCARD:
+            candidate.similarity = common / (u_degree + x_degree - common);
+            break;
+        case SIMILARITY_OVERLAP:
+            candidate.similarity = common / Min(u_degree, x_degree);
+            break;
+        case SIMILARITY_COSINE:
+            candidate.similarity = common / sqrt(u_degree * x_degree);
+            break;
+        }
+        candidate.vertex_id = simple->vertex_ids[x];
+
+        offer_candidate(work->heap, &heap_count, heap_size, &candidate);
+        shared[x] = 0;
+    }
+
+    /* best first */
+    if (heap_count > 1)
+    {
+        qsort(work->heap, heap_count, sizeof(similarity_candidate),
+              compare_candidates);
+    }
+
+    return heap_count;
+}
+
+/*
+ * Node similarity over out neighborhoods, in the calling backend. For every
+ * vertex u with out edges, its top_k most similar vertices are appended to
+ * the result best first as (u, other vertex id, similarity) rows. Parallel
+ * edges count once.
+ */
+static void compute_node_similarity(GraphCSR *csr, int64 top_k,
+                                    similarity_metric metric,
+                                    graph_algorithm_result *result)
+{
+    GraphCSR *simple = NULL;
+    similarity_work *work = NULL;
+    int32 heap_size;
+    int32 n = csr->num_vertices;
+    int32 u;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    heap_size = (int32) Min(top_k, (int64) n);
+
+    simple = build_similarity_csr(csr);
+    work = create_similarity_work(n, heap_size);
+
+    for (u = 0; u < n; u++)
+    {
+        int32 heap_count;
+        int32 t;
+
+        CHECK_FOR_INTERRUPTS();
+
+        heap_count = find_similar_vertices(simple, u, metric, heap_size,
+                                           work);
+
+        /* the rows of u, best first */
+        for (t = 0; t < heap_count; t++)
+        {
+            Datum values[2];
+
+            values[0] = GRAPHID_GET_DATUM(work->heap[t].vertex_id);
+            values[1] = Float8GetDatum(work->heap[t].similarity);
+            append_algorithm_result_row(result, csr->vertex_ids[u], values);
+        }
+    }
+
+    free_similarity_work(work);
+    free_similarity_csr(simple);
+}
+
+/* helper function to add a row to a set of similarity rows */
+static void append_similarity_row(similarity_rows *rows, similarity_row *row)
+{
+    if (rows->num_rows == rows->capacity)
+    {
+        rows->capacity = Max(rows->capacity * 2, 1024);
+        rows->rows = (rows->rows == NULL) ?
+            palloc_extended(sizeof(similarity_row) * rows->capacity,
+                            MCXT_ALLOC_HUGE) :
+            repalloc_huge(rows->rows,
+                          sizeof(similarity_row) * rows->capacity);
+    }
+
+    rows->rows[rows->num_rows++] = *row;
+}
+
+/* qsort comparator to order similarity rows by source, then best first */
+static int compare_similarity_rows(const void *a, const void *b)
+{
+    similarity_row *lhs = (similarity_row *) a;
+    similarity_row *rhs = (similarity_row *) b;
+
+    if (lhs->source != rhs->source)
+    {
+        return (lhs->source > rhs->source) - (lhs->source < rhs->source);
+    }
+
+    return compare_candidates(&lhs->candidate, &rhs->candidate);
+}
+
+/* helper function to send a worker's buffered similarity rows */
+static void send_similarity_rows(shm_mq_handle *queue, similarity_rows *rows)
+{
+    shm_mq_result result;
+
+    if (rows->num_rows == 0)
+    {
+        return;
+    }
+
+    result = shm_mq_send(queue, sizeof(similarity_row) * rows->num_rows,
+                         rows->rows, false, false);
+
+    /* the leader only detaches when it is erroring out */
+    if (result == SHM_MQ_DETACHED)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_ADMIN_SHUTDOWN),
+                 errmsg("parallel node similarity leader detached")));
+    }
+
+    rows->num_rows = 0;
+}
+
+/*
+ * Score blocks of sources as one participant until there are none left. A
+ * worker sends the rows to the leader through its queue, in messages of up
+ * to SIMILARITY_MESSAGE_ROWS rows; the leader adds them to rows.
+ */
+static void run_similarity_participant(GraphCSR *simple,
+                                       graph_algorithm_shared *shared,
+                                       shm_mq_handle *queue,
+                                       similarity_rows *rows)
+{
+    similarity_work *work = NULL;
+    similarity_rows buffer;
+    int64 block;
+
+    work = create_similarity_work(simple->num_vertices, shared->heap_size);
+
+    /* a worker buffers its rows until there are enough to send */
+    MemSet(&buffer, 0, sizeof(buffer));
+    if (queue != NULL)
+    {
+        rows = &buffer;
+    }
+
+    while (claim_algorithm_block(&shared->next_block[0], shared->num_blocks,
+                                 &block))
+    {
+        int64 first = block * SIMILARITY_SOURCE_BLOCK_SIZE;
+        int64 last = Min(first + SIMILARITY_SOURCE_BLOCK_SIZE,
+                         (int64) simple->num_vertices);
+        int64 u;
+
+        for (u = first; u < last; u++)
+        {
+            int32 heap_count;
+            int32 t;
+
+            CHECK_FOR_INTERRUPTS();
+
+            heap_count = find_similar_vertices(simple, (int32) u,
+                                               (similarity_metric)
+                                               shared->metric,
+                                               shared->heap_size, work);
+
+            for (t = 0; t < heap_count; t++)
+            {
+                similarity_row row;
+
+                row.source = (int32) u;
+                row.candidate = work->heap[t];
+                append_similarity_row(rows, &row);
+            }
+
+            if (queue != NULL && rows->num_rows >= SIMILARITY_MESSAGE_ROWS)
+            {
+                send_similarity_rows(queue, rows);
+            }
+        }
+    }
+
+    if (queue != NULL)
+    {
+        send_similarity_rows(queue, rows);
+        pfree_if_not_null(buffer.rows);
+    }
+
+    free_similarity_work(work);
+}
+
+/*
+ * Collect the rows sent by the workers until all of them have detached,
+ * taking one message from each queue in turn.
+ */
+static void receive_similarity_rows(graph_algorithm_parallel *pg,
+                                    similarity_rows *rows)
+{
+    int num_queues = pg->pcxt->nworkers;
+    int num_active = 0;
+    int i;
+
+    for (i = 0; i < num_queues; i++)
+    {
+        if (pg->queues[i] != NULL)
+        {
+            num_active++;
+        }
+    }
+
+    while (num_active > 0)
+    {
+        bool received = false;
+
+        CHECK_FOR_INTERRUPTS();
+
+        for (i = 0; i < num_queues; i++)
+        {
+            shm_mq_result result;
+            Size nbytes;
+            void *data;
+            Size r;
+
+            if (pg->queues[i] == NULL)
+            {
+                continue;
+            }
+
+            result = shm_mq_receive(pg->queues[i], &nbytes, &data, true);
+
+            if (result == SHM_MQ_DETACHED)
+            {
+                /* done, or failed; a failure is reported when waiting */
+                shm_mq_detach(pg->queues[i]);
+                pg->queues[i] = NULL;
+                num_active--;
+                continue;
+            }
+
+            if (result == SHM_MQ_WOULD_BLOCK)
+            {
+                continue;
+            }
+
+            /* the message is only valid until the next receive, so copy it */
+            for (r = 0; r < nbytes / sizeof(similarity_row); r++)
+            {
+                similarity_row row;
+
+                memcpy(&row, (char *) data + r * sizeof(similarity_row),
+                       sizeof(similarity_row));
+                append_similarity_row(rows, &row);
+            }
+            received = true;
+        }
+
+        if (!received && num_active > 0)
+        {
+            (void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+                             GRAPH_ALGORITHM_WAIT_EVENT);
+            ResetLatch(MyLatch);
+        }
+    }
+}
+
+/*
+ * Node similarity as compute_node_similarity, with the sources split over
+ * nworkers parallel workers. Every source's top_k heap is independent of
+ * the others, so the workers claim blocks of sources from a shared counter
+ * and send their rows to the leader, which merges them. The leader only
+ * scores sources itself if no worker could be launched. Sorting the merged
+ * rows by source, then best first, gives the same rows in the same order as
+ * the serial path.
+ */
+static void compute_node_similarity_parallel(GraphCSR *csr, int64 top_k,
+                                             similarity_metric metric,
+                                             int nworkers,
+                                             graph_algorithm_result *result)
+{
+    graph_algorithm_parallel *pg = NULL;
+    GraphCSR *simple = NULL;
+    similarity_rows rows;
+    int32 n = csr->num_vertices;
+    int64 num_blocks;
+    int64 r;
+
+    simple = build_similarity_csr(csr);
+    num_blocks = ((int64) n + SIMILARITY_SOURCE_BLOCK_SIZE - 1) /
+                 SIMILARITY_SOURCE_BLOCK_SIZE;
+
+    pg = begin_parallel_graph_algorithm(simple,
+                                        GRAPH_ALGORITHM_NODE_SIMILARITY,
+                                        nworkers, num_blocks, 0, true);
+    pg->shared->heap_size = (int32) Min(top_k, (int64) n);
+    pg->shared->metric = (int) metric;
+
+    launch_parallel_graph_algorithm(pg);
+
+    MemSet(&rows, 0, sizeof(rows));
+    receive_similarity_rows(pg, &rows);
+
+    /* without workers, the leader scores the sources itself */
+    run_similarity_participant(simple, pg->shared, NULL, &rows);
+
+    WaitForParallelWorkersToFinish(pg->pcxt);
+    end_parallel_graph_algorithm(pg);
+
+    if (rows.num_rows > 1)
+    {
+        qsort(rows.rows, rows.num_rows, sizeof(similarity_row),
+              compare_similarity_rows);
+    }
+
+    for (r = 0; r < rows.num_rows; r++)
+    {
+        Datum values[2];
+
+        values[0] = GRAPHID_GET_DATUM(rows.rows[r].candidate.vertex_id);
+        values[1] = Float8GetDatum(rows.rows[r].candidate.similarity);
+        append_algorithm_result_row(result,
+                                    csr->vertex_ids[rows.rows[r].source],
+                                    values);
+    }
+
+    pfree_if_not_null(rows.rows);
+    free_similarity_csr(simple);
+}
+
+/*
+ * age_node_similarity(graph, edge_types, top_k, metric) returns, for every
+ * vertex of the graph with out edges of edge_types, its top_k most similar
+ * vertices by out neighborhood as (vertex_id, other_id, similarity) rows,
+ * most similar first. Only vertices sharing at least one neighbor are
+ * similar. The metric is "jaccard", the default, "overlap", or "cosine";
+ * top_k defaults to 10. Ties go to the smaller vertex id.
+ */
+PG_FUNCTION_INFO_V1(age_node_similarity);
+
+Datum age_node_similarity(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    HeapTuple tuple = NULL;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        graph_algorithm_result *result = NULL;
+        similarity_metric metric = SIMILARITY_JACCARD;
+        MemoryContext oldctx;
+        MemoryContext algctx;
+        GraphCSR *csr = NULL;
+        char *graph_name = NULL;
+        char *metric_name = NULL;
+        int64 top_k;
+        int nworkers;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        algctx = init_algorithm_srf(fcinfo, funcctx, "age_node_similarity");
+
+        graph_name = get_graph_name_arg(fcinfo, "age_node_similarity");
+        top_k = get_int64_arg(get_optional_arg(fcinfo, 2),
+                              NODE_SIMILARITY_DEFAULT_TOP_K,
+                              "age_node_similarity", "top_k");
+        metric_name = get_string_arg(get_optional_arg(fcinfo, 3),
+                                     "age_node_similarity", "metric");
+
+        if (top_k < 1)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_node_similarity: top_k must be positive")));
+        }
+
+        if (metric_name == NULL || pg_strcasecmp(metric_name, "jaccard") == 0)
+        {
+            metric = SIMILARITY_JACCARD;
+        }
+        else if (pg_strcasecmp(metric_name, "overlap") == 0)
+        {
+            metric = SIMILARITY_OVERLAP;
+        }
+        else if (pg_strcasecmp(metric_name, "cosine") == 0)
+        {
+            metric = SIMILARITY_COSINE;
+        }
+        else
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_node_similarity: metric must be \"jaccard\", \"overlap\", or \"cosine\"")));
+        }
+
+        /* build the CSR in the child context */
+        MemoryContextSwitchTo(algctx);
+
+        csr = build_graph_csr(graph_name, get_optional_arg(fcinfo, 1), NULL,
+                              "age_node_similarity");
+
+        /* the rows are appended across calls, in the multi call context */
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        result = create_algorithm_result(csr, 2);
+        result->num_rows = 0;
+
+        MemoryContextSwitchTo(algctx);
+
+        nworkers = plan_graph_algorithm_workers(csr);
+        if (nworkers > 0)
+        {
+            compute_node_similarity_parallel(csr, top_k, metric, nworkers,
+                                             result);
+        }
+        else
+        {
+            compute_node_similarity(csr, top_k, metric, result);
+        }
+        funcctx->user_fctx = result;
+
+        MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        MemoryContextDelete(algctx);
+        pfree(graph_name);
+        pfree_if_not_null(metric_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+
+    tuple = next_algorithm_result_row(funcctx);
+    if (tuple == NULL)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+}
+
+/* the state of age_random_walks across calls */
+typedef struct random_walk_state
+{
+    GraphCSR *csr;                 /* the CSR copy being walked */
+    pg_prng_state prng;            /* the walks' random number generator */
+    int32 *sources;                /* vertex indexes to start walks from */
+    int32 num_sources;             /* number of sources */
+    int32 next_source;             /* the source being walked from */
+    int64 walks_left;              /* walks left from that source */
+    int64 walks_per_node;          /* walks to take from each source */
+    int64 walk_length;             /* maximum vertices in a walk */
+    float8 return_weight;          /* 1 / p */
+    float8 in_out_weight;          /* 1 / q */
+    float8 max_weight;             /* the largest of 1 / p, 1 and 1 / q */
+    bool biased;                   /* are p and q not both 1? */
+    Datum *walk;                   /* walk_length vertex ids, reused */
+} random_walk_state;
+
+/* helper function to check whether x is an undirected neighbor of v */
+static bool is_graph_csr_neighbor(GraphCSR *csr, int32 v, int32 x)
+{
+    return bsearch(&x, &csr->neighbors[csr->neighbor_offsets[v]],
+                   GRAPH_CSR_NEIGHBOR_COUNT(csr, v), sizeof(int32),
+                   compare_graph_csr_vertex_index) != NULL;
+}
+
+/*
+ * Helper function to take one walk from source along the CSR out edges,
+ * storing its vertex ids in state->walk. Returns the number of vertices in
+ * the walk, which ends early at a vertex without out edges.
+ *
+ * The first step, and every step of an unbiased walk, picks an out edge
+ * uniformly. Otherwise the node2vec bias applies: stepping from v, having
+ * come from t, to x has weight 1 / p if x is t, 1 if x is adjacent to t,
+ * and 1 / q otherwise. Rather than precomputing an alias table for every
+ * (t, v) pair, which takes memory quadratic in the degrees, each step draws
+ * edges uniformly and accepts one with probability weight / max_weight.
+ */
+static int64 take_random_walk(random_walk_state *state, int32 source)
+{
+    GraphCSR *csr = state->csr;
+    int32 previous = -1;
+    int32 current = source;
+    int64 length = 0;
+
+    state->walk[length++] = GRAPHID_GET_DATUM(csr->vertex_ids[source]);
+
+    while (length < state->walk_length)
+    {
+        int64 degree = GRAPH_CSR_OUT_DEGREE(csr, current);
+        int64 offset = csr->out_offsets[current];
+        int32 next;
+
+        if (degree == 0)
+        {
+            break;
+        }
+
+        for (;;)
+        {
+            float8 weight;
+
+            next = csr->out_targets[offset +
+                                    pg_prng_uint64_range(&state->prng, 0,
+                                                         degree - 1)];
+
+            if (!state->biased || previous == -1)
+            {
+                break;
+            }
+
+            if (next == previous)
+            {
+                weight = state->return_weight;
+            }
+            else if (is_graph_csr_neighbor(csr, previous, next))
+            {
+                weight = 1.0;
+            }
+            else
+            {
+                weight = state->in_out_weight;
+            }
+
+            if (pg_prng_double(&state->prng) * state->max_weight < weight)
+            {
+                break;
+            }
+        }
+
+        state->walk[length++] = GRAPHID_GET_DATUM(csr->vertex_ids[next]);
+        previous = current;
+        current = next;
+    }
+
+    return length;
+}
+
+/*
+ * age_random_walks(graph, start_vertices, walk_length, walks_per_node, p, q,
+ * seed) returns walks_per_node random walks, following out edges, from
+ * each of the start vertices, or from every vertex when start_vertices is
+ * NULL. Each walk is returned as an array of at most walk_length vertex
+ * ids, 80 by default, starting with its start vertex; walks_per_node
+ * defaults to 10. p and q, both 1 by default, are the node2vec return and
+ * in-out parameters. A seed makes the walks repeatable. The walks are
+ * generated as they are returned.
+ */
+PG_FUNCTION_INFO_V1(age_random_walks);
+
+Datum age_random_walks(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    random_walk_state *state = NULL;
+    ArrayType *walk = NULL;
+    int64 length;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        MemoryContext oldctx;
+        agtype *agt_sources = NULL;
+        agtype *agt_seed = NULL;
+        char *graph_name = NULL;
+        float8 p;
+        float8 q;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        state = palloc0(sizeof(random_walk_state));
+
+        graph_name = get_graph_name_arg(fcinfo, "age_random_walks");
+        state->walk_length = get_int64_arg(get_optional_arg(fcinfo, 2),
+                                           RANDOM_WALK_DEFAULT_LENGTH,
+                                           "age_random_walks", "walk_length");
+        state->walks_per_node = get_int64_arg(
+            get_optional_arg(fcinfo, 3), RANDOM_WALK_DEFAULT_WALKS_PER_NODE,
+            "age_random_walks", "walks_per_node");
+        p = get_float8_arg(get_optional_arg(fcinfo, 4), 1.0,
+                           "age_random_walks", "p");
+        q = get_float8_arg(get_optional_arg(fcinfo, 5), 1.0,
+                           "age_random_walks", "q");
+
+        if (state->walk_length < 1 ||
+            state->walk_length > MaxAllocSize / sizeof(Datum))
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_random_walks: walk_length is out of range")));
+        }
+        if (state->walks_per_node < 0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_random_walks: walks_per_node cannot be negative")));
+        }
+        if (isnan(p) || p <= 0.0 || isnan(q) || q <= 0.0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_random_walks: p and q must be positive")));
+        }
+
+        state->return_weight = 1.0 / p;
+        state->in_out_weight = 1.0 / q;
+        state->max_weight = Max(Max(state->return_weight, 1.0),
+                                state->in_out_weight);
+        state->biased = (p != 1.0 || q != 1.0);
+
+        agt_seed = get_optional_arg(fcinfo, 6);
+        if (agt_seed == NULL)
+        {
+            pg_prng_seed(&state->prng, pg_prng_uint64(&pg_global_prng_state));
+        }
+        else
+        {
+            pg_prng_seed(&state->prng,
+                         (uint64) get_int64_arg(agt_seed, 0,
+                                                "age_random_walks", "seed"));
+        }
+
+        /* the CSR stays for the life of the walks */
+        state->csr = build_graph_csr(graph_name, NULL, NULL,
+                                     "age_random_walks");
+        if (state->biased)
+        {
+            build_graph_csr_neighbors(state->csr);
+        }
+
+        /* resolve the start vertices, skipping those not in the graph */
+        agt_sources = get_optional_arg(fcinfo, 1);
+        if (agt_sources == NULL)
+        {
+            int32 v;
+
+            state->num_sources = state->csr->num_vertices;
+            state->sources = palloc_extended(sizeof(int32) *
+                                             Max(state->num_sources, 1),
+                                             MCXT_ALLOC_HUGE);
+            for (v = 0; v < state->num_sources; v++)
+            {
+                state->sources[v] = v;
+            }
+        }
+        else
+        {
+            int64 num_elements = 0;
+            int64 i;
+
+            if (!AGT_ROOT_IS_ARRAY(agt_sources) ||
+                AGT_ROOT_IS_SCALAR(agt_sources))
+            {
+                ereport(ERROR,
+                        (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                         errmsg("age_random_walks: start_vertices must be an array of vertices or integer ids")));
+            }
+
+            num_elements = AGT_ROOT_COUNT(agt_sources);
+            state->sources = palloc(sizeof(int32) * Max(num_elements, 1));
+            for (i = 0; i < num_elements; i++)
+            {
+                agtype_value *agtv_source = NULL;
+                int32 index;
+
+                agtv_source = get_ith_agtype_value_from_container(
+                    &agt_sources->root, i);
+
+                /* null start vertices don't start any walks */
+                if (agtv_source->type == AGTV_NULL)
+                {
+                    continue;
+                }
+                if (agtv_source->type == AGTV_VERTEX)
+                {
+                    agtv_source = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_source,
+                                                                "id");
+                }
+                if (agtv_source->type != AGTV_INTEGER)
+                {
+                    ereport(ERROR,
+                            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                             errmsg("age_random_walks: start_vertices must be an array of vertices or integer ids")));
+                }
+
+                index = get_graph_csr_vertex_index(state->csr,
+                                                   agtv_source->val.int_value);
+                if (index >= 0)
+                {
+                    state->sources[state->num_sources++] = index;
+                }
+            }
+        }
+
+        state->walk = palloc(sizeof(Datum) * state->walk_length);
+        state->next_source = 0;
+        state->walks_left = state->walks_per_node;
+        funcctx->user_fctx = state;
+
+        pfree(graph_name);
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    state = (random_walk_state *) funcctx->user_fctx;
+
+    /* move on to the next source with walks left */
+    while (state->next_source < state->num_sources && state->walks_left == 0)
+    {
+        state->next_source++;
+        state->walks_left = state->walks_per_node;
+    }
+    if (state->next_source >= state->num_sources || state->walks_left == 0)
+    {
+        SRF_RETURN_DONE(funcctx);
+    }
+
+    CHECK_FOR_INTERRUPTS();
+
+    length = take_random_walk(state, state->sources[state->next_source]);
+    state->walks_left--;
+
+    walk = construct_array(state->walk, (int) length, GRAPHIDOID,
+                           sizeof(graphid), FLOAT8PASSBYVAL, TYPALIGN_DOUBLE);
+
+    SRF_RETURN_NEXT(funcctx, PointerGetDatum(walk));
+}
+
+/*
+ * Helper function for a worker to attach to its queue to the leader, as the
+ * sender, or return NULL if the algorithm has no queues.
+ */
+static shm_mq_handle *get_algorithm_worker_queue(dsm_segment *seg,
+                                                 shm_toc *toc)
+{
+    char *queue_space;
+    shm_mq *mq;
+
+    queue_space = shm_toc_lookup(toc, GRAPH_ALGORITHM_KEY_QUEUES, true);
+    if (queue_space == NULL)
+    {
+        return NULL;
+    }
+
+    mq = (shm_mq *) (queue_space +
+                     (Size) ParallelWorkerNumber * GRAPH_ALGORITHM_QUEUE_SIZE);
+    shm_mq_set_sender(mq, MyProc);
+
+    return shm_mq_attach(mq, seg, NULL);
+}
+
+/*
+ * Parallel worker entry point of the whole-graph algorithms. Attach to the
+ * CSR copy in the DSM and take part in the algorithm the leader started.
+ */
+void age_graph_algorithm_worker_main(dsm_segment *seg, shm_toc *toc)
+{
+    graph_algorithm_shared *shared = NULL;
+    GraphCSR *csr = NULL;
+    char *state = NULL;
+
+    shared = shm_toc_lookup(toc, GRAPH_ALGORITHM_KEY_SHARED, false);
+    csr = attach_graph_csr_shared(shm_toc_lookup(toc, GRAPH_ALGORITHM_KEY_CSR,
+                                                 false));
+    state = shm_toc_lookup(toc, GRAPH_ALGORITHM_KEY_STATE, false);
+
+    switch (shared->kind)
+    {
+    case GRAPH_ALGORITHM_PAGERANK:
+        (void) run_pagerank_participant(csr, shared, state);
+        break;
+    case GRAPH_ALGORITHM_WCC:
+        run_wcc_participant(csr, shared, state);
+        break;
+    case GRAPH_ALGORITHM_BETWEENNESS:
+        run_betweenness_participant(csr, shared, state, ParallelWorkerNumber);
+        break;
+    case GRAPH_ALGORITHM_LABEL_PROPAGATION:
+        run_label_propagation_participant(csr, shared, state);
+        break;
+    case GRAPH_ALGORITHM_NODE_SIMILARITY:
+        run_similarity_participant(csr, shared,
+                                   get_algorithm_worker_queue(seg, toc),
+                                   NULL);
+        break;
+    }
+}
@@ -0,0 +1,708 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Compressed sparse row copies of the cached graph.
+ *
+ * The whole-graph algorithms (PageRank, connected components, ...) touch
+ * every vertex and edge many times. Walking the cache for that means a
+ * hashtable lookup per vertex and per edge on every pass, so instead they
+ * build a GraphCSR once: dense vertex numbers and flat int32 adjacency
+ * arrays, filtered by edge type. The copy costs one pass over the cache and
+ * O(V + E) memory, after which each pass is a sequential array scan.
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "miscadmin.h"
+#include "utils/hsearch.h"
+
+#include "catalog/ag_graph.h"
+#include "catalog/ag_label.h"
+#include "utils/age_graph_csr.h"
+
+#define GRAPH_CSR_INITIAL_EDGES 1024
+
+/* vertex id to dense vertex index map entry */
+typedef struct graph_csr_vertex_entry
+{
+    graphid vertex_id;             /* vertex id, it is also the hash key */
+    int32 index;                   /* dense vertex index */
+} graph_csr_vertex_entry;
+
+/*
+ * Resolve an optional edge type filter to the edge label table oids it
+ * allows. A relationship type may be supplied as a bare string, or one or
+ * more types may be supplied as an array of strings. An empty string, an
+ * empty array, or NULL means no filter and returns NULL with *num_label_oids
+ * set to 0. An unknown type resolves to InvalidOid and so matches no edges.
+ */
+Oid *get_edge_type_label_oids(agtype *edge_types, Oid graph_oid, char *fname,
+                              int *num_label_oids)
+{
+    agtype_value *agtv_temp = NULL;
+    Oid *label_oids = NULL;
+    char *label_name = NULL;
+
+    *num_label_oids = 0;
+
+    if (edge_types == NULL || is_agtype_null(edge_types))
+    {
+        return NULL;
+    }
+
+    if (AGT_ROOT_IS_ARRAY(edge_types) && !AGT_ROOT_IS_SCALAR(edge_types))
+    {
+        int nelems = AGT_ROOT_COUNT(edge_types);
+        int i = 0;
+
+        if (nelems > 0)
+        {
+            label_oids = palloc(sizeof(Oid) * nelems);
+        }
+
+        for (i = 0; i < nelems; i++)
+        {
+            agtv_temp = get_ith_agtype_value_from_container(&edge_types->root,
+                                                            i);
+            if (agtv_temp->type != AGTV_STRING)
+            {
+                ereport(ERROR,
+                        (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                         errmsg("%s: relationship type must be a string",
+                                fname)));
+            }
+            /* skip empty type names; they impose no constraint */
+            if (agtv_temp->val.string.len != 0)
+            {
+                label_name = pnstrdup(agtv_temp->val.string.val,
+                                      agtv_temp->val.string.len);
+                label_oids[*num_label_oids] = get_label_relation(label_name,
+                                                                 graph_oid);
+                *num_label_oids = *num_label_oids + 1;
+
+                /* the resolved oid is all we keep; free the type name */
+                pfree(label_name);
+                label_name = NULL;
+            }
+        }
+    }
+    else
+    {
+        agtv_temp = get_agtype_value(fname, edge_types, AGTV_STRING, true);
+        if (agtv_temp->val.string.len != 0)
+        {
+            label_name = pnstrdup(agtv_temp->val.string.val,
+                                  agtv_temp->val.string.len);
+            label_oids = palloc(sizeof(Oid));
+            label_oids[0] = get_label_relation(label_name, graph_oid);
+            *num_label_oids = 1;
+
+            /* the resolved oid is all we keep; free the type name */
+            pfree(label_name);
+            label_name = NULL;
+        }
+    }
+
+    return label_oids;
+}
+
+/* helper function to check an edge against the edge type filter */
+static bool is_edge_type_match(edge_entry *ee, Oid *label_oids,
+                               int num_label_oids)
+{
+    Oid edge_label_oid = InvalidOid;
+    int i;
+
+    if (num_label_oids == 0)
+    {
+        return true;
+    }
+
+    edge_label_oid = get_edge_entry_label_table_oid(ee);
+    for (i = 0; i < num_label_oids; i++)
+    {
+        if (label_oids[i] == edge_label_oid)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* get the dense index of a vertex, or -1 if it isn't in the copy */
+int32 get_graph_csr_vertex_index(GraphCSR *csr, graphid vertex_id)
+{
+    graph_csr_vertex_entry *entry = NULL;
+
+    entry = hash_search(csr->vertex_index, &vertex_id, HASH_FIND, NULL);
+
+    return (entry == NULL) ? -1 : entry->index;
+}
+
+/*
+ * Helper function to get the weight of an edge from one of its properties.
+ * An edge without the property, or with a null value, weighs 1.
+ */
+static float8 get_edge_weight(edge_entry *ee, agtype_value *weight_key,
+                              char *fname)
+{
+    agtype *properties = NULL;
+    agtype_value *agtv_weight = NULL;
+    float8 weight = 1.0;
+    Datum properties_datum;
+
+    properties_datum = get_edge_entry_properties(ee);
+    properties = DATUM_GET_AGTYPE_P(properties_datum);
+
+    agtv_weight = find_agtype_value_from_container(&properties->root,
+                                                   AGT_FOBJECT, weight_key);
+    if (agtv_weight != NULL && agtv_weight->type == AGTV_INTEGER)
+    {
+        weight = (float8) agtv_weight->val.int_value;
+    }
+    else if (agtv_weight != NULL && agtv_weight->type == AGTV_FLOAT)
+    {
+        weight = agtv_weight->val.float_value;
+    }
+    else if (agtv_weight != NULL && agtv_weight->type != AGTV_NULL)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("%s: edge weight must be a number", fname)));
+    }
+
+    if (isnan(weight) || weight < 0.0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("%s: edge weight cannot be negative", fname)));
+    }
+
+    /* the properties are a copy, so don't let them pile up */
+    pfree_if_not_null(agtv_weight);
+    if ((Pointer) properties != DatumGetPointer(properties_datum))
+    {
+        pfree(properties);
+    }
+    pfree(DatumGetPointer(properties_datum));
+
+    return weight;
+}
+
+/* helper function to append an out edge, growing the edge arrays */
+static void append_out_target(GraphCSR *csr, int64 *capacity, int32 target,
+                              float8 weight)
+{
+    if (csr->num_edges == *capacity)
+    {
+        *capacity = *capacity * 2;
+        csr->out_targets = repalloc_huge(csr->out_targets,
+                                         sizeof(int32) * *capacity);
+        if (csr->out_weights != NULL)
+        {
+            csr->out_weights = repalloc_huge(csr->out_weights,
+                                             sizeof(float8) * *capacity);
+        }
+    }
+
+    csr->out_targets[csr->num_edges] = target;
+    if (csr->out_weights != NULL)
+    {
+        csr->out_weights[csr->num_edges] = weight;
+    }
+    csr->num_edges++;
+}
+
+/*
+ * Build a CSR copy of the named graph's cache, keeping only the edges that
+ * pass the edge type filter (see get_edge_type_label_oids). If a weight
+ * property is given, the edge weights are read from it (see
+ * get_edge_weight); otherwise the copy is unweighted. The cache is built
+ * first if need be.
+ */
+GraphCSR *build_graph_csr(char *graph_name, agtype *edge_types,
+                          char *weight_property, char *fname)
+{
+    GRAPH_global_context *ggctx = NULL;
+    GraphCSR *csr = NULL;
+    ListGraphId *vertices = NULL;
+    GraphIdNode *node = NULL;
+    HASHCTL vertex_index_ctl;
+    agtype_value weight_key;
+    Oid graph_oid = InvalidOid;
+    Oid *label_oids = NULL;
+    int num_label_oids = 0;
+    int64 num_vertices = 0;
+    int64 capacity = GRAPH_CSR_INITIAL_EDGES;
+    int64 *in_next = NULL;
+    int64 i = 0;
+    int32 v = 0;
+
+    graph_oid = get_graph_oid(graph_name);
+    if (!OidIsValid(graph_oid))
+    {
+        ereport(ERROR, (errcode(ERRCODE_UNDEFINED_SCHEMA),
+                        errmsg("graph \"%s\" does not exist", graph_name)));
+    }
+
+    label_oids = get_edge_type_label_oids(edge_types, graph_oid, fname,
+                                          &num_label_oids);
+
+    ggctx = manage_GRAPH_global_contexts(graph_name, graph_oid);
+
+    csr = palloc0(sizeof(GraphCSR));
+
+    vertices = (ggctx == NULL) ? NULL : get_graph_vertices(ggctx);
+    num_vertices = (vertices == NULL) ? 0 : get_list_size(vertices);
+    if (num_vertices > PG_INT32_MAX)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                 errmsg("%s: too many vertices in graph \"%s\"", fname,
+                        graph_name)));
+    }
+
+    /* number the vertices */
+    MemSet(&vertex_index_ctl, 0, sizeof(vertex_index_ctl));
+    vertex_index_ctl.keysize = sizeof(int64);
+    vertex_index_ctl.entrysize = sizeof(graph_csr_vertex_entry);
+    vertex_index_ctl.hash = graphid_hash;
+    vertex_index_ctl.hcxt = CurrentMemoryContext;
+    csr->vertex_index = hash_create("graph csr vertex index",
+                                    Max(num_vertices, 16), &vertex_index_ctl,
+                                    HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+
+    csr->num_vertices = (int32) num_vertices;
+    csr->vertex_ids = palloc_extended(sizeof(graphid) * Max(num_vertices, 1),
+                                      MCXT_ALLOC_HUGE);
+
+    v = 0;
+    for (node = (vertices == NULL) ? NULL : get_list_head(vertices);
+         node != NULL; node = next_GraphIdNode(node))
+    {
+        graph_csr_vertex_entry *entry = NULL;
+        graphid vertex_id = get_graphid(node);
+
+        entry = hash_search(csr->vertex_index, &vertex_id, HASH_ENTER, NULL);
+        entry->index = v;
+        csr->vertex_ids[v] = vertex_id;
+        v++;
+    }
+
+    /* the out edges, in vertex order, so they can be appended in one pass */
+    csr->out_offsets = palloc_extended(sizeof(int64) * (num_vertices + 1),
+                                       MCXT_ALLOC_HUGE);
+    csr->out_targets = palloc_extended(sizeof(int32) * capacity,
+                                       MCXT_ALLOC_HUGE);
+    csr->num_edges = 0;
+
+    if (weight_property != NULL)
+    {
+        weight_key.type = AGTV_STRING;
+        weight_key.val.string.val = weight_property;
+        weight_key.val.string.len = strlen(weight_property);
+        csr->out_weights = palloc_extended(sizeof(float8) * capacity,
+                                           MCXT_ALLOC_HUGE);
+    }
+
+    for (v = 0; v < csr->num_vertices; v++)
+    {
+        vertex_entry *ve = NULL;
+        VertexEdgeArray *edges[2];
+        int e;
+
+        if ((v & 0xFFFF) == 0)
+        {
+            CHECK_FOR_INTERRUPTS();
+        }
+
+        csr->out_offsets[v] = csr->num_edges;
+
+        ve = get_vertex_entry(ggctx, csr->vertex_ids[v]);
+        edges[0] = get_vertex_entry_edges_out_array(ve);
+        edges[1] = get_vertex_entry_edges_self_array(ve);
+
+        for (e = 0; e < 2; e++)
+        {
+            int32 j;
+
+            for (j = 0; j < edges[e]->size; j++)
+            {
+                edge_entry *ee = NULL;
+                int32 target;
+
+                ee = get_edge_entry(ggctx, edges[e]->array[j]);
+                if (ee == NULL)
+                {
+                    elog(ERROR, "build_graph_csr: no edge found");
+                }
+
+                if (!is_edge_type_match(ee, label_oids, num_label_oids))
+                {
+                    continue;
+                }
+
+                target = get_graph_csr_vertex_index(
+                            csr, get_edge_entry_end_vertex_id(ee));
+                if (target < 0)
+                {
+                    elog(ERROR, "build_graph_csr: no vertex found");
+                }
+
+                append_out_target(csr, &capacity, target,
+                                  (weight_property == NULL) ? 1.0 :
+                                  get_edge_weight(ee, &weight_key, fname));
+            }
+        }
+    }
+    csr->out_offsets[csr->num_vertices] = csr->num_edges;
+
+    /* the in edges, by a counting sort of the out edges on their target */
+    csr->in_offsets = palloc_extended(sizeof(int64) * (num_vertices + 1),
+                                      MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+    csr->in_sources = palloc_extended(sizeof(int32) * Max(csr->num_edges, 1),
+                                      MCXT_ALLOC_HUGE);
+    if (csr->out_weights != NULL)
+    {
+        csr->in_weights = palloc_extended(sizeof(float8) *
+                                          Max(csr->num_edges, 1),
+                                          MCXT_ALLOC_HUGE);
+    }
+
+    for (i = 0; i < csr->num_edges; i++)
+    {
+        csr->in_offsets[csr->out_targets[i] + 1]++;
+    }
+    for (v = 0; v < csr->num_vertices; v++)
+    {
+        csr->in_offsets[v + 1] += csr->in_offsets[v];
+    }
+
+    in_next = palloc_extended(sizeof(int64) * Max(num_vertices, 1),
+                              MCXT_ALLOC_HUGE);
+    memcpy(in_next, csr->in_offsets, sizeof(int64) * num_vertices);
+
+    for (v = 0; v < csr->num_vertices; v++)
+    {
+        for (i = csr->out_offsets[v]; i < csr->out_offsets[v + 1]; i++)
+        {
+            int64 position = in_next[csr->out_targets[i]]++;
+
+            csr->in_sources[position] = v;
+            if (csr->out_weights != NULL)
+            {
+                csr->in_weights[position] = csr->out_weights[i];
+            }
+        }
+    }
+
+    pfree_if_not_null(in_next);
+    pfree_if_not_null(label_oids);
+
+    return csr;
+}
+
+/* qsort comparator for dense vertex indexes */
+int compare_graph_csr_vertex_index(const void *a, const void *b)
+{
+    int32 lhs = *(const int32 *) a;
+    int32 rhs = *(const int32 *) b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+/*
+ * Fill in the sorted, duplicate free, undirected neighbor lists of a CSR
+ * copy (see GraphCSR). Each vertex's out and in edges are gathered, sorted
+ * once and deduplicated in place, then the lists are compacted. Calling it
+ * again does nothing.
+ */
+void build_graph_csr_neighbors(GraphCSR *csr)
+{
+    int64 *offsets = NULL;
+    int32 *neighbors = NULL;
+    int64 write = 0;
+    int32 v;
+
+    if (csr->neighbors != NULL)
+    {
+        return;
+    }
+
+    offsets = palloc_extended(sizeof(int64) * (csr->num_vertices + 1),
+                              MCXT_ALLOC_HUGE);
+    neighbors = palloc_extended(sizeof(int32) * Max(csr->num_edges * 2, 1),
+                                MCXT_ALLOC_HUGE);
+
+    for (v = 0; v < csr->num_vertices; v++)
+    {
+        int64 start = csr->out_offsets[v] + csr->in_offsets[v];
+        int64 count = 0;
+        int64 i;
+
+        if ((v & 0xFFFF) == 0)
+        {
+            CHECK_FOR_INTERRUPTS();
+        }
+
+        /* gather both directions, skipping self loops */
+        for (i = csr->out_offsets[v]; i < csr->out_offsets[v + 1]; i++)
+        {
+            if (csr->out_targets[i] != v)
+            {
+                neighbors[start + count++] = csr->out_targets[i];
+            }
+        }
+        for (i = csr->in_offsets[v]; i < csr->in_offsets[v + 1]; i++)
+        {
+            if (csr->in_sources[i] != v)
+            {
+                neighbors[start + count++] = csr->in_sources[i];
+            }
+        }
+
+        if (count > 1)
+        {
+            qsort(&neighbors[start], count, sizeof(int32),
+                  compare_graph_csr_vertex_index);
+        }
+
+        /*
+         * Deduplicate while compacting toward the front; write never passes
+         * start, so the lists of later vertices are not overwritten.
+         */
+        offsets[v] = write;
+        for (i = 0; i < count; i++)
+        {
+            if (i == 0 || neighbors[start + i] != neighbors[start + i - 1])
+            {
+                neighbors[write++] = neighbors[start + i];
+            }
+        }
+    }
+    offsets[csr->num_vertices] = write;
+
+    csr->neighbor_offsets = offsets;
+    csr->neighbors = neighbors;
+}
+
+/* free a CSR copy */
+void free_graph_csr(GraphCSR *csr)
+{
+    if (csr == NULL)
+    {
+        return;
+    }
+
+    hash_destroy(csr->vertex_index);
+    pfree_if_not_null(csr->vertex_ids);
+    pfree_if_not_null(csr->out_offsets);
+    pfree_if_not_null(csr->out_targets);
+    pfree_if_not_null(csr->in_offsets);
+    pfree_if_not_null(csr->in_sources);
+    pfree_if_not_null(csr->out_weights);
+    pfree_if_not_null(csr->in_weights);
+    pfree_if_not_null(csr->neighbor_offsets);
+    pfree_if_not_null(csr->neighbors);
+    pfree(csr);
+}
+
+/*
+ * The layout of a CSR copy flattened into one chunk of shared memory. The
+ * arrays follow this header, each at a MAXALIGNed offset from the start of
+ * the chunk; an offset of 0 means that the array is absent.
+ */
+typedef struct graph_csr_shared
+{
+    int32 num_vertices;
+    int64 num_edges;
+    Size size;                     /* size of the whole chunk */
+    Size vertex_ids;
+    Size out_offsets;
+    Size out_targets;
+    Size in_offsets;
+    Size in_sources;
+    Size out_weights;
+    Size in_weights;
+    Size neighbor_offsets;
+    Size neighbors;
+} graph_csr_shared;
+
+/* helper function to place an array of a CSR in the shared chunk */
+static Size add_graph_csr_array(Size *size, void *array, Size array_size)
+{
+    Size offset;
+
+    if (array == NULL)
+    {
+        return 0;
+    }
+
+    offset = *size;
+    *size = add_size(*size, MAXALIGN(array_size));
+
+    return offset;
+}
+
+/* helper function to lay out a CSR copy in a shared chunk */
+static void layout_graph_csr_shared(GraphCSR *csr, graph_csr_shared *layout)
+{
+    Size n = (Size) csr->num_vertices;
+    Size m = (Size) csr->num_edges;
+    Size size = MAXALIGN(sizeof(graph_csr_shared));
+
+    layout->num_vertices = csr->num_vertices;
+    layout->num_edges = csr->num_edges;
+    layout->vertex_ids = add_graph_csr_array(&size, csr->vertex_ids,
+                                             mul_size(sizeof(graphid), n));
+    layout->out_offsets = add_graph_csr_array(&size, csr->out_offsets,
+                                              mul_size(sizeof(int64), n + 1));
+    layout->out_targets = add_graph_csr_array(&size, csr->out_targets,
+                                              mul_size(sizeof(int32), m));
+    layout->in_offsets = add_graph_csr_array(&size, csr->in_offsets,
+                                             mul_size(sizeof(int64), n + 1));
+    layout->in_sources = add_graph_csr_array(&size, csr->in_sources,
+                                             mul_size(sizeof(int32), m));
+    layout->out_weights = add_graph_csr_array(&size, csr->out_weights,
+                                              mul_size(sizeof(float8), m));
+    layout->in_weights = add_graph_csr_array(&size, csr->in_weights,
+                                             mul_size(sizeof(float8), m));
+    layout->neighbor_offsets = add_graph_csr_array(&size,
+                                                   csr->neighbor_offsets,
+                                                   mul_size(sizeof(int64),
+                                                            n + 1));
+    layout->neighbors = add_graph_csr_array(&size, csr->neighbors,
+                                            (csr->neighbors == NULL) ? 0 :
+                                            mul_size(sizeof(int32),
+                                                     csr->neighbor_offsets[n]));
+    layout->size = size;
+}
+
+/*
+ * Return the size of the shared memory chunk that a CSR copy is flattened
+ * into by store_graph_csr_shared, for the parallel algorithms. The optional
+ * neighbor lists are included if they have been built.
+ */
+Size estimate_graph_csr_shared(GraphCSR *csr)
+{
+    graph_csr_shared layout;
+
+    layout_graph_csr_shared(csr, &layout);
+
+    return layout.size;
+}
+
+/*
+ * Flatten a CSR copy into space, a chunk of shared memory of at least
+ * estimate_graph_csr_shared(csr) bytes. The vertex index is not copied.
+ */
+void store_graph_csr_shared(GraphCSR *csr, void *space)
+{
+    graph_csr_shared *layout = (graph_csr_shared *) space;
+    char *base = (char *) space;
+    Size n = (Size) csr->num_vertices;
+    Size m = (Size) csr->num_edges;
+
+    layout_graph_csr_shared(csr, layout);
+
+    if (layout->vertex_ids != 0)
+    {
+        memcpy(base + layout->vertex_ids, csr->vertex_ids,
+               sizeof(graphid) * n);
+    }
+    if (layout->out_offsets != 0)
+    {
+        memcpy(base + layout->out_offsets, csr->out_offsets,
+               sizeof(int64) * (n + 1));
+    }
+    if (layout->out_targets != 0)
+    {
+        memcpy(base + layout->out_targets, csr->out_targets,
+               sizeof(int32) * m);
+    }
+    if (layout->in_offsets != 0)
+    {
+        memcpy(base + layout->in_offsets, csr->in_offsets,
+               sizeof(int64) * (n + 1));
+    }
+    if (layout->in_sources != 0)
+    {
+        memcpy(base + layout->in_sources, csr->in_sources,
+               sizeof(int32) * m);
+    }
+    if (layout->out_weights != 0)
+    {
+        memcpy(base + layout->out_weights, csr->out_weights,
+               sizeof(float8) * m);
+    }
+    if (layout->in_weights != 0)
+    {
+        memcpy(base + layout->in_weights, csr->in_weights,
+               sizeof(float8) * m);
+    }
+    if (layout->neighbor_offsets != 0)
+    {
+        memcpy(base + layout->neighbor_offsets, csr->neighbor_offsets,
+               sizeof(int64) * (n + 1));
+    }
+    if (layout->neighbors != 0)
+    {
+        memcpy(base + layout->neighbors, csr->neighbors,
+               sizeof(int32) * csr->neighbor_offsets[n]);
+    }
+}
+
+/* helper function to find an array of a shared CSR copy, NULL if absent */
+static void *get_graph_csr_array(void *space, Size offset)
+{
+    return (offset == 0) ? NULL : (char *) space + offset;
+}
+
+/*
+ * Return a CSR copy whose arrays point into space, a chunk filled in by
+ * store_graph_csr_shared. The copy is read only, has no vertex index, and
+ * must not be freed with free_graph_csr; only the GraphCSR itself is
+ * allocated, in the current memory context.
+ */
+GraphCSR *attach_graph_csr_shared(void *space)
+{
+    graph_csr_shared *layout = (graph_csr_shared *) space;
+    GraphCSR *csr = NULL;
+
+    csr = palloc0(sizeof(GraphCSR));
+    csr->num_vertices = layout->num_vertices;
+    csr->num_edges = layout->num_edges;
+    csr->vertex_ids = get_graph_csr_array(space, layout->vertex_ids);
+    csr->out_offsets = get_graph_csr_array(space, layout->out_offsets);
+    csr->out_targets = get_graph_csr_array(space, layout->out_targets);
+    csr->in_offsets = get_graph_csr_array(space, layout->in_offsets);
+    csr->in_sources = get_graph_csr_array(space, layout->in_sources);
+    csr->out_weights = get_graph_csr_array(space, layout->out_weights);
+    csr->in_weights = get_graph_csr_array(space, layout->in_weights);
+    csr->neighbor_offsets = get_graph_csr_array(space,
+                                                layout->neighbor_offsets);
+    csr->neighbors = get_graph_csr_array(space, layout->neighbors);
+    csr->vertex_index = NULL;
+
+    return csr;
+}
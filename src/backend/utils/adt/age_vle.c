@@ -55,21 +55,34 @@
  *
  * Implementation pointer
  *
- *   Cycle prevention is enforced by edge_state_entry.used_in_path, set
+ *   Cycle prevention is enforced by the edge_in_path bitset, set
  *   and cleared during DFS traversal in dfs_find_a_path_between() and
  *   dfs_find_a_path_from(). The helper is_edge_in_path() inspects the
  *   current path stack. See those functions for the enforcement site.
+ *
+ * Vertex constraint pushdown
+ *
+ *   The transform may pass a vertex prototype (label and/or properties)
+ *   derived from a WHERE all(x IN nodes(p) WHERE ...) predicate. Every
+ *   vertex reached through a traversed edge is then checked against it in
+ *   add_valid_vertex_edges() and the edge is not pushed if it fails. This
+ *   is pure pruning - the original predicate is still evaluated over the
+ *   emitted paths, so the start vertex (which is not reached through an
+ *   edge) is left to it.
  */
 
 #include "postgres.h"
 
 #include "common/hashfn.h"
+#include "common/int.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "nodes/pg_list.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 
+#include "utils/age_graph_csr.h"
 #include "utils/age_vle.h"
 #include "catalog/ag_graph.h"
 #include "catalog/ag_label.h"
@@ -78,20 +91,19 @@
 /* defines */
 #define GET_GRAPHID_ARRAY_FROM_CONTAINER(vpc) \
             (graphid *) (&vpc->graphid_array_data)
-#define EDGE_STATE_HTAB_NAME "Edge state "
-#define EDGE_STATE_HTAB_INITIAL_SIZE 100000
 #define EXISTS_HTAB_NAME "known edges"
 #define EXISTS_HTAB_NAME_INITIAL_SIZE 1000
+#define VERTEX_STATE_HTAB_NAME "Vertex state "
+#define VERTEX_STATE_HTAB_INITIAL_SIZE 1000
 #define MAXIMUM_NUMBER_OF_CACHED_LOCAL_CONTEXTS 5
+#define EDGE_IN_PATH_INITIAL_BYTES 64
 
-/* edge state entry for the edge_state_hashtable */
-typedef struct edge_state_entry
+/* vertex state entry for the vertex_state_hashtable */
+typedef struct vertex_state_entry
 {
-    graphid edge_id;               /* edge id, it is also the hash key */
-    bool used_in_path;             /* like visited but more descriptive */
-    bool has_been_matched;         /* have we checked for a  match */
-    bool matched;                  /* is it a match */
-} edge_state_entry;
+    graphid vertex_id;             /* vertex id, it is also the hash key */
+    bool matched;                  /* does it match the vertex constraint */
+} vertex_state_entry;
 
 /*
  * VLE_path_function is an enum for the path function to use. This currently can
@@ -124,7 +136,18 @@ typedef struct VLE_local_context
     int64 uidx;                    /* upper (end) bound index */
     bool uidx_infinite;            /* flag if the upper bound is omitted */
     cypher_rel_dir edge_direction; /* the direction of the edge */
-    HTAB *edge_state_hashtable;    /* local state hashtable for our edges */
+    bits8 *edge_in_path;           /* edges in the path, by edge index */
+    Size edge_in_path_bytes;       /* allocated size of edge_in_path */
+    uint64 edge_state_build;       /* ggctx build the edge state is for */
+    EdgeMatchMemo *edge_match_memo; /* memoized edge constraint results */
+    bool owns_edge_match_memo;     /* is the memo private to this context */
+    bool has_vertex_constraint;    /* is there a pushed down vertex filter */
+    char *vertex_label_name;       /* vertex label name for match */
+    int32 vertex_label_id;         /* vertex label id for match */
+    agtype *vertex_property_constraint; /* vertex property constraint */
+    HTAB *vertex_state_hashtable;  /* memoized vertex constraint results */
+    char *terminal_label_name;     /* terminal vertex label name for match */
+    int32 terminal_label_id;       /* terminal vertex label id for match */
     GraphIdStack *dfs_vertex_stack; /* dfs stack for vertices (array-based) */
     GraphIdStack *dfs_edge_stack;   /* dfs stack for edges (array-based) */
     GraphIdStack *dfs_path_stack;   /* dfs stack containing the path (array-based) */
@@ -136,6 +159,17 @@ typedef struct VLE_local_context
     bool is_dirty;                 /* is this VLE context reusable */
 } VLE_local_context;
 
+/*
+ * Is the edge, by its dense edge index, in the current path. Indexes past the
+ * end of the edge_in_path bitset haven't been added yet.
+ */
+static inline bool is_edge_index_in_path(VLE_local_context *vlelctx,
+                                         uint32 edge_index)
+{
+    return (((Size) edge_index >> 3) < vlelctx->edge_in_path_bytes &&
+            EDGE_BITSET_TEST(vlelctx->edge_in_path, edge_index));
+}
+
 /*
  * Container to hold the graphid array that contains one valid path. This
  * structure will allow it to be easily passed as an AGTYPE pointer. The
@@ -191,15 +225,18 @@ static VLE_local_context *global_vle_local_contexts = NULL;
 
 /* agtype functions */
 static bool is_an_edge_match(VLE_local_context *vlelctx, edge_entry *ee);
+static bool is_a_vertex_match(VLE_local_context *vlelctx, graphid vertex_id);
 /* VLE local context functions */
 static VLE_local_context *build_local_vle_context(FunctionCallInfo fcinfo,
                                                   FuncCallContext *funcctx);
-static void create_VLE_local_state_hashtable(VLE_local_context *vlelctx);
+static void create_VLE_local_edge_state(VLE_local_context *vlelctx);
+static void free_VLE_local_edge_state(VLE_local_context *vlelctx);
+static void rebuild_VLE_local_graph_state(VLE_local_context *vlelctx);
+static void set_VLE_edge_constraint(VLE_local_context *vlelctx,
+                                    agtype *agt_edge_proto, char *fname);
+static void create_VLE_vertex_state_hashtable(VLE_local_context *vlelctx);
 static void free_VLE_local_context(VLE_local_context *vlelctx);
 /* VLE graph traversal functions */
-static edge_state_entry *get_edge_state_with_hash(VLE_local_context *vlelctx,
-                                                  graphid edge_id,
-                                                  uint32 hashvalue);
 /* graphid data structures */
 static void load_initial_dfs_stacks(VLE_local_context *vlelctx);
 static bool dfs_find_a_path_between(VLE_local_context *vlelctx);
@@ -209,6 +246,8 @@ static void add_valid_vertex_edges(VLE_local_context *vlelctx,
                                    graphid vertex_id);
 static graphid get_next_vertex(VLE_local_context *vlelctx, edge_entry *ee);
 static bool is_edge_in_path(VLE_local_context *vlelctx, graphid edge_id);
+static void add_edge_index_to_path(VLE_local_context *vlelctx,
+                                   uint32 edge_index);
 /* VLE path and edge building functions */
 static VLE_path_container *create_VLE_path_container(int64 path_size);
 static VLE_path_container *build_VLE_path_container(VLE_local_context *vlelctx);
@@ -301,6 +340,16 @@ static VLE_local_context *get_cached_VLE_local_context(int64 vle_grammar_node_id
 
                 vlelctx->ggctx = ggctx;
 
+                /*
+                 * If the GRAPH global context was rebuilt since this context
+                 * last used it, the state kept from the old one is stale.
+                 */
+                if (ggctx != NULL &&
+                    get_graph_build_number(ggctx) != vlelctx->edge_state_build)
+                {
+                    rebuild_VLE_local_graph_state(vlelctx);
+                }
+
                 /*
                  * If the context is good and isn't at the head of the cache,
                  * promote it to the head.
@@ -368,37 +417,83 @@ static void cache_VLE_local_context(VLE_local_context *vlelctx)
     global_vle_local_contexts = vlelctx;
 }
 
-/* helper function to create the local VLE edge state hashtable. */
-static void create_VLE_local_state_hashtable(VLE_local_context *vlelctx)
+/*
+ * Helper function to create the local VLE edge state. This is a bitset, by
+ * dense edge index, of the edges in the current path and the edge match memo
+ * for this context's edge constraint. The memo is shared through the GRAPH
+ * global context whenever possible, so repeated VLEs with the same edge
+ * constraint don't retest edges. The bitset is only allocated once an edge
+ * is added to the path, see add_edge_index_to_path.
+ */
+static void create_VLE_local_edge_state(VLE_local_context *vlelctx)
 {
-    HASHCTL edge_state_ctl;
-    char *graph_name = NULL;
-    char *eshn = NULL;
-    int glen;
-    int elen;
-
-    /* get the graph name and length */
-    graph_name = vlelctx->graph_name;
-    glen = strlen(graph_name);
-    /* get the edge state htab name length */
-    elen = strlen(EDGE_STATE_HTAB_NAME);
-    /* allocate the space and build the name */
-    eshn = palloc0(elen + glen + 1);
-    /* copy in the name */
-    strcpy(eshn, EDGE_STATE_HTAB_NAME);
-    /* add in the graph name */
-    eshn = strncat(eshn, graph_name, glen);
-
-    /* initialize the edge state hashtable */
-    MemSet(&edge_state_ctl, 0, sizeof(edge_state_ctl));
-    edge_state_ctl.keysize = sizeof(int64);
-    edge_state_ctl.entrysize = sizeof(edge_state_entry);
-    edge_state_ctl.hash = graphid_hash;
-    vlelctx->edge_state_hashtable = hash_create(eshn,
-                                                EDGE_STATE_HTAB_INITIAL_SIZE,
-                                                &edge_state_ctl,
-                                                HASH_ELEM | HASH_FUNCTION);
-    pfree_if_not_null(eshn);
+    int64 num_edges = get_graph_num_edges(vlelctx->ggctx);
+    bool label_missing = (vlelctx->edge_label_name != NULL &&
+                          vlelctx->edge_label_name_oid == InvalidOid);
+
+    vlelctx->edge_in_path = NULL;
+    vlelctx->edge_in_path_bytes = 0;
+    vlelctx->edge_state_build = get_graph_build_number(vlelctx->ggctx);
+
+    vlelctx->edge_match_memo = get_edge_match_memo(
+                                    vlelctx->ggctx,
+                                    vlelctx->edge_label_name_oid,
+                                    label_missing,
+                                    vlelctx->edge_property_constraint_datum,
+                                    vlelctx->edge_property_constraint_hash);
+    vlelctx->owns_edge_match_memo = false;
+
+    /* if there isn't room for another shared memo, use a private one */
+    if (vlelctx->edge_match_memo == NULL)
+    {
+        vlelctx->edge_match_memo = create_edge_match_memo(
+                                    num_edges,
+                                    vlelctx->edge_label_name_oid,
+                                    label_missing,
+                                    vlelctx->edge_property_constraint_datum,
+                                    vlelctx->edge_property_constraint_hash);
+        vlelctx->owns_edge_match_memo = true;
+    }
+}
+
+/*
+ * Helper function to free the local VLE edge state. A shared memo belongs to
+ * the GRAPH global context and is freed with it, which may already have
+ * happened, so it is only dropped.
+ */
+static void free_VLE_local_edge_state(VLE_local_context *vlelctx)
+{
+    pfree_if_not_null(vlelctx->edge_in_path);
+    vlelctx->edge_in_path = NULL;
+    vlelctx->edge_in_path_bytes = 0;
+
+    if (vlelctx->owns_edge_match_memo)
+    {
+        free_edge_match_memo(vlelctx->edge_match_memo);
+    }
+    vlelctx->edge_match_memo = NULL;
+    vlelctx->owns_edge_match_memo = false;
+}
+
+/*
+ * Helper function to rebuild the state a cached VLE local context keeps from
+ * its GRAPH global context, after that context was rebuilt. The edge state is
+ * indexed by the old context's dense edge indexes, the next vertex points
+ * into its vertex list, which has been freed, and the memoized vertex matches
+ * may be for properties that have since changed.
+ */
+static void rebuild_VLE_local_graph_state(VLE_local_context *vlelctx)
+{
+    free_VLE_local_edge_state(vlelctx);
+    create_VLE_local_edge_state(vlelctx);
+
+    if (vlelctx->vertex_state_hashtable != NULL)
+    {
+        hash_destroy(vlelctx->vertex_state_hashtable);
+        create_VLE_vertex_state_hashtable(vlelctx);
+    }
+
+    vlelctx->next_vertex = peek_stack_head(get_graph_vertices(vlelctx->ggctx));
 }
 
 /*
@@ -523,13 +618,114 @@ static bool is_an_edge_match(VLE_local_context *vlelctx, edge_entry *ee)
     }
 }
 
+/*
+ * Helper function to create the local VLE vertex state hashtable. It is kept
+ * in the memory context of the VLE local context, so it lives as long as the
+ * local context does, cached or not.
+ */
+static void create_VLE_vertex_state_hashtable(VLE_local_context *vlelctx)
+{
+    HASHCTL vertex_state_ctl;
+    char *vshn = NULL;
+
+    /* build the name from the prefix and the graph name */
+    vshn = psprintf("%s%s", VERTEX_STATE_HTAB_NAME, vlelctx->graph_name);
+
+    /* initialize the vertex state hashtable */
+    MemSet(&vertex_state_ctl, 0, sizeof(vertex_state_ctl));
+    vertex_state_ctl.keysize = sizeof(int64);
+    vertex_state_ctl.entrysize = sizeof(vertex_state_entry);
+    vertex_state_ctl.hash = graphid_hash;
+    vertex_state_ctl.hcxt = GetMemoryChunkContext(vlelctx);
+    vlelctx->vertex_state_hashtable = hash_create(vshn,
+                                                  VERTEX_STATE_HTAB_INITIAL_SIZE,
+                                                  &vertex_state_ctl,
+                                                  HASH_ELEM | HASH_FUNCTION |
+                                                  HASH_CONTEXT);
+    pfree_if_not_null(vshn);
+}
+
+/*
+ * Helper function to check a vertex against the pushed down vertex
+ * constraint. The label is checked directly from the graphid, so it costs
+ * nothing. Property constraints need the vertex's properties, which are
+ * fetched from the heap, so the result is memoized per vertex.
+ */
+static bool is_a_vertex_match(VLE_local_context *vlelctx, graphid vertex_id)
+{
+    vertex_state_entry *vse = NULL;
+    vertex_entry *ve = NULL;
+    Datum vertex_property_datum;
+    agtype *vertex_property = NULL;
+    agtype_iterator *constraint_it = NULL;
+    agtype_iterator *property_it = NULL;
+    bool found = false;
+
+    if (!vlelctx->has_vertex_constraint)
+    {
+        return true;
+    }
+
+    /*
+     * A label that doesn't exist in the graph can't match anything. Otherwise
+     * the label id is embedded in the graphid.
+     */
+    if (vlelctx->vertex_label_name != NULL &&
+        (vlelctx->vertex_label_id == INVALID_LABEL_ID ||
+         get_graphid_label_id(vertex_id) != vlelctx->vertex_label_id))
+    {
+        return false;
+    }
+
+    /* nothing more to check if there aren't any property constraints */
+    if (vlelctx->vertex_property_constraint == NULL)
+    {
+        return true;
+    }
+
+    vse = (vertex_state_entry *)hash_search(vlelctx->vertex_state_hashtable,
+                                            (void *)&vertex_id, HASH_ENTER,
+                                            &found);
+    if (found)
+    {
+        return vse->matched;
+    }
+
+    /* the vertex better exist */
+    ve = get_vertex_entry(vlelctx->ggctx, vertex_id);
+    if (ve == NULL)
+    {
+        elog(ERROR, "is_a_vertex_match: no vertex found");
+    }
+
+    vertex_property_datum = get_vertex_entry_properties(ve);
+    vertex_property = DATUM_GET_AGTYPE_P(vertex_property_datum);
+
+    /* get the iterators and check for containment */
+    property_it = agtype_iterator_init(&vertex_property->root);
+    constraint_it = agtype_iterator_init(
+        &vlelctx->vertex_property_constraint->root);
+
+    vse->vertex_id = vertex_id;
+    vse->matched = agtype_deep_contains(&property_it, &constraint_it, false);
+
+    /* the properties are a copy, and possibly a detoasted one on top of it */
+    if ((Pointer) vertex_property != DatumGetPointer(vertex_property_datum))
+    {
+        pfree(vertex_property);
+    }
+    pfree(DatumGetPointer(vertex_property_datum));
+
+    return vse->matched;
+}
+
 /*
  * Helper function to free up the memory used by the VLE_local_context.
  *
- * Currently, the only structures that needs to be freed are the edge state
- * hashtable and the dfs stacks (vertex, edge, and path). The hashtable is easy
- * because hash_create packages everything into its own memory context. So, you
- * only need to do a destroy.
+ * The structures that need to be freed are the edge state (the edge_in_path
+ * bitset and, if it isn't shared, the edge match memo), the vertex state
+ * hashtable, and the dfs stacks (vertex, edge, and path). A shared edge match
+ * memo belongs to the GRAPH global context and is freed with it.
  */
 static void free_VLE_local_context(VLE_local_context *vlelctx)
 {
@@ -553,9 +749,35 @@ static void free_VLE_local_context(VLE_local_context *vlelctx)
         vlelctx->edge_label_name = NULL;
     }
 
-    /* we need to free our state hashtable */
-    hash_destroy(vlelctx->edge_state_hashtable);
-    vlelctx->edge_state_hashtable = NULL;
+    /* free the stored terminal vertex label name */
+    if (vlelctx->terminal_label_name != NULL)
+    {
+        pfree_if_not_null(vlelctx->terminal_label_name);
+        vlelctx->terminal_label_name = NULL;
+    }
+
+    /* free the stored vertex constraint */
+    if (vlelctx->vertex_label_name != NULL)
+    {
+        pfree_if_not_null(vlelctx->vertex_label_name);
+        vlelctx->vertex_label_name = NULL;
+    }
+    if (vlelctx->vertex_property_constraint != NULL)
+    {
+        pfree_if_not_null(vlelctx->vertex_property_constraint);
+        vlelctx->vertex_property_constraint = NULL;
+    }
+
+    /* free the edge state, the memo only if it isn't shared */
+    free_VLE_local_edge_state(vlelctx);
+
+    /* we need to free our vertex state hashtable */
+
+    if (vlelctx->vertex_state_hashtable != NULL)
+    {
+        hash_destroy(vlelctx->vertex_state_hashtable);
+        vlelctx->vertex_state_hashtable = NULL;
+    }
 
     /*
      * Free the DFS stacks. When is_dirty is false, the stacks are in the
@@ -621,6 +843,50 @@ static void load_initial_dfs_stacks(VLE_local_context *vlelctx)
     add_valid_vertex_edges(vlelctx, vlelctx->vsid);
 }
 
+/*
+ * Helper function to set the VLE edge constraint from an edge prototype, as
+ * built by age_build_vle_match_edge. Only its label and properties are used.
+ * The graph oid of the context needs to be set.
+ */
+static void set_VLE_edge_constraint(VLE_local_context *vlelctx,
+                                    agtype *agt_edge_proto, char *fname)
+{
+    agtype_value *agtv_edge = NULL;
+    agtype_value *agtv_temp = NULL;
+    agtype *agt_edge_property_constraint = NULL;
+    Datum d_edge_property_constraint = 0;
+
+    agtv_edge = get_agtype_value(fname, agt_edge_proto, AGTV_EDGE, true);
+
+    /* get the edge prototype's property conditions */
+    agtv_temp = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_edge, "properties");
+    agt_edge_property_constraint = agtype_value_to_agtype(agtv_temp);
+
+    /* store the properties as an agtype */
+    vlelctx->edge_property_constraint = agt_edge_property_constraint;
+
+    d_edge_property_constraint = AGTYPE_P_GET_DATUM(agt_edge_property_constraint);
+    vlelctx->edge_property_constraint_datum = d_edge_property_constraint;
+    vlelctx->edge_property_constraint_hash = datum_image_hash(d_edge_property_constraint, false, -1);
+
+    /* get the edge prototype's label name */
+    agtv_temp = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_edge, "label");
+    if (agtv_temp->type == AGTV_STRING &&
+        agtv_temp->val.string.len != 0)
+    {
+        vlelctx->edge_label_name = pnstrdup(agtv_temp->val.string.val,
+                                            agtv_temp->val.string.len);
+
+        vlelctx->edge_label_name_oid = get_label_relation(vlelctx->edge_label_name,
+                                                          vlelctx->graph_oid);
+    }
+    else
+    {
+        vlelctx->edge_label_name = NULL;
+        vlelctx->edge_label_name_oid = InvalidOid;
+    }
+}
+
 /*
  * Helper function to build the local VLE context. This is also the point
  * where, if necessary, the global GRAPH contexts are created and freed.
@@ -633,8 +899,6 @@ static VLE_local_context *build_local_vle_context(FunctionCallInfo fcinfo,
     VLE_local_context *vlelctx = NULL;
     agtype_value *agtv_temp = NULL;
     agtype_value *agtv_object = NULL;
-    agtype *agt_edge_property_constraint = NULL;
-    Datum d_edge_property_constraint = 0;
     char *graph_name = NULL;
     Oid graph_oid = InvalidOid;
     int64 vle_grammar_node_id = 0;
@@ -644,7 +908,7 @@ static VLE_local_context *build_local_vle_context(FunctionCallInfo fcinfo,
      * Get the VLE grammar node id, if it exists. Remember, we overload the
      * age_vle function, for now, for backwards compatibility
      */
-    if (PG_NARGS() == 8)
+    if (PG_NARGS() >= 8)
     {
         /* get the VLE grammar node id */
         agtv_temp = get_agtype_value("age_vle", AG_GET_ARG_AGTYPE_P(7),
@@ -857,36 +1121,7 @@ static VLE_local_context *build_local_vle_context(FunctionCallInfo fcinfo,
     }
 
     /* get the VLE edge prototype */
-    agtv_temp = get_agtype_value("age_vle", AG_GET_ARG_AGTYPE_P(3),
-                                 AGTV_EDGE, true);
-
-    /* get the edge prototype's property conditions */
-    agtv_object = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_temp, "properties");
-    agt_edge_property_constraint = agtype_value_to_agtype(agtv_object);
-
-    /* store the properties as an agtype */
-    vlelctx->edge_property_constraint = agt_edge_property_constraint;
-
-    d_edge_property_constraint = AGTYPE_P_GET_DATUM(agt_edge_property_constraint);
-    vlelctx->edge_property_constraint_datum = d_edge_property_constraint;
-    vlelctx->edge_property_constraint_hash = datum_image_hash(d_edge_property_constraint, false, -1);
-
-    /* get the edge prototype's label name */
-    agtv_temp = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_temp, "label");
-    if (agtv_temp->type == AGTV_STRING &&
-        agtv_temp->val.string.len != 0)
-    {
-        vlelctx->edge_label_name = pnstrdup(agtv_temp->val.string.val,
-                                            agtv_temp->val.string.len);
-
-        vlelctx->edge_label_name_oid = get_label_relation(vlelctx->edge_label_name,
-                                                          graph_oid);
-    }
-    else
-    {
-        vlelctx->edge_label_name = NULL;
-        vlelctx->edge_label_name_oid = InvalidOid;
-    }
+    set_VLE_edge_constraint(vlelctx, AG_GET_ARG_AGTYPE_P(3), "age_vle");
 
     /* get the left range index */
     if (PG_ARGISNULL(4) || is_agtype_null(AG_GET_ARG_AGTYPE_P(4)))
@@ -918,8 +1153,55 @@ static VLE_local_context *build_local_vle_context(FunctionCallInfo fcinfo,
                                  AGTV_INTEGER, true);
     vlelctx->edge_direction = agtv_temp->val.int_value;
 
-    /* create the local state hashtable */
-    create_VLE_local_state_hashtable(vlelctx);
+    /* get the optional VLE vertex prototype pushed down by the transform */
+    if (PG_NARGS() >= 9 && !PG_ARGISNULL(8) &&
+        !is_agtype_null(AG_GET_ARG_AGTYPE_P(8)))
+    {
+        agtype_value *agtv_vertex = NULL;
+
+        agtv_vertex = get_agtype_value("age_vle", AG_GET_ARG_AGTYPE_P(8),
+                                       AGTV_VERTEX, true);
+
+        /* get the vertex prototype's label name */
+        agtv_temp = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_vertex, "label");
+        if (agtv_temp->type == AGTV_STRING &&
+            agtv_temp->val.string.len != 0)
+        {
+            vlelctx->vertex_label_name = pnstrdup(agtv_temp->val.string.val,
+                                                  agtv_temp->val.string.len);
+            vlelctx->vertex_label_id = get_label_id(vlelctx->vertex_label_name,
+                                                    graph_oid);
+            vlelctx->has_vertex_constraint = true;
+        }
+
+        /* get the vertex prototype's property conditions, if any */
+        agtv_object = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_vertex, "properties");
+        if (agtv_object->type == AGTV_OBJECT &&
+            agtv_object->val.object.num_pairs > 0)
+        {
+            vlelctx->vertex_property_constraint =
+                agtype_value_to_agtype(agtv_object);
+            vlelctx->has_vertex_constraint = true;
+
+            create_VLE_vertex_state_hashtable(vlelctx);
+        }
+    }
+
+    /* get the optional terminal vertex label */
+    if (PG_NARGS() >= 10 && !PG_ARGISNULL(9) &&
+        !is_agtype_null(AG_GET_ARG_AGTYPE_P(9)))
+    {
+        agtv_temp = get_agtype_value("age_vle", AG_GET_ARG_AGTYPE_P(9),
+                                     AGTV_STRING, true);
+        vlelctx->terminal_label_name = pnstrdup(agtv_temp->val.string.val,
+                                                agtv_temp->val.string.len);
+        /* a missing label is INVALID_LABEL_ID, which no vertex can have */
+        vlelctx->terminal_label_id = get_label_id(vlelctx->terminal_label_name,
+                                                  graph_oid);
+    }
+
+    /* create the local edge state */
+    create_VLE_local_edge_state(vlelctx);
 
     /* initialize the dfs stacks */
     vlelctx->dfs_vertex_stack = new_gid_stack();
@@ -948,33 +1230,6 @@ static VLE_local_context *build_local_vle_context(FunctionCallInfo fcinfo,
     return vlelctx;
 }
 
-/*
- * Helper function to get the specified edge's state, using a precomputed hash
- * value. Callers can compute graphid_hash() once and reuse it for lookups in
- * both the dynahash edge_state_hashtable here and the agehash-backed
- * edge_table on the global-graph lookup path elsewhere.
- */
-static edge_state_entry *get_edge_state_with_hash(VLE_local_context *vlelctx,
-                                                  graphid edge_id,
-                                                  uint32 hashvalue)
-{
-    edge_state_entry *ese = NULL;
-    bool found = false;
-
-    ese = (edge_state_entry *)hash_search_with_hash_value(
-                                            vlelctx->edge_state_hashtable,
-                                            (void *)&edge_id, hashvalue,
-                                            HASH_ENTER, &found);
-    if (!found)
-    {
-        ese->edge_id = edge_id;
-        ese->used_in_path = false;
-        ese->has_been_matched = false;
-        ese->matched = false;
-    }
-    return ese;
-}
-
 /*
  * Helper function to get the id of the next vertex to move to. This is to
  * simplify finding the next vertex due to the VLE edge's direction.
@@ -1062,8 +1317,8 @@ static bool dfs_find_a_path_between(VLE_local_context *vlelctx)
     {
         graphid edge_id;
         graphid next_vertex_id;
-        edge_state_entry *ese = NULL;
         edge_entry *ee = NULL;
+        uint32 edge_index;
         bool found = false;
         uint32 edge_hashvalue;
 
@@ -1078,13 +1333,12 @@ static bool dfs_find_a_path_between(VLE_local_context *vlelctx)
         /* get an edge, but leave it on the stack for now */
         edge_id = gid_stack_peek(edge_stack);
         /*
-         * Compute the hash for edge_id once and reuse it for both the
-         * edge_state_hashtable lookup and (later) the edge_hashtable lookup.
-         * Both tables key on graphid using graphid_hash().
+         * Get the edge entry, we need it for the dense edge index that keys
+         * the edge's state and, later, for the next vertex to move to.
          */
         edge_hashvalue = graphid_hash(&edge_id, sizeof(int64));
-        /* get the edge's state */
-        ese = get_edge_state_with_hash(vlelctx, edge_id, edge_hashvalue);
+        ee = get_edge_entry_with_hash(vlelctx->ggctx, edge_id, edge_hashvalue);
+        edge_index = get_edge_entry_index(ee);
         /*
          * If the edge is already in use, it means that the edge is in the path.
          * So, we need to see if it is the last path entry (we are backing up -
@@ -1093,7 +1347,7 @@ static bool dfs_find_a_path_between(VLE_local_context *vlelctx)
          * in the path (loop - we need to remove the edge from the edge stack
          * and start with the next edge).
          */
-        if (ese->used_in_path)
+        if (is_edge_index_in_path(vlelctx, edge_index))
         {
             graphid path_edge_id;
 
@@ -1101,12 +1355,12 @@ static bool dfs_find_a_path_between(VLE_local_context *vlelctx)
             path_edge_id = gid_stack_peek(path_stack);
             /*
              * If the ids are the same, we're backing up. So, remove it from the
-             * path stack and reset used_in_path.
+             * path stack and clear its edge_in_path bit.
              */
             if (edge_id == path_edge_id)
             {
                 gid_stack_pop(path_stack);
-                ese->used_in_path = false;
+                EDGE_BITSET_CLEAR(vlelctx->edge_in_path, edge_index);
             }
             /* now remove it from the edge stack */
             gid_stack_pop(edge_stack);
@@ -1128,11 +1382,10 @@ static bool dfs_find_a_path_between(VLE_local_context *vlelctx)
          * Mark it and push it on the path stack. There is no need to push it on
          * the edge stack as it is already there.
          */
-        ese->used_in_path = true;
+        add_edge_index_to_path(vlelctx, edge_index);
         gid_stack_push(path_stack, edge_id);
 
-        /* now get the edge entry so we can get the next vertex to move to */
-        ee = get_edge_entry_with_hash(vlelctx->ggctx, edge_id, edge_hashvalue);
+        /* now get the next vertex to move to */
         next_vertex_id = get_next_vertex(vlelctx, ee);
 
         /*
@@ -1205,8 +1458,8 @@ static bool dfs_find_a_path_from(VLE_local_context *vlelctx)
     {
         graphid edge_id;
         graphid next_vertex_id;
-        edge_state_entry *ese = NULL;
         edge_entry *ee = NULL;
+        uint32 edge_index;
         bool found = false;
         uint32 edge_hashvalue;
 
@@ -1221,13 +1474,12 @@ static bool dfs_find_a_path_from(VLE_local_context *vlelctx)
         /* get an edge, but leave it on the stack for now */
         edge_id = gid_stack_peek(edge_stack);
         /*
-         * Compute the hash for edge_id once and reuse it for both the
-         * edge_state_hashtable lookup and (later) the edge_hashtable lookup.
-         * Both tables key on graphid using graphid_hash().
+         * Get the edge entry, we need it for the dense edge index that keys
+         * the edge's state and, later, for the next vertex to move to.
          */
         edge_hashvalue = graphid_hash(&edge_id, sizeof(int64));
-        /* get the edge's state */
-        ese = get_edge_state_with_hash(vlelctx, edge_id, edge_hashvalue);
+        ee = get_edge_entry_with_hash(vlelctx->ggctx, edge_id, edge_hashvalue);
+        edge_index = get_edge_entry_index(ee);
         /*
          * If the edge is already in use, it means that the edge is in the path.
          * So, we need to see if it is the last path entry (we are backing up -
@@ -1236,7 +1488,7 @@ static bool dfs_find_a_path_from(VLE_local_context *vlelctx)
          * in the path (loop - we need to remove the edge from the edge stack
          * and start with the next edge).
          */
-        if (ese->used_in_path)
+        if (is_edge_index_in_path(vlelctx, edge_index))
         {
             graphid path_edge_id;
 
@@ -1244,12 +1496,12 @@ static bool dfs_find_a_path_from(VLE_local_context *vlelctx)
             path_edge_id = gid_stack_peek(path_stack);
             /*
              * If the ids are the same, we're backing up. So, remove it from the
-             * path stack and reset used_in_path.
+             * path stack and clear its edge_in_path bit.
              */
             if (edge_id == path_edge_id)
             {
                 gid_stack_pop(path_stack);
-                ese->used_in_path = false;
+                EDGE_BITSET_CLEAR(vlelctx->edge_in_path, edge_index);
             }
             /* now remove it from the edge stack */
             gid_stack_pop(edge_stack);
@@ -1271,20 +1523,24 @@ static bool dfs_find_a_path_from(VLE_local_context *vlelctx)
          * Mark it and push it on the path stack. There is no need to push it on
          * the edge stack as it is already there.
          */
-        ese->used_in_path = true;
+        add_edge_index_to_path(vlelctx, edge_index);
         gid_stack_push(path_stack, edge_id);
 
-        /* now get the edge entry so we can get the next vertex to move to */
-        ee = get_edge_entry_with_hash(vlelctx->ggctx, edge_id, edge_hashvalue);
+        /* now get the next vertex to move to */
         next_vertex_id = get_next_vertex(vlelctx, ee);
 
         /*
          * Is this a path that meets our requirements? Is its length within the
-         * bounds specified?
+         * bounds specified? If a terminal label was given, does the vertex it
+         * ends on have it? The label id is part of the graphid, so this check
+         * is free and saves building and joining paths that can't match.
          */
         if (gid_stack_size(path_stack) >= vlelctx->lidx &&
             (vlelctx->uidx_infinite ||
-             gid_stack_size(path_stack) <= vlelctx->uidx))
+             gid_stack_size(path_stack) <= vlelctx->uidx) &&
+            (vlelctx->terminal_label_name == NULL ||
+             get_graphid_label_id(next_vertex_id) ==
+             vlelctx->terminal_label_id))
         {
             /* we found one */
             found = true;
@@ -1306,6 +1562,42 @@ static bool dfs_find_a_path_from(VLE_local_context *vlelctx)
     return false;
 }
 
+/*
+ * Helper function to add an edge, by its dense edge index, to the
+ * edge_in_path bitset. The bitset is grown to cover the index as needed, in
+ * the memory context of the VLE local context, so an activation only pays for
+ * the edge indexes its paths reach and a cached context keeps what it grew.
+ */
+static void add_edge_index_to_path(VLE_local_context *vlelctx,
+                                   uint32 edge_index)
+{
+    Size needed = ((Size) edge_index >> 3) + 1;
+
+    if (needed > vlelctx->edge_in_path_bytes)
+    {
+        Size max_bytes = EDGE_BITSET_BYTES(get_graph_num_edges(vlelctx->ggctx));
+        Size new_bytes = Max(Max(vlelctx->edge_in_path_bytes * 2,
+                                 EDGE_IN_PATH_INITIAL_BYTES), needed);
+
+        new_bytes = Max(Min(new_bytes, max_bytes), needed);
+
+        if (vlelctx->edge_in_path == NULL)
+        {
+            vlelctx->edge_in_path = MemoryContextAllocZero(
+                GetMemoryChunkContext(vlelctx), new_bytes);
+        }
+        else
+        {
+            vlelctx->edge_in_path = repalloc(vlelctx->edge_in_path, new_bytes);
+            memset(vlelctx->edge_in_path + vlelctx->edge_in_path_bytes, 0,
+                   new_bytes - vlelctx->edge_in_path_bytes);
+        }
+        vlelctx->edge_in_path_bytes = new_bytes;
+    }
+
+    EDGE_BITSET_SET(vlelctx->edge_in_path, edge_index);
+}
+
 /*
  * Helper routine to quickly check if an edge_id is in the path stack. It is
  * only meant as a quick check to avoid doing a much more costly hash search for
@@ -1374,16 +1666,15 @@ static void add_valid_vertex_edges(VLE_local_context *vlelctx,
     /*
      * Per-batch scratch arrays for the MLP lookup pipeline. Each iteration
      * gathers up to VLE_LOOKUP_BATCH not-already-in-path candidate edges,
-     * then issues their edge_table (agehash) and edge_state_hashtable
-     * (dynahash) lookups in two tight back-to-back loops. The CPU's
-     * out-of-order engine overlaps the K independent cache misses inside
-     * each loop, hiding memory latency that the original one-edge-at-a-time
-     * loop serialized.
+     * then issues their edge_table (agehash) lookups in one tight
+     * back-to-back loop. The CPU's out-of-order engine overlaps the K
+     * independent cache misses inside the loop, hiding memory latency that
+     * the original one-edge-at-a-time loop serialized.
      */
     graphid           batch_eids[VLE_LOOKUP_BATCH];
     uint32            batch_hashes[VLE_LOOKUP_BATCH];
     edge_entry       *batch_ee[VLE_LOOKUP_BATCH];
-    edge_state_entry *batch_ese[VLE_LOOKUP_BATCH];
+    EdgeMatchMemo    *memo = vlelctx->edge_match_memo;
 
     /* get the vertex entry */
     ve = get_vertex_entry(vlelctx->ggctx, vertex_id);
@@ -1418,18 +1709,16 @@ static void add_valid_vertex_edges(VLE_local_context *vlelctx,
     sz_self  = vea->size;
 
     /*
-     * Outer loop: drain the three flat arrays via a 5-phase pipeline.
+     * Outer loop: drain the three flat arrays via a 4-phase pipeline.
      *   1. Gather: pull up to VLE_LOOKUP_BATCH next edge_ids that survive
      *      the cheap is_edge_in_path() early-skip.
      *   2. Hash:   compute graphid_hash for the batch (pure compute).
      *   3. Lookup: K back-to-back edge_table (agehash) lookups via
-     *      get_edge_entry_with_hash() — MLP window 1 (the CPU overlaps
-     *      the K slot misses).
-     *   4. State:  K back-to-back edge_state_hashtable (dynahash) HASH_ENTER
-     *      calls — MLP window 2 (different table, different bucket misses).
-     *   5. Apply:  per-edge match/state-update/stack-push, now operating
-     *      on cache-warm ee/ese pointers.
-     * Phase 5 preserves the exact processing order of the original loop
+     *      get_edge_entry_with_hash() — the CPU overlaps the K slot misses.
+     *   4. Apply:  per-edge match/state-update/stack-push, now operating
+     *      on cache-warm ee pointers. The edge state is a bit test in the
+     *      edge_in_path and memo bitsets, by the entry's dense edge index.
+     * Phase 4 preserves the exact processing order of the original loop
      * (out direction first, then in, then self), so DFS stack ordering and
      * therefore path enumeration are identical to the previous version.
      */
@@ -1489,20 +1778,12 @@ static void add_valid_vertex_edges(VLE_local_context *vlelctx,
                                                    batch_hashes[i]);
         }
 
-        /* Phase 4: K back-to-back edge_state_hashtable lookups (MLP wave 2) */
-        for (i = 0; i < batch_n; i++)
-        {
-            batch_ese[i] = get_edge_state_with_hash(vlelctx,
-                                                    batch_eids[i],
-                                                    batch_hashes[i]);
-        }
-
-        /* Phase 5: process the batch sequentially */
+        /* Phase 4: process the batch sequentially */
         for (i = 0; i < batch_n; i++)
         {
             edge_entry       *ee  = batch_ee[i];
-            edge_state_entry *ese = batch_ese[i];
             graphid           edge_id = batch_eids[i];
+            uint32            edge_index;
 
             /* it better exist */
             if (ee == NULL)
@@ -1510,44 +1791,79 @@ static void add_valid_vertex_edges(VLE_local_context *vlelctx,
                 elog(ERROR, "add_valid_vertex_edges: no edge found");
             }
 
+            edge_index = get_edge_entry_index(ee);
+
             /*
              * Don't add any edges that we have already seen because they
              * will cause a loop to form.
              */
-            if (ese->used_in_path)
+            if (is_edge_index_in_path(vlelctx, edge_index))
             {
                 continue;
             }
 
             /* validate the edge if it hasn't been already */
-            if (!ese->has_been_matched && is_an_edge_match(vlelctx, ee))
+            if (!EDGE_BITSET_TEST(memo->checked, edge_index))
             {
-                ese->has_been_matched = true;
-                ese->matched = true;
+                if (is_an_edge_match(vlelctx, ee))
+                {
+                    EDGE_BITSET_SET(memo->matched, edge_index);
+                }
+                EDGE_BITSET_SET(memo->checked, edge_index);
             }
-            else if (!ese->has_been_matched)
+
+            /* skip it if it isn't a match */
+            if (!EDGE_BITSET_TEST(memo->matched, edge_index))
             {
-                ese->has_been_matched = true;
-                ese->matched = false;
+                continue;
             }
 
-            /* if it is a match, add it */
-            if (ese->has_been_matched && ese->matched)
+            /*
+             * If there is a pushed down vertex constraint, the vertex this
+             * edge leads to must satisfy it. This check is direction
+             * dependent for un-directional edges, so it isn't folded into
+             * the memoized edge state.
+             */
+            if (vlelctx->has_vertex_constraint)
             {
-                /*
-                 * We need to maintain our source vertex for each edge
-                 * added if the edge_direction is CYPHER_REL_DIR_NONE. This
-                 * is due to the edges having a fixed direction and the dfs
-                 * algorithm working strictly through edges. With an
-                 * un-directional VLE edge, you don't know the vertex that
-                 * you just came from. So, we need to store it.
-                 */
-                if (vlelctx->edge_direction == CYPHER_REL_DIR_NONE)
+                graphid terminal_vertex_id;
+
+                if (vlelctx->edge_direction == CYPHER_REL_DIR_RIGHT)
                 {
-                    gid_stack_push(vertex_stack, get_vertex_entry_id(ve));
+                    terminal_vertex_id = get_edge_entry_end_vertex_id(ee);
                 }
-                gid_stack_push(edge_stack, edge_id);
+                else if (vlelctx->edge_direction == CYPHER_REL_DIR_LEFT)
+                {
+                    terminal_vertex_id = get_edge_entry_start_vertex_id(ee);
+                }
+                else if (get_edge_entry_start_vertex_id(ee) == vertex_id)
+                {
+                    terminal_vertex_id = get_edge_entry_end_vertex_id(ee);
+                }
+                else
+                {
+                    terminal_vertex_id = get_edge_entry_start_vertex_id(ee);
+                }
+
+                if (!is_a_vertex_match(vlelctx, terminal_vertex_id))
+                {
+                    continue;
+                }
+            }
+
+            /*
+             * It is a match, so add it. We need to maintain our source
+             * vertex for each edge added if the edge_direction is
+             * CYPHER_REL_DIR_NONE. This is due to the edges having a fixed
+             * direction and the dfs algorithm working strictly through
+             * edges. With an un-directional VLE edge, you don't know the
+             * vertex that you just came from. So, we need to store it.
+             */
+            if (vlelctx->edge_direction == CYPHER_REL_DIR_NONE)
+            {
+                gid_stack_push(vertex_stack, get_vertex_entry_id(ve));
             }
+            gid_stack_push(edge_stack, edge_id);
         }
     }
 }
@@ -1917,6 +2233,14 @@ static agtype_value *build_path(VLE_path_container *vpc)
  *     5 - agtype OPTIONAL uidx (upper range index)
  *                 Note: A NULL is appropriate here for an infinite upper bound.
  *     6 - agtype REQUIRED edge direction (enum) as an integer. REQUIRED
+ *     7 - agtype OPTIONAL VLE grammar node id, used for context caching
+ *     8 - agtype OPTIONAL (vertex prototype every traversed vertex must match)
+ *                 Note: Built by age_build_vle_match_vertex. Only the label
+ *                       and properties are used.
+ *     9 - agtype OPTIONAL (terminal vertex label name as a string)
+ *                 Note: Only paths ending on a vertex with this label are
+ *                       emitted. The zero length path is left to the
+ *                       caller's quals.
  *
  * This is a set returning function. This means that the first call sets
  * up the initial structures and then outputs the first row. After that each
@@ -2554,28 +2878,110 @@ Datum age_build_vle_match_edge(PG_FUNCTION_ARGS)
     PG_RETURN_POINTER(agtype_value_to_agtype(result.res));
 }
 
-PG_FUNCTION_INFO_V1(_ag_enforce_edge_uniqueness2);
+PG_FUNCTION_INFO_V1(age_build_vle_match_vertex);
 
-Datum _ag_enforce_edge_uniqueness2(PG_FUNCTION_ARGS)
+/*
+ * Function to build a vertex prototype for a VLE match. This is the vertex
+ * constraint that the transform pushes down into age_vle for the
+ * intermediate (and terminal) vertices of a path.
+ */
+Datum age_build_vle_match_vertex(PG_FUNCTION_ARGS)
 {
-    graphid gid1 = AG_GETARG_GRAPHID(0);
-    graphid gid2 = AG_GETARG_GRAPHID(1);
+    agtype_in_state result;
+    agtype_value agtv_zero;
+    agtype_value agtv_nstr;
+    agtype_value *agtv_temp = NULL;
 
-    if (gid1 == gid2)
-    {
-        PG_RETURN_BOOL(false);
-    }
+    /* create an agtype_value integer 0 */
+    agtv_zero.type = AGTV_INTEGER;
+    agtv_zero.val.int_value = 0;
 
-    PG_RETURN_BOOL(true);
-}
+    /* create an agtype_value null string */
+    agtv_nstr.type = AGTV_STRING;
+    agtv_nstr.val.string.len = 0;
+    agtv_nstr.val.string.val = NULL;
 
-PG_FUNCTION_INFO_V1(_ag_enforce_edge_uniqueness3);
+    /* zero the state */
+    memset(&result, 0, sizeof(agtype_in_state));
 
-Datum _ag_enforce_edge_uniqueness3(PG_FUNCTION_ARGS)
-{
-    graphid gid1 = AG_GETARG_GRAPHID(0);
-    graphid gid2 = AG_GETARG_GRAPHID(1);
-    graphid gid3 = AG_GETARG_GRAPHID(2);
+    /* start the object */
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                   NULL);
+    /* create dummy graph id */
+    result.res = push_agtype_value(&result.parse_state, WAGT_KEY,
+                                   string_to_agtype_value("id"));
+    result.res = push_agtype_value(&result.parse_state, WAGT_VALUE, &agtv_zero);
+    /* process the label */
+    result.res = push_agtype_value(&result.parse_state, WAGT_KEY,
+                                   string_to_agtype_value("label"));
+    if (!PG_ARGISNULL(0))
+    {
+        agtv_temp = get_agtype_value("build_vle_match_vertex",
+                                     AG_GET_ARG_AGTYPE_P(0), AGTV_STRING, true);
+        result.res = push_agtype_value(&result.parse_state, WAGT_VALUE,
+                                       agtv_temp);
+    }
+    else
+    {
+        result.res = push_agtype_value(&result.parse_state, WAGT_VALUE,
+                                       &agtv_nstr);
+    }
+
+    /* process the properties */
+    result.res = push_agtype_value(&result.parse_state, WAGT_KEY,
+                                   string_to_agtype_value("properties"));
+    if (!PG_ARGISNULL(1))
+    {
+        agtype *properties = NULL;
+
+        properties = AG_GET_ARG_AGTYPE_P(1);
+
+        if (!AGT_ROOT_IS_OBJECT(properties))
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("build_vle_match_vertex(): properties argument must be an object")));
+        }
+
+        add_agtype((Datum)properties, false, &result, AGTYPEOID, false);
+    }
+    else
+    {
+        result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                       NULL);
+        result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT,
+                                       NULL);
+    }
+
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT, NULL);
+
+    result.res->type = AGTV_VERTEX;
+
+    PG_RETURN_POINTER(agtype_value_to_agtype(result.res));
+}
+
+PG_FUNCTION_INFO_V1(_ag_enforce_edge_uniqueness2);
+
+Datum _ag_enforce_edge_uniqueness2(PG_FUNCTION_ARGS)
+{
+    graphid gid1 = AG_GETARG_GRAPHID(0);
+    graphid gid2 = AG_GETARG_GRAPHID(1);
+
+    if (gid1 == gid2)
+    {
+        PG_RETURN_BOOL(false);
+    }
+
+    PG_RETURN_BOOL(true);
+}
+
+PG_FUNCTION_INFO_V1(_ag_enforce_edge_uniqueness3);
+
+Datum _ag_enforce_edge_uniqueness3(PG_FUNCTION_ARGS)
+{
+    graphid gid1 = AG_GETARG_GRAPHID(0);
+    graphid gid2 = AG_GETARG_GRAPHID(1);
+    graphid gid3 = AG_GETARG_GRAPHID(2);
 
     if (gid1 == gid2 || gid1 == gid3 || gid2 == gid3)
     {
@@ -3374,7 +3780,7 @@ static Datum *sp_minhops_fallback(GRAPH_global_context *ggctx, Oid graph_oid,
     vlelctx->next = NULL;
     vlelctx->is_dirty = true;
 
-    create_VLE_local_state_hashtable(vlelctx);
+    create_VLE_local_edge_state(vlelctx);
     vlelctx->dfs_vertex_stack = new_gid_stack();
     vlelctx->dfs_edge_stack = new_gid_stack();
     vlelctx->dfs_path_stack = new_gid_stack();
@@ -3526,73 +3932,9 @@ static Datum *sp_compute_paths(agtype *graph_name_agt, agtype *start_agt,
     source = sp_agtype_to_graphid(start_agt, fname, "start vertex");
     target = sp_agtype_to_graphid(end_agt, fname, "end vertex");
 
-    /*
-     * Optional edge type filter. A relationship type may be supplied as a
-     * bare string, or one or more types may be supplied as an array of
-     * strings. Each (non-empty) type name is resolved to its edge label table
-     * oid; an edge is kept when its label oid is one of the requested set. An
-     * empty string, an empty array, or NULL means no filter (every edge is
-     * traversed). An unknown type resolves to InvalidOid and so matches no
-     * edges.
-     */
-    if (label_agt != NULL)
-    {
-        char *label_name = NULL;
-
-        if (AGT_ROOT_IS_ARRAY(label_agt) && !AGT_ROOT_IS_SCALAR(label_agt))
-        {
-            int nelems = AGT_ROOT_COUNT(label_agt);
-            int i = 0;
-
-            if (nelems > 0)
-            {
-                label_oids = palloc(sizeof(Oid) * nelems);
-            }
-
-            for (i = 0; i < nelems; i++)
-            {
-                agtv_temp = get_ith_agtype_value_from_container(
-                    &label_agt->root, i);
-                if (agtv_temp->type != AGTV_STRING)
-                {
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                             errmsg("%s: relationship type must be a string",
-                                    fname)));
-                }
-                /* skip empty type names; they impose no constraint */
-                if (agtv_temp->val.string.len != 0)
-                {
-                    label_name = pnstrdup(agtv_temp->val.string.val,
-                                          agtv_temp->val.string.len);
-                    label_oids[n_label_oids] =
-                        get_label_relation(label_name, graph_oid);
-                    n_label_oids = n_label_oids + 1;
-
-                    /* the resolved oid is all we keep; free the type name */
-                    pfree(label_name);
-                    label_name = NULL;
-                }
-            }
-        }
-        else
-        {
-            agtv_temp = get_agtype_value(fname, label_agt,
-                                         AGTV_STRING, true);
-            if (agtv_temp->val.string.len != 0)
-            {
-                label_name = pnstrdup(agtv_temp->val.string.val,
-                                      agtv_temp->val.string.len);
-                label_oids = palloc(sizeof(Oid));
-                label_oids[0] = get_label_relation(label_name, graph_oid);
-                n_label_oids = 1;
-
-                /* the resolved oid is all we keep; free the type name */
-                pfree(label_name);
-                label_name = NULL;
-            }
-        }
-    }
+    /* optional edge type filter, see get_edge_type_label_oids */
+    label_oids = get_edge_type_label_oids(label_agt, graph_oid, fname,
+                                          &n_label_oids);
 
     /* optional direction (defaults to undirected) */
     dir = sp_agtype_to_direction(dir_agt, fname);
@@ -3895,3 +4237,1045 @@ Datum age_all_shortest_paths(PG_FUNCTION_ARGS)
 {
     return sp_srf_impl(fcinfo, true);
 }
+
+/*
+ * Helper function to build a VLE local context by hand (no fcinfo, no
+ * caching) for a paths-from search with the given edge prototype. The bounds
+ * default to [*1..] and the direction to un-directional; the caller sets them
+ * and loads the start vertex.
+ */
+static VLE_local_context *build_VLE_paths_from_context(
+    GRAPH_global_context *ggctx, char *graph_name, Oid graph_oid,
+    agtype *agt_edge_proto, char *fname)
+{
+    VLE_local_context *vlelctx = NULL;
+
+    vlelctx = palloc0(sizeof(VLE_local_context));
+    vlelctx->graph_name = graph_name;
+    vlelctx->graph_oid = graph_oid;
+    vlelctx->ggctx = ggctx;
+    vlelctx->path_function = VLE_FUNCTION_PATHS_FROM;
+    vlelctx->next_vertex = NULL;
+    vlelctx->vsid = 0;
+    vlelctx->veid = 0;
+    set_VLE_edge_constraint(vlelctx, agt_edge_proto, fname);
+    vlelctx->lidx = 1;
+    vlelctx->uidx = 0;
+    vlelctx->uidx_infinite = true;
+    vlelctx->edge_direction = CYPHER_REL_DIR_NONE;
+    vlelctx->use_cache = false;
+    vlelctx->vle_grammar_node_id = 0;
+    vlelctx->next = NULL;
+    vlelctx->is_dirty = true;
+
+    create_VLE_local_edge_state(vlelctx);
+    vlelctx->dfs_vertex_stack = new_gid_stack();
+    vlelctx->dfs_edge_stack = new_gid_stack();
+    vlelctx->dfs_path_stack = new_gid_stack();
+
+    return vlelctx;
+}
+
+/*
+ * Helper function to set the range bounds of a hand built VLE local context.
+ * A NULL lower bound defaults to 1 and a NULL upper bound means unbounded.
+ */
+static void set_VLE_bounds(VLE_local_context *vlelctx, agtype *agt_lidx,
+                           agtype *agt_uidx, char *fname)
+{
+    agtype_value *agtv_temp = NULL;
+
+    if (agt_lidx == NULL || is_agtype_null(agt_lidx))
+    {
+        vlelctx->lidx = 1;
+    }
+    else
+    {
+        agtv_temp = get_agtype_value(fname, agt_lidx, AGTV_INTEGER, true);
+        vlelctx->lidx = agtv_temp->val.int_value;
+    }
+
+    if (agt_uidx == NULL || is_agtype_null(agt_uidx))
+    {
+        vlelctx->uidx_infinite = true;
+        vlelctx->uidx = 0;
+    }
+    else
+    {
+        agtv_temp = get_agtype_value(fname, agt_uidx, AGTV_INTEGER, true);
+        vlelctx->uidx = agtv_temp->val.int_value;
+        vlelctx->uidx_infinite = false;
+    }
+
+    if (vlelctx->lidx < 0 ||
+        (!vlelctx->uidx_infinite && vlelctx->uidx < vlelctx->lidx))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("%s: invalid range bounds", fname)));
+    }
+}
+
+/*
+ * Multi-source VLE
+ *
+ * A correlated age_vle call rebuilds (or re-fetches) its local context, edge
+ * state, and constraint parse once per outer row. When many start vertices
+ * need to be expanded with the same pattern, age_vle_multi takes them all as
+ * one array and runs the DFS for each in turn over a single local context.
+ * The edge bitset, the edge constraint memo, and the vertex lookups are set
+ * up once and shared by every source; the DFS stacks are empty again by the
+ * time one source is exhausted, so no per-source reset is needed.
+ */
+typedef struct VLE_multi_state
+{
+    VLE_local_context *vlelctx;    /* the shared local context */
+    graphid *sources;              /* the start vertex ids */
+    int64 num_sources;             /* the number of start vertex ids */
+    int64 next_source;             /* the next source to load */
+    bool emit_zero;                /* is a [*0..x] zero path due */
+} VLE_multi_state;
+
+/*
+ * Helper function to move the multi-source VLE onto its next start vertex
+ * that exists in the graph. Returns false when there are no more sources.
+ */
+static bool vle_multi_next_source(VLE_multi_state *state)
+{
+    VLE_local_context *vlelctx = state->vlelctx;
+
+    while (state->next_source < state->num_sources)
+    {
+        graphid vsid = state->sources[state->next_source];
+
+        state->next_source = state->next_source + 1;
+
+        /* skip start vertices that aren't in the graph */
+        if (get_vertex_entry(vlelctx->ggctx, vsid) == NULL)
+        {
+            continue;
+        }
+
+        vlelctx->vsid = vsid;
+        load_initial_dfs_stacks(vlelctx);
+        state->emit_zero = (vlelctx->lidx == 0);
+
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * age_vle_multi(graph_name, sources, edge_prototype, lower_bound, upper_bound,
+ * direction) -> SETOF (source_id graphid, edges agtype, end_id graphid)
+ *
+ * Batched form of the VLE paths-from search. The sources are an agtype array
+ * of vertices or integer vertex ids; every path from each of them that
+ * satisfies the edge prototype (as built by age_build_vle_match_edge) and the
+ * bounds is emitted with the source it belongs to. A NULL upper bound means
+ * unbounded and the direction is one of 'out', 'in', or 'any'. The edges
+ * column is the same VLE path container that age_vle returns.
+ */
+PG_FUNCTION_INFO_V1(age_vle_multi);
+
+Datum age_vle_multi(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx = NULL;
+    VLE_multi_state *state = NULL;
+    VLE_local_context *vlelctx = NULL;
+    VLE_path_container *vpc = NULL;
+    MemoryContext oldctx;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        agtype *agt_sources = NULL;
+        agtype_value *agtv_temp = NULL;
+        TupleDesc tupdesc;
+        char *graph_name = NULL;
+        Oid graph_oid = InvalidOid;
+        GRAPH_global_context *ggctx = NULL;
+        int64 num_elements = 0;
+        int64 i = 0;
+
+        /* the graph name and edge prototype are required */
+        if (PG_ARGISNULL(0) || is_agtype_null(AG_GET_ARG_AGTYPE_P(0)) ||
+            PG_ARGISNULL(2) || is_agtype_null(AG_GET_ARG_AGTYPE_P(2)))
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_vle_multi: invalid NULL argument passed")));
+        }
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                     errmsg("age_vle_multi: function returning record called in context that cannot accept type record")));
+        }
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+        agtv_temp = get_agtype_value("age_vle_multi", AG_GET_ARG_AGTYPE_P(0),
+                                     AGTV_STRING, true);
+        graph_name = pnstrdup(agtv_temp->val.string.val,
+                              agtv_temp->val.string.len);
+        graph_oid = get_graph_oid(graph_name);
+
+        state = palloc0(sizeof(VLE_multi_state));
+        funcctx->user_fctx = state;
+
+        /* no sources, or no graph cache, means no paths */
+        if (PG_ARGISNULL(1) || is_agtype_null(AG_GET_ARG_AGTYPE_P(1)))
+        {
+            pfree_if_not_null(graph_name);
+            MemoryContextSwitchTo(oldctx);
+            SRF_RETURN_DONE(funcctx);
+        }
+
+        agt_sources = AG_GET_ARG_AGTYPE_P(1);
+        if (!AGT_ROOT_IS_ARRAY(agt_sources) || AGT_ROOT_IS_SCALAR(agt_sources))
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("age_vle_multi: sources must be an array of vertices or integer ids")));
+        }
+
+        /* resolve the sources to their graphids */
+        num_elements = AGT_ROOT_COUNT(agt_sources);
+        state->sources = palloc(sizeof(graphid) * Max(num_elements, 1));
+        for (i = 0; i < num_elements; i++)
+        {
+            agtype_value *agtv_source = NULL;
+
+            agtv_source = get_ith_agtype_value_from_container(&agt_sources->root,
+                                                              i);
+
+            /* null sources don't start any paths */
+            if (agtv_source->type == AGTV_NULL)
+            {
+                continue;
+            }
+            if (agtv_source->type == AGTV_VERTEX)
+            {
+                agtv_source = GET_AGTYPE_VALUE_OBJECT_VALUE(agtv_source, "id");
+            }
+            if (agtv_source->type != AGTV_INTEGER)
+            {
+                ereport(ERROR,
+                        (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                         errmsg("age_vle_multi: sources must be an array of vertices or integer ids")));
+            }
+
+            state->sources[state->num_sources] = agtv_source->val.int_value;
+            state->num_sources = state->num_sources + 1;
+        }
+
+        ggctx = manage_GRAPH_global_contexts(graph_name, graph_oid);
+        if (ggctx == NULL || state->num_sources == 0)
+        {
+            pfree_if_not_null(graph_name);
+            MemoryContextSwitchTo(oldctx);
+            SRF_RETURN_DONE(funcctx);
+        }
+
+        /* build the shared VLE local context */
+        vlelctx = build_VLE_paths_from_context(ggctx, graph_name, graph_oid,
+                                               AG_GET_ARG_AGTYPE_P(2),
+                                               "age_vle_multi");
+        set_VLE_bounds(vlelctx,
+                       PG_ARGISNULL(3) ? NULL : AG_GET_ARG_AGTYPE_P(3),
+                       PG_ARGISNULL(4) ? NULL : AG_GET_ARG_AGTYPE_P(4),
+                       "age_vle_multi");
+        vlelctx->edge_direction = sp_agtype_to_direction(
+            PG_ARGISNULL(5) || is_agtype_null(AG_GET_ARG_AGTYPE_P(5)) ?
+            NULL : AG_GET_ARG_AGTYPE_P(5), "age_vle_multi");
+
+        state->vlelctx = vlelctx;
+        state->next_source = 0;
+
+        /* load the first source */
+        if (!vle_multi_next_source(state))
+        {
+            free_VLE_local_context(vlelctx);
+            state->vlelctx = NULL;
+            MemoryContextSwitchTo(oldctx);
+            SRF_RETURN_DONE(funcctx);
+        }
+
+        MemoryContextSwitchTo(oldctx);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    state = (VLE_multi_state *) funcctx->user_fctx;
+    vlelctx = state->vlelctx;
+
+    /* the DFS state needs to survive across calls */
+    oldctx = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+    for (;;)
+    {
+        CHECK_FOR_INTERRUPTS();
+
+        if (state->emit_zero)
+        {
+            state->emit_zero = false;
+            MemoryContextSwitchTo(oldctx);
+            vpc = build_VLE_zero_container(vlelctx);
+            break;
+        }
+
+        if (dfs_find_a_path_from(vlelctx))
+        {
+            MemoryContextSwitchTo(oldctx);
+            vpc = build_VLE_path_container(vlelctx);
+            break;
+        }
+
+        /* this source is exhausted, move on to the next one */
+        if (!vle_multi_next_source(state))
+        {
+            vlelctx->is_dirty = false;
+            free_VLE_local_context(vlelctx);
+            state->vlelctx = NULL;
+            MemoryContextSwitchTo(oldctx);
+            SRF_RETURN_DONE(funcctx);
+        }
+    }
+
+    /* emit a composite (source_id, edges, end_id) row */
+    {
+        Datum values[3];
+        bool nulls[3] = {false, false, false};
+        HeapTuple tuple;
+
+        values[0] = GRAPHID_GET_DATUM(vpc->start_vid);
+        values[1] = PointerGetDatum(vpc);
+        values[2] = GRAPHID_GET_DATUM(vpc->end_vid);
+
+        tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    }
+}
+
+/*
+ * VLE path counting
+ *
+ * A count(*) or count(DISTINCT end) over a VLE only needs the number of
+ * paths, or the set of vertices they end on, so the transform routes those
+ * aggregates to age_vle_count and age_vle_reachable. Neither builds a path
+ * container.
+ *
+ * When the edges walkable from the start vertex, within the upper bound, form
+ * a DAG (a directed VLE with no cycle or self loop in reach), no walk can
+ * repeat an edge, so every walk is a valid path. The paths are then counted
+ * by dynamic programming over hop levels: the number of paths of length k
+ * ending on a vertex is the sum, over its matching edges from level k-1, of
+ * the number of paths of length k-1 ending on their other vertex. This costs one pass over the reachable edges
+ * per level, however many paths there are. Otherwise edge-uniqueness has to
+ * be tracked per path, so the DFS is run and its paths are counted as they
+ * are found.
+ */
+#define VLE_COUNT_HTAB_INITIAL_SIZE 1000
+
+/* per vertex path count, or DAG check visit state */
+typedef struct vle_count_entry
+{
+    graphid vertex_id;             /* vertex id, it is also the hash key */
+    int64 count;                   /* paths ending on the vertex, or state */
+} vle_count_entry;
+
+/* DAG check visit states */
+#define VLE_DAG_ON_STACK 1
+#define VLE_DAG_DONE 2
+
+/* DAG check DFS frame */
+typedef struct vle_dag_frame
+{
+    graphid *edges;                /* the vertex's edges in the direction */
+    int32 num_edges;               /* the number of edges */
+    int32 next_edge;               /* the next edge to follow */
+} vle_dag_frame;
+
+/* helper function to create a vertex keyed count hashtable */
+static HTAB *create_VLE_count_hashtable(const char *name)
+{
+    HASHCTL count_ctl;
+
+    MemSet(&count_ctl, 0, sizeof(count_ctl));
+    count_ctl.keysize = sizeof(int64);
+    count_ctl.entrysize = sizeof(vle_count_entry);
+    count_ctl.hash = graphid_hash;
+    count_ctl.hcxt = CurrentMemoryContext;
+
+    return hash_create(name, VLE_COUNT_HTAB_INITIAL_SIZE, &count_ctl,
+                       HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+}
+
+/* helper function to check a path's end vertex against the terminal label */
+static bool is_a_terminal_match(VLE_local_context *vlelctx, graphid vertex_id)
+{
+    return (vlelctx->terminal_label_name == NULL ||
+            get_graphid_label_id(vertex_id) == vlelctx->terminal_label_id);
+}
+
+/* helper function to add a vertex to a set of path end vertices */
+static void add_VLE_end_vertex(HTAB *ends, graphid vertex_id)
+{
+    vle_count_entry *entry = NULL;
+    bool found = false;
+
+    entry = hash_search(ends, &vertex_id, HASH_ENTER, &found);
+    if (!found)
+    {
+        entry->count = 1;
+    }
+}
+
+/*
+ * Helper function to get a vertex's edges in the direction of a directed VLE.
+ * Self loops are kept separately by the global graph and aren't included.
+ */
+static VertexEdgeArray *get_VLE_directed_edges(VLE_local_context *vlelctx,
+                                               graphid vertex_id)
+{
+    vertex_entry *ve = NULL;
+
+    ve = get_vertex_entry(vlelctx->ggctx, vertex_id);
+    if (ve == NULL)
+    {
+        elog(ERROR, "get_VLE_directed_edges: no vertex found");
+    }
+
+    if (vlelctx->edge_direction == CYPHER_REL_DIR_RIGHT)
+    {
+        return get_vertex_entry_edges_out_array(ve);
+    }
+
+    return get_vertex_entry_edges_in_array(ve);
+}
+
+/*
+ * Helper function to fetch an edge and check it against the edge constraint,
+ * through the edge match memo. Returns the edge entry if it matches, NULL
+ * otherwise.
+ */
+static edge_entry *get_VLE_matched_edge(VLE_local_context *vlelctx,
+                                        graphid edge_id)
+{
+    EdgeMatchMemo *memo = vlelctx->edge_match_memo;
+    edge_entry *ee = NULL;
+    uint32 edge_index;
+
+    ee = get_edge_entry(vlelctx->ggctx, edge_id);
+    if (ee == NULL)
+    {
+        elog(ERROR, "get_VLE_matched_edge: no edge found");
+    }
+
+    edge_index = get_edge_entry_index(ee);
+
+    if (!EDGE_BITSET_TEST(memo->checked, edge_index))
+    {
+        if (is_an_edge_match(vlelctx, ee))
+        {
+            EDGE_BITSET_SET(memo->matched, edge_index);
+        }
+        EDGE_BITSET_SET(memo->checked, edge_index);
+    }
+
+    return EDGE_BITSET_TEST(memo->matched, edge_index) ? ee : NULL;
+}
+
+/* helper function to check for a matching self loop on a vertex */
+static bool has_matched_self_loop(VLE_local_context *vlelctx,
+                                  graphid vertex_id)
+{
+    vertex_entry *ve = NULL;
+    VertexEdgeArray *vea = NULL;
+    int32 i;
+
+    ve = get_vertex_entry(vlelctx->ggctx, vertex_id);
+    vea = get_vertex_entry_edges_self_array(ve);
+
+    for (i = 0; i < vea->size; i++)
+    {
+        if (get_VLE_matched_edge(vlelctx, vea->array[i]) != NULL)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Helper function to collect the vertices that a bounded VLE can still take
+ * an edge from: those within uidx - 1 matching edges of the start vertex, in
+ * the VLE's direction. Found by a breadth first search, level by level.
+ */
+static HTAB *collect_VLE_bounded_vertices(VLE_local_context *vlelctx)
+{
+    HTAB *bounded = NULL;
+    graphid *level = NULL;
+    int64 level_size = 1;
+    int64 level_capacity = 64;
+    int64 depth;
+
+    bounded = create_VLE_count_hashtable("VLE bounded vertices");
+    level = palloc(sizeof(graphid) * level_capacity);
+    level[0] = vlelctx->vsid;
+    hash_search(bounded, &vlelctx->vsid, HASH_ENTER, NULL);
+
+    for (depth = 1; depth < vlelctx->uidx && level_size > 0; depth++)
+    {
+        graphid *next_level = NULL;
+        int64 next_size = 0;
+        int64 i;
+
+        next_level = palloc(sizeof(graphid) * level_capacity);
+
+        for (i = 0; i < level_size; i++)
+        {
+            VertexEdgeArray *vea = NULL;
+            int32 j;
+
+            CHECK_FOR_INTERRUPTS();
+
+            vea = get_VLE_directed_edges(vlelctx, level[i]);
+            for (j = 0; j < vea->size; j++)
+            {
+                edge_entry *ee = NULL;
+                graphid next_vertex_id;
+                bool found = false;
+
+                ee = get_VLE_matched_edge(vlelctx, vea->array[j]);
+                if (ee == NULL)
+                {
+                    continue;
+                }
+
+                next_vertex_id =
+                    (vlelctx->edge_direction == CYPHER_REL_DIR_RIGHT) ?
+                    get_edge_entry_end_vertex_id(ee) :
+                    get_edge_entry_start_vertex_id(ee);
+
+                hash_search(bounded, &next_vertex_id, HASH_ENTER, &found);
+                if (found)
+                {
+                    continue;
+                }
+
+                if (next_size == level_capacity)
+                {
+                    level_capacity = level_capacity * 2;
+                    next_level = repalloc(next_level,
+                                          sizeof(graphid) * level_capacity);
+                }
+                next_level[next_size++] = next_vertex_id;
+            }
+        }
+
+        pfree(level);
+        level = next_level;
+        level_size = next_size;
+    }
+
+    pfree(level);
+
+    return bounded;
+}
+
+/*
+ * Helper function to check that the matching edges a VLE can walk from the
+ * start vertex, in its direction, form a DAG. This is an iterative DFS that
+ * looks for a back edge. Un-directional VLEs can always walk back along the
+ * edge they came in on, so they never qualify.
+ *
+ * A bounded VLE only walks the edges of the vertices within uidx - 1 hops,
+ * so only those are searched, and a cycle further away doesn't keep it from
+ * being counted by level. A cycle among them is enough to fall back to the
+ * DFS, even if it is too long to be walked within the bound.
+ */
+static bool is_VLE_reachable_dag(VLE_local_context *vlelctx)
+{
+    HTAB *bounded = NULL;
+    HTAB *visited = NULL;
+    vle_dag_frame *frames = NULL;
+    int64 num_frames = 0;
+    int64 max_frames = 64;
+    vle_count_entry *entry = NULL;
+    VertexEdgeArray *vea = NULL;
+    graphid *frame_vertices = NULL;
+    bool is_dag = true;
+
+    if (vlelctx->edge_direction == CYPHER_REL_DIR_NONE ||
+        has_matched_self_loop(vlelctx, vlelctx->vsid))
+    {
+        return false;
+    }
+
+    /* only the zero length path */
+    if (!vlelctx->uidx_infinite && vlelctx->uidx == 0)
+    {
+        return true;
+    }
+
+    if (!vlelctx->uidx_infinite)
+    {
+        bounded = collect_VLE_bounded_vertices(vlelctx);
+    }
+
+    visited = create_VLE_count_hashtable("VLE dag check");
+    frames = palloc(sizeof(vle_dag_frame) * max_frames);
+    frame_vertices = palloc(sizeof(graphid) * max_frames);
+
+    /* push the start vertex */
+    entry = hash_search(visited, &vlelctx->vsid, HASH_ENTER, NULL);
+    entry->count = VLE_DAG_ON_STACK;
+    vea = get_VLE_directed_edges(vlelctx, vlelctx->vsid);
+    frames[0].edges = vea->array;
+    frames[0].num_edges = vea->size;
+    frames[0].next_edge = 0;
+    frame_vertices[0] = vlelctx->vsid;
+    num_frames = 1;
+
+    while (num_frames > 0 && is_dag)
+    {
+        vle_dag_frame *frame = &frames[num_frames - 1];
+        edge_entry *ee = NULL;
+        graphid next_vertex_id;
+        bool found = false;
+
+        CHECK_FOR_INTERRUPTS();
+
+        /* all of this vertex's edges are done, so it is too */
+        if (frame->next_edge >= frame->num_edges)
+        {
+            entry = hash_search(visited, &frame_vertices[num_frames - 1],
+                                HASH_FIND, NULL);
+            entry->count = VLE_DAG_DONE;
+            num_frames--;
+            continue;
+        }
+
+        ee = get_VLE_matched_edge(vlelctx, frame->edges[frame->next_edge]);
+        frame->next_edge++;
+        if (ee == NULL)
+        {
+            continue;
+        }
+
+        next_vertex_id = (vlelctx->edge_direction == CYPHER_REL_DIR_RIGHT) ?
+                         get_edge_entry_end_vertex_id(ee) :
+                         get_edge_entry_start_vertex_id(ee);
+
+        /* the VLE can't walk on from a vertex beyond the bound */
+        if (bounded != NULL &&
+            hash_search(bounded, &next_vertex_id, HASH_FIND, NULL) == NULL)
+        {
+            continue;
+        }
+
+        entry = hash_search(visited, &next_vertex_id, HASH_ENTER, &found);
+        if (found)
+        {
+            /* an edge back into the DFS stack closes a cycle */
+            if (entry->count == VLE_DAG_ON_STACK)
+            {
+                is_dag = false;
+            }
+            continue;
+        }
+        entry->count = VLE_DAG_ON_STACK;
+
+        if (has_matched_self_loop(vlelctx, next_vertex_id))
+        {
+            is_dag = false;
+            continue;
+        }
+
+        /* push the next vertex */
+        if (num_frames == max_frames)
+        {
+            max_frames = max_frames * 2;
+            frames = repalloc(frames, sizeof(vle_dag_frame) * max_frames);
+            frame_vertices = repalloc(frame_vertices,
+                                      sizeof(graphid) * max_frames);
+        }
+        vea = get_VLE_directed_edges(vlelctx, next_vertex_id);
+        frames[num_frames].edges = vea->array;
+        frames[num_frames].num_edges = vea->size;
+        frames[num_frames].next_edge = 0;
+        frame_vertices[num_frames] = next_vertex_id;
+        num_frames++;
+    }
+
+    hash_destroy(visited);
+    hash_destroy(bounded);
+    pfree_if_not_null(frames);
+    pfree_if_not_null(frame_vertices);
+
+    return is_dag;
+}
+
+/*
+ * Helper function to count the paths from the start vertex by dynamic
+ * programming over hop levels. The matching edges reachable from the start
+ * vertex must form a DAG. If ends is passed, the end vertices are collected
+ * into it instead and the return value is meaningless.
+ */
+static int64 count_VLE_paths_by_level(VLE_local_context *vlelctx, HTAB *ends)
+{
+    HTAB *frontier = NULL;
+    vle_count_entry *entry = NULL;
+    int64 total = 0;
+    int64 level = 0;
+
+    /* the zero length path */
+    if (vlelctx->lidx == 0 && is_a_terminal_match(vlelctx, vlelctx->vsid))
+    {
+        total = 1;
+        if (ends != NULL)
+        {
+            add_VLE_end_vertex(ends, vlelctx->vsid);
+        }
+    }
+
+    frontier = create_VLE_count_hashtable("VLE count frontier");
+    entry = hash_search(frontier, &vlelctx->vsid, HASH_ENTER, NULL);
+    entry->count = 1;
+
+    while (hash_get_num_entries(frontier) > 0 &&
+           (vlelctx->uidx_infinite || level < vlelctx->uidx))
+    {
+        HTAB *next_frontier = NULL;
+        HASH_SEQ_STATUS status;
+
+        CHECK_FOR_INTERRUPTS();
+
+        level++;
+        next_frontier = create_VLE_count_hashtable("VLE count frontier");
+
+        /* extend every path on the frontier by one edge */
+        hash_seq_init(&status, frontier);
+        while ((entry = hash_seq_search(&status)) != NULL)
+        {
+            VertexEdgeArray *vea = NULL;
+            int32 i;
+
+            vea = get_VLE_directed_edges(vlelctx, entry->vertex_id);
+
+            for (i = 0; i < vea->size; i++)
+            {
+                edge_entry *ee = NULL;
+                vle_count_entry *next_entry = NULL;
+                graphid next_vertex_id;
+                bool found = false;
+
+                ee = get_VLE_matched_edge(vlelctx, vea->array[i]);
+                if (ee == NULL)
+                {
+                    continue;
+                }
+
+                next_vertex_id =
+                    (vlelctx->edge_direction == CYPHER_REL_DIR_RIGHT) ?
+                    get_edge_entry_end_vertex_id(ee) :
+                    get_edge_entry_start_vertex_id(ee);
+
+                next_entry = hash_search(next_frontier, &next_vertex_id,
+                                         HASH_ENTER, &found);
+                if (!found)
+                {
+                    next_entry->count = 0;
+                }
+
+                /* only reachability matters for the end vertices */
+                if (ends != NULL)
+                {
+                    next_entry->count = 1;
+                }
+                else if (pg_add_s64_overflow(next_entry->count, entry->count,
+                                             &next_entry->count))
+                {
+                    ereport(ERROR,
+                            (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                             errmsg("age_vle_count: path count out of range")));
+                }
+            }
+        }
+
+        hash_destroy(frontier);
+        frontier = next_frontier;
+
+        /* the paths of this length are within the bounds */
+        if (level >= vlelctx->lidx)
+        {
+            hash_seq_init(&status, frontier);
+            while ((entry = hash_seq_search(&status)) != NULL)
+            {
+                if (!is_a_terminal_match(vlelctx, entry->vertex_id))
+                {
+                    continue;
+                }
+
+                if (ends != NULL)
+                {
+                    add_VLE_end_vertex(ends, entry->vertex_id);
+                }
+                else if (pg_add_s64_overflow(total, entry->count, &total))
+                {
+                    ereport(ERROR,
+                            (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+                             errmsg("age_vle_count: path count out of range")));
+                }
+            }
+        }
+    }
+
+    hash_destroy(frontier);
+
+    return total;
+}
+
+/* helper function to get the vertex the path on the path stack ends on */
+static graphid get_VLE_path_end_vertex(VLE_local_context *vlelctx)
+{
+    GraphIdStack *stack = vlelctx->dfs_path_stack;
+    graphid vid = vlelctx->vsid;
+    int j;
+
+    for (j = 0; j < gid_stack_size(stack); j++)
+    {
+        edge_entry *ee = NULL;
+
+        ee = get_edge_entry(vlelctx->ggctx, gid_stack_get(stack, j));
+        vid = (vid == get_edge_entry_start_vertex_id(ee)) ?
+                   get_edge_entry_end_vertex_id(ee) :
+                   get_edge_entry_start_vertex_id(ee);
+    }
+
+    return vid;
+}
+
+/*
+ * Helper function to count the paths from the start vertex by running the
+ * DFS, without building the paths. If ends is passed, the end vertices are
+ * collected into it as well.
+ */
+static int64 count_VLE_paths_by_dfs(VLE_local_context *vlelctx, HTAB *ends)
+{
+    int64 total = 0;
+
+    /* the zero length path */
+    if (vlelctx->lidx == 0 && is_a_terminal_match(vlelctx, vlelctx->vsid))
+    {
+        total = 1;
+        if (ends != NULL)
+        {
+            add_VLE_end_vertex(ends, vlelctx->vsid);
+        }
+    }
+
+    load_initial_dfs_stacks(vlelctx);
+
+    while (dfs_find_a_path_from(vlelctx))
+    {
+        total++;
+        if (ends != NULL)
+        {
+            add_VLE_end_vertex(ends, get_VLE_path_end_vertex(vlelctx));
+        }
+    }
+
+    return total;
+}
+
+/*
+ * Helper function to build the VLE local context for age_vle_count and
+ * age_vle_reachable. Their arguments are the graph name, the start vertex or
+ * its id, the edge prototype, the lower and upper bounds, the direction as
+ * age_vle takes it, and the optional terminal vertex label. Returns NULL if
+ * there can't be any paths.
+ */
+static VLE_local_context *build_VLE_count_context(FunctionCallInfo fcinfo,
+                                                  char *fname)
+{
+    VLE_local_context *vlelctx = NULL;
+    GRAPH_global_context *ggctx = NULL;
+    agtype_value *agtv_temp = NULL;
+    char *graph_name = NULL;
+    Oid graph_oid = InvalidOid;
+    graphid vsid = 0;
+
+    if (PG_ARGISNULL(0) || is_agtype_null(AG_GET_ARG_AGTYPE_P(0)) ||
+        PG_ARGISNULL(2) || is_agtype_null(AG_GET_ARG_AGTYPE_P(2)) ||
+        PG_ARGISNULL(5) || is_agtype_null(AG_GET_ARG_AGTYPE_P(5)))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("%s: invalid NULL argument passed", fname)));
+    }
+
+    /* a NULL start vertex doesn't start any paths */
+    if (PG_ARGISNULL(1) || is_agtype_null(AG_GET_ARG_AGTYPE_P(1)))
+    {
+        return NULL;
+    }
+
+    vsid = sp_agtype_to_graphid(AG_GET_ARG_AGTYPE_P(1), fname, "start vertex");
+
+    agtv_temp = get_agtype_value(fname, AG_GET_ARG_AGTYPE_P(0), AGTV_STRING,
+                                 true);
+    graph_name = pnstrdup(agtv_temp->val.string.val,
+                          agtv_temp->val.string.len);
+    graph_oid = get_graph_oid(graph_name);
+
+    ggctx = manage_GRAPH_global_contexts(graph_name, graph_oid);
+    if (ggctx == NULL || get_vertex_entry(ggctx, vsid) == NULL)
+    {
+        pfree_if_not_null(graph_name);
+        return NULL;
+    }
+
+    vlelctx = build_VLE_paths_from_context(ggctx, graph_name, graph_oid,
+                                           AG_GET_ARG_AGTYPE_P(2), fname);
+    vlelctx->vsid = vsid;
+    set_VLE_bounds(vlelctx,
+                   PG_ARGISNULL(3) ? NULL : AG_GET_ARG_AGTYPE_P(3),
+                   PG_ARGISNULL(4) ? NULL : AG_GET_ARG_AGTYPE_P(4),
+                   fname);
+
+    agtv_temp = get_agtype_value(fname, AG_GET_ARG_AGTYPE_P(5), AGTV_INTEGER,
+                                 true);
+    vlelctx->edge_direction = agtv_temp->val.int_value;
+
+    if (!PG_ARGISNULL(6) && !is_agtype_null(AG_GET_ARG_AGTYPE_P(6)))
+    {
+        agtv_temp = get_agtype_value(fname, AG_GET_ARG_AGTYPE_P(6),
+                                     AGTV_STRING, true);
+        vlelctx->terminal_label_name = pnstrdup(agtv_temp->val.string.val,
+                                                agtv_temp->val.string.len);
+        vlelctx->terminal_label_id = get_label_id(vlelctx->terminal_label_name,
+                                                  graph_oid);
+    }
+
+    return vlelctx;
+}
+
+/*
+ * age_vle_count(graph_name, start, edge_prototype, lower_bound, upper_bound,
+ * direction, terminal_label) -> agtype integer
+ *
+ * Returns the number of paths age_vle would emit from the start vertex,
+ * without building them.
+ */
+PG_FUNCTION_INFO_V1(age_vle_count);
+
+Datum age_vle_count(PG_FUNCTION_ARGS)
+{
+    MemoryContext oldctx = CurrentMemoryContext;
+    MemoryContext tmpctx = NULL;
+    VLE_local_context *vlelctx = NULL;
+    agtype_value agtv_result;
+    int64 total = 0;
+
+    tmpctx = AllocSetContextCreate(oldctx, "age vle count",
+                                   ALLOCSET_DEFAULT_SIZES);
+    MemoryContextSwitchTo(tmpctx);
+
+    vlelctx = build_VLE_count_context(fcinfo, "age_vle_count");
+    if (vlelctx != NULL)
+    {
+        if (is_VLE_reachable_dag(vlelctx))
+        {
+            total = count_VLE_paths_by_level(vlelctx, NULL);
+        }
+        else
+        {
+            total = count_VLE_paths_by_dfs(vlelctx, NULL);
+        }
+
+        vlelctx->is_dirty = false;
+        free_VLE_local_context(vlelctx);
+    }
+
+    MemoryContextSwitchTo(oldctx);
+    MemoryContextDelete(tmpctx);
+
+    agtv_result.type = AGTV_INTEGER;
+    agtv_result.val.int_value = total;
+
+    PG_RETURN_POINTER(agtype_value_to_agtype(&agtv_result));
+}
+
+/*
+ * age_vle_reachable(graph_name, start, edge_prototype, lower_bound,
+ * upper_bound, direction, terminal_label) -> agtype list
+ *
+ * Returns the distinct ids of the vertices that the paths age_vle would emit
+ * from the start vertex end on, without building the paths.
+ */
+PG_FUNCTION_INFO_V1(age_vle_reachable);
+
+Datum age_vle_reachable(PG_FUNCTION_ARGS)
+{
+    MemoryContext oldctx = CurrentMemoryContext;
+    MemoryContext tmpctx = NULL;
+    VLE_local_context *vlelctx = NULL;
+    agtype_in_state result;
+    HTAB *ends = NULL;
+
+    tmpctx = AllocSetContextCreate(oldctx, "age vle reachable",
+                                   ALLOCSET_DEFAULT_SIZES);
+    MemoryContextSwitchTo(tmpctx);
+
+    vlelctx = build_VLE_count_context(fcinfo, "age_vle_reachable");
+    if (vlelctx != NULL)
+    {
+        ends = create_VLE_count_hashtable("VLE reachable ends");
+
+        if (is_VLE_reachable_dag(vlelctx))
+        {
+            count_VLE_paths_by_level(vlelctx, ends);
+        }
+        else
+        {
+            count_VLE_paths_by_dfs(vlelctx, ends);
+        }
+
+        vlelctx->is_dirty = false;
+        free_VLE_local_context(vlelctx);
+    }
+
+    /* build the list of end vertex ids in the caller's context */
+    MemoryContextSwitchTo(oldctx);
+
+    memset(&result, 0, sizeof(agtype_in_state));
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_ARRAY,
+                                   NULL);
+    if (ends != NULL)
+    {
+        HASH_SEQ_STATUS status;
+        vle_count_entry *entry = NULL;
+
+        hash_seq_init(&status, ends);
+        while ((entry = hash_seq_search(&status)) != NULL)
+        {
+            agtype_value agtv_id;
+
+            agtv_id.type = AGTV_INTEGER;
+            agtv_id.val.int_value = entry->vertex_id;
+            result.res = push_agtype_value(&result.parse_state, WAGT_ELEM,
+                                           &agtv_id);
+        }
+    }
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_ARRAY, NULL);
+
+    MemoryContextDelete(tmpctx);
+
+    PG_RETURN_POINTER(agtype_value_to_agtype(result.res));
+}
@@ -23,6 +23,7 @@
 #include "utils/ag_guc.h"
 
 bool age_enable_containment = true;
+int age_min_parallel_graph_size = 100000;
 
 /*
  * Defines AGE's custom configuration parameters.
@@ -42,5 +43,17 @@ void define_config_params(void)
                              NULL,
                              NULL,
                              NULL);
+    DefineCustomIntVariable("age.min_parallel_graph_size",
+                            "Sets the minimum number of vertices plus edges for the whole-graph algorithms to use parallel workers.",
+                            NULL,
+                            &age_min_parallel_graph_size,
+                            100000,
+                            0,
+                            INT_MAX,
+                            PGC_USERSET,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
     EmitWarningsOnPlaceholders("age");
 }
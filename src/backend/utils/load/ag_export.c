@@ -0,0 +1,1272 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "postgres.h"
+
+#include <sys/stat.h>
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/parallel.h"
+#include "access/stratnum.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "port/pg_bswap.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/latch.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "utils/fmgroids.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+#include "utils/load/ag_export.h"
+
+/* keys for the parallel exporter's DSM table of contents */
+#define PARALLEL_EXPORT_KEY_SHARED UINT64CONST(0xA6E0000000000011)
+#define PARALLEL_EXPORT_KEY_QUEUES UINT64CONST(0xA6E0000000000012)
+
+/* size of each worker's queue to the leader */
+#define PARALLEL_EXPORT_QUEUE_SIZE 65536
+
+/* the leader's wait event while its queues are empty */
+#if PG_VERSION_NUM >= 170000
+#define PARALLEL_EXPORT_WAIT_EVENT WAIT_EVENT_MESSAGE_QUEUE_RECEIVE
+#else
+#define PARALLEL_EXPORT_WAIT_EVENT WAIT_EVENT_MQ_RECEIVE
+#endif
+
+/*
+ * With workers, labels of more than this many blocks are exported in parts
+ * of this many blocks, each to a file of its own, so that one big label can
+ * be exported by several processes.
+ */
+#define PARALLEL_EXPORT_PART_BLOCKS 8192
+
+/* output is written to the file in pieces of about this size */
+#define EXPORT_WRITE_SIZE 65536
+
+#define AGE_CSV_FILE_EXTENSION ".csv"
+#define AGE_BINARY_FILE_EXTENSION ".bin"
+
+/* the signature that starts a binary COPY file */
+static const char binary_signature[11] = "PGCOPY\n\377\r\n\0";
+
+/* the fixed columns of edge files, as the edge loaders read them */
+static const char *const edge_id_columns[] = {
+    "start_id", "start_vertex_type", "end_id", "end_vertex_type"
+};
+
+#define VERTEX_ID_COLUMN "__id__"
+
+/*
+ * A label, or a range of its blocks, to export, and where its result goes in
+ * the caller's array
+ */
+typedef struct parallel_export_task
+{
+    graph_export_label label;
+    int result_index;
+    int part;                   /* from 1 for a range, 0 for the label */
+    BlockNumber start_block;    /* the range, if part is set */
+    BlockNumber num_blocks;
+} parallel_export_task;
+
+/* the state shared by the leader and the workers */
+typedef struct parallel_export_shared
+{
+    char directory[MAXPGPATH];
+    bool binary;
+
+    /* the next task to be claimed */
+    pg_atomic_uint32 next_task;
+
+    int num_tasks;
+    parallel_export_task tasks[FLEXIBLE_ARRAY_MEMBER];
+} parallel_export_shared;
+
+/*
+ * What a worker sends to the leader for each task it finished. The column
+ * names follow it in the same message, each ending in a NUL.
+ */
+typedef struct parallel_export_message
+{
+    int task_index;
+    int num_columns;
+    int64 num_rows;
+} parallel_export_message;
+
+/* the top-level property keys of a label, kept sorted */
+typedef struct export_columns
+{
+    MemoryContext mcxt;     /* holds the names */
+    int num_columns;
+    int max_columns;
+    char **names;
+    int *lengths;
+} export_columns;
+
+/* a label file being written */
+typedef struct export_writer
+{
+    FILE *file;
+    char *file_path;
+    bool binary;
+    StringInfoData buf;     /* output not yet written to the file */
+    StringInfoData value;   /* the value being rendered */
+} export_writer;
+
+PGDLLEXPORT void age_export_parallel_worker_main(dsm_segment *seg,
+                                                 shm_toc *toc);
+
+static int compare_export_tasks(const void *a, const void *b, void *arg);
+static char *export_file_path(char *directory, parallel_export_task *task,
+                              bool binary);
+static TableScanDesc begin_export_scan(Relation rel,
+                                       parallel_export_task *task);
+static char **build_label_name_map(parallel_export_shared *shared,
+                                   int32 *max_label_id);
+static void export_unclaimed_tasks(parallel_export_shared *shared,
+                                   char **label_names, int32 max_label_id,
+                                   graph_export_result *results);
+static void receive_export_results(parallel_export_shared *shared,
+                                   shm_mq_handle **queues, int num_queues,
+                                   graph_export_result *results);
+static void export_label_file(parallel_export_shared *shared,
+                              parallel_export_task *task, char **label_names,
+                              int32 max_label_id,
+                              graph_export_result *result);
+static agtype *get_row_properties(TupleTableSlot *slot, bool is_edge);
+static int find_export_column(export_columns *columns, const char *name,
+                              int len, int *position);
+static void collect_export_columns(Relation rel, parallel_export_task *task,
+                                   bool is_edge, export_columns *columns,
+                                   MemoryContext row_context);
+static void open_export_writer(export_writer *writer, char *file_path,
+                               bool binary);
+static void flush_export_writer(export_writer *writer, bool force);
+static void close_export_writer(export_writer *writer);
+static void write_export_header(export_writer *writer, char **column_names,
+                                int num_columns);
+static void write_export_row(export_writer *writer, TupleTableSlot *slot,
+                             bool is_edge, export_columns *columns,
+                             agtype_value *values, bool *present,
+                             char **label_names, int32 max_label_id);
+static char *get_endpoint_label_name(graphid id, char **label_names,
+                                     int32 max_label_id);
+static void append_csv_field(StringInfo buf, const char *field, int len);
+static void append_binary_int16(StringInfo buf, int16 value);
+static void append_binary_int32(StringInfo buf, int32 value);
+static void append_binary_int64_field(StringInfo buf, int64 value);
+static void append_binary_text_field(StringInfo buf, const char *text);
+static void render_export_value(StringInfo out, agtype_value *value);
+
+/*
+ * Get the labels of a graph to export.
+ */
+graph_export_label *get_graph_export_labels(Oid graph_oid, int *num_labels)
+{
+    ScanKeyData scan_keys[1];
+    Relation ag_label;
+    SysScanDesc scan_desc;
+    HeapTuple tuple;
+    TupleDesc tupdesc;
+    graph_export_label *labels;
+    int max_labels = 16;
+    int n = 0;
+
+    labels = palloc(sizeof(graph_export_label) * max_labels);
+
+    ScanKeyInit(&scan_keys[0], Anum_ag_label_graph, BTEqualStrategyNumber,
+                F_OIDEQ, ObjectIdGetDatum(graph_oid));
+
+    ag_label = table_open(ag_label_relation_id(), AccessShareLock);
+    tupdesc = RelationGetDescr(ag_label);
+    scan_desc = systable_beginscan(ag_label, ag_label_graph_oid_index_id(),
+                                   true, NULL, 1, scan_keys);
+
+    while (HeapTupleIsValid(tuple = systable_getnext(scan_desc)))
+    {
+        graph_export_label *label;
+        Name name;
+        bool isnull;
+
+        name = DatumGetName(heap_getattr(tuple, Anum_ag_label_name, tupdesc,
+                                         &isnull));
+        if (strcmp(NameStr(*name), AG_DEFAULT_LABEL_EDGE) == 0)
+        {
+            continue;
+        }
+
+        if (n == max_labels)
+        {
+            max_labels *= 2;
+            labels = repalloc(labels, sizeof(graph_export_label) * max_labels);
+        }
+
+        label = &labels[n++];
+        namestrcpy(&label->name, NameStr(*name));
+        label->id = DatumGetInt32(heap_getattr(tuple, Anum_ag_label_id,
+                                               tupdesc, &isnull));
+        label->kind = DatumGetChar(heap_getattr(tuple, Anum_ag_label_kind,
+                                                tupdesc, &isnull));
+        label->relid = DatumGetObjectId(heap_getattr(tuple,
+                                                     Anum_ag_label_relation,
+                                                     tupdesc, &isnull));
+    }
+
+    systable_endscan(scan_desc);
+    table_close(ag_label, AccessShareLock);
+
+    *num_labels = n;
+
+    return labels;
+}
+
+/*
+ * Export the labels of a graph, using parallel workers if asked to.
+ */
+graph_export_result *export_graph_labels(char *directory,
+                                         graph_export_label *labels,
+                                         int num_labels, bool binary,
+                                         int parallel_workers,
+                                         int *num_results)
+{
+    parallel_export_shared *shared;
+    Size shared_size;
+    BlockNumber *label_blocks;
+    BlockNumber *task_blocks;
+    graph_export_result *results;
+    char **label_names;
+    int32 max_label_id;
+    int num_tasks = 0;
+    int nworkers;
+    int i;
+
+    /* room for the label name, a part number and the extension */
+    if (strlen(directory) + NAMEDATALEN + 12 +
+        strlen(AGE_BINARY_FILE_EXTENSION) + 1 >= MAXPGPATH)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_NAME_TOO_LONG),
+                 errmsg("directory path is too long")));
+    }
+
+    *num_results = 0;
+
+    if (num_labels == 0)
+    {
+        return palloc0(sizeof(graph_export_result));
+    }
+
+    /* with workers, big labels are exported in parts */
+    label_blocks = palloc(sizeof(BlockNumber) * num_labels);
+    for (i = 0; i < num_labels; i++)
+    {
+        Relation rel = table_open(labels[i].relid, AccessShareLock);
+
+        label_blocks[i] = RelationGetNumberOfBlocks(rel);
+        table_close(rel, AccessShareLock);
+
+        if (parallel_workers > 0 &&
+            label_blocks[i] > PARALLEL_EXPORT_PART_BLOCKS)
+        {
+            num_tasks += (label_blocks[i] + PARALLEL_EXPORT_PART_BLOCKS - 1) /
+                         PARALLEL_EXPORT_PART_BLOCKS;
+        }
+        else
+        {
+            num_tasks++;
+        }
+    }
+
+    shared_size = add_size(offsetof(parallel_export_shared, tasks),
+                           mul_size(sizeof(parallel_export_task), num_tasks));
+    shared = palloc0(shared_size);
+    strlcpy(shared->directory, directory, MAXPGPATH);
+    shared->binary = binary;
+    shared->num_tasks = num_tasks;
+    pg_atomic_init_u32(&shared->next_task, 0);
+
+    results = palloc0(sizeof(graph_export_result) * num_tasks);
+    task_blocks = palloc(sizeof(BlockNumber) * num_tasks);
+
+    num_tasks = 0;
+    for (i = 0; i < num_labels; i++)
+    {
+        BlockNumber start_block = 0;
+        int part = 0;
+
+        do
+        {
+            parallel_export_task *task = &shared->tasks[num_tasks];
+
+            task->label = labels[i];
+            task->result_index = num_tasks;
+            task->part = 0;
+            task->start_block = 0;
+            task->num_blocks = label_blocks[i];
+
+            if (parallel_workers > 0 &&
+                label_blocks[i] > PARALLEL_EXPORT_PART_BLOCKS)
+            {
+                task->part = ++part;
+                task->start_block = start_block;
+                task->num_blocks = Min(PARALLEL_EXPORT_PART_BLOCKS,
+                                       label_blocks[i] - start_block);
+            }
+
+            task_blocks[num_tasks] = task->num_blocks;
+            results[num_tasks].label_index = i;
+            start_block += task->num_blocks;
+            num_tasks++;
+        } while (start_block < label_blocks[i]);
+    }
+
+    /*
+     * Hand the tasks out largest first, so that a big one claimed last
+     * doesn't leave the other processes idle while it is exported.
+     */
+    qsort_arg(shared->tasks, num_tasks, sizeof(parallel_export_task),
+              compare_export_tasks, task_blocks);
+
+    pfree(label_blocks);
+    pfree(task_blocks);
+
+    *num_results = num_tasks;
+
+    label_names = build_label_name_map(shared, &max_label_id);
+
+    /* the leader exports too, so one worker per other task will do */
+    nworkers = Min(parallel_workers, num_tasks - 1);
+
+    if (nworkers <= 0)
+    {
+        export_unclaimed_tasks(shared, label_names, max_label_id, results);
+    }
+    else
+    {
+        parallel_export_shared *dsm_shared;
+        char *queue_space;
+        shm_mq_handle **queues;
+        ParallelContext *pcxt;
+
+        EnterParallelMode();
+
+        pcxt = CreateParallelContext("age", "age_export_parallel_worker_main",
+                                     nworkers);
+
+        shm_toc_estimate_chunk(&pcxt->estimator, shared_size);
+        shm_toc_estimate_chunk(&pcxt->estimator,
+                               mul_size(PARALLEL_EXPORT_QUEUE_SIZE, nworkers));
+        shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+        InitializeParallelDSM(pcxt);
+
+        /* the DSM may be private memory, and then no workers are launched */
+        dsm_shared = shm_toc_allocate(pcxt->toc, shared_size);
+        memcpy(dsm_shared, shared, shared_size);
+        pg_atomic_init_u32(&dsm_shared->next_task, 0);
+        shm_toc_insert(pcxt->toc, PARALLEL_EXPORT_KEY_SHARED, dsm_shared);
+
+        queue_space = shm_toc_allocate(pcxt->toc,
+                                       mul_size(PARALLEL_EXPORT_QUEUE_SIZE,
+                                                nworkers));
+        shm_toc_insert(pcxt->toc, PARALLEL_EXPORT_KEY_QUEUES, queue_space);
+        queues = palloc0(sizeof(shm_mq_handle *) * nworkers);
+        for (i = 0; i < pcxt->nworkers; i++)
+        {
+            shm_mq *mq;
+
+            mq = shm_mq_create(queue_space +
+                               (Size) i * PARALLEL_EXPORT_QUEUE_SIZE,
+                               PARALLEL_EXPORT_QUEUE_SIZE);
+            shm_mq_set_receiver(mq, MyProc);
+            queues[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+        }
+
+        LaunchParallelWorkers(pcxt);
+
+        /*
+         * Detect workers that fail to start, and let go of the queues of the
+         * ones that weren't launched.
+         */
+        for (i = 0; i < pcxt->nworkers; i++)
+        {
+            if (i < pcxt->nworkers_launched)
+            {
+                shm_mq_set_handle(queues[i], pcxt->worker[i].bgwhandle);
+            }
+            else
+            {
+                shm_mq_detach(queues[i]);
+                queues[i] = NULL;
+            }
+        }
+
+        /* the leader exports too, then collects the workers' results */
+        export_unclaimed_tasks(dsm_shared, label_names, max_label_id,
+                               results);
+        receive_export_results(dsm_shared, queues, pcxt->nworkers_launched,
+                               results);
+
+        WaitForParallelWorkersToFinish(pcxt);
+        DestroyParallelContext(pcxt);
+        ExitParallelMode();
+    }
+
+    return results;
+}
+
+/*
+ * Worker entry point. Claim tasks until there are none left, export them,
+ * and send what was written to the leader.
+ */
+void age_export_parallel_worker_main(dsm_segment *seg, shm_toc *toc)
+{
+    parallel_export_shared *shared;
+    char *queue_space;
+    shm_mq *mq;
+    shm_mq_handle *queue;
+    char **label_names;
+    int32 max_label_id;
+    uint32 task_index;
+
+    shared = shm_toc_lookup(toc, PARALLEL_EXPORT_KEY_SHARED, false);
+    queue_space = shm_toc_lookup(toc, PARALLEL_EXPORT_KEY_QUEUES, false);
+
+    mq = (shm_mq *) (queue_space +
+                     (Size) ParallelWorkerNumber * PARALLEL_EXPORT_QUEUE_SIZE);
+    shm_mq_set_sender(mq, MyProc);
+    queue = shm_mq_attach(mq, seg, NULL);
+
+    label_names = build_label_name_map(shared, &max_label_id);
+
+    while ((task_index = pg_atomic_fetch_add_u32(&shared->next_task, 1)) <
+           (uint32) shared->num_tasks)
+    {
+        graph_export_result result;
+        parallel_export_message message;
+        StringInfoData names;
+        shm_mq_iovec iov[2];
+        shm_mq_result mq_result;
+        int i;
+
+        export_label_file(shared, &shared->tasks[task_index], label_names,
+                          max_label_id, &result);
+
+        message.task_index = task_index;
+        message.num_columns = result.num_columns;
+        message.num_rows = result.num_rows;
+
+        initStringInfo(&names);
+        for (i = 0; i < result.num_columns; i++)
+        {
+            appendBinaryStringInfo(&names, result.column_names[i],
+                                   strlen(result.column_names[i]) + 1);
+        }
+
+        iov[0].data = (const char *) &message;
+        iov[0].len = sizeof(parallel_export_message);
+        iov[1].data = names.data;
+        iov[1].len = names.len;
+
+        mq_result = shm_mq_sendv(queue, iov, 2, false, false);
+
+        /* the leader only detaches when it is erroring out */
+        if (mq_result == SHM_MQ_DETACHED)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_ADMIN_SHUTDOWN),
+                     errmsg("parallel export leader detached")));
+        }
+
+        pfree(names.data);
+    }
+
+    /* the leader stops waiting for this worker once it detaches */
+    shm_mq_detach(queue);
+}
+
+/* Order tasks by their number of blocks, largest first */
+static int compare_export_tasks(const void *a, const void *b, void *arg)
+{
+    const parallel_export_task *task_a = a;
+    const parallel_export_task *task_b = b;
+    BlockNumber *num_blocks = arg;
+    BlockNumber blocks_a = num_blocks[task_a->result_index];
+    BlockNumber blocks_b = num_blocks[task_b->result_index];
+
+    if (blocks_a != blocks_b)
+    {
+        return (blocks_a > blocks_b) ? -1 : 1;
+    }
+
+    return task_a->result_index - task_b->result_index;
+}
+
+/*
+ * Get the file a task writes: <label>.csv for a whole label, and
+ * <label>.<part>.csv for a part of one.
+ */
+static char *export_file_path(char *directory, parallel_export_task *task,
+                              bool binary)
+{
+    const char *extension = binary ? AGE_BINARY_FILE_EXTENSION :
+                                     AGE_CSV_FILE_EXTENSION;
+
+    if (task->part > 0)
+    {
+        return psprintf("%s/%s.%d%s", directory, NameStr(task->label.name),
+                        task->part, extension);
+    }
+
+    return psprintf("%s/%s%s", directory, NameStr(task->label.name),
+                    extension);
+}
+
+/*
+ * Begin a scan of the rows a task exports. A part's blocks are read without
+ * a synchronized scan, which could start outside of them.
+ */
+static TableScanDesc begin_export_scan(Relation rel,
+                                       parallel_export_task *task)
+{
+    TableScanDesc scan;
+
+    if (task->part == 0)
+    {
+        return table_beginscan(rel, GetActiveSnapshot(), 0, NULL);
+    }
+
+    scan = table_beginscan_strat(rel, GetActiveSnapshot(), 0, NULL, true,
+                                 false);
+    heap_setscanlimits(scan, task->start_block, task->num_blocks);
+
+    return scan;
+}
+
+/*
+ * Map the label ids of the graph to their names, for the endpoint label
+ * names of edges. The names point into shared.
+ */
+static char **build_label_name_map(parallel_export_shared *shared,
+                                   int32 *max_label_id)
+{
+    char **label_names;
+    int32 max_id = 0;
+    int i;
+
+    for (i = 0; i < shared->num_tasks; i++)
+    {
+        max_id = Max(max_id, shared->tasks[i].label.id);
+    }
+
+    label_names = palloc0(sizeof(char *) * (max_id + 1));
+    for (i = 0; i < shared->num_tasks; i++)
+    {
+        label_names[shared->tasks[i].label.id] =
+            NameStr(shared->tasks[i].label.name);
+    }
+
+    *max_label_id = max_id;
+
+    return label_names;
+}
+
+/*
+ * Export the labels that no other process has claimed, recording the
+ * results directly.
+ */
+static void export_unclaimed_tasks(parallel_export_shared *shared,
+                                   char **label_names, int32 max_label_id,
+                                   graph_export_result *results)
+{
+    uint32 task_index;
+
+    while ((task_index = pg_atomic_fetch_add_u32(&shared->next_task, 1)) <
+           (uint32) shared->num_tasks)
+    {
+        parallel_export_task *task = &shared->tasks[task_index];
+
+        export_label_file(shared, task, label_names, max_label_id,
+                          &results[task->result_index]);
+    }
+}
+
+/*
+ * Record the results sent by the workers until all of them have detached.
+ */
+static void receive_export_results(parallel_export_shared *shared,
+                                   shm_mq_handle **queues, int num_queues,
+                                   graph_export_result *results)
+{
+    int num_active = num_queues;
+
+    while (num_active > 0)
+    {
+        bool received = false;
+        int i;
+
+        CHECK_FOR_INTERRUPTS();
+
+        for (i = 0; i < num_queues; i++)
+        {
+            shm_mq_result mq_result;
+            Size nbytes;
+            void *data;
+            parallel_export_message message;
+            parallel_export_task *task;
+            graph_export_result *result;
+            char *name;
+            int j;
+
+            if (queues[i] == NULL)
+            {
+                continue;
+            }
+
+            mq_result = shm_mq_receive(queues[i], &nbytes, &data, true);
+
+            if (mq_result == SHM_MQ_DETACHED)
+            {
+                /* done, or failed; a failure is reported when waiting */
+                shm_mq_detach(queues[i]);
+                queues[i] = NULL;
+                num_active--;
+                continue;
+            }
+
+            if (mq_result == SHM_MQ_WOULD_BLOCK)
+            {
+                continue;
+            }
+
+            memcpy(&message, data, sizeof(parallel_export_message));
+
+            task = &shared->tasks[message.task_index];
+            result = &results[task->result_index];
+
+            result->file_path = export_file_path(shared->directory, task,
+                                                 shared->binary);
+            result->num_rows = message.num_rows;
+            result->num_columns = message.num_columns;
+            result->column_names = palloc(sizeof(char *) *
+                                          message.num_columns);
+
+            name = (char *) data + sizeof(parallel_export_message);
+            for (j = 0; j < message.num_columns; j++)
+            {
+                result->column_names[j] = pstrdup(name);
+                name += strlen(name) + 1;
+            }
+
+            received = true;
+        }
+
+        if (!received && num_active > 0)
+        {
+            (void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+                             PARALLEL_EXPORT_WAIT_EVENT);
+            ResetLatch(MyLatch);
+        }
+    }
+}
+
+/*
+ * Export one label, or part of one: a first scan collects the property keys
+ * of its rows, which become the columns, and a second one writes the rows.
+ * Both scans use the active snapshot, so they see the same rows. The parts
+ * of a label have the columns of their own rows, so each part file loads on
+ * its own. The result is allocated in the
+ * current memory context.
+ */
+static void export_label_file(parallel_export_shared *shared,
+                              parallel_export_task *task, char **label_names,
+                              int32 max_label_id, graph_export_result *result)
+{
+    bool is_edge = (task->label.kind == LABEL_KIND_EDGE);
+    int num_id_columns = is_edge ? lengthof(edge_id_columns) : 1;
+    MemoryContext label_context;
+    MemoryContext row_context;
+    MemoryContext old_context;
+    Relation rel;
+    TupleTableSlot *slot;
+    TableScanDesc scan;
+    export_columns columns;
+    export_writer writer;
+    agtype_value *values;
+    bool *present;
+    int i;
+
+    result->file_path = export_file_path(shared->directory, task,
+                                         shared->binary);
+    result->num_rows = 0;
+
+    label_context = AllocSetContextCreate(CurrentMemoryContext,
+                                          "AGE Export Label Context",
+                                          ALLOCSET_DEFAULT_SIZES);
+    row_context = AllocSetContextCreate(label_context,
+                                        "AGE Export Row Context",
+                                        ALLOCSET_DEFAULT_SIZES);
+
+    rel = table_open(task->label.relid, AccessShareLock);
+
+    columns.mcxt = label_context;
+    collect_export_columns(rel, task, is_edge, &columns, row_context);
+
+    result->num_columns = num_id_columns + columns.num_columns;
+    result->column_names = palloc(sizeof(char *) * result->num_columns);
+    for (i = 0; i < num_id_columns; i++)
+    {
+        result->column_names[i] = pstrdup(is_edge ? edge_id_columns[i] :
+                                                    VERTEX_ID_COLUMN);
+    }
+    for (i = 0; i < columns.num_columns; i++)
+    {
+        result->column_names[num_id_columns + i] =
+            pnstrdup(columns.names[i], columns.lengths[i]);
+    }
+
+    /* a binary row starts with its field count, an int16 */
+    if (shared->binary && result->num_columns > PG_INT16_MAX)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                 errmsg("label \"%s\" has too many properties for a binary file",
+                        NameStr(task->label.name))));
+    }
+
+    old_context = MemoryContextSwitchTo(label_context);
+
+    open_export_writer(&writer, result->file_path, shared->binary);
+    write_export_header(&writer, result->column_names, result->num_columns);
+
+    values = palloc(sizeof(agtype_value) * Max(columns.num_columns, 1));
+    present = palloc(sizeof(bool) * Max(columns.num_columns, 1));
+
+    slot = table_slot_create(rel, NULL);
+    scan = begin_export_scan(rel, task);
+
+    while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+    {
+        CHECK_FOR_INTERRUPTS();
+
+        MemoryContextSwitchTo(row_context);
+        write_export_row(&writer, slot, is_edge, &columns, values, present,
+                         label_names, max_label_id);
+        MemoryContextSwitchTo(label_context);
+        MemoryContextReset(row_context);
+
+        result->num_rows++;
+    }
+
+    table_endscan(scan);
+    ExecDropSingleTupleTableSlot(slot);
+    table_close(rel, AccessShareLock);
+
+    /* the trailer of a binary file */
+    if (shared->binary)
+    {
+        append_binary_int16(&writer.buf, -1);
+    }
+
+    close_export_writer(&writer);
+
+    MemoryContextSwitchTo(old_context);
+    MemoryContextDelete(label_context);
+}
+
+static agtype *get_row_properties(TupleTableSlot *slot, bool is_edge)
+{
+    agtype *properties;
+    bool isnull;
+
+    properties = DATUM_GET_AGTYPE_P(slot_getattr(slot,
+        is_edge ? Anum_ag_label_edge_table_properties :
+                  Anum_ag_label_vertex_table_properties, &isnull));
+
+    if (!AGT_ROOT_IS_OBJECT(properties))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATA_EXCEPTION),
+                 errmsg("properties of a row of table \"%s\" are not an object",
+                        get_rel_name(slot->tts_tableOid))));
+    }
+
+    return properties;
+}
+
+/*
+ * Return the index of the column with the given name, or -1 with the
+ * position it would be inserted at in *position.
+ */
+static int find_export_column(export_columns *columns, const char *name,
+                              int len, int *position)
+{
+    int low = 0;
+    int high = columns->num_columns - 1;
+
+    while (low <= high)
+    {
+        int middle = low + (high - low) / 2;
+        int cmp;
+
+        cmp = memcmp(name, columns->names[middle],
+                     Min(len, columns->lengths[middle]));
+        if (cmp == 0)
+        {
+            cmp = len - columns->lengths[middle];
+        }
+
+        if (cmp == 0)
+        {
+            return middle;
+        }
+        else if (cmp < 0)
+        {
+            high = middle - 1;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    *position = low;
+
+    return -1;
+}
+
+/*
+ * Collect the top-level property keys of the rows of a task. A vertex's
+ * __id__ property is left out, since the id column stands for it.
+ */
+static void collect_export_columns(Relation rel, parallel_export_task *task,
+                                   bool is_edge, export_columns *columns,
+                                   MemoryContext row_context)
+{
+    TupleTableSlot *slot;
+    TableScanDesc scan;
+
+    columns->num_columns = 0;
+    columns->max_columns = 16;
+    columns->names = MemoryContextAlloc(columns->mcxt,
+                                        sizeof(char *) * columns->max_columns);
+    columns->lengths = MemoryContextAlloc(columns->mcxt,
+                                          sizeof(int) * columns->max_columns);
+
+    slot = table_slot_create(rel, NULL);
+    scan = begin_export_scan(rel, task);
+
+    while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+    {
+        MemoryContext old_context;
+        agtype *properties;
+        agtype_iterator *it;
+        agtype_value v;
+        agtype_iterator_token token;
+
+        CHECK_FOR_INTERRUPTS();
+
+        old_context = MemoryContextSwitchTo(row_context);
+
+        properties = get_row_properties(slot, is_edge);
+        it = agtype_iterator_init(&properties->root);
+
+        while ((token = agtype_iterator_next(&it, &v, true)) != WAGT_DONE)
+        {
+            int position;
+
+            if (token != WAGT_KEY ||
+                (!is_edge &&
+                 v.val.string.len == strlen(VERTEX_ID_COLUMN) &&
+                 memcmp(v.val.string.val, VERTEX_ID_COLUMN,
+                        v.val.string.len) == 0) ||
+                find_export_column(columns, v.val.string.val,
+                                   v.val.string.len, &position) >= 0)
+            {
+                continue;
+            }
+
+            if (columns->num_columns == columns->max_columns)
+            {
+                columns->max_columns *= 2;
+                columns->names = repalloc(columns->names, sizeof(char *) *
+                                          columns->max_columns);
+                columns->lengths = repalloc(columns->lengths, sizeof(int) *
+                                            columns->max_columns);
+            }
+
+            memmove(&columns->names[position + 1], &columns->names[position],
+                    sizeof(char *) * (columns->num_columns - position));
+            memmove(&columns->lengths[position + 1],
+                    &columns->lengths[position],
+                    sizeof(int) * (columns->num_columns - position));
+
+            columns->names[position] = MemoryContextAlloc(columns->mcxt,
+                                                          v.val.string.len);
+            memcpy(columns->names[position], v.val.string.val,
+                   v.val.string.len);
+            columns->lengths[position] = v.val.string.len;
+            columns->num_columns++;
+        }
+
+        MemoryContextSwitchTo(old_context);
+        MemoryContextReset(row_context);
+    }
+
+    table_endscan(scan);
+    ExecDropSingleTupleTableSlot(slot);
+}
+
+static void open_export_writer(export_writer *writer, char *file_path,
+                               bool binary)
+{
+    mode_t oumask;
+
+    writer->file_path = file_path;
+    writer->binary = binary;
+    initStringInfo(&writer->buf);
+    initStringInfo(&writer->value);
+
+    /* as COPY TO does, let other users read the file */
+    oumask = umask(S_IWGRP | S_IWOTH);
+    PG_TRY();
+    {
+        writer->file = AllocateFile(file_path, PG_BINARY_W);
+    }
+    PG_FINALLY();
+    {
+        umask(oumask);
+    }
+    PG_END_TRY();
+
+    if (writer->file == NULL)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not open file \"%s\" for writing: %m",
+                        file_path)));
+    }
+}
+
+/* Write out the buffered output once there is enough of it, or if forced */
+static void flush_export_writer(export_writer *writer, bool force)
+{
+    if (writer->buf.len == 0 || (!force && writer->buf.len < EXPORT_WRITE_SIZE))
+    {
+        return;
+    }
+
+    if (fwrite(writer->buf.data, 1, writer->buf.len, writer->file) !=
+        (size_t) writer->buf.len)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not write to file \"%s\": %m",
+                        writer->file_path)));
+    }
+
+    resetStringInfo(&writer->buf);
+}
+
+static void close_export_writer(export_writer *writer)
+{
+    flush_export_writer(writer, true);
+
+    if (FreeFile(writer->file) != 0)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not close file \"%s\": %m",
+                        writer->file_path)));
+    }
+
+    writer->file = NULL;
+}
+
+/*
+ * Write the header of a CSV file, its column names, or the header of a
+ * binary file, which has no column names.
+ */
+static void write_export_header(export_writer *writer, char **column_names,
+                                int num_columns)
+{
+    int i;
+
+    if (writer->binary)
+    {
+        appendBinaryStringInfo(&writer->buf, binary_signature,
+                               sizeof(binary_signature));
+        /* no flags, and no header extension */
+        append_binary_int32(&writer->buf, 0);
+        append_binary_int32(&writer->buf, 0);
+        return;
+    }
+
+    for (i = 0; i < num_columns; i++)
+    {
+        if (i > 0)
+        {
+            appendStringInfoChar(&writer->buf, ',');
+        }
+        append_csv_field(&writer->buf, column_names[i],
+                         strlen(column_names[i]));
+    }
+    appendStringInfoChar(&writer->buf, '\n');
+}
+
+/*
+ * Write the row in slot. values and present have room for the property
+ * columns.
+ */
+static void write_export_row(export_writer *writer, TupleTableSlot *slot,
+                             bool is_edge, export_columns *columns,
+                             agtype_value *values, bool *present,
+                             char **label_names, int32 max_label_id)
+{
+    StringInfo buf = &writer->buf;
+    agtype *properties;
+    agtype_iterator *it;
+    agtype_value v;
+    agtype_iterator_token token;
+    int column = -1;
+    bool isnull;
+    int i;
+
+    /* line the property values up with the columns */
+    memset(present, 0, sizeof(bool) * columns->num_columns);
+
+    properties = get_row_properties(slot, is_edge);
+    it = agtype_iterator_init(&properties->root);
+
+    while ((token = agtype_iterator_next(&it, &v, true)) != WAGT_DONE)
+    {
+        int position;
+
+        if (token == WAGT_KEY)
+        {
+            column = find_export_column(columns, v.val.string.val,
+                                        v.val.string.len, &position);
+        }
+        else if (token == WAGT_VALUE && column >= 0)
+        {
+            values[column] = v;
+            present[column] = true;
+        }
+    }
+
+    if (writer->binary)
+    {
+        append_binary_int16(buf, (is_edge ? lengthof(edge_id_columns) : 1) +
+                                 columns->num_columns);
+    }
+
+    if (is_edge)
+    {
+        graphid start_id;
+        graphid end_id;
+
+        start_id = DATUM_GET_GRAPHID(slot_getattr(slot,
+            Anum_ag_label_edge_table_start_id, &isnull));
+        end_id = DATUM_GET_GRAPHID(slot_getattr(slot,
+            Anum_ag_label_edge_table_end_id, &isnull));
+
+        if (writer->binary)
+        {
+            append_binary_int64_field(buf, get_graphid_entry_id(start_id));
+            append_binary_text_field(buf,
+                get_endpoint_label_name(start_id, label_names, max_label_id));
+            append_binary_int64_field(buf, get_graphid_entry_id(end_id));
+            append_binary_text_field(buf,
+                get_endpoint_label_name(end_id, label_names, max_label_id));
+        }
+        else
+        {
+            char *label_name;
+
+            appendStringInfo(buf, INT64_FORMAT ",",
+                             get_graphid_entry_id(start_id));
+            label_name = get_endpoint_label_name(start_id, label_names,
+                                                 max_label_id);
+            append_csv_field(buf, label_name, strlen(label_name));
+            appendStringInfo(buf, "," INT64_FORMAT ",",
+                             get_graphid_entry_id(end_id));
+            label_name = get_endpoint_label_name(end_id, label_names,
+                                                 max_label_id);
+            append_csv_field(buf, label_name, strlen(label_name));
+        }
+    }
+    else
+    {
+        graphid id;
+
+        id = DATUM_GET_GRAPHID(slot_getattr(slot,
+                                            Anum_ag_label_vertex_table_id,
+                                            &isnull));
+
+        if (writer->binary)
+        {
+            append_binary_int64_field(buf, get_graphid_entry_id(id));
+        }
+        else
+        {
+            appendStringInfo(buf, INT64_FORMAT, get_graphid_entry_id(id));
+        }
+    }
+
+    for (i = 0; i < columns->num_columns; i++)
+    {
+        if (present[i])
+        {
+            render_export_value(&writer->value, &values[i]);
+        }
+
+        if (writer->binary)
+        {
+            if (!present[i])
+            {
+                append_binary_int32(buf, -1);
+                continue;
+            }
+
+            /* agtype's binary format is a version byte and the text */
+            append_binary_int32(buf, writer->value.len + 1);
+            appendStringInfoChar(buf, 1);
+            appendBinaryStringInfo(buf, writer->value.data,
+                                   writer->value.len);
+        }
+        else
+        {
+            appendStringInfoChar(buf, ',');
+            if (present[i])
+            {
+                append_csv_field(buf, writer->value.data, writer->value.len);
+            }
+        }
+    }
+
+    if (!writer->binary)
+    {
+        appendStringInfoChar(buf, '\n');
+    }
+
+    flush_export_writer(writer, false);
+}
+
+static char *get_endpoint_label_name(graphid id, char **label_names,
+                                     int32 max_label_id)
+{
+    int32 label_id = get_graphid_label_id(id);
+
+    if (label_id < 0 || label_id > max_label_id ||
+        label_names[label_id] == NULL)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATA_EXCEPTION),
+                 errmsg("label %d of edge endpoint " INT64_FORMAT
+                        " does not exist", label_id, (int64) id)));
+    }
+
+    return label_names[label_id];
+}
+
+/*
+ * Append a CSV field, quoting it if it has a delimiter, a quote or a line
+ * break in it, or if it is empty, which COPY would read as NULL.
+ */
+static void append_csv_field(StringInfo buf, const char *field, int len)
+{
+    bool quote = (len == 0);
+    int i;
+
+    for (i = 0; i < len && !quote; i++)
+    {
+        if (field[i] == ',' || field[i] == '"' || field[i] == '\n' ||
+            field[i] == '\r')
+        {
+            quote = true;
+        }
+    }
+
+    if (!quote)
+    {
+        appendBinaryStringInfo(buf, field, len);
+        return;
+    }
+
+    appendStringInfoChar(buf, '"');
+    for (i = 0; i < len; i++)
+    {
+        if (field[i] == '"')
+        {
+            appendStringInfoChar(buf, '"');
+        }
+        appendStringInfoChar(buf, field[i]);
+    }
+    appendStringInfoChar(buf, '"');
+}
+
+static void append_binary_int16(StringInfo buf, int16 value)
+{
+    uint16 n = pg_hton16((uint16) value);
+
+    appendBinaryStringInfo(buf, (char *) &n, sizeof(n));
+}
+
+static void append_binary_int32(StringInfo buf, int32 value)
+{
+    uint32 n = pg_hton32((uint32) value);
+
+    appendBinaryStringInfo(buf, (char *) &n, sizeof(n));
+}
+
+/* Append an int8 field, with its length */
+static void append_binary_int64_field(StringInfo buf, int64 value)
+{
+    uint64 n = pg_hton64((uint64) value);
+
+    append_binary_int32(buf, sizeof(n));
+    appendBinaryStringInfo(buf, (char *) &n, sizeof(n));
+}
+
+/* Append a text field, with its length */
+static void append_binary_text_field(StringInfo buf, const char *text)
+{
+    int len = strlen(text);
+
+    append_binary_int32(buf, len);
+    appendBinaryStringInfo(buf, text, len);
+}
+
+/* Render a property value as agtype text, replacing the contents of out */
+static void render_export_value(StringInfo out, agtype_value *value)
+{
+    agtype *agt = agtype_value_to_agtype(value);
+
+    resetStringInfo(out);
+    (void) agtype_to_cstring(out, &agt->root, VARSIZE(agt));
+}
@@ -0,0 +1,546 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "postgres.h"
+
+#include "access/table.h"
+#include "catalog/pg_type.h"
+#include "executor/executor.h"
+#include "lib/stringinfo.h"
+#include "port/pg_bswap.h"
+#include "storage/fd.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+#include "utils/load/ag_load_binary.h"
+
+/* the signature that starts a binary COPY file */
+static const char binary_signature[11] = "PGCOPY\n\377\r\n\0";
+
+/* a binary COPY file being read, with the receive functions of its columns */
+typedef struct binary_load_reader
+{
+    FILE *file;
+    char *file_path;
+    int num_columns;
+    Oid *column_types;
+    FmgrInfo *receive_functions;
+    Oid *receive_ioparams;
+    StringInfoData field_buf;
+    Datum *values;
+    bool *nulls;
+} binary_load_reader;
+
+static void read_binary_bytes(binary_load_reader *reader, void *buf,
+                              size_t len);
+static int32 read_binary_int32(binary_load_reader *reader);
+static void read_binary_header(binary_load_reader *reader);
+static bool read_binary_row(binary_load_reader *reader);
+static int64 integer_datum_to_int64(Datum value, Oid type);
+static void push_binary_field(agtype_in_state *result, Datum value,
+                              bool isnull, Oid type);
+static agtype *create_agtype_from_datums(binary_load_reader *reader,
+                                         char **column_names, int start_index,
+                                         bool add_entry_id, int64 entry_id);
+
+/* Read len bytes, raising an error at the end of the file */
+static void read_binary_bytes(binary_load_reader *reader, void *buf,
+                              size_t len)
+{
+    if (fread(buf, 1, len, reader->file) != len)
+    {
+        if (ferror(reader->file))
+        {
+            ereport(ERROR,
+                    (errcode_for_file_access(),
+                     errmsg("could not read file \"%s\": %m",
+                            reader->file_path)));
+        }
+
+        ereport(ERROR,
+                (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                 errmsg("unexpected EOF in COPY data")));
+    }
+}
+
+static int32 read_binary_int32(binary_load_reader *reader)
+{
+    uint32 value;
+
+    read_binary_bytes(reader, &value, sizeof(value));
+
+    return (int32) pg_ntoh32(value);
+}
+
+/* Check the file header and skip its extension area */
+static void read_binary_header(binary_load_reader *reader)
+{
+    char signature[sizeof(binary_signature)];
+    int32 flags;
+    int32 extension_len;
+
+    read_binary_bytes(reader, signature, sizeof(signature));
+    if (memcmp(signature, binary_signature, sizeof(binary_signature)) != 0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                 errmsg("COPY file signature not recognized")));
+    }
+
+    /* bit 16 says the rows have OIDs, the other high bits are critical */
+    flags = read_binary_int32(reader);
+    if ((flags & (1 << 16)) != 0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                 errmsg("binary files with OIDs are not supported")));
+    }
+    if ((flags & 0xFFFE0000) != 0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                 errmsg("unrecognized critical flags in COPY file header")));
+    }
+
+    extension_len = read_binary_int32(reader);
+    if (extension_len < 0)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                 errmsg("invalid COPY file header (wrong length)")));
+    }
+
+    while (extension_len-- > 0)
+    {
+        char c;
+
+        read_binary_bytes(reader, &c, 1);
+    }
+}
+
+/*
+ * Read the next row into reader->values and reader->nulls, in the current
+ * memory context. Returns false at the end of the data.
+ */
+static bool read_binary_row(binary_load_reader *reader)
+{
+    uint16 field_count;
+    int i;
+
+    /* the end of the file is also accepted in place of the trailer */
+    if (fread(&field_count, 1, sizeof(field_count), reader->file) !=
+        sizeof(field_count))
+    {
+        if (ferror(reader->file))
+        {
+            ereport(ERROR,
+                    (errcode_for_file_access(),
+                     errmsg("could not read file \"%s\": %m",
+                            reader->file_path)));
+        }
+
+        return false;
+    }
+
+    field_count = pg_ntoh16(field_count);
+
+    /* the trailer */
+    if ((int16) field_count == -1)
+    {
+        return false;
+    }
+
+    if ((int16) field_count != reader->num_columns)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                 errmsg("row field count is %d, expected %d",
+                        (int16) field_count, reader->num_columns)));
+    }
+
+    for (i = 0; i < reader->num_columns; i++)
+    {
+        int32 len = read_binary_int32(reader);
+
+        if (len == -1)
+        {
+            reader->values[i] = (Datum) 0;
+            reader->nulls[i] = true;
+            continue;
+        }
+
+        if (len < 0)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+                     errmsg("invalid field size")));
+        }
+
+        resetStringInfo(&reader->field_buf);
+        enlargeStringInfo(&reader->field_buf, len);
+        read_binary_bytes(reader, reader->field_buf.data, len);
+        reader->field_buf.len = len;
+        reader->field_buf.data[len] = '\0';
+
+        reader->values[i] = ReceiveFunctionCall(&reader->receive_functions[i],
+                                                &reader->field_buf,
+                                                reader->receive_ioparams[i],
+                                                -1);
+        reader->nulls[i] = false;
+
+        /* the receive function must have used the whole field */
+        if (reader->field_buf.cursor != reader->field_buf.len)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+                     errmsg("incorrect binary data format in field %d",
+                            i + 1)));
+        }
+    }
+
+    return true;
+}
+
+static int64 integer_datum_to_int64(Datum value, Oid type)
+{
+    switch (type)
+    {
+    case INT2OID:
+        return DatumGetInt16(value);
+    case INT4OID:
+        return DatumGetInt32(value);
+    default:
+        return DatumGetInt64(value);
+    }
+}
+
+/*
+ * Push a field as an object value. The common scalar types are mapped
+ * directly; anything else goes through add_agtype.
+ */
+static void push_binary_field(agtype_in_state *result, Datum value,
+                              bool isnull, Oid type)
+{
+    agtype_value agtv;
+
+    if (isnull)
+    {
+        agtv.type = AGTV_NULL;
+    }
+    else
+    {
+        switch (type)
+        {
+        case BOOLOID:
+            agtv.type = AGTV_BOOL;
+            agtv.val.boolean = DatumGetBool(value);
+            break;
+        case INT2OID:
+        case INT4OID:
+        case INT8OID:
+            agtv.type = AGTV_INTEGER;
+            agtv.val.int_value = integer_datum_to_int64(value, type);
+            break;
+        case FLOAT4OID:
+            agtv.type = AGTV_FLOAT;
+            agtv.val.float_value = DatumGetFloat4(value);
+            break;
+        case FLOAT8OID:
+            agtv.type = AGTV_FLOAT;
+            agtv.val.float_value = DatumGetFloat8(value);
+            break;
+        case NUMERICOID:
+            agtv.type = AGTV_NUMERIC;
+            agtv.val.numeric = DatumGetNumeric(value);
+            break;
+        case TEXTOID:
+        case VARCHAROID:
+        {
+            text *t = DatumGetTextPP(value);
+
+            agtv.type = AGTV_STRING;
+            agtv.val.string.len = VARSIZE_ANY_EXHDR(t);
+            agtv.val.string.val = VARDATA_ANY(t);
+            break;
+        }
+        default:
+            add_agtype(value, false, result, type, false);
+            return;
+        }
+    }
+
+    result->res = push_agtype_value(&result->parse_state, WAGT_VALUE, &agtv);
+}
+
+/*
+ * Build the properties of a row from the columns starting at start_index,
+ * with the __id__ property for vertices.
+ */
+static agtype *create_agtype_from_datums(binary_load_reader *reader,
+                                         char **column_names, int start_index,
+                                         bool add_entry_id, int64 entry_id)
+{
+    agtype_in_state result;
+    agtype *out;
+    int i;
+
+    memset(&result, 0, sizeof(agtype_in_state));
+
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                   NULL);
+
+    if (add_entry_id)
+    {
+        result.res = push_agtype_value(&result.parse_state, WAGT_KEY,
+                                       string_to_agtype_value("__id__"));
+        result.res = push_agtype_value(&result.parse_state, WAGT_VALUE,
+                                       integer_to_agtype_value(entry_id));
+    }
+
+    for (i = start_index; i < reader->num_columns; i++)
+    {
+        result.res = push_agtype_value(&result.parse_state, WAGT_KEY,
+                                       string_to_agtype_value(column_names[i]));
+        push_binary_field(&result, reader->values[i], reader->nulls[i],
+                          reader->column_types[i]);
+    }
+
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT,
+                                   NULL);
+
+    /* serialize it */
+    out = agtype_value_to_agtype(result.res);
+
+    /* now that it is serialized we can free the in memory structure */
+    pfree_agtype_in_state(&result);
+
+    return out;
+}
+
+/*
+ * Load vertices or edges from a binary COPY file.
+ */
+int create_entities_from_binary_file(char *file_path, Oid graph_oid,
+                                     char *label_name, int label_id,
+                                     char label_kind, bool id_field_exists,
+                                     char **column_names, Oid *column_types,
+                                     int num_columns)
+{
+    bool is_edge = (label_kind == LABEL_KIND_EDGE);
+    binary_load_reader reader;
+    Oid label_seq_relid;
+    entry_id_block entry_ids;
+    int64 curr_seq_num = 0;
+    int64 max_entry_id = 0;
+    batch_insert_state *batch_state = NULL;
+    MemoryContext batch_context;
+    MemoryContext old_context;
+    int i;
+
+    /* Create a memory context for batch processing - reset after each batch */
+    batch_context = AllocSetContextCreate(CurrentMemoryContext,
+                                          "AGE Binary Load Batch Context",
+                                          ALLOCSET_DEFAULT_SIZES);
+
+    reader.file_path = file_path;
+    reader.num_columns = num_columns;
+    reader.column_types = column_types;
+    reader.receive_functions = palloc(sizeof(FmgrInfo) * num_columns);
+    reader.receive_ioparams = palloc(sizeof(Oid) * num_columns);
+    reader.values = palloc(sizeof(Datum) * num_columns);
+    reader.nulls = palloc(sizeof(bool) * num_columns);
+    initStringInfo(&reader.field_buf);
+
+    for (i = 0; i < num_columns; i++)
+    {
+        Oid receive_function;
+
+        getTypeBinaryInputInfo(column_types[i], &receive_function,
+                               &reader.receive_ioparams[i]);
+        fmgr_info(receive_function, &reader.receive_functions[i]);
+    }
+
+    /* Get sequence info */
+    label_seq_relid = get_relname_relid(get_label_seq_relation_name(label_name),
+                                        graph_oid);
+    init_entry_id_block(&entry_ids, label_seq_relid);
+
+    if (id_field_exists && !is_edge)
+    {
+        /*
+         * Set the curr_seq_num since we will need it to compare with
+         * incoming entry_id.
+         */
+        curr_seq_num = nextval_internal(label_seq_relid, true);
+    }
+
+    reader.file = AllocateFile(file_path, PG_BINARY_R);
+    if (reader.file == NULL)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not open file \"%s\" for reading: %m",
+                        file_path)));
+    }
+
+    read_binary_header(&reader);
+
+    /* Initialize the batch insert state */
+    init_batch_insert(&batch_state, label_name, graph_oid);
+
+    for (;;)
+    {
+        TupleTableSlot *slot;
+        agtype *properties;
+        graphid id;
+        int64 entry_id;
+
+        /* Switch to batch context for row processing */
+        old_context = MemoryContextSwitchTo(batch_context);
+
+        if (!read_binary_row(&reader))
+        {
+            MemoryContextSwitchTo(old_context);
+            break;
+        }
+
+        /* Get the appropriate slot from the batch state */
+        slot = batch_state->slots[batch_state->num_tuples];
+
+        /* Clear the slots contents */
+        ExecClearTuple(slot);
+
+        if (is_edge)
+        {
+            int32 start_vertex_type_id;
+            int32 end_vertex_type_id;
+
+            for (i = 0; i < 4; i++)
+            {
+                if (reader.nulls[i])
+                {
+                    ereport(ERROR,
+                            (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                             errmsg("edge endpoint column %d must not be "
+                                    "NULL", i + 1)));
+                }
+            }
+
+            start_vertex_type_id =
+                get_label_id(TextDatumGetCString(reader.values[1]),
+                             graph_oid);
+            end_vertex_type_id =
+                get_label_id(TextDatumGetCString(reader.values[3]),
+                             graph_oid);
+
+            entry_id = next_entry_id_from_block(&entry_ids);
+            id = make_graphid(label_id, entry_id);
+            properties = create_agtype_from_datums(&reader, column_names, 4,
+                                                   false, 0);
+
+            slot->tts_values[1] = GRAPHID_GET_DATUM(make_graphid(
+                start_vertex_type_id,
+                integer_datum_to_int64(reader.values[0], column_types[0])));
+            slot->tts_values[2] = GRAPHID_GET_DATUM(make_graphid(
+                end_vertex_type_id,
+                integer_datum_to_int64(reader.values[2], column_types[2])));
+            slot->tts_values[3] = AGTYPE_P_GET_DATUM(properties);
+            slot->tts_isnull[1] = false;
+            slot->tts_isnull[2] = false;
+            slot->tts_isnull[3] = false;
+        }
+        else
+        {
+            if (id_field_exists)
+            {
+                if (reader.nulls[0])
+                {
+                    ereport(ERROR,
+                            (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                             errmsg("vertex id column must not be NULL")));
+                }
+
+                entry_id = integer_datum_to_int64(reader.values[0],
+                                                  column_types[0]);
+                max_entry_id = Max(max_entry_id, entry_id);
+            }
+            else
+            {
+                entry_id = next_entry_id_from_block(&entry_ids);
+            }
+
+            id = make_graphid(label_id, entry_id);
+            properties = create_agtype_from_datums(&reader, column_names, 0,
+                                                   true, entry_id);
+
+            slot->tts_values[1] = AGTYPE_P_GET_DATUM(properties);
+            slot->tts_isnull[1] = false;
+        }
+
+        slot->tts_values[0] = GRAPHID_GET_DATUM(id);
+        slot->tts_isnull[0] = false;
+
+        /* Make the slot as containing virtual tuple */
+        ExecStoreVirtualTuple(slot);
+
+        batch_state->buffered_bytes += VARSIZE(properties);
+        batch_state->num_tuples++;
+
+        /* Switch back to main context */
+        MemoryContextSwitchTo(old_context);
+
+        /* Insert the batch when tuple count OR byte threshold is reached */
+        if (batch_state->num_tuples >= BATCH_SIZE ||
+            batch_state->buffered_bytes >= MAX_BUFFERED_BYTES)
+        {
+            insert_batch(batch_state);
+            batch_state->num_tuples = 0;
+            batch_state->buffered_bytes = 0;
+
+            /* Reset batch context after each batch to free memory */
+            MemoryContextReset(batch_context);
+
+            /* Move the sequence past the ids loaded, once per batch */
+            if (max_entry_id > curr_seq_num)
+            {
+                DirectFunctionCall2(setval_oid,
+                                    ObjectIdGetDatum(label_seq_relid),
+                                    Int64GetDatum(max_entry_id));
+                curr_seq_num = max_entry_id;
+            }
+        }
+    }
+
+    if (max_entry_id > curr_seq_num)
+    {
+        /* This is needed to ensure the sequence is up-to-date */
+        DirectFunctionCall2(setval_oid, ObjectIdGetDatum(label_seq_relid),
+                            Int64GetDatum(max_entry_id));
+    }
+
+    /* Finish any remaining batch inserts */
+    finish_batch_insert(&batch_state);
+
+    /* Give back the ids reserved but not used */
+    release_entry_id_block(&entry_ids);
+
+    FreeFile(reader.file);
+    MemoryContextDelete(batch_context);
+
+    return EXIT_SUCCESS;
+}
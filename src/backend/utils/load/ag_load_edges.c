@@ -23,38 +23,389 @@
 #include "catalog/namespace.h"
 #include "commands/copy.h"
 #include "executor/executor.h"
-#include "nodes/makefuncs.h"
+#include "miscadmin.h"
 #include "parser/parse_node.h"
+#include "utils/acl.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/rls.h"
+#include "utils/snapmgr.h"
 
 #include "utils/load/ag_load_edges.h"
 
 /*
- * Process a single edge row from COPY's raw fields.
- * Edge CSV format: start_id, start_vertex_type, end_id, end_vertex_type, [properties...]
+ * The natural keys of the endpoint vertex labels of an edge load, each
+ * mapped to its vertex's graphid. A label's map is created the first time an
+ * edge row names it, see create_vertex_key_map.
  */
-static void process_edge_row(char **fields, int nfields,
-                             char **header, int header_count,
-                             int label_id, Oid label_seq_relid,
-                             Oid graph_oid, bool load_as_agtype,
-                             batch_insert_state *batch_state)
+struct edge_endpoint_keys
+{
+    Oid graph_oid;
+    char *key_property;
+    bool load_as_agtype;    /* keys are typed like the loaded properties */
+    MemoryContext mcxt;
+    List *labels;   /* vertex_key_label entries */
+};
+
+typedef struct vertex_key_label
+{
+    char *label_name;
+    vertex_key_map *keys;
+} vertex_key_label;
+
+/*
+ * The entry ids of the vertices of each endpoint label of an edge load, for
+ * checking that the endpoints exist. A label's ids are read with one scan of
+ * the label the first time an endpoint is in it, and kept sorted.
+ */
+struct edge_endpoint_check
+{
+    Oid graph_oid;
+    bool skip_invalid;      /* skip edges with missing endpoints, or fail */
+    int64 num_skipped;
+    MemoryContext mcxt;
+    List *labels;           /* vertex_id_set entries */
+};
+
+typedef struct vertex_id_set
+{
+    int32 label_id;
+    int64 *entry_ids;       /* sorted */
+    int64 num_ids;
+} vertex_id_set;
+
+static void check_endpoint_label_scan(Oid relid, char *label_name,
+                                      const char *option);
+static int compare_entry_ids(const void *a, const void *b);
+static vertex_id_set *build_vertex_id_set(edge_endpoint_check *check,
+                                          int32 label_id);
+static bool vertex_exists(edge_endpoint_check *check, graphid id);
+static vertex_key_map *build_vertex_key_map(edge_endpoint_keys *keys,
+                                            char *label_name);
+static graphid resolve_endpoint_key(edge_endpoint_keys *keys,
+                                    char *label_name, char *key);
+
+/*
+ * Endpoint lookups scan vertex labels directly, so the labels must be readable
+ * as a whole.
+ */
+static void check_endpoint_label_scan(Oid relid, char *label_name,
+                                      const char *option)
+{
+    AclResult aclresult;
+
+    aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+    if (aclresult != ACLCHECK_OK)
+    {
+        aclcheck_error(aclresult, OBJECT_TABLE, get_rel_name(relid));
+    }
+
+    if (check_enable_rls(relid, InvalidOid, true) == RLS_ENABLED)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("%s cannot be used with row-level security enabled "
+                        "on label \"%s\"", option, label_name)));
+    }
+}
+
+static int compare_entry_ids(const void *a, const void *b)
+{
+    int64 ia = *(const int64 *) a;
+    int64 ib = *(const int64 *) b;
+
+    if (ia < ib)
+    {
+        return -1;
+    }
+    if (ia > ib)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Read the entry ids of the vertices of a label. A label id that is not a
+ * vertex label of the graph gets an empty set.
+ */
+static vertex_id_set *build_vertex_id_set(edge_endpoint_check *check,
+                                          int32 label_id)
+{
+    label_cache_data *label;
+    vertex_id_set *set;
+    Relation relation;
+    TupleTableSlot *slot;
+    TableScanDesc scan;
+    int64 max_ids = 1024;
+
+    set = MemoryContextAllocZero(check->mcxt, sizeof(vertex_id_set));
+    set->label_id = label_id;
+
+    label = search_label_graph_oid_cache(check->graph_oid, label_id);
+    if (label == NULL || label->kind != LABEL_KIND_VERTEX)
+    {
+        return set;
+    }
+
+    check_endpoint_label_scan(label->relation, NameStr(label->name),
+                              "endpoint_validation");
+
+    set->entry_ids = MemoryContextAllocHuge(check->mcxt,
+                                            sizeof(int64) * max_ids);
+
+    relation = table_open(label->relation, AccessShareLock);
+    slot = table_slot_create(relation, NULL);
+    scan = table_beginscan(relation, GetActiveSnapshot(), 0, NULL);
+
+    while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+    {
+        bool isnull;
+
+        CHECK_FOR_INTERRUPTS();
+
+        if (set->num_ids == max_ids)
+        {
+            max_ids *= 2;
+            set->entry_ids = repalloc_huge(set->entry_ids,
+                                           sizeof(int64) * max_ids);
+        }
+
+        set->entry_ids[set->num_ids++] = get_graphid_entry_id(
+            DATUM_GET_GRAPHID(slot_getattr(slot,
+                                           Anum_ag_label_vertex_table_id,
+                                           &isnull)));
+    }
+
+    table_endscan(scan);
+    ExecDropSingleTupleTableSlot(slot);
+    table_close(relation, AccessShareLock);
+
+    qsort(set->entry_ids, set->num_ids, sizeof(int64), compare_entry_ids);
+
+    return set;
+}
+
+static bool vertex_exists(edge_endpoint_check *check, graphid id)
+{
+    int32 label_id = get_graphid_label_id(id);
+    int64 entry_id = get_graphid_entry_id(id);
+    vertex_id_set *set = NULL;
+    ListCell *lc;
+
+    foreach(lc, check->labels)
+    {
+        vertex_id_set *s = lfirst(lc);
+
+        if (s->label_id == label_id)
+        {
+            set = s;
+            break;
+        }
+    }
+
+    if (set == NULL)
+    {
+        MemoryContext old_context;
+
+        set = build_vertex_id_set(check, label_id);
+
+        old_context = MemoryContextSwitchTo(check->mcxt);
+        check->labels = lappend(check->labels, set);
+        MemoryContextSwitchTo(old_context);
+    }
+
+    return set->num_ids > 0 &&
+           bsearch(&entry_id, set->entry_ids, set->num_ids, sizeof(int64),
+                   compare_entry_ids) != NULL;
+}
+
+edge_endpoint_check *create_edge_endpoint_check(
+    Oid graph_oid, edge_endpoint_validation validation)
+{
+    edge_endpoint_check *check;
+
+    if (validation == EDGE_ENDPOINT_VALIDATION_NONE)
+    {
+        return NULL;
+    }
+
+    check = palloc0(sizeof(edge_endpoint_check));
+    check->graph_oid = graph_oid;
+    check->skip_invalid = (validation == EDGE_ENDPOINT_VALIDATION_SKIP);
+    check->mcxt = AllocSetContextCreate(CurrentMemoryContext,
+                                        "AGE Edge Load Vertex Ids",
+                                        ALLOCSET_DEFAULT_SIZES);
+
+    return check;
+}
+
+bool check_edge_endpoints(edge_endpoint_check *check, graphid start_id,
+                          graphid end_id, int64 line_number)
+{
+    bool start_exists = vertex_exists(check, start_id);
+    bool end_exists = vertex_exists(check, end_id);
+    graphid missing_id;
+
+    if (start_exists && end_exists)
+    {
+        return true;
+    }
+
+    missing_id = start_exists ? end_id : start_id;
+
+    if (!check->skip_invalid)
+    {
+        label_cache_data *label;
+
+        label = search_label_graph_oid_cache(check->graph_oid,
+                                             get_graphid_label_id(missing_id));
+
+        ereport(ERROR,
+                (errcode(ERRCODE_FOREIGN_KEY_VIOLATION),
+                 errmsg("%s vertex " INT64_FORMAT " of label \"%s\" does "
+                        "not exist", start_exists ? "end" : "start",
+                        get_graphid_entry_id(missing_id),
+                        label != NULL ? NameStr(label->name) : "?"),
+                 line_number > 0 ?
+                 errdetail("The edge is on line " INT64_FORMAT " of the file.",
+                           line_number) : 0));
+    }
+
+    ereport(DEBUG1,
+            (errmsg_internal("skipped edge from " INT64_FORMAT " to "
+                             INT64_FORMAT, start_id, end_id)));
+    check->num_skipped++;
+
+    return false;
+}
+
+void finish_edge_endpoint_check(edge_endpoint_check *check)
+{
+    if (check == NULL)
+    {
+        return;
+    }
+
+    if (check->num_skipped > 0)
+    {
+        ereport(NOTICE,
+                (errmsg("skipped " INT64_FORMAT " edges with a missing start "
+                        "or end vertex", check->num_skipped)));
+    }
+
+    MemoryContextDelete(check->mcxt);
+    pfree(check);
+}
+
+/*
+ * Build the key map of an endpoint label, which is read directly.
+ */
+static vertex_key_map *build_vertex_key_map(edge_endpoint_keys *keys,
+                                            char *label_name)
+{
+    Oid relid = get_label_relation(label_name, keys->graph_oid);
+
+    if (OidIsValid(relid))
+    {
+        check_endpoint_label_scan(relid, label_name, "key_property");
+    }
+
+    return create_vertex_key_map(keys->graph_oid, label_name,
+                                 keys->key_property, keys->mcxt);
+}
+
+/* Get the graphid of the vertex of a label with the given key */
+static graphid resolve_endpoint_key(edge_endpoint_keys *keys,
+                                    char *label_name, char *key)
+{
+    vertex_key_label *label = NULL;
+    vertex_key_entry *entry;
+    vertex_key vertex_key_value;
+    ListCell *lc;
+
+    foreach(lc, keys->labels)
+    {
+        vertex_key_label *l = lfirst(lc);
+
+        if (strcmp(l->label_name, label_name) == 0)
+        {
+            label = l;
+            break;
+        }
+    }
+
+    if (label == NULL)
+    {
+        MemoryContext old_context = MemoryContextSwitchTo(keys->mcxt);
+
+        label = palloc(sizeof(vertex_key_label));
+        label->label_name = pstrdup(label_name);
+        label->keys = build_vertex_key_map(keys, label_name);
+        keys->labels = lappend(keys->labels, label);
+
+        MemoryContextSwitchTo(old_context);
+    }
+
+    csv_field_to_vertex_key(key, keys->load_as_agtype, keys->key_property,
+                            &vertex_key_value);
+    entry = find_vertex_key(label->keys, &vertex_key_value);
+    if (entry == NULL)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("no vertex of label \"%s\" has %s \"%s\"",
+                        label_name, keys->key_property,
+                        vertex_key_value.value)));
+    }
+
+    return entry->id;
+}
+
+/*
+ * Check the header of an edge file.
+ */
+void check_edge_file_header(int header_count)
+{
+    /*
+     * Edge files require the four fixed columns start_id, start_vertex_type,
+     * end_id and end_vertex_type. A smaller count almost always means the
+     * file is not comma-delimited (COPY defaults to comma). Fail clearly here
+     * instead of reading past the parsed fields in process_edge_row(), which
+     * previously caused a segfault.
+     */
+    if (header_count < 4)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("edge file must have at least 4 columns "
+                        "(start_id, start_vertex_type, end_id, "
+                        "end_vertex_type), but the header has %d",
+                        header_count),
+                 errhint("load_edges_from_file expects a "
+                         "comma-delimited CSV; check the file's "
+                         "delimiter.")));
+    }
+}
+
+/*
+ * Check the width of an edge row and get the graphids of its start and end
+ * vertices.
+ */
+void get_edge_row_endpoints(char **fields, int nfields, int header_count,
+                            Oid graph_oid, edge_endpoint_keys *keys,
+                            graphid *start_vertex_graph_id,
+                            graphid *end_vertex_graph_id)
 {
     int64 start_id_int;
-    graphid start_vertex_graph_id;
     int start_vertex_type_id;
 
     int64 end_id_int;
-    graphid end_vertex_graph_id;
     int end_vertex_type_id;
 
-    graphid edge_id;
-    int64 entry_id;
-    TupleTableSlot *slot;
-
     char *start_vertex_type;
     char *end_vertex_type;
-    agtype *edge_properties;
 
     /*
      * Guard the fixed fields[0..3] accesses below and the header[i]/fields[i]
@@ -74,14 +425,22 @@ static void process_edge_row(char **fields, int nfields,
                         nfields, header_count)));
     }
 
-    /* Generate edge ID */
-    entry_id = nextval_internal(label_seq_relid, true);
-    edge_id = make_graphid(label_id, entry_id);
-
     /* Trim whitespace from vertex type names */
     start_vertex_type = trim_whitespace(fields[1]);
     end_vertex_type = trim_whitespace(fields[3]);
 
+    /* Natural keys are looked up in the endpoint labels */
+    if (keys != NULL)
+    {
+        *start_vertex_graph_id =
+            resolve_endpoint_key(keys, start_vertex_type,
+                                 trim_whitespace(fields[0]));
+        *end_vertex_graph_id =
+            resolve_endpoint_key(keys, end_vertex_type,
+                                 trim_whitespace(fields[2]));
+        return;
+    }
+
     /* Parse start vertex info */
     start_id_int = strtol(fields[0], NULL, 10);
     start_vertex_type_id = get_label_id(start_vertex_type, graph_oid);
@@ -91,8 +450,45 @@ static void process_edge_row(char **fields, int nfields,
     end_vertex_type_id = get_label_id(end_vertex_type, graph_oid);
 
     /* Create graphids for start and end vertices */
-    start_vertex_graph_id = make_graphid(start_vertex_type_id, start_id_int);
-    end_vertex_graph_id = make_graphid(end_vertex_type_id, end_id_int);
+    *start_vertex_graph_id = make_graphid(start_vertex_type_id, start_id_int);
+    *end_vertex_graph_id = make_graphid(end_vertex_type_id, end_id_int);
+}
+
+/*
+ * Process a single edge row from COPY's raw fields.
+ * Edge CSV format: start_id, start_vertex_type, end_id, end_vertex_type, [properties...]
+ */
+static void process_edge_row(char **fields, int nfields,
+                             char **header, int header_count,
+                             int label_id, entry_id_block *entry_ids,
+                             Oid graph_oid, edge_endpoint_keys *keys,
+                             edge_endpoint_check *endpoint_check,
+                             bool load_as_agtype,
+                             batch_insert_state *batch_state,
+                             int64 line_number)
+{
+    graphid start_vertex_graph_id;
+    graphid end_vertex_graph_id;
+
+    graphid edge_id;
+    int64 entry_id;
+    TupleTableSlot *slot;
+
+    agtype *edge_properties;
+
+    get_edge_row_endpoints(fields, nfields, header_count, graph_oid, keys,
+                           &start_vertex_graph_id, &end_vertex_graph_id);
+
+    if (endpoint_check != NULL &&
+        !check_edge_endpoints(endpoint_check, start_vertex_graph_id,
+                              end_vertex_graph_id, line_number))
+    {
+        return;
+    }
+
+    /* Generate edge ID */
+    entry_id = next_entry_id_from_block(entry_ids);
+    edge_id = make_graphid(label_id, entry_id);
 
     /* Get the appropriate slot from the batch state */
     slot = batch_state->slots[batch_state->num_tuples];
@@ -130,40 +526,6 @@ static void process_edge_row(char **fields, int nfields,
     }
 }
 
-/*
- * Create COPY options for CSV parsing.
- * Returns a List of DefElem nodes.
- */
-static List *create_copy_options(char delimiter)
-{
-    List *options = NIL;
-
-    /* FORMAT csv */
-    options = lappend(options,
-                      makeDefElem("format",
-                                  (Node *) makeString("csv"),
-                                  -1));
-
-    /* HEADER false - we'll read the header ourselves */
-    options = lappend(options,
-                      makeDefElem("header",
-                                  (Node *) makeBoolean(false),
-                                  -1));
-
-    /* DELIMITER */
-    {
-        char delimiter_str[2];
-        delimiter_str[0] = delimiter;
-        delimiter_str[1] = '\0';
-        options = lappend(options,
-                          makeDefElem("delimiter",
-                                      (Node *) makeString(pstrdup(delimiter_str)),
-                                      -1));
-    }
-
-    return options;
-}
-
 /*
  * Load edges from CSV file using pg's COPY infrastructure.
  */
@@ -173,7 +535,10 @@ int create_edges_from_csv_file(char *file_path,
                                char *label_name,
                                int label_id,
                                bool load_as_agtype,
-                               char delimiter)
+                               char delimiter,
+                               bool deferred_indexes,
+                               char *key_property,
+                               edge_endpoint_validation validation)
 {
     Relation        label_rel;
     Oid             label_relid;
@@ -185,8 +550,12 @@ int create_edges_from_csv_file(char *file_path,
     char          **header = NULL;
     int             header_count = 0;
     bool            is_first_row = true;
+    int64           line_number = 0;
     char           *label_seq_name;
     Oid             label_seq_relid;
+    entry_id_block  entry_ids;
+    edge_endpoint_keys *keys = NULL;
+    edge_endpoint_check *endpoint_check = NULL;
     batch_insert_state *batch_state = NULL;
     MemoryContext   batch_context;
     MemoryContext   old_context;
@@ -196,6 +565,22 @@ int create_edges_from_csv_file(char *file_path,
                                           "AGE CSV Edge Load Batch Context",
                                           ALLOCSET_DEFAULT_SIZES);
 
+    if (key_property != NULL)
+    {
+        keys = palloc0(sizeof(edge_endpoint_keys));
+        keys->graph_oid = graph_oid;
+        keys->key_property = key_property;
+        keys->load_as_agtype = load_as_agtype;
+        keys->mcxt = AllocSetContextCreate(CurrentMemoryContext,
+                                           "AGE Edge Load Vertex Keys",
+                                           ALLOCSET_DEFAULT_SIZES);
+    }
+    else
+    {
+        /* endpoints found by their keys exist, so only ids are checked */
+        endpoint_check = create_edge_endpoint_check(graph_oid, validation);
+    }
+
     /* Get the label relation */
     label_relid = get_label_relation(label_name, graph_oid);
     label_rel = table_open(label_relid, RowExclusiveLock);
@@ -203,12 +588,14 @@ int create_edges_from_csv_file(char *file_path,
     /* Get sequence info */
     label_seq_name = get_label_seq_relation_name(label_name);
     label_seq_relid = get_relname_relid(label_seq_name, graph_oid);
+    init_entry_id_block(&entry_ids, label_seq_relid);
 
     /* Initialize the batch insert state */
     init_batch_insert(&batch_state, label_name, graph_oid);
+    batch_state->defer_indexes = deferred_indexes;
 
     /* Create COPY options for CSV parsing */
-    copy_options = create_copy_options(delimiter);
+    copy_options = create_csv_copy_options(delimiter);
 
     /* Create a minimal ParseState for BeginCopyFrom */
     pstate = make_parsestate(NULL);
@@ -235,6 +622,9 @@ int create_edges_from_csv_file(char *file_path,
          */
         while (NextCopyFromRawFields(cstate, &fields, &nfields))
         {
+            /* a record's line, as COPY counts them */
+            line_number++;
+
             if (is_first_row)
             {
                 int i;
@@ -249,26 +639,7 @@ int create_edges_from_csv_file(char *file_path,
                     header[i] = trim_whitespace(fields[i]);
                 }
 
-                /*
-                 * Edge files require the four fixed columns start_id,
-                 * start_vertex_type, end_id and end_vertex_type. A smaller
-                 * count almost always means the file is not comma-delimited
-                 * (COPY defaults to comma). Fail clearly here instead of
-                 * reading past the parsed fields in process_edge_row(), which
-                 * previously caused a segfault.
-                 */
-                if (header_count < 4)
-                {
-                    ereport(ERROR,
-                            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                             errmsg("edge file must have at least 4 columns "
-                                    "(start_id, start_vertex_type, end_id, "
-                                    "end_vertex_type), but the header has %d",
-                                    header_count),
-                             errhint("load_edges_from_file expects a "
-                                     "comma-delimited CSV; check the file's "
-                                     "delimiter.")));
-                }
+                check_edge_file_header(header_count);
 
                 is_first_row = false;
             }
@@ -280,9 +651,9 @@ int create_edges_from_csv_file(char *file_path,
                 /* Data row - process it */
                 process_edge_row(fields, nfields,
                                  header, header_count,
-                                 label_id, label_seq_relid,
-                                 graph_oid, load_as_agtype,
-                                 batch_state);
+                                 label_id, &entry_ids,
+                                 graph_oid, keys, endpoint_check,
+                                 load_as_agtype, batch_state, line_number);
 
                 /* Switch back to main context */
                 MemoryContextSwitchTo(old_context);
@@ -299,6 +670,21 @@ int create_edges_from_csv_file(char *file_path,
         finish_batch_insert(&batch_state);
         MemoryContextReset(batch_context);
 
+        /* Give back the ids reserved but not used */
+        release_entry_id_block(&entry_ids);
+
+        finish_edge_endpoint_check(endpoint_check);
+
+        if (keys != NULL)
+        {
+            ListCell *lc;
+
+            foreach(lc, keys->labels)
+            {
+                free_vertex_key_map(((vertex_key_label *) lfirst(lc))->keys);
+            }
+        }
+
         /* Clean up COPY state */
         EndCopyFrom(cstate);
     }
@@ -321,6 +707,12 @@ int create_edges_from_csv_file(char *file_path,
         /* Delete batch context */
         MemoryContextDelete(batch_context);
 
+        /* Delete the vertex key maps */
+        if (keys != NULL)
+        {
+            MemoryContextDelete(keys->mcxt);
+        }
+
         /* Free parse state */
         free_parsestate(pstate);
     }
@@ -22,30 +22,20 @@
 #include "access/table.h"
 #include "catalog/namespace.h"
 #include "commands/copy.h"
+#include "access/xact.h"
 #include "executor/executor.h"
-#include "nodes/makefuncs.h"
 #include "parser/parse_node.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 
 #include "utils/load/ag_load_labels.h"
 
 /*
- * Process a single vertex row from COPY's raw fields.
- * Vertex CSV format: [id,] [properties...]
+ * Check the width of a vertex row.
  */
-static void process_vertex_row(char **fields, int nfields,
-                               char **header, int header_count,
-                               int label_id, Oid label_seq_relid,
-                               bool id_field_exists, bool load_as_agtype,
-                               int64 *curr_seq_num,
-                               batch_insert_state *batch_state)
+void check_label_file_row(int nfields, int header_count)
 {
-    graphid vertex_id;
-    int64 entry_id;
-    TupleTableSlot *slot;
-    agtype *vertex_properties;
-
     /*
      * Guard the header[i]/fields[i] pairing in create_agtype_from_list()
      * against out-of-bounds reads on malformed rows that have more fields
@@ -62,23 +52,52 @@ static void process_vertex_row(char **fields, int nfields,
                  errmsg("label file row has %d columns, more than the "
                         "header's %d columns", nfields, header_count)));
     }
+}
+
+/*
+ * Move the label's sequence up to the highest id loaded from the file so far.
+ * This is done once per batch rather than for every row.
+ */
+static void update_label_seq(Oid label_seq_relid, int64 max_entry_id,
+                             int64 *curr_seq_num)
+{
+    if (max_entry_id > *curr_seq_num)
+    {
+        /* This is needed to ensure the sequence is up-to-date */
+        DirectFunctionCall2(setval_oid,
+                            ObjectIdGetDatum(label_seq_relid),
+                            Int64GetDatum(max_entry_id));
+        *curr_seq_num = max_entry_id;
+    }
+}
+
+/*
+ * Process a single vertex row from COPY's raw fields.
+ * Vertex CSV format: [id,] [properties...]
+ */
+static void process_vertex_row(char **fields, int nfields,
+                               char **header, int header_count,
+                               int label_id, entry_id_block *entry_ids,
+                               bool id_field_exists, bool load_as_agtype,
+                               int64 *curr_seq_num, int64 *max_entry_id,
+                               batch_insert_state *batch_state)
+{
+    graphid vertex_id;
+    int64 entry_id;
+    TupleTableSlot *slot;
+    agtype *vertex_properties;
+
+    check_label_file_row(nfields, header_count);
 
     /* Generate or use provided entry_id */
     if (id_field_exists)
     {
         entry_id = strtol(fields[0], NULL, 10);
-        if (entry_id > *curr_seq_num)
-        {
-            /* This is needed to ensure the sequence is up-to-date */
-            DirectFunctionCall2(setval_oid,
-                                ObjectIdGetDatum(label_seq_relid),
-                                Int64GetDatum(entry_id));
-            *curr_seq_num = entry_id;
-        }
+        *max_entry_id = Max(*max_entry_id, entry_id);
     }
     else
     {
-        entry_id = nextval_internal(label_seq_relid, true);
+        entry_id = next_entry_id_from_block(entry_ids);
     }
 
     vertex_id = make_graphid(label_id, entry_id);
@@ -113,41 +132,10 @@ static void process_vertex_row(char **fields, int nfields,
         insert_batch(batch_state);
         batch_state->num_tuples = 0;
         batch_state->buffered_bytes = 0;
-    }
-}
 
-/*
- * Create COPY options for csv parsing.
- * Returns a List of DefElem nodes.
- */
-static List *create_copy_options(char delimiter)
-{
-    List *options = NIL;
-
-    /* FORMAT csv */
-    options = lappend(options,
-                      makeDefElem("format",
-                                  (Node *) makeString("csv"),
-                                  -1));
-
-    /* HEADER false - we'll read the header ourselves */
-    options = lappend(options,
-                      makeDefElem("header",
-                                  (Node *) makeBoolean(false),
-                                  -1));
-
-    /* DELIMITER */
-    {
-        char delimiter_str[2];
-        delimiter_str[0] = delimiter;
-        delimiter_str[1] = '\0';
-        options = lappend(options,
-                          makeDefElem("delimiter",
-                                      (Node *) makeString(pstrdup(delimiter_str)),
-                                      -1));
+        update_label_seq(entry_ids->label_seq_relid, *max_entry_id,
+                         curr_seq_num);
     }
-
-    return options;
 }
 
 /*
@@ -160,7 +148,8 @@ int create_labels_from_csv_file(char *file_path,
                                 int label_id,
                                 bool id_field_exists,
                                 bool load_as_agtype,
-                                char delimiter)
+                                char delimiter,
+                                bool deferred_indexes)
 {
     Relation        label_rel;
     Oid             label_relid;
@@ -175,6 +164,8 @@ int create_labels_from_csv_file(char *file_path,
     char           *label_seq_name;
     Oid             label_seq_relid;
     int64           curr_seq_num = 0;
+    int64           max_entry_id = 0;
+    entry_id_block  entry_ids;
     batch_insert_state *batch_state = NULL;
     MemoryContext   batch_context;
     MemoryContext   old_context;
@@ -191,6 +182,7 @@ int create_labels_from_csv_file(char *file_path,
     /* Get sequence info */
     label_seq_name = get_label_seq_relation_name(label_name);
     label_seq_relid = get_relname_relid(label_seq_name, graph_oid);
+    init_entry_id_block(&entry_ids, label_seq_relid);
 
     if (id_field_exists)
     {
@@ -203,9 +195,10 @@ int create_labels_from_csv_file(char *file_path,
 
     /* Initialize the batch insert state */
     init_batch_insert(&batch_state, label_name, graph_oid);
+    batch_state->defer_indexes = deferred_indexes;
 
     /* Create COPY options for CSV parsing */
-    copy_options = create_copy_options(delimiter);
+    copy_options = create_csv_copy_options(delimiter);
 
     /* Create a minimal ParseState for BeginCopyFrom */
     pstate = make_parsestate(NULL);
@@ -256,9 +249,9 @@ int create_labels_from_csv_file(char *file_path,
                 /* Data row - process it */
                 process_vertex_row(fields, nfields,
                                    header, header_count,
-                                   label_id, label_seq_relid,
+                                   label_id, &entry_ids,
                                    id_field_exists, load_as_agtype,
-                                   &curr_seq_num,
+                                   &curr_seq_num, &max_entry_id,
                                    batch_state);
 
                 /* Switch back to main context */
@@ -273,9 +266,13 @@ int create_labels_from_csv_file(char *file_path,
         }
 
         /* Finish any remaining batch inserts */
+        update_label_seq(label_seq_relid, max_entry_id, &curr_seq_num);
         finish_batch_insert(&batch_state);
         MemoryContextReset(batch_context);
 
+        /* Give back the ids reserved but not used */
+        release_entry_id_block(&entry_ids);
+
         /* Clean up COPY state */
         EndCopyFrom(cstate);
     }
@@ -305,3 +302,346 @@ int create_labels_from_csv_file(char *file_path,
 
     return EXIT_SUCCESS;
 }
+
+/*
+ * The state of an upsert: the key map of the label, which also gets the keys
+ * of the vertices inserted, and the updates waiting to be written.
+ */
+typedef struct label_upsert_state
+{
+    Oid graph_oid;
+    int label_id;
+    char *key_property;
+    int key_index;                  /* column of the key in the file */
+    vertex_key_map *keys;
+    MemoryContext keys_context;
+    entry_id_block entry_ids;
+    batch_insert_state *batch_state;
+    MemoryContext update_context;   /* holds the pending updates */
+    vertex_property_update *updates;
+    int64 num_updates;
+    int64 max_updates;
+    int64 num_rows;
+} label_upsert_state;
+
+/* pending updates are written in groups of this many */
+#define UPSERT_UPDATE_BATCH_SIZE (BATCH_SIZE * 10)
+
+/*
+ * Write the pending updates. The inserts before them are written first and
+ * made visible, since an update may be for a vertex inserted by this load.
+ */
+static void flush_vertex_updates(label_upsert_state *state)
+{
+    batch_insert_state *batch_state = state->batch_state;
+
+    if (state->num_updates == 0)
+    {
+        return;
+    }
+
+    if (batch_state->num_tuples > 0)
+    {
+        insert_batch(batch_state);
+        batch_state->num_tuples = 0;
+        batch_state->buffered_bytes = 0;
+    }
+
+    CommandCounterIncrement();
+    UpdateActiveSnapshotCommandId();
+
+    write_vertex_property_updates(state->graph_oid, NULL, state->updates,
+                                  state->num_updates);
+
+    /* let later updates of the same vertices see these */
+    UpdateActiveSnapshotCommandId();
+
+    MemoryContextReset(state->update_context);
+    state->updates = NULL;
+    state->num_updates = 0;
+    state->max_updates = 0;
+}
+
+/*
+ * Insert a vertex row with a new key, or queue the update of the vertex that
+ * has its key.
+ */
+static void upsert_vertex_row(label_upsert_state *state, char **fields,
+                              int nfields, char **header, int header_count,
+                              bool load_as_agtype)
+{
+    batch_insert_state *batch_state = state->batch_state;
+    vertex_key_entry *entry;
+    vertex_key vertex_key_value;
+    char *key = NULL;
+
+    check_label_file_row(nfields, header_count);
+
+    if (state->key_index < nfields && fields[state->key_index] != NULL)
+    {
+        key = trim_whitespace(fields[state->key_index]);
+    }
+
+    if (key == NULL || key[0] == '\0')
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                 errmsg("label file row has no value for key property \"%s\"",
+                        state->key_property)));
+    }
+
+    csv_field_to_vertex_key(key, load_as_agtype, state->key_property,
+                            &vertex_key_value);
+    entry = find_vertex_key(state->keys, &vertex_key_value);
+
+    if (entry != NULL)
+    {
+        vertex_property_update *update;
+        MemoryContext old_context;
+
+        old_context = MemoryContextSwitchTo(state->update_context);
+
+        if (state->num_updates == state->max_updates)
+        {
+            state->max_updates = Max(state->max_updates * 2, BATCH_SIZE);
+            state->updates = (state->updates == NULL) ?
+                palloc(sizeof(vertex_property_update) * state->max_updates) :
+                repalloc(state->updates,
+                         sizeof(vertex_property_update) * state->max_updates);
+        }
+
+        update = &state->updates[state->num_updates++];
+        update->vertex_id = entry->id;
+        update->position = state->num_rows;
+        update->value = AGTYPE_P_GET_DATUM(
+            create_agtype_from_list_i(header, fields, nfields, 0,
+                                      load_as_agtype));
+        update->value_isnull = false;
+        ItemPointerSetInvalid(&update->tid);
+
+        MemoryContextSwitchTo(old_context);
+    }
+    else
+    {
+        TupleTableSlot *slot;
+        agtype *vertex_properties;
+        int64 entry_id;
+
+        entry_id = next_entry_id_from_block(&state->entry_ids);
+        entry = add_vertex_key(state->keys, &vertex_key_value,
+                               make_graphid(state->label_id, entry_id));
+
+        /* Get the appropriate slot from the batch state */
+        slot = batch_state->slots[batch_state->num_tuples];
+
+        /* Clear the slots contents */
+        ExecClearTuple(slot);
+
+        /* Build the agtype properties */
+        vertex_properties = create_agtype_from_list(header, fields, nfields,
+                                                    entry_id, load_as_agtype);
+
+        /* Fill the values in the slot */
+        slot->tts_values[0] = GRAPHID_GET_DATUM(entry->id);
+        slot->tts_values[1] = AGTYPE_P_GET_DATUM(vertex_properties);
+        slot->tts_isnull[0] = false;
+        slot->tts_isnull[1] = false;
+
+        /* Make the slot as containing virtual tuple */
+        ExecStoreVirtualTuple(slot);
+
+        batch_state->buffered_bytes += VARSIZE(vertex_properties);
+        batch_state->num_tuples++;
+
+        /* Insert the batch when tuple count OR byte threshold is reached */
+        if (batch_state->num_tuples >= BATCH_SIZE ||
+            batch_state->buffered_bytes >= MAX_BUFFERED_BYTES)
+        {
+            insert_batch(batch_state);
+            batch_state->num_tuples = 0;
+            batch_state->buffered_bytes = 0;
+        }
+    }
+
+    state->num_rows++;
+
+    if (state->num_updates >= UPSERT_UPDATE_BATCH_SIZE)
+    {
+        flush_vertex_updates(state);
+    }
+}
+
+/*
+ * Insert or update vertices from a csv file, matching them on a key property.
+ */
+int upsert_labels_from_csv_file(char *file_path,
+                                char *graph_name,
+                                Oid graph_oid,
+                                char *label_name,
+                                int label_id,
+                                char *key_property,
+                                bool load_as_agtype,
+                                char delimiter)
+{
+    Relation        label_rel;
+    Oid             label_relid;
+    CopyFromState   cstate;
+    List           *copy_options;
+    ParseState     *pstate;
+    char          **fields;
+    int             nfields;
+    char          **header = NULL;
+    int             header_count = 0;
+    bool            is_first_row = true;
+    label_upsert_state state;
+    MemoryContext   batch_context;
+    MemoryContext   old_context;
+
+    /* Create a memory context for batch processing - reset after each batch */
+    batch_context = AllocSetContextCreate(CurrentMemoryContext,
+                                          "AGE CSV Upsert Batch Context",
+                                          ALLOCSET_DEFAULT_SIZES);
+
+    memset(&state, 0, sizeof(state));
+    state.graph_oid = graph_oid;
+    state.label_id = label_id;
+    state.key_property = key_property;
+    state.keys_context = AllocSetContextCreate(CurrentMemoryContext,
+                                               "AGE CSV Upsert Keys",
+                                               ALLOCSET_DEFAULT_SIZES);
+    state.update_context = AllocSetContextCreate(CurrentMemoryContext,
+                                                 "AGE CSV Upsert Updates",
+                                                 ALLOCSET_DEFAULT_SIZES);
+
+    /* Get the label relation */
+    label_relid = get_label_relation(label_name, graph_oid);
+    label_rel = table_open(label_relid, RowExclusiveLock);
+
+    init_entry_id_block(&state.entry_ids,
+                        get_relname_relid(get_label_seq_relation_name(label_name),
+                                          graph_oid));
+
+    /*
+     * The load reads back what it writes, so it works with its own copy of
+     * the snapshot, moved forward after each group of updates.
+     */
+    PushCopiedSnapshot(GetActiveSnapshot());
+    UpdateActiveSnapshotCommandId();
+
+    state.keys = create_vertex_key_map(graph_oid, label_name, key_property,
+                                       state.keys_context);
+
+    /* Initialize the batch insert state */
+    init_batch_insert(&state.batch_state, label_name, graph_oid);
+
+    /* Create COPY options for CSV parsing */
+    copy_options = create_csv_copy_options(delimiter);
+
+    /* Create a minimal ParseState for BeginCopyFrom */
+    pstate = make_parsestate(NULL);
+
+    PG_TRY();
+    {
+        cstate = BeginCopyFrom(pstate,
+                               label_rel,
+                               NULL,           /* whereClause */
+                               file_path,
+                               false,          /* is_program */
+                               NULL,           /* data_source_cb */
+                               NIL,            /* attnamelist */
+                               copy_options);
+
+        while (NextCopyFromRawFields(cstate, &fields, &nfields))
+        {
+            if (is_first_row)
+            {
+                int i;
+
+                /* First row is the header - save column names (in main context) */
+                header_count = nfields;
+                header = (char **) palloc(sizeof(char *) * nfields);
+                state.key_index = -1;
+
+                for (i = 0; i < nfields; i++)
+                {
+                    /* Trim whitespace from header fields */
+                    header[i] = trim_whitespace(fields[i]);
+
+                    if (strcmp(header[i], key_property) == 0)
+                    {
+                        state.key_index = i;
+                    }
+                }
+
+                if (state.key_index < 0)
+                {
+                    ereport(ERROR,
+                            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                             errmsg("key property \"%s\" is not a column of "
+                                    "the label file", key_property)));
+                }
+
+                is_first_row = false;
+            }
+            else
+            {
+                /* Switch to batch context for row processing */
+                old_context = MemoryContextSwitchTo(batch_context);
+
+                upsert_vertex_row(&state, fields, nfields, header,
+                                  header_count, load_as_agtype);
+
+                /* Switch back to main context */
+                MemoryContextSwitchTo(old_context);
+
+                /* Reset batch context after each batch to free memory */
+                if (state.batch_state->num_tuples == 0)
+                {
+                    MemoryContextReset(batch_context);
+                }
+            }
+        }
+
+        /* Write the remaining inserts, then the updates */
+        flush_vertex_updates(&state);
+        finish_batch_insert(&state.batch_state);
+        MemoryContextReset(batch_context);
+
+        /* Give back the ids reserved but not used */
+        release_entry_id_block(&state.entry_ids);
+
+        free_vertex_key_map(state.keys);
+
+        /* Clean up COPY state */
+        EndCopyFrom(cstate);
+
+        PopActiveSnapshot();
+    }
+    PG_FINALLY();
+    {
+        /* Free header if allocated */
+        if (header != NULL)
+        {
+            int i;
+            for (i = 0; i < header_count; i++)
+            {
+                pfree(header[i]);
+            }
+            pfree(header);
+        }
+
+        /* Close the relation */
+        table_close(label_rel, RowExclusiveLock);
+
+        /* Delete the contexts */
+        MemoryContextDelete(batch_context);
+        MemoryContextDelete(state.update_context);
+        MemoryContextDelete(state.keys_context);
+
+        /* Free parse state */
+        free_parsestate(pstate);
+    }
+    PG_END_TRY();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1137 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "postgres.h"
+
+#include <sys/stat.h>
+
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "commands/copy.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "parser/parse_node.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/fd.h"
+#include "storage/latch.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+#include "utils/load/ag_load_edges.h"
+#include "utils/load/ag_load_labels.h"
+#include "utils/load/ag_load_parallel.h"
+
+/* keys for the parallel loader's DSM table of contents */
+#define PARALLEL_LOAD_KEY_SHARED UINT64CONST(0xA6E0000000000001)
+#define PARALLEL_LOAD_KEY_HEADER UINT64CONST(0xA6E0000000000002)
+#define PARALLEL_LOAD_KEY_QUEUES UINT64CONST(0xA6E0000000000003)
+#define PARALLEL_LOAD_KEY_ID_RUNS UINT64CONST(0xA6E0000000000004)
+
+/* size of each worker's queue to the leader */
+#define PARALLEL_LOAD_QUEUE_SIZE 65536
+
+/*
+ * The file is cut into this many chunks per worker, so that a worker that
+ * gets slow chunks doesn't hold up the others, but chunks are never smaller
+ * than PARALLEL_LOAD_MIN_CHUNK_SIZE bytes.
+ */
+#define PARALLEL_LOAD_CHUNKS_PER_WORKER 4
+#define PARALLEL_LOAD_MIN_CHUNK_SIZE (1024 * 1024)
+
+/* the leader's wait event while its queues are empty */
+#if PG_VERSION_NUM >= 170000
+#define PARALLEL_LOAD_WAIT_EVENT WAIT_EVENT_MESSAGE_QUEUE_RECEIVE
+#else
+#define PARALLEL_LOAD_WAIT_EVENT WAIT_EVENT_MQ_RECEIVE
+#endif
+
+/* read size of the pass that splits the file */
+#define PARALLEL_LOAD_READ_SIZE (1024 * 1024)
+
+/* a run of whole records of the file */
+typedef struct parallel_load_chunk
+{
+    off_t start;                /* offset of the first record */
+    off_t end;                  /* offset just past the last record */
+    int64 num_rows;             /* number of records */
+    int64 first_row;            /* file order index of the first record */
+} parallel_load_chunk;
+
+/*
+ * Records from first_row on get consecutive entry ids from first_id, up to
+ * the first_row of the next run.
+ */
+typedef struct parallel_load_id_run
+{
+    int64 first_row;
+    int64 first_id;
+} parallel_load_id_run;
+
+/* the state shared by the leader and the workers */
+typedef struct parallel_load_shared
+{
+    char file_path[MAXPGPATH];
+    Oid graph_oid;
+    Oid label_relid;
+    int32 label_id;
+    bool is_edge;
+    bool id_field_exists;
+    bool load_as_agtype;
+    char delimiter;
+    int header_count;
+    int64 num_id_runs;          /* 0 if the ids come from the file */
+
+    /* the next chunk to be claimed */
+    pg_atomic_uint32 next_chunk;
+
+    int num_chunks;
+    parallel_load_chunk chunks[FLEXIBLE_ARRAY_MEMBER];
+} parallel_load_shared;
+
+/*
+ * A row as sent from a worker to the leader. The properties follow it in the
+ * same message.
+ */
+typedef struct parallel_load_row
+{
+    graphid id;
+    graphid start_id;           /* edges only */
+    graphid end_id;             /* edges only */
+    int64 line_number;          /* the record's line, for errors */
+} parallel_load_row;
+
+/*
+ * Where the parsed rows go. A worker sends them to the leader through its
+ * queue; the leader, for the chunks it parses itself, inserts them directly.
+ */
+typedef struct parallel_load_sink
+{
+    parallel_load_shared *shared;
+    parallel_load_id_run *id_runs;      /* the entry ids drawn, if any */
+    shm_mq_handle *queue;               /* worker only */
+    batch_insert_state *batch_state;    /* leader only */
+    MemoryContext row_context;          /* holds the row being built */
+    int64 max_entry_id;                 /* highest entry id inserted */
+    edge_endpoint_check *endpoint_check; /* leader only, may be NULL */
+} parallel_load_sink;
+
+PGDLLEXPORT void age_load_parallel_worker_main(dsm_segment *seg,
+                                               shm_toc *toc);
+
+static bool split_load_file(char *file_path, int max_chunks,
+                            off_t *header_end, parallel_load_chunk **chunks,
+                            int *num_chunks);
+static void open_load_chunk(char *file_path, off_t start, off_t end);
+static void close_load_chunk(void);
+static int read_load_chunk(void *outbuf, int minread, int maxread);
+static char **read_load_file_header(parallel_load_shared *shared,
+                                    off_t header_end, Relation rel);
+static parallel_load_id_run *draw_entry_id_runs(Oid label_seq_relid,
+                                                parallel_load_chunk *chunks,
+                                                int num_chunks,
+                                                int64 *num_runs);
+static void add_entry_id_run(parallel_load_id_run **runs, int64 *num_runs,
+                             int64 *max_runs, int64 row, int64 entry_id);
+static int64 find_entry_id_run(parallel_load_id_run *runs, int64 num_runs,
+                               int64 row);
+static void load_chunk(parallel_load_sink *sink, char **header,
+                       parallel_load_chunk *chunk, Relation rel);
+static void insert_load_row(parallel_load_sink *sink, parallel_load_row *row,
+                            agtype *properties);
+static void receive_load_rows(parallel_load_sink *sink, shm_mq_handle **queues,
+                              int num_queues);
+static void load_unclaimed_chunks(parallel_load_sink *sink, char **header,
+                                  Relation rel);
+
+/*
+ * The chunk being read through COPY's data source callback, which doesn't
+ * take an argument of its own.
+ */
+static FILE *load_chunk_file = NULL;
+static off_t load_chunk_remaining = 0;
+
+/*
+ * Load vertices or edges from a CSV file using parallel workers.
+ */
+int create_entities_from_csv_file_parallel(char *file_path, char *graph_name,
+                                           Oid graph_oid, char *label_name,
+                                           int label_id, char label_kind,
+                                           bool id_field_exists,
+                                           bool load_as_agtype, char delimiter,
+                                           int parallel_workers,
+                                           bool deferred_indexes,
+                                           edge_endpoint_validation validation)
+{
+    bool is_edge = (label_kind == LABEL_KIND_EDGE);
+    parallel_load_chunk *chunks;
+    int num_chunks;
+    off_t header_end = 0;
+    Relation label_rel;
+    Oid label_relid;
+    Oid label_seq_relid;
+    int64 curr_seq_num = 0;
+    int64 num_rows = 0;
+    parallel_load_id_run *id_runs = NULL;
+    Size id_runs_size;
+    parallel_load_shared *shared;
+    Size shared_size;
+    char **header;
+    Size header_size = 0;
+    char *header_space;
+    char *queue_space;
+    shm_mq_handle **queues;
+    ParallelContext *pcxt;
+    parallel_load_sink sink;
+    int nworkers;
+    int i;
+
+    if (strlen(file_path) >= MAXPGPATH)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_NAME_TOO_LONG),
+                 errmsg("file path is too long")));
+    }
+
+    if (!split_load_file(file_path,
+                         parallel_workers * PARALLEL_LOAD_CHUNKS_PER_WORKER,
+                         &header_end, &chunks, &num_chunks))
+    {
+        if (is_edge)
+        {
+            return create_edges_from_csv_file(file_path, graph_name,
+                                              graph_oid, label_name, label_id,
+                                              load_as_agtype, delimiter,
+                                              deferred_indexes, NULL,
+                                              validation);
+        }
+
+        return create_labels_from_csv_file(file_path, graph_name, graph_oid,
+                                           label_name, label_id,
+                                           id_field_exists, load_as_agtype,
+                                           delimiter, deferred_indexes);
+    }
+
+    /* an empty file has no header and nothing to load */
+    if (header_end == 0)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    label_relid = get_label_relation(label_name, graph_oid);
+    label_rel = table_open(label_relid, RowExclusiveLock);
+    label_seq_relid = get_relname_relid(get_label_seq_relation_name(label_name),
+                                        graph_oid);
+
+    shared_size = add_size(offsetof(parallel_load_shared, chunks),
+                           mul_size(sizeof(parallel_load_chunk),
+                                    Max(num_chunks, 1)));
+    shared = palloc0(shared_size);
+    strlcpy(shared->file_path, file_path, MAXPGPATH);
+    shared->graph_oid = graph_oid;
+    shared->label_relid = label_relid;
+    shared->label_id = label_id;
+    shared->is_edge = is_edge;
+    shared->id_field_exists = id_field_exists && !is_edge;
+    shared->load_as_agtype = load_as_agtype;
+    shared->delimiter = delimiter;
+
+    header = read_load_file_header(shared, header_end, label_rel);
+
+    for (i = 0; i < num_chunks; i++)
+    {
+        chunks[i].first_row = num_rows;
+        num_rows += chunks[i].num_rows;
+    }
+
+    if (num_rows == 0)
+    {
+        table_close(label_rel, RowExclusiveLock);
+        return EXIT_SUCCESS;
+    }
+
+    /*
+     * Vertices with an id column keep their ids, and the sequence is moved
+     * past the highest of them at the end, as the serial loader does. All
+     * other rows get their ids here, one range per chunk in file order, since
+     * the sequence can't be advanced in parallel mode.
+     */
+    if (shared->id_field_exists)
+    {
+        curr_seq_num = nextval_internal(label_seq_relid, true);
+    }
+    else
+    {
+        id_runs = draw_entry_id_runs(label_seq_relid, chunks, num_chunks,
+                                     &shared->num_id_runs);
+    }
+    id_runs_size = mul_size(sizeof(parallel_load_id_run),
+                            Max(shared->num_id_runs, 1));
+
+    memcpy(shared->chunks, chunks, sizeof(parallel_load_chunk) * num_chunks);
+    shared->num_chunks = num_chunks;
+    pg_atomic_init_u32(&shared->next_chunk, 0);
+
+    for (i = 0; i < shared->header_count; i++)
+    {
+        header_size += strlen(header[i]) + 1;
+    }
+
+    nworkers = Min(parallel_workers, num_chunks);
+
+    /* the leader inserts, so it needs its xid before entering parallel mode */
+    (void) GetCurrentTransactionId();
+
+    init_batch_insert(&sink.batch_state, label_name, graph_oid);
+    sink.batch_state->defer_indexes = deferred_indexes;
+    sink.row_context = AllocSetContextCreate(CurrentMemoryContext,
+                                             "AGE Parallel Load Batch Context",
+                                             ALLOCSET_DEFAULT_SIZES);
+    sink.queue = NULL;
+    sink.max_entry_id = 0;
+    sink.endpoint_check = is_edge ?
+        create_edge_endpoint_check(graph_oid, validation) : NULL;
+
+    EnterParallelMode();
+
+    pcxt = CreateParallelContext("age", "age_load_parallel_worker_main",
+                                 nworkers);
+
+    shm_toc_estimate_chunk(&pcxt->estimator, shared_size);
+    shm_toc_estimate_chunk(&pcxt->estimator, Max(header_size, 1));
+    shm_toc_estimate_chunk(&pcxt->estimator,
+                           mul_size(PARALLEL_LOAD_QUEUE_SIZE, nworkers));
+    shm_toc_estimate_chunk(&pcxt->estimator, id_runs_size);
+    shm_toc_estimate_keys(&pcxt->estimator, 4);
+
+    InitializeParallelDSM(pcxt);
+
+    /* the DSM may be private memory, and then no workers are launched */
+    sink.shared = shm_toc_allocate(pcxt->toc, shared_size);
+    memcpy(sink.shared, shared, shared_size);
+    shm_toc_insert(pcxt->toc, PARALLEL_LOAD_KEY_SHARED, sink.shared);
+
+    sink.id_runs = shm_toc_allocate(pcxt->toc, id_runs_size);
+    shm_toc_insert(pcxt->toc, PARALLEL_LOAD_KEY_ID_RUNS, sink.id_runs);
+    if (id_runs != NULL)
+    {
+        memcpy(sink.id_runs, id_runs,
+               sizeof(parallel_load_id_run) * shared->num_id_runs);
+    }
+
+    header_space = shm_toc_allocate(pcxt->toc, Max(header_size, 1));
+    shm_toc_insert(pcxt->toc, PARALLEL_LOAD_KEY_HEADER, header_space);
+    for (i = 0; i < shared->header_count; i++)
+    {
+        size_t len = strlen(header[i]) + 1;
+
+        memcpy(header_space, header[i], len);
+        header_space += len;
+    }
+
+    queue_space = shm_toc_allocate(pcxt->toc,
+                                   mul_size(PARALLEL_LOAD_QUEUE_SIZE,
+                                            nworkers));
+    shm_toc_insert(pcxt->toc, PARALLEL_LOAD_KEY_QUEUES, queue_space);
+    queues = palloc0(sizeof(shm_mq_handle *) * Max(nworkers, 1));
+    for (i = 0; i < pcxt->nworkers; i++)
+    {
+        shm_mq *mq;
+
+        mq = shm_mq_create(queue_space + (Size) i * PARALLEL_LOAD_QUEUE_SIZE,
+                           PARALLEL_LOAD_QUEUE_SIZE);
+        shm_mq_set_receiver(mq, MyProc);
+        queues[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+    }
+
+    LaunchParallelWorkers(pcxt);
+
+    /*
+     * Detect workers that fail to start, and let go of the queues of the ones
+     * that weren't launched.
+     */
+    for (i = 0; i < pcxt->nworkers; i++)
+    {
+        if (i < pcxt->nworkers_launched)
+        {
+            shm_mq_set_handle(queues[i], pcxt->worker[i].bgwhandle);
+        }
+        else
+        {
+            shm_mq_detach(queues[i]);
+            queues[i] = NULL;
+        }
+    }
+
+    receive_load_rows(&sink, queues, pcxt->nworkers_launched);
+
+    /* without workers, the leader loads the chunks itself */
+    load_unclaimed_chunks(&sink, header, label_rel);
+
+    WaitForParallelWorkersToFinish(pcxt);
+    DestroyParallelContext(pcxt);
+    ExitParallelMode();
+
+    finish_batch_insert(&sink.batch_state);
+    MemoryContextDelete(sink.row_context);
+    finish_edge_endpoint_check(sink.endpoint_check);
+
+    /* make the rows inserted in parallel mode visible */
+    CommandCounterIncrement();
+
+    if (shared->id_field_exists && sink.max_entry_id > curr_seq_num)
+    {
+        /* This is needed to ensure the sequence is up-to-date */
+        DirectFunctionCall2(setval_oid, ObjectIdGetDatum(label_seq_relid),
+                            Int64GetDatum(sink.max_entry_id));
+    }
+
+    table_close(label_rel, RowExclusiveLock);
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Worker entry point. Claim chunks until there are none left, and send their
+ * rows to the leader.
+ */
+void age_load_parallel_worker_main(dsm_segment *seg, shm_toc *toc)
+{
+    parallel_load_shared *shared;
+    char *header_space;
+    char **header;
+    char *queue_space;
+    shm_mq *mq;
+    parallel_load_sink sink;
+    Relation rel;
+    uint32 chunk_index;
+    int i;
+
+    shared = shm_toc_lookup(toc, PARALLEL_LOAD_KEY_SHARED, false);
+    sink.id_runs = shm_toc_lookup(toc, PARALLEL_LOAD_KEY_ID_RUNS, false);
+    header_space = shm_toc_lookup(toc, PARALLEL_LOAD_KEY_HEADER, false);
+    queue_space = shm_toc_lookup(toc, PARALLEL_LOAD_KEY_QUEUES, false);
+
+    header = palloc(sizeof(char *) * shared->header_count);
+    for (i = 0; i < shared->header_count; i++)
+    {
+        header[i] = header_space;
+        header_space += strlen(header_space) + 1;
+    }
+
+    mq = (shm_mq *) (queue_space +
+                     (Size) ParallelWorkerNumber * PARALLEL_LOAD_QUEUE_SIZE);
+    shm_mq_set_sender(mq, MyProc);
+
+    sink.shared = shared;
+    sink.queue = shm_mq_attach(mq, seg, NULL);
+    sink.batch_state = NULL;
+    sink.row_context = AllocSetContextCreate(CurrentMemoryContext,
+                                             "AGE Parallel Load Row Context",
+                                             ALLOCSET_DEFAULT_SIZES);
+    sink.max_entry_id = 0;
+    sink.endpoint_check = NULL;
+
+    rel = table_open(shared->label_relid, AccessShareLock);
+
+    while ((chunk_index = pg_atomic_fetch_add_u32(&shared->next_chunk, 1)) <
+           (uint32) shared->num_chunks)
+    {
+        load_chunk(&sink, header, &shared->chunks[chunk_index], rel);
+    }
+
+    table_close(rel, AccessShareLock);
+
+    /* the leader stops waiting for this worker once it detaches */
+    shm_mq_detach(sink.queue);
+}
+
+/*
+ * Split the file into at most max_chunks chunks of whole records, in one pass
+ * over it.
+ *
+ * A newline ends a record unless it is inside a quoted field. Quotes inside
+ * fields are doubled, so a newline is inside one exactly when an odd number
+ * of quotes precede it. COPY can also take rows that end in a bare carriage
+ * return, but they can't be told apart from data this way, so for them (and
+ * for files with an unterminated quote, for COPY to report) false is
+ * returned and the caller falls back to the serial loader.
+ */
+static bool split_load_file(char *file_path, int max_chunks,
+                            off_t *header_end, parallel_load_chunk **chunks,
+                            int *num_chunks)
+{
+    FILE *file;
+    struct stat st;
+    char *buf;
+    size_t len;
+    off_t offset = 0;
+    off_t record_start = 0;
+    off_t chunk_start = -1;
+    off_t target_size;
+    int64 chunk_rows = 0;
+    bool in_quotes = false;
+    bool after_cr = false;
+    bool splittable = true;
+
+    file = AllocateFile(file_path, PG_BINARY_R);
+    if (file == NULL)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not open file \"%s\" for reading: %m",
+                        file_path)));
+    }
+
+    if (fstat(fileno(file), &st) < 0)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not stat file \"%s\": %m", file_path)));
+    }
+
+    target_size = Max(st.st_size / Max(max_chunks, 1),
+                      PARALLEL_LOAD_MIN_CHUNK_SIZE);
+
+    *chunks = palloc(sizeof(parallel_load_chunk) * Max(max_chunks, 1));
+    *num_chunks = 0;
+
+    buf = palloc(PARALLEL_LOAD_READ_SIZE);
+
+    while (splittable &&
+           (len = fread(buf, 1, PARALLEL_LOAD_READ_SIZE, file)) > 0)
+    {
+        size_t i;
+
+        for (i = 0; i < len; i++)
+        {
+            char c = buf[i];
+            off_t record_end;
+
+            if (after_cr)
+            {
+                after_cr = false;
+
+                if (c != '\n')
+                {
+                    splittable = false;
+                    break;
+                }
+            }
+
+            if (c == '"')
+            {
+                in_quotes = !in_quotes;
+                continue;
+            }
+
+            if (in_quotes)
+            {
+                continue;
+            }
+
+            if (c == '\r')
+            {
+                after_cr = true;
+                continue;
+            }
+
+            if (c != '\n')
+            {
+                continue;
+            }
+
+            record_end = offset + i + 1;
+            record_start = record_end;
+
+            /* the first record is the header */
+            if (chunk_start < 0)
+            {
+                *header_end = record_end;
+                chunk_start = record_end;
+                continue;
+            }
+
+            chunk_rows++;
+
+            /* the last chunk takes whatever is left */
+            if (record_end - chunk_start >= target_size &&
+                *num_chunks < max_chunks - 1)
+            {
+                (*chunks)[*num_chunks].start = chunk_start;
+                (*chunks)[*num_chunks].end = record_end;
+                (*chunks)[*num_chunks].num_rows = chunk_rows;
+                (*num_chunks)++;
+
+                chunk_start = record_end;
+                chunk_rows = 0;
+            }
+        }
+
+        offset += len;
+    }
+
+    if (ferror(file))
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not read file \"%s\": %m", file_path)));
+    }
+
+    FreeFile(file);
+    pfree(buf);
+
+    if (!splittable || in_quotes || after_cr)
+    {
+        return false;
+    }
+
+    /* the last record need not end in a newline */
+    if (record_start < offset)
+    {
+        if (chunk_start < 0)
+        {
+            *header_end = offset;
+            chunk_start = offset;
+        }
+        else
+        {
+            chunk_rows++;
+        }
+    }
+
+    if (chunk_rows > 0)
+    {
+        (*chunks)[*num_chunks].start = chunk_start;
+        (*chunks)[*num_chunks].end = offset;
+        (*chunks)[*num_chunks].num_rows = chunk_rows;
+        (*num_chunks)++;
+    }
+
+    return true;
+}
+
+/*
+ * Open the file for reading the bytes from start to end through
+ * read_load_chunk.
+ */
+static void open_load_chunk(char *file_path, off_t start, off_t end)
+{
+    if (load_chunk_file == NULL)
+    {
+        load_chunk_file = AllocateFile(file_path, PG_BINARY_R);
+        if (load_chunk_file == NULL)
+        {
+            ereport(ERROR,
+                    (errcode_for_file_access(),
+                     errmsg("could not open file \"%s\" for reading: %m",
+                            file_path)));
+        }
+    }
+
+    if (fseeko(load_chunk_file, start, SEEK_SET) != 0)
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not seek in file \"%s\": %m", file_path)));
+    }
+
+    load_chunk_remaining = end - start;
+}
+
+static void close_load_chunk(void)
+{
+    if (load_chunk_file != NULL)
+    {
+        FreeFile(load_chunk_file);
+        load_chunk_file = NULL;
+    }
+}
+
+/* COPY data source callback returning the current chunk's bytes */
+static int read_load_chunk(void *outbuf, int minread, int maxread)
+{
+    size_t len;
+
+    len = fread(outbuf, 1, Min((off_t) maxread, load_chunk_remaining),
+                load_chunk_file);
+
+    if (ferror(load_chunk_file))
+    {
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("could not read from COPY file: %m")));
+    }
+
+    load_chunk_remaining -= len;
+
+    return (int) len;
+}
+
+/*
+ * Read the header, the file's first record, and set shared->header_count.
+ * The names are allocated in the current memory context.
+ */
+static char **read_load_file_header(parallel_load_shared *shared,
+                                    off_t header_end, Relation rel)
+{
+    CopyFromState cstate;
+    ParseState *pstate;
+    char **fields;
+    int nfields;
+    char **header = NULL;
+    int i;
+
+    pstate = make_parsestate(NULL);
+
+    PG_TRY();
+    {
+        open_load_chunk(shared->file_path, 0, header_end);
+
+        cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false,
+                               read_load_chunk, NIL,
+                               create_csv_copy_options(shared->delimiter));
+
+        if (NextCopyFromRawFields(cstate, &fields, &nfields))
+        {
+            header = palloc(sizeof(char *) * nfields);
+            for (i = 0; i < nfields; i++)
+            {
+                /* Trim whitespace from header fields */
+                header[i] = trim_whitespace(fields[i]);
+            }
+            shared->header_count = nfields;
+        }
+
+        EndCopyFrom(cstate);
+    }
+    PG_FINALLY();
+    {
+        close_load_chunk();
+        free_parsestate(pstate);
+    }
+    PG_END_TRY();
+
+    if (shared->is_edge)
+    {
+        check_edge_file_header(shared->header_count);
+    }
+
+    return header;
+}
+
+/*
+ * Get the entry ids of the records of the file, in file order, as runs of
+ * consecutive ids. Each chunk's ids are reserved as one range, so the
+ * sequence is written once per chunk rather than once per record. A chunk
+ * whose range can't be reserved without waiting, because another session is
+ * drawing from the label's sequence, has its ids drawn one at a time with
+ * nextval instead, as next_entry_id_from_block does.
+ *
+ * This is done by the leader before the workers start, as nextval and setval
+ * can't be called in parallel mode; the ids can't be drawn as the rows come
+ * back. Drawing them is cheap next to the inserts, which the leader also does
+ * alone: the workers only take the parsing off the leader, and a load is
+ * still bound by how fast one backend can insert the rows.
+ */
+static parallel_load_id_run *draw_entry_id_runs(Oid label_seq_relid,
+                                                parallel_load_chunk *chunks,
+                                                int num_chunks,
+                                                int64 *num_runs)
+{
+    parallel_load_id_run *runs;
+    int64 max_runs = 16;
+    int i;
+
+    runs = palloc(sizeof(parallel_load_id_run) * max_runs);
+    *num_runs = 0;
+
+    for (i = 0; i < num_chunks; i++)
+    {
+        parallel_load_chunk *chunk = &chunks[i];
+        int64 first_id;
+        int64 row;
+
+        CHECK_FOR_INTERRUPTS();
+
+        if (chunk->num_rows == 0)
+        {
+            continue;
+        }
+
+        first_id = reserve_label_entry_ids(label_seq_relid, chunk->num_rows);
+        if (first_id >= 0)
+        {
+            add_entry_id_run(&runs, num_runs, &max_runs, chunk->first_row,
+                             first_id);
+            continue;
+        }
+
+        for (row = chunk->first_row;
+             row < chunk->first_row + chunk->num_rows;
+             row++)
+        {
+            CHECK_FOR_INTERRUPTS();
+
+            add_entry_id_run(&runs, num_runs, &max_runs, row,
+                             nextval_internal(label_seq_relid, true));
+        }
+    }
+
+    return runs;
+}
+
+/*
+ * Give the record at row the given entry id, which starts a new run unless
+ * it follows on from the last one.
+ */
+static void add_entry_id_run(parallel_load_id_run **runs, int64 *num_runs,
+                             int64 *max_runs, int64 row, int64 entry_id)
+{
+    parallel_load_id_run *last;
+
+    if (*num_runs > 0)
+    {
+        last = &(*runs)[*num_runs - 1];
+        if (last->first_id + (row - last->first_row) == entry_id)
+        {
+            return;
+        }
+    }
+
+    if (*num_runs == *max_runs)
+    {
+        *max_runs *= 2;
+        *runs = repalloc_huge(*runs, mul_size(sizeof(parallel_load_id_run),
+                                              *max_runs));
+    }
+
+    (*runs)[*num_runs].first_row = row;
+    (*runs)[*num_runs].first_id = entry_id;
+    (*num_runs)++;
+}
+
+/* find the run of entry ids that the record at row, in file order, is in */
+static int64 find_entry_id_run(parallel_load_id_run *runs, int64 num_runs,
+                               int64 row)
+{
+    int64 low = 0;
+    int64 high = num_runs - 1;
+
+    while (low < high)
+    {
+        int64 mid = low + (high - low + 1) / 2;
+
+        if (runs[mid].first_row <= row)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+
+    return low;
+}
+
+/*
+ * Parse one chunk and pass its rows to the sink. This mirrors
+ * process_vertex_row and process_edge_row, except that entry ids come from
+ * the ones drawn for the file up front.
+ */
+static void load_chunk(parallel_load_sink *sink, char **header,
+                       parallel_load_chunk *chunk, Relation rel)
+{
+    parallel_load_shared *shared = sink->shared;
+    CopyFromState cstate;
+    ParseState *pstate;
+    char **fields;
+    int nfields;
+    int64 row_index = 0;
+    int64 run = 0;
+
+    pstate = make_parsestate(NULL);
+
+    if (shared->num_id_runs > 0)
+    {
+        run = find_entry_id_run(sink->id_runs, shared->num_id_runs,
+                                chunk->first_row);
+    }
+
+    PG_TRY();
+    {
+        open_load_chunk(shared->file_path, chunk->start, chunk->end);
+
+        cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false,
+                               read_load_chunk, NIL,
+                               create_csv_copy_options(shared->delimiter));
+
+        while (NextCopyFromRawFields(cstate, &fields, &nfields))
+        {
+            MemoryContext old_context;
+            parallel_load_row row;
+            agtype *properties;
+            int64 entry_id = 0;
+
+            /* the splitting pass and COPY must agree on the records */
+            if (row_index >= chunk->num_rows)
+            {
+                ereport(ERROR,
+                        (errcode(ERRCODE_INTERNAL_ERROR),
+                         errmsg("parallel load found more rows than expected "
+                                "in \"%s\"", shared->file_path)));
+            }
+
+            /* the header is the first line */
+            row.line_number = chunk->first_row + row_index + 2;
+
+            if (shared->num_id_runs > 0)
+            {
+                int64 row = chunk->first_row + row_index;
+
+                while (run + 1 < shared->num_id_runs &&
+                       sink->id_runs[run + 1].first_row <= row)
+                {
+                    run++;
+                }
+
+                entry_id = sink->id_runs[run].first_id +
+                           (row - sink->id_runs[run].first_row);
+            }
+            row_index++;
+
+            old_context = MemoryContextSwitchTo(sink->row_context);
+
+            if (shared->is_edge)
+            {
+                get_edge_row_endpoints(fields, nfields, shared->header_count,
+                                       shared->graph_oid, NULL,
+                                       &row.start_id, &row.end_id);
+                row.id = make_graphid(shared->label_id, entry_id);
+                properties = create_agtype_from_list_i(header, fields, nfields,
+                                                       4,
+                                                       shared->load_as_agtype);
+            }
+            else
+            {
+                check_label_file_row(nfields, shared->header_count);
+
+                if (shared->id_field_exists)
+                {
+                    entry_id = strtol(fields[0], NULL, 10);
+                }
+
+                row.id = make_graphid(shared->label_id, entry_id);
+                row.start_id = 0;
+                row.end_id = 0;
+                properties = create_agtype_from_list(header, fields, nfields,
+                                                     entry_id,
+                                                     shared->load_as_agtype);
+            }
+
+            MemoryContextSwitchTo(old_context);
+
+            insert_load_row(sink, &row, properties);
+        }
+
+        EndCopyFrom(cstate);
+    }
+    PG_FINALLY();
+    {
+        close_load_chunk();
+        free_parsestate(pstate);
+    }
+    PG_END_TRY();
+}
+
+/*
+ * Pass a row built in the sink's row context on: a worker sends it to the
+ * leader, and the leader adds it to its batch.
+ */
+static void insert_load_row(parallel_load_sink *sink, parallel_load_row *row,
+                            agtype *properties)
+{
+    batch_insert_state *batch_state = sink->batch_state;
+    TupleTableSlot *slot;
+
+    if (sink->queue != NULL)
+    {
+        shm_mq_iovec iov[2];
+        shm_mq_result result;
+
+        iov[0].data = (const char *) row;
+        iov[0].len = sizeof(parallel_load_row);
+        iov[1].data = (const char *) properties;
+        iov[1].len = VARSIZE(properties);
+
+        result = shm_mq_sendv(sink->queue, iov, 2, false, false);
+
+        /* the leader only detaches when it is erroring out */
+        if (result == SHM_MQ_DETACHED)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_ADMIN_SHUTDOWN),
+                     errmsg("parallel load leader detached")));
+        }
+
+        MemoryContextReset(sink->row_context);
+        return;
+    }
+
+    if (sink->endpoint_check != NULL &&
+        !check_edge_endpoints(sink->endpoint_check, row->start_id,
+                              row->end_id, row->line_number))
+    {
+        return;
+    }
+
+    /* Get the appropriate slot from the batch state */
+    slot = batch_state->slots[batch_state->num_tuples];
+
+    /* Clear the slots contents */
+    ExecClearTuple(slot);
+
+    /* Fill the values in the slot */
+    slot->tts_values[0] = GRAPHID_GET_DATUM(row->id);
+    slot->tts_isnull[0] = false;
+
+    if (sink->shared->is_edge)
+    {
+        slot->tts_values[1] = GRAPHID_GET_DATUM(row->start_id);
+        slot->tts_values[2] = GRAPHID_GET_DATUM(row->end_id);
+        slot->tts_values[3] = AGTYPE_P_GET_DATUM(properties);
+        slot->tts_isnull[1] = false;
+        slot->tts_isnull[2] = false;
+        slot->tts_isnull[3] = false;
+    }
+    else
+    {
+        slot->tts_values[1] = AGTYPE_P_GET_DATUM(properties);
+        slot->tts_isnull[1] = false;
+
+        sink->max_entry_id = Max(sink->max_entry_id,
+                                 get_graphid_entry_id(row->id));
+    }
+
+    /* Make the slot as containing virtual tuple */
+    ExecStoreVirtualTuple(slot);
+
+    batch_state->buffered_bytes += VARSIZE(properties);
+    batch_state->num_tuples++;
+
+    /* Insert the batch when tuple count OR byte threshold is reached */
+    if (batch_state->num_tuples >= BATCH_SIZE ||
+        batch_state->buffered_bytes >= MAX_BUFFERED_BYTES)
+    {
+        insert_batch(batch_state);
+        batch_state->num_tuples = 0;
+        batch_state->buffered_bytes = 0;
+
+        /* Reset the batch's memory now that it has been inserted */
+        MemoryContextReset(sink->row_context);
+    }
+}
+
+/*
+ * Insert the rows sent by the workers until all of them have detached,
+ * taking one row from each queue in turn.
+ */
+static void receive_load_rows(parallel_load_sink *sink, shm_mq_handle **queues,
+                              int num_queues)
+{
+    int num_active = num_queues;
+
+    while (num_active > 0)
+    {
+        bool received = false;
+        int i;
+
+        CHECK_FOR_INTERRUPTS();
+
+        for (i = 0; i < num_queues; i++)
+        {
+            shm_mq_result result;
+            Size nbytes;
+            void *data;
+            parallel_load_row row;
+            agtype *properties;
+            MemoryContext old_context;
+
+            if (queues[i] == NULL)
+            {
+                continue;
+            }
+
+            result = shm_mq_receive(queues[i], &nbytes, &data, true);
+
+            if (result == SHM_MQ_DETACHED)
+            {
+                /* done, or failed; a failure is reported when waiting */
+                shm_mq_detach(queues[i]);
+                queues[i] = NULL;
+                num_active--;
+                continue;
+            }
+
+            if (result == SHM_MQ_WOULD_BLOCK)
+            {
+                continue;
+            }
+
+            /* the message is only valid until the next receive, so copy it */
+            memcpy(&row, data, sizeof(parallel_load_row));
+
+            old_context = MemoryContextSwitchTo(sink->row_context);
+            properties = palloc(nbytes - sizeof(parallel_load_row));
+            memcpy(properties, (char *) data + sizeof(parallel_load_row),
+                   nbytes - sizeof(parallel_load_row));
+            MemoryContextSwitchTo(old_context);
+
+            insert_load_row(sink, &row, properties);
+            received = true;
+        }
+
+        if (!received && num_active > 0)
+        {
+            (void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+                             PARALLEL_LOAD_WAIT_EVENT);
+            ResetLatch(MyLatch);
+        }
+    }
+}
+
+/*
+ * Load the chunks that no worker claimed, which happens when no worker could
+ * be launched.
+ */
+static void load_unclaimed_chunks(parallel_load_sink *sink, char **header,
+                                  Relation rel)
+{
+    parallel_load_shared *shared = sink->shared;
+    uint32 chunk_index;
+
+    while ((chunk_index = pg_atomic_fetch_add_u32(&shared->next_chunk, 1)) <
+           (uint32) shared->num_chunks)
+    {
+        load_chunk(sink, header, &shared->chunks[chunk_index], rel);
+    }
+}
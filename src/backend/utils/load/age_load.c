@@ -19,36 +19,84 @@
 
 #include "postgres.h"
 
+#include <sys/stat.h>
+
+#include "access/genam.h"
 #include "access/heapam.h"
+#include "access/stratnum.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/index.h"
 #include "catalog/indexing.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "executor/executor.h"
+#include "funcapi.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_relation.h"
+#include "postmaster/bgworker_internals.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/json.h"
 #include "utils/rel.h"
 #include "utils/rls.h"
+#include "utils/snapmgr.h"
 
+#include "utils/load/ag_export.h"
+#include "utils/load/ag_load_binary.h"
 #include "utils/load/ag_load_edges.h"
 #include "utils/load/ag_load_labels.h"
+#include "utils/load/ag_load_parallel.h"
 #include "utils/load/age_load.h"
+#include "utils/ag_func.h"
+#include "utils/age_global_graph.h"
 
 static agtype_value *csv_value_to_agtype_value(char *csv_val);
 static Oid get_or_create_graph(const Name graph_name);
 static int32 get_or_create_label(Oid graph_oid, char *graph_name,
                                  char *label_name, char label_kind);
-static char *build_safe_filename(char *name);
+static char *build_safe_filename(char *name, const char *extension);
+static char *build_safe_directory(char *name);
 static void check_file_read_permission(void);
-static void check_table_permissions(Oid relid);
+static void check_file_write_permission(void);
+static void check_table_permissions(Oid relid, AclMode mode);
 static void check_rls_for_load(Oid relid);
+static void check_rls_for_export(Oid relid);
+static char get_delimiter_arg(FunctionCallInfo fcinfo, int argno);
+static int get_parallel_workers_arg(FunctionCallInfo fcinfo, int argno);
+static char *get_key_property_arg(FunctionCallInfo fcinfo, int argno);
+static edge_endpoint_validation get_endpoint_validation_arg(
+    FunctionCallInfo fcinfo, int argno);
+static bool get_export_format_arg(FunctionCallInfo fcinfo, int argno);
+static int get_binary_load_columns(FunctionCallInfo fcinfo, int argno,
+                                   char ***column_names, Oid **column_types);
+static void check_integer_column(Oid type, const char *column);
+static void check_string_column(Oid type, const char *column);
+static void check_reindex_permission(Oid relid);
+static void rebuild_label_indexes(Oid relid);
+static EState *create_label_estate(Oid relid, AclMode required_perms,
+                                   ResultRelInfo **result_rel_info);
+static uint32 vertex_key_hash(const void *key, Size keysize);
+static int vertex_key_match(const void *key1, const void *key2, Size keysize);
+static void agtype_value_to_vertex_key(agtype_value *value, char *key_property,
+                                       char *label_name, vertex_key *key);
+static bool is_key_property_expression(Node *expr, char *key_property);
+static Oid find_key_property_index(Relation relation, char *key_property);
+static void read_vertex_keys(vertex_key_map *map, Relation relation);
+static vertex_key_entry *probe_vertex_key(vertex_key_map *map,
+                                          vertex_key *key);
 
 #define AGE_BASE_CSV_DIRECTORY "/tmp/age/"
 #define AGE_CSV_FILE_EXTENSION ".csv"
+#define AGE_BINARY_FILE_EXTENSION ".bin"
 
 /*
  * Trim leading and trailing whitespace from a string.
@@ -93,7 +141,158 @@ char *trim_whitespace(const char *str)
     return pnstrdup(start, len);
 }
 
-static char *build_safe_filename(char *name)
+/*
+ * Create COPY options for CSV parsing.
+ * Returns a List of DefElem nodes.
+ */
+List *create_csv_copy_options(char delimiter)
+{
+    List *options = NIL;
+
+    /* FORMAT csv */
+    options = lappend(options,
+                      makeDefElem("format",
+                                  (Node *) makeString("csv"),
+                                  -1));
+
+    /* HEADER false - we'll read the header ourselves */
+    options = lappend(options,
+                      makeDefElem("header",
+                                  (Node *) makeBoolean(false),
+                                  -1));
+
+    /* DELIMITER */
+    {
+        char delimiter_str[2];
+        delimiter_str[0] = delimiter;
+        delimiter_str[1] = '\0';
+        options = lappend(options,
+                          makeDefElem("delimiter",
+                                      (Node *) makeString(pstrdup(delimiter_str)),
+                                      -1));
+    }
+
+    return options;
+}
+
+/*
+ * Reserve count consecutive entry ids from a label's sequence and return the
+ * first one, or -1 if they can't be reserved without waiting.
+ *
+ * The sequence is advanced past the whole block with a nextval and a setval,
+ * which is only safe if no other session draws from it in between. An
+ * ExclusiveLock on the sequence ensures that: it conflicts with the
+ * RowExclusiveLock that nextval takes and keeps until the end of the
+ * transaction. The lock is only ever tried, never waited for. Waiting for
+ * it queued a loader behind every open transaction that had inserted into
+ * the label, and two loaders that had both drawn ids, so that both held the
+ * RowExclusiveLock, each waited for the other: a deadlock.
+ */
+int64 reserve_label_entry_ids(Oid label_seq_relid, int64 count)
+{
+    int64 first_id;
+
+    Assert(count > 0);
+
+    if (!ConditionalLockRelationOid(label_seq_relid, ExclusiveLock))
+    {
+        return -1;
+    }
+
+    first_id = nextval_internal(label_seq_relid, true);
+
+    if (count > 1)
+    {
+        DirectFunctionCall2(setval_oid, ObjectIdGetDatum(label_seq_relid),
+                            Int64GetDatum(first_id + count - 1));
+    }
+
+    UnlockRelationOid(label_seq_relid, ExclusiveLock);
+
+    return first_id;
+}
+
+void init_entry_id_block(entry_id_block *block, Oid label_seq_relid)
+{
+    block->label_seq_relid = label_seq_relid;
+    block->next_id = 0;
+    block->last_id = -1;
+    block->unreserved = 0;
+}
+
+/*
+ * Hand out the next entry id, reserving a new block of BATCH_SIZE ids when
+ * the current one is used up. While another transaction is drawing from the
+ * sequence, the block can't be reserved; the next BATCH_SIZE ids are then
+ * drawn one at a time with nextval before trying again.
+ */
+int64 next_entry_id_from_block(entry_id_block *block)
+{
+    if (block->next_id > block->last_id)
+    {
+        int64 first_id;
+
+        if (block->unreserved > 0)
+        {
+            block->unreserved--;
+            return nextval_internal(block->label_seq_relid, true);
+        }
+
+        first_id = reserve_label_entry_ids(block->label_seq_relid,
+                                           BATCH_SIZE);
+        if (first_id < 0)
+        {
+            block->unreserved = BATCH_SIZE - 1;
+            return nextval_internal(block->label_seq_relid, true);
+        }
+
+        block->next_id = first_id;
+        block->last_id = first_id + BATCH_SIZE - 1;
+    }
+
+    return block->next_id++;
+}
+
+/*
+ * Give the unused tail of the current block back to the sequence, so that a
+ * load leaves it where id-at-a-time loading would have. This is only done
+ * if the sequence is still at the end of the block and the lock can be had
+ * without waiting; otherwise the tail is left as a gap.
+ */
+void release_entry_id_block(entry_id_block *block)
+{
+    LOCAL_FCINFO(fcinfo, 1);
+    Datum last_value;
+
+    if (block->next_id > block->last_id)
+    {
+        return;
+    }
+
+    if (!ConditionalLockRelationOid(block->label_seq_relid, ExclusiveLock))
+    {
+        block->last_id = block->next_id - 1;
+        return;
+    }
+
+    InitFunctionCallInfoData(*fcinfo, NULL, 1, InvalidOid, NULL, NULL);
+    fcinfo->args[0].value = ObjectIdGetDatum(block->label_seq_relid);
+    fcinfo->args[0].isnull = false;
+    last_value = pg_sequence_last_value(fcinfo);
+
+    if (!fcinfo->isnull && DatumGetInt64(last_value) == block->last_id)
+    {
+        DirectFunctionCall2(setval_oid,
+                            ObjectIdGetDatum(block->label_seq_relid),
+                            Int64GetDatum(block->next_id - 1));
+    }
+
+    UnlockRelationOid(block->label_seq_relid, ExclusiveLock);
+
+    block->last_id = block->next_id - 1;
+}
+
+static char *build_safe_filename(char *name, const char *extension)
 {
     int length;
     char path[PATH_MAX];
@@ -133,13 +332,49 @@ static char *build_safe_filename(char *name)
                                AGE_BASE_CSV_DIRECTORY)));
     }
 
-    length = strlen(resolved) - 4;
-    if (strncmp(resolved+length, AGE_CSV_FILE_EXTENSION,
-                strlen(AGE_CSV_FILE_EXTENSION)) != 0)
+    length = strlen(resolved) - strlen(extension);
+    if (length < 0 || strcmp(resolved + length, extension) != 0)
     {
         ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
                         errmsg("You can only load files with extension [%s].",
-                               AGE_CSV_FILE_EXTENSION)));
+                               extension)));
+    }
+
+    return resolved;
+}
+
+/*
+ * Resolve a directory under AGE_BASE_CSV_DIRECTORY to write files to. As
+ * with build_safe_filename, the caller must free() the result.
+ */
+static char *build_safe_directory(char *name)
+{
+    char path[PATH_MAX];
+    char *resolved;
+    struct stat st;
+
+    if (name == NULL || strlen(name) == 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("directory name cannot be NULL or zero length")));
+    }
+
+    snprintf(path, sizeof(path), "%s%s", AGE_BASE_CSV_DIRECTORY, name);
+
+    resolved = realpath(path, NULL);
+
+    if (resolved == NULL || stat(resolved, &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("Directory does not exist [%s]", path)));
+    }
+
+    if (strncmp(resolved, AGE_BASE_CSV_DIRECTORY,
+                strlen(AGE_BASE_CSV_DIRECTORY)) != 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("You can only export to directories located in [%s].",
+                               AGE_BASE_CSV_DIRECTORY)));
     }
 
     return resolved;
@@ -162,13 +397,29 @@ static void check_file_read_permission(void)
 }
 
 /*
- * Check if the current user has INSERT permission on the target table.
+ * Check if the current user has permission to write server files.
+ * Only users with the pg_write_server_files role can export to files.
+ */
+static void check_file_write_permission(void)
+{
+    if (!has_privs_of_role(GetUserId(), ROLE_PG_WRITE_SERVER_FILES))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                 errmsg("permission denied to export to a file"),
+                 errdetail("Only roles with privileges of the \"%s\" role may export to a file.",
+                           "pg_write_server_files")));
+    }
+}
+
+/*
+ * Check if the current user has the given permission on the target table.
  */
-static void check_table_permissions(Oid relid)
+static void check_table_permissions(Oid relid, AclMode mode)
 {
     AclResult aclresult;
 
-    aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_INSERT);
+    aclresult = pg_class_aclcheck(relid, GetUserId(), mode);
     if (aclresult != ACLCHECK_OK)
     {
         aclcheck_error(aclresult, OBJECT_TABLE, get_rel_name(relid));
@@ -190,6 +441,21 @@ static void check_rls_for_load(Oid relid)
     }
 }
 
+/*
+ * Check if RLS is enabled on a table to export. The export reads the table
+ * directly, so it would bypass the policies.
+ */
+static void check_rls_for_export(Oid relid)
+{
+    if (check_enable_rls(relid, InvalidOid, true) == RLS_ENABLED)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("export to file is not supported with row-level security"),
+                 errhint("Use a Cypher MATCH query instead.")));
+    }
+}
+
 agtype *create_empty_agtype(void)
 {
     agtype* out;
@@ -255,6 +521,16 @@ static agtype_value *csv_value_to_agtype_value(char *csv_val)
     {
         res = &res->val.array.elems[0];
     }
+    /* an array or object can only be pushed as a value in binary form */
+    else if (res->type == AGTV_ARRAY || res->type == AGTV_OBJECT)
+    {
+        agtype *container = agtype_value_to_agtype(res);
+
+        res = palloc(sizeof(agtype_value));
+        res->type = AGTV_BINARY;
+        res->val.binary.data = &container->root;
+        res->val.binary.len = VARSIZE(container) - VARHDRSZ;
+    }
 
     return res;
 }
@@ -534,8 +810,12 @@ void insert_batch(batch_insert_state *batch_state)
                       TABLE_INSERT_SKIP_FSM,  /* Skip free space map for bulk */
                       batch_state->bistate);  /* Use bulk insert state */
 
-    /* Insert index entries for the tuples */
-    if (batch_state->resultRelInfo->ri_NumIndices > 0)
+    /*
+     * Insert index entries for the tuples, unless the indexes are rebuilt
+     * after the load.
+     */
+    if (batch_state->resultRelInfo->ri_NumIndices > 0 &&
+        !batch_state->defer_indexes)
     {
         for (i = 0; i < batch_state->num_tuples; i++)
         {
@@ -559,7 +839,14 @@ void insert_batch(batch_insert_state *batch_state)
         }
     }
 
-    CommandCounterIncrement();
+    /*
+     * The command counter can't be advanced in parallel mode, so the parallel
+     * loader does that itself once its workers are done.
+     */
+    if (!IsInParallelMode())
+    {
+        CommandCounterIncrement();
+    }
 }
 
 PG_FUNCTION_INFO_V1(load_labels_from_file);
@@ -577,6 +864,8 @@ Datum load_labels_from_file(PG_FUNCTION_ARGS)
     bool id_field_exists;
     bool load_as_agtype;
     char delimiter;
+    int parallel_workers;
+    bool deferred_indexes;
 
     if (PG_ARGISNULL(0))
     {
@@ -605,22 +894,11 @@ Datum load_labels_from_file(PG_FUNCTION_ARGS)
     id_field_exists = PG_GETARG_BOOL(3);
     load_as_agtype = PG_GETARG_BOOL(4);
 
-    if (PG_NARGS() > 5 && !PG_ARGISNULL(5))
-    {
-        text *delim_text = PG_GETARG_TEXT_P(5);
-        char *delim_str = text_to_cstring(delim_text);
-        if (strlen(delim_str) != 1)
-        {
-            ereport(ERROR,
-                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                     errmsg("delimiter must be a single character")));
-        }
-        delimiter = delim_str[0];
-    }
-    else
-    {
-        delimiter = ',';
-    }
+    delimiter = get_delimiter_arg(fcinfo, 5);
+
+    parallel_workers = get_parallel_workers_arg(fcinfo, 6);
+    deferred_indexes = (PG_NARGS() > 7 && !PG_ARGISNULL(7) &&
+                        PG_GETARG_BOOL(7));
 
     graph_name_str = NameStr(*graph_name);
     label_name_str = NameStr(*label_name);
@@ -630,7 +908,8 @@ Datum load_labels_from_file(PG_FUNCTION_ARGS)
         label_name_str = AG_DEFAULT_LABEL_VERTEX;
     }
 
-    file_path_str = build_safe_filename(text_to_cstring(file_name));
+    file_path_str = build_safe_filename(text_to_cstring(file_name),
+                                        AGE_CSV_FILE_EXTENSION);
 
     graph_oid = get_or_create_graph(graph_name);
     label_id = get_or_create_label(graph_oid, graph_name_str,
@@ -638,12 +917,36 @@ Datum load_labels_from_file(PG_FUNCTION_ARGS)
 
     /* Get the label relation and check permissions */
     label_relid = get_label_relation(label_name_str, graph_oid);
-    check_table_permissions(label_relid);
+    check_table_permissions(label_relid, ACL_INSERT);
     check_rls_for_load(label_relid);
 
-    create_labels_from_csv_file(file_path_str, graph_name_str, graph_oid,
-                                label_name_str, label_id, id_field_exists,
-                                load_as_agtype, delimiter);
+    if (deferred_indexes)
+    {
+        check_reindex_permission(label_relid);
+    }
+
+    if (parallel_workers > 0)
+    {
+        create_entities_from_csv_file_parallel(file_path_str, graph_name_str,
+                                               graph_oid, label_name_str,
+                                               label_id, LABEL_KIND_VERTEX,
+                                               id_field_exists, load_as_agtype,
+                                               delimiter, parallel_workers,
+                                               deferred_indexes,
+                                               EDGE_ENDPOINT_VALIDATION_NONE);
+    }
+    else
+    {
+        create_labels_from_csv_file(file_path_str, graph_name_str, graph_oid,
+                                    label_name_str, label_id, id_field_exists,
+                                    load_as_agtype, delimiter,
+                                    deferred_indexes);
+    }
+
+    if (deferred_indexes)
+    {
+        rebuild_label_indexes(label_relid);
+    }
 
     free(file_path_str);
 
@@ -664,6 +967,10 @@ Datum load_edges_from_file(PG_FUNCTION_ARGS)
     int32 label_id;
     bool load_as_agtype;
     char delimiter;
+    int parallel_workers;
+    bool deferred_indexes;
+    char *key_property;
+    edge_endpoint_validation endpoint_validation;
 
     if (PG_ARGISNULL(0))
     {
@@ -691,21 +998,19 @@ Datum load_edges_from_file(PG_FUNCTION_ARGS)
     file_name = PG_GETARG_TEXT_P(2);
     load_as_agtype = PG_GETARG_BOOL(3);
 
-    if (PG_NARGS() > 4 && !PG_ARGISNULL(4))
-    {
-        text *delim_text = PG_GETARG_TEXT_P(4);
-        char *delim_str = text_to_cstring(delim_text);
-        if (strlen(delim_str) != 1)
-        {
-            ereport(ERROR,
-                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                     errmsg("delimiter must be a single character")));
-        }
-        delimiter = delim_str[0];
-    }
-    else
+    delimiter = get_delimiter_arg(fcinfo, 4);
+
+    parallel_workers = get_parallel_workers_arg(fcinfo, 5);
+    deferred_indexes = (PG_NARGS() > 6 && !PG_ARGISNULL(6) &&
+                        PG_GETARG_BOOL(6));
+    key_property = get_key_property_arg(fcinfo, 7);
+    endpoint_validation = get_endpoint_validation_arg(fcinfo, 8);
+
+    if (key_property != NULL && parallel_workers > 0)
     {
-        delimiter = ',';
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("key_property cannot be used with parallel_workers")));
     }
 
     graph_name_str = NameStr(*graph_name);
@@ -716,7 +1021,8 @@ Datum load_edges_from_file(PG_FUNCTION_ARGS)
         label_name_str = AG_DEFAULT_LABEL_EDGE;
     }
 
-    file_path_str = build_safe_filename(text_to_cstring(file_name));
+    file_path_str = build_safe_filename(text_to_cstring(file_name),
+                                        AGE_CSV_FILE_EXTENSION);
 
     graph_oid = get_or_create_graph(graph_name);
     label_id = get_or_create_label(graph_oid, graph_name_str,
@@ -724,12 +1030,36 @@ Datum load_edges_from_file(PG_FUNCTION_ARGS)
 
     /* Get the label relation and check permissions */
     label_relid = get_label_relation(label_name_str, graph_oid);
-    check_table_permissions(label_relid);
+    check_table_permissions(label_relid, ACL_INSERT);
     check_rls_for_load(label_relid);
 
-    create_edges_from_csv_file(file_path_str, graph_name_str, graph_oid,
-                               label_name_str, label_id, load_as_agtype,
-                               delimiter);
+    if (deferred_indexes)
+    {
+        check_reindex_permission(label_relid);
+    }
+
+    if (parallel_workers > 0)
+    {
+        create_entities_from_csv_file_parallel(file_path_str, graph_name_str,
+                                               graph_oid, label_name_str,
+                                               label_id, LABEL_KIND_EDGE,
+                                               false, load_as_agtype,
+                                               delimiter, parallel_workers,
+                                               deferred_indexes,
+                                               endpoint_validation);
+    }
+    else
+    {
+        create_edges_from_csv_file(file_path_str, graph_name_str, graph_oid,
+                                   label_name_str, label_id, load_as_agtype,
+                                   delimiter, deferred_indexes, key_property,
+                                   endpoint_validation);
+    }
+
+    if (deferred_indexes)
+    {
+        rebuild_label_indexes(label_relid);
+    }
 
     free(file_path_str);
 
@@ -737,175 +1067,2051 @@ Datum load_edges_from_file(PG_FUNCTION_ARGS)
 }
 
 /*
- * Helper function to create a graph if it does not exist.
- * Just returns Oid of the graph if it already exists.
+ * upsert_labels_from_file inserts the vertices of a CSV file whose key is new
+ * and updates the properties of those whose key matches an existing vertex.
  */
-static Oid get_or_create_graph(const Name graph_name)
+PG_FUNCTION_INFO_V1(upsert_labels_from_file);
+Datum upsert_labels_from_file(PG_FUNCTION_ARGS)
 {
+    Name graph_name;
+    Name label_name;
+    char* graph_name_str;
+    char* label_name_str;
+    char* file_path_str;
+    char *key_property;
     Oid graph_oid;
-    char *graph_name_str;
+    Oid label_relid;
+    int32 label_id;
+    bool load_as_agtype;
+    char delimiter;
+
+    if (PG_ARGISNULL(0))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("graph name must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(1))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("label name must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(2))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("file path must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(3))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("key property must not be NULL")));
+    }
+
+    /* Check file read permission first */
+    check_file_read_permission();
+
+    graph_name = PG_GETARG_NAME(0);
+    label_name = PG_GETARG_NAME(1);
+    key_property = get_key_property_arg(fcinfo, 3);
+    load_as_agtype = !PG_ARGISNULL(4) && PG_GETARG_BOOL(4);
+    delimiter = get_delimiter_arg(fcinfo, 5);
 
     graph_name_str = NameStr(*graph_name);
-    graph_oid = get_graph_oid(graph_name_str);
+    label_name_str = NameStr(*label_name);
 
-    if (OidIsValid(graph_oid))
+    if (strcmp(label_name_str, "") == 0)
     {
-        return graph_oid;
+        label_name_str = AG_DEFAULT_LABEL_VERTEX;
     }
 
-    graph_oid = create_graph_internal(graph_name);
-    ereport(NOTICE,
-            (errmsg("graph \"%s\" has been created", NameStr(*graph_name))));
-    
-    return graph_oid;
+    file_path_str = build_safe_filename(text_to_cstring(PG_GETARG_TEXT_P(2)),
+                                        AGE_CSV_FILE_EXTENSION);
+
+    graph_oid = get_or_create_graph(graph_name);
+    label_id = get_or_create_label(graph_oid, graph_name_str,
+                                   label_name_str, LABEL_KIND_VERTEX);
+
+    /* the existing vertices are read to match the keys, then updated */
+    label_relid = get_label_relation(label_name_str, graph_oid);
+    check_table_permissions(label_relid, ACL_INSERT);
+    check_table_permissions(label_relid, ACL_UPDATE);
+    check_table_permissions(label_relid, ACL_SELECT);
+    check_rls_for_load(label_relid);
+
+    upsert_labels_from_csv_file(file_path_str, graph_name_str, graph_oid,
+                                label_name_str, label_id, key_property,
+                                load_as_agtype, delimiter);
+
+    /* invalidate the graph caches, which may have the old properties */
+    increment_graph_version(graph_oid);
+
+    free(file_path_str);
+
+    PG_RETURN_VOID();
 }
 
 /*
- * Helper function to create a label if it does not exist.
- * Just returns label_id of the label if it already exists.
+ * The stdin variants of the load functions stream the CSV data from the
+ * client over the COPY protocol, as COPY ... FROM STDIN does, instead of
+ * reading a file on the server.
  */
-static int32 get_or_create_label(Oid graph_oid, char *graph_name,
-                                 char *label_name, char label_kind)
+PG_FUNCTION_INFO_V1(load_labels_from_stdin);
+Datum load_labels_from_stdin(PG_FUNCTION_ARGS)
 {
+    Name graph_name;
+    Name label_name;
+    char* graph_name_str;
+    char* label_name_str;
+    Oid graph_oid;
+    Oid label_relid;
     int32 label_id;
+    bool id_field_exists;
+    bool load_as_agtype;
+    char delimiter;
+    bool deferred_indexes;
 
-    label_id = get_label_id(label_name, graph_oid);
-
-    /* Check if label exists */
-    if (label_id_is_valid(label_id))
+    if (PG_ARGISNULL(0))
     {
-        char *label_kind_full = (label_kind == LABEL_KIND_VERTEX)
-                                ? "vertex" : "edge";
-        char opposite_label_kind = (label_kind == LABEL_KIND_VERTEX)
-                                    ? LABEL_KIND_EDGE : LABEL_KIND_VERTEX;
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("graph name must not be NULL")));
+    }
 
-        /* If it exists, but as another label_kind, throw an error */
-        if (get_label_kind(label_name, graph_oid) == opposite_label_kind)
+    if (PG_ARGISNULL(1))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("label name must not be NULL")));
+    }
+
+    graph_name = PG_GETARG_NAME(0);
+    label_name = PG_GETARG_NAME(1);
+    id_field_exists = PG_ARGISNULL(2) ? true : PG_GETARG_BOOL(2);
+    load_as_agtype = !PG_ARGISNULL(3) && PG_GETARG_BOOL(3);
+    delimiter = get_delimiter_arg(fcinfo, 4);
+    deferred_indexes = !PG_ARGISNULL(5) && PG_GETARG_BOOL(5);
+
+    graph_name_str = NameStr(*graph_name);
+    label_name_str = NameStr(*label_name);
+
+    if (strcmp(label_name_str, "") == 0)
+    {
+        label_name_str = AG_DEFAULT_LABEL_VERTEX;
+    }
+
+    graph_oid = get_or_create_graph(graph_name);
+    label_id = get_or_create_label(graph_oid, graph_name_str,
+                                   label_name_str, LABEL_KIND_VERTEX);
+
+    /* Get the label relation and check permissions */
+    label_relid = get_label_relation(label_name_str, graph_oid);
+    check_table_permissions(label_relid, ACL_INSERT);
+    check_rls_for_load(label_relid);
+
+    if (deferred_indexes)
+    {
+        check_reindex_permission(label_relid);
+    }
+
+    /* a NULL file path reads the data from the client */
+    create_labels_from_csv_file(NULL, graph_name_str, graph_oid,
+                                label_name_str, label_id, id_field_exists,
+                                load_as_agtype, delimiter, deferred_indexes);
+
+    if (deferred_indexes)
+    {
+        rebuild_label_indexes(label_relid);
+    }
+
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(load_edges_from_stdin);
+Datum load_edges_from_stdin(PG_FUNCTION_ARGS)
+{
+    Name graph_name;
+    Name label_name;
+    char* graph_name_str;
+    char* label_name_str;
+    Oid graph_oid;
+    Oid label_relid;
+    int32 label_id;
+    bool load_as_agtype;
+    char delimiter;
+    bool deferred_indexes;
+    char *key_property;
+    edge_endpoint_validation endpoint_validation;
+
+    if (PG_ARGISNULL(0))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("graph name must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(1))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("label name must not be NULL")));
+    }
+
+    graph_name = PG_GETARG_NAME(0);
+    label_name = PG_GETARG_NAME(1);
+    load_as_agtype = !PG_ARGISNULL(2) && PG_GETARG_BOOL(2);
+    delimiter = get_delimiter_arg(fcinfo, 3);
+    deferred_indexes = !PG_ARGISNULL(4) && PG_GETARG_BOOL(4);
+    key_property = get_key_property_arg(fcinfo, 5);
+    endpoint_validation = get_endpoint_validation_arg(fcinfo, 6);
+
+    graph_name_str = NameStr(*graph_name);
+    label_name_str = NameStr(*label_name);
+
+    if (strcmp(label_name_str, "") == 0)
+    {
+        label_name_str = AG_DEFAULT_LABEL_EDGE;
+    }
+
+    graph_oid = get_or_create_graph(graph_name);
+    label_id = get_or_create_label(graph_oid, graph_name_str,
+                                   label_name_str, LABEL_KIND_EDGE);
+
+    /* Get the label relation and check permissions */
+    label_relid = get_label_relation(label_name_str, graph_oid);
+    check_table_permissions(label_relid, ACL_INSERT);
+    check_rls_for_load(label_relid);
+
+    if (deferred_indexes)
+    {
+        check_reindex_permission(label_relid);
+    }
+
+    /* a NULL file path reads the data from the client */
+    create_edges_from_csv_file(NULL, graph_name_str, graph_oid,
+                               label_name_str, label_id, load_as_agtype,
+                               delimiter, deferred_indexes, key_property,
+                               endpoint_validation);
+
+    if (deferred_indexes)
+    {
+        rebuild_label_indexes(label_relid);
+    }
+
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(load_labels_from_binary_file);
+Datum load_labels_from_binary_file(PG_FUNCTION_ARGS)
+{
+    Name graph_name;
+    Name label_name;
+    char* graph_name_str;
+    char* label_name_str;
+    char* file_path_str;
+    char **column_names;
+    Oid *column_types;
+    int num_columns;
+    Oid graph_oid;
+    Oid label_relid;
+    int32 label_id;
+    bool id_field_exists;
+
+    if (PG_ARGISNULL(0))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("graph name must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(1))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("label name must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(2))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("file path must not be NULL")));
+    }
+
+    /* Check file read permission first */
+    check_file_read_permission();
+
+    graph_name = PG_GETARG_NAME(0);
+    label_name = PG_GETARG_NAME(1);
+    num_columns = get_binary_load_columns(fcinfo, 3, &column_names,
+                                          &column_types);
+    id_field_exists = PG_ARGISNULL(5) ? true : PG_GETARG_BOOL(5);
+
+    if (id_field_exists)
+    {
+        check_integer_column(column_types[0], column_names[0]);
+    }
+
+    graph_name_str = NameStr(*graph_name);
+    label_name_str = NameStr(*label_name);
+
+    if (strcmp(label_name_str, "") == 0)
+    {
+        label_name_str = AG_DEFAULT_LABEL_VERTEX;
+    }
+
+    file_path_str = build_safe_filename(text_to_cstring(PG_GETARG_TEXT_P(2)),
+                                        AGE_BINARY_FILE_EXTENSION);
+
+    graph_oid = get_or_create_graph(graph_name);
+    label_id = get_or_create_label(graph_oid, graph_name_str,
+                                   label_name_str, LABEL_KIND_VERTEX);
+
+    /* Get the label relation and check permissions */
+    label_relid = get_label_relation(label_name_str, graph_oid);
+    check_table_permissions(label_relid, ACL_INSERT);
+    check_rls_for_load(label_relid);
+
+    create_entities_from_binary_file(file_path_str, graph_oid, label_name_str,
+                                     label_id, LABEL_KIND_VERTEX,
+                                     id_field_exists, column_names,
+                                     column_types, num_columns);
+
+    free(file_path_str);
+
+    PG_RETURN_VOID();
+}
+
+PG_FUNCTION_INFO_V1(load_edges_from_binary_file);
+Datum load_edges_from_binary_file(PG_FUNCTION_ARGS)
+{
+    Name graph_name;
+    Name label_name;
+    char* graph_name_str;
+    char* label_name_str;
+    char* file_path_str;
+    char **column_names;
+    Oid *column_types;
+    int num_columns;
+    Oid graph_oid;
+    Oid label_relid;
+    int32 label_id;
+
+    if (PG_ARGISNULL(0))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("graph name must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(1))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("label name must not be NULL")));
+    }
+
+    if (PG_ARGISNULL(2))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("file path must not be NULL")));
+    }
+
+    /* Check file read permission first */
+    check_file_read_permission();
+
+    graph_name = PG_GETARG_NAME(0);
+    label_name = PG_GETARG_NAME(1);
+    num_columns = get_binary_load_columns(fcinfo, 3, &column_names,
+                                          &column_types);
+
+    /* the four fixed columns, as in edge CSV files */
+    if (num_columns < 4)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("edge file must have at least 4 columns "
+                        "(start_id, start_vertex_type, end_id, "
+                        "end_vertex_type), but %d were given",
+                        num_columns)));
+    }
+    check_integer_column(column_types[0], column_names[0]);
+    check_string_column(column_types[1], column_names[1]);
+    check_integer_column(column_types[2], column_names[2]);
+    check_string_column(column_types[3], column_names[3]);
+
+    graph_name_str = NameStr(*graph_name);
+    label_name_str = NameStr(*label_name);
+
+    if (strcmp(label_name_str, "") == 0)
+    {
+        label_name_str = AG_DEFAULT_LABEL_EDGE;
+    }
+
+    file_path_str = build_safe_filename(text_to_cstring(PG_GETARG_TEXT_P(2)),
+                                        AGE_BINARY_FILE_EXTENSION);
+
+    graph_oid = get_or_create_graph(graph_name);
+    label_id = get_or_create_label(graph_oid, graph_name_str,
+                                   label_name_str, LABEL_KIND_EDGE);
+
+    /* Get the label relation and check permissions */
+    label_relid = get_label_relation(label_name_str, graph_oid);
+    check_table_permissions(label_relid, ACL_INSERT);
+    check_rls_for_load(label_relid);
+
+    create_entities_from_binary_file(file_path_str, graph_oid, label_name_str,
+                                     label_id, LABEL_KIND_EDGE, false,
+                                     column_names, column_types, num_columns);
+
+    free(file_path_str);
+
+    PG_RETURN_VOID();
+}
+
+/* The labels of an export_graph_to_files call and what was written */
+typedef struct export_graph_state
+{
+    graph_export_label *labels;
+    graph_export_result *results;
+} export_graph_state;
+
+/*
+ * Export every label of a graph to files in a directory under /tmp/age/,
+ * returning a row per file with its label, its number of rows and its
+ * columns.
+ */
+PG_FUNCTION_INFO_V1(export_graph_to_files);
+Datum export_graph_to_files(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx;
+    export_graph_state *state;
+
+    if (SRF_IS_FIRSTCALL())
+    {
+        MemoryContext old_context;
+        TupleDesc tupdesc;
+        Name graph_name;
+        char *resolved;
+        char *directory;
+        bool binary;
+        int parallel_workers;
+        Oid graph_oid;
+        int num_labels;
+        int num_results;
+        int i;
+
+        funcctx = SRF_FIRSTCALL_INIT();
+        old_context = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+        if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                     errmsg("function returning record called in context "
+                            "that cannot accept type record")));
+        }
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+        if (PG_ARGISNULL(0))
+        {
+            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("graph name must not be NULL")));
+        }
+
+        if (PG_ARGISNULL(1))
+        {
+            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("directory must not be NULL")));
+        }
+
+        /* Check file write permission first */
+        check_file_write_permission();
+
+        graph_name = PG_GETARG_NAME(0);
+        binary = get_export_format_arg(fcinfo, 2);
+        parallel_workers = get_parallel_workers_arg(fcinfo, 3);
+
+        resolved = build_safe_directory(text_to_cstring(PG_GETARG_TEXT_PP(1)));
+        directory = pstrdup(resolved);
+        free(resolved);
+
+        graph_oid = get_graph_oid(NameStr(*graph_name));
+
+        if (!OidIsValid(graph_oid))
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_UNDEFINED_SCHEMA),
+                     errmsg("graph \"%s\" does not exist",
+                            NameStr(*graph_name))));
+        }
+
+        state = palloc(sizeof(export_graph_state));
+        state->labels = get_graph_export_labels(graph_oid, &num_labels);
+
+        /* Check permissions on every label before writing anything */
+        for (i = 0; i < num_labels; i++)
+        {
+            check_table_permissions(state->labels[i].relid, ACL_SELECT);
+            check_rls_for_export(state->labels[i].relid);
+        }
+
+        state->results = export_graph_labels(directory, state->labels,
+                                             num_labels, binary,
+                                             parallel_workers, &num_results);
+
+        funcctx->user_fctx = state;
+        funcctx->max_calls = num_results;
+
+        MemoryContextSwitchTo(old_context);
+    }
+
+    funcctx = SRF_PERCALL_SETUP();
+    state = funcctx->user_fctx;
+
+    if (funcctx->call_cntr < funcctx->max_calls)
+    {
+        graph_export_result *result = &state->results[funcctx->call_cntr];
+        graph_export_label *label = &state->labels[result->label_index];
+        Datum values[4];
+        bool nulls[4] = {false, false, false, false};
+        Datum *column_names;
+        HeapTuple tuple;
+        int i;
+
+        column_names = palloc(sizeof(Datum) * Max(result->num_columns, 1));
+        for (i = 0; i < result->num_columns; i++)
+        {
+            column_names[i] = CStringGetTextDatum(result->column_names[i]);
+        }
+
+        values[0] = NameGetDatum(&label->name);
+        values[1] = CStringGetTextDatum(result->file_path);
+        values[2] = Int64GetDatum(result->num_rows);
+        values[3] = PointerGetDatum(construct_array(column_names,
+                                                    result->num_columns,
+                                                    TEXTOID, -1, false,
+                                                    TYPALIGN_INT));
+
+        tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+    }
+
+    SRF_RETURN_DONE(funcctx);
+}
+
+/*
+ * Get the optional key_property argument of the edge load functions, NULL
+ * when the endpoints are given as entry ids.
+ */
+static char *get_key_property_arg(FunctionCallInfo fcinfo, int argno)
+{
+    char *key_property;
+
+    if (PG_NARGS() <= argno || PG_ARGISNULL(argno))
+    {
+        return NULL;
+    }
+
+    key_property = text_to_cstring(PG_GETARG_TEXT_PP(argno));
+    if (key_property[0] == '\0')
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("key_property must not be empty")));
+    }
+
+    return key_property;
+}
+
+/*
+ * Get the optional endpoint_validation argument of the edge load functions:
+ * 'none', 'error' or 'skip'.
+ */
+static edge_endpoint_validation get_endpoint_validation_arg(
+    FunctionCallInfo fcinfo, int argno)
+{
+    char *validation;
+
+    if (PG_NARGS() <= argno || PG_ARGISNULL(argno))
+    {
+        return EDGE_ENDPOINT_VALIDATION_NONE;
+    }
+
+    validation = text_to_cstring(PG_GETARG_TEXT_PP(argno));
+
+    if (pg_strcasecmp(validation, "none") == 0)
+    {
+        return EDGE_ENDPOINT_VALIDATION_NONE;
+    }
+    else if (pg_strcasecmp(validation, "error") == 0)
+    {
+        return EDGE_ENDPOINT_VALIDATION_ERROR;
+    }
+    else if (pg_strcasecmp(validation, "skip") == 0)
+    {
+        return EDGE_ENDPOINT_VALIDATION_SKIP;
+    }
+
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("endpoint_validation must be \"none\", \"error\" or "
+                    "\"skip\"")));
+
+    return EDGE_ENDPOINT_VALIDATION_NONE;
+}
+
+/*
+ * Get the optional format argument of export_graph_to_files: 'csv' or
+ * 'binary'. Returns true for binary.
+ */
+static bool get_export_format_arg(FunctionCallInfo fcinfo, int argno)
+{
+    char *format;
+
+    if (PG_NARGS() <= argno || PG_ARGISNULL(argno))
+    {
+        return false;
+    }
+
+    format = text_to_cstring(PG_GETARG_TEXT_PP(argno));
+
+    if (pg_strcasecmp(format, "csv") == 0)
+    {
+        return false;
+    }
+    else if (pg_strcasecmp(format, "binary") == 0)
+    {
+        return true;
+    }
+
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("format must be \"csv\" or \"binary\"")));
+
+    return false;
+}
+
+/*
+ * Get the column_names and column_types arguments of the binary load
+ * functions, which start at argno, and return the number of columns.
+ */
+static int get_binary_load_columns(FunctionCallInfo fcinfo, int argno,
+                                   char ***column_names, Oid **column_types)
+{
+    Datum *name_datums;
+    bool *name_nulls;
+    int num_names;
+    Datum *type_datums;
+    bool *type_nulls;
+    int num_types;
+    int i;
+
+    if (PG_ARGISNULL(argno) || PG_ARGISNULL(argno + 1))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("column names and types must not be NULL")));
+    }
+
+    deconstruct_array(PG_GETARG_ARRAYTYPE_P(argno), TEXTOID, -1, false,
+                      TYPALIGN_INT, &name_datums, &name_nulls, &num_names);
+    deconstruct_array(PG_GETARG_ARRAYTYPE_P(argno + 1), REGTYPEOID,
+                      sizeof(Oid), true, TYPALIGN_INT, &type_datums,
+                      &type_nulls, &num_types);
+
+    if (num_names != num_types)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("column names and types must have the same length")));
+    }
+
+    if (num_names == 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("at least one column must be given")));
+    }
+
+    *column_names = palloc(sizeof(char *) * num_names);
+    *column_types = palloc(sizeof(Oid) * num_names);
+
+    for (i = 0; i < num_names; i++)
+    {
+        if (name_nulls[i] || type_nulls[i])
+        {
+            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("column names and types must not contain NULL")));
+        }
+
+        (*column_names)[i] = TextDatumGetCString(name_datums[i]);
+        (*column_types)[i] = DatumGetObjectId(type_datums[i]);
+    }
+
+    return num_names;
+}
+
+/* Check that an id column of a binary load is an integer */
+static void check_integer_column(Oid type, const char *column)
+{
+    if (type != INT2OID && type != INT4OID && type != INT8OID)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATATYPE_MISMATCH),
+                 errmsg("column \"%s\" must be of type smallint, integer or "
+                        "bigint, not %s", column, format_type_be(type))));
+    }
+}
+
+/* Check that a label name column of a binary load is a string */
+static void check_string_column(Oid type, const char *column)
+{
+    if (type != TEXTOID && type != VARCHAROID)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATATYPE_MISMATCH),
+                 errmsg("column \"%s\" must be of type text or varchar, "
+                        "not %s", column, format_type_be(type))));
+    }
+}
+
+/*
+ * Get the optional delimiter argument of the load functions, ',' when it
+ * is not given.
+ */
+static char get_delimiter_arg(FunctionCallInfo fcinfo, int argno)
+{
+    char *delim_str;
+
+    if (PG_NARGS() <= argno || PG_ARGISNULL(argno))
+    {
+        return ',';
+    }
+
+    delim_str = text_to_cstring(PG_GETARG_TEXT_P(argno));
+    if (strlen(delim_str) != 1)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("delimiter must be a single character")));
+    }
+
+    return delim_str[0];
+}
+
+/*
+ * Get the optional parallel_workers argument of the load functions. Zero, the
+ * default, loads serially.
+ */
+static int get_parallel_workers_arg(FunctionCallInfo fcinfo, int argno)
+{
+    int parallel_workers;
+
+    if (PG_NARGS() <= argno || PG_ARGISNULL(argno))
+    {
+        return 0;
+    }
+
+    parallel_workers = PG_GETARG_INT32(argno);
+
+    if (parallel_workers < 0 || parallel_workers > MAX_PARALLEL_WORKER_LIMIT)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("parallel_workers must be between 0 and %d",
+                        MAX_PARALLEL_WORKER_LIMIT)));
+    }
+
+    return parallel_workers;
+}
+
+/*
+ * Check that the current user may rebuild the indexes of the target table,
+ * as a load with deferred_indexes does.
+ */
+static void check_reindex_permission(Oid relid)
+{
+#if PG_VERSION_NUM >= 170000
+    check_table_permissions(relid, ACL_MAINTAIN);
+#else
+    if (!object_ownercheck(RelationRelationId, relid, GetUserId()))
+    {
+        aclcheck_error(ACLCHECK_NOT_OWNER, OBJECT_TABLE, get_rel_name(relid));
+    }
+#endif
+}
+
+/*
+ * Rebuild the indexes of a label table after a load with deferred_indexes.
+ *
+ * REINDEX builds each index from a sort of the whole table, which is far
+ * cheaper than maintaining it with a random insert per row, and it checks
+ * uniqueness as it goes, so duplicate ids are reported here rather than at
+ * insert time. The rebuild covers the rows that were there before the load
+ * too, so this pays off for initial loads and loads that dwarf the table.
+ */
+static void rebuild_label_indexes(Oid relid)
+{
+    ReindexParams params = {0};
+
+    /* make the loaded rows visible to the index builds */
+    CommandCounterIncrement();
+
+#if PG_VERSION_NUM >= 170000
+    reindex_relation(NULL, relid, REINDEX_REL_CHECK_CONSTRAINTS, &params);
+#else
+    reindex_relation(relid, REINDEX_REL_CHECK_CONSTRAINTS, &params);
+#endif
+}
+
+/*
+ * Helper function to create a graph if it does not exist.
+ * Just returns Oid of the graph if it already exists.
+ */
+static Oid get_or_create_graph(const Name graph_name)
+{
+    Oid graph_oid;
+    char *graph_name_str;
+
+    graph_name_str = NameStr(*graph_name);
+    graph_oid = get_graph_oid(graph_name_str);
+
+    if (OidIsValid(graph_oid))
+    {
+        return graph_oid;
+    }
+
+    graph_oid = create_graph_internal(graph_name);
+    ereport(NOTICE,
+            (errmsg("graph \"%s\" has been created", NameStr(*graph_name))));
+    
+    return graph_oid;
+}
+
+/*
+ * Helper function to create a label if it does not exist.
+ * Just returns label_id of the label if it already exists.
+ */
+static int32 get_or_create_label(Oid graph_oid, char *graph_name,
+                                 char *label_name, char label_kind)
+{
+    int32 label_id;
+
+    label_id = get_label_id(label_name, graph_oid);
+
+    /* Check if label exists */
+    if (label_id_is_valid(label_id))
+    {
+        char *label_kind_full = (label_kind == LABEL_KIND_VERTEX)
+                                ? "vertex" : "edge";
+        char opposite_label_kind = (label_kind == LABEL_KIND_VERTEX)
+                                    ? LABEL_KIND_EDGE : LABEL_KIND_VERTEX;
+
+        /* If it exists, but as another label_kind, throw an error */
+        if (get_label_kind(label_name, graph_oid) == opposite_label_kind)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("label \"%s\" already exists as %s label",
+                            label_name, label_kind_full)));
+        }
+    }
+    else
+    {
+        /* Create a label */
+        RangeVar *rv;
+        List *parent;
+        char *default_label = (label_kind == LABEL_KIND_VERTEX)
+                               ? AG_DEFAULT_LABEL_VERTEX : AG_DEFAULT_LABEL_EDGE;
+        rv = get_label_range_var(graph_name, graph_oid, default_label);
+        parent = list_make1(rv);
+
+        create_label(graph_name, label_name, label_kind, parent);
+        label_id = get_label_id(label_name, graph_oid);
+
+        ereport(NOTICE,
+                (errmsg("VLabel \"%s\" has been created", label_name)));
+    }
+
+    return label_id;
+}
+
+/*
+ * Initialize the batch insert state.
+ */
+/*
+ * Create an executor state with the label table as its only result relation,
+ * opened with RowExclusiveLock and with its indices open. The caller cleans up
+ * with ExecCloseResultRelations, ExecCloseRangeTableRelations, and
+ * FreeExecutorState.
+ */
+static EState *create_label_estate(Oid relid, AclMode required_perms,
+                                   ResultRelInfo **result_rel_info)
+{
+    EState *estate;
+    ResultRelInfo *resultRelInfo;
+    RangeTblEntry *rte;
+    RTEPermissionInfo *perminfo;
+    List *range_table = NIL;
+    List *perminfos = NIL;
+
+    /* Initialize executor state */
+    estate = CreateExecutorState();
+
+    /* Create range table entry for ExecConstraints */
+    rte = makeNode(RangeTblEntry);
+    rte->rtekind = RTE_RELATION;
+    rte->relid = relid;
+    rte->relkind = RELKIND_RELATION;
+    rte->rellockmode = RowExclusiveLock;
+    rte->perminfoindex = 1;
+    range_table = list_make1(rte);
+
+    /* Create permission info */
+    perminfo = makeNode(RTEPermissionInfo);
+    perminfo->relid = relid;
+    perminfo->requiredPerms = required_perms;
+    perminfos = list_make1(perminfo);
+
+    /* Initialize range table in executor state */
+    ExecInitRangeTable(estate, range_table, perminfos, NULL);
+
+    /* Initialize resultRelInfo - this opens the relation */
+    resultRelInfo = makeNode(ResultRelInfo);
+    ExecInitResultRelation(estate, resultRelInfo, 1);
+
+    /* Open the indices */
+    ExecOpenIndices(resultRelInfo, false);
+
+    *result_rel_info = resultRelInfo;
+
+    return estate;
+}
+
+void init_batch_insert(batch_insert_state **batch_state,
+                              char *label_name, Oid graph_oid)
+{
+    Relation relation;
+    Oid relid;
+    EState *estate;
+    ResultRelInfo *resultRelInfo;
+    int i;
+
+    /* Get the relation OID */
+    relid = get_label_relation(label_name, graph_oid);
+
+    /* Initialize executor state and open the relation and its indices */
+    estate = create_label_estate(relid, ACL_INSERT, &resultRelInfo);
+
+    /* Get relation from resultRelInfo (opened by ExecInitResultRelation) */
+    relation = resultRelInfo->ri_RelationDesc;
+
+    /* Initialize the batch insert state */
+    *batch_state = (batch_insert_state *) palloc0(sizeof(batch_insert_state));
+    (*batch_state)->slots = palloc(sizeof(TupleTableSlot *) * BATCH_SIZE);
+    (*batch_state)->estate = estate;
+    (*batch_state)->resultRelInfo = resultRelInfo;
+    (*batch_state)->num_tuples = 0;
+    (*batch_state)->buffered_bytes = 0;
+    (*batch_state)->bistate = GetBulkInsertState();
+
+    /* Create slots */
+    for (i = 0; i < BATCH_SIZE; i++)
+    {
+        (*batch_state)->slots[i] = MakeSingleTupleTableSlot(
+                                            RelationGetDescr(relation),
+                                            &TTSOpsHeapTuple);
+    }
+}
+
+/*
+ * Finish the batch insert for vertices. Insert the
+ * tuples remaining in the batch state and clean up.
+ */
+void finish_batch_insert(batch_insert_state **batch_state)
+{
+    int i;
+
+    if ((*batch_state)->num_tuples > 0)
+    {
+        insert_batch(*batch_state);
+        (*batch_state)->num_tuples = 0;
+    }
+
+    /* Free slots */
+    for (i = 0; i < BATCH_SIZE; i++)
+    {
+        ExecDropSingleTupleTableSlot((*batch_state)->slots[i]);
+    }
+
+    /* Free BulkInsertState */
+    FreeBulkInsertState((*batch_state)->bistate);
+
+    /* Close result relations and range table relations */
+    ExecCloseResultRelations((*batch_state)->estate);
+    ExecCloseRangeTableRelations((*batch_state)->estate);
+
+    /* Clean up executor state */
+    FreeExecutorState((*batch_state)->estate);
+    pfree((*batch_state)->slots);
+    pfree(*batch_state);
+    *batch_state = NULL;
+}
+
+static uint32 vertex_key_hash(const void *key, Size keysize)
+{
+    const vertex_key *k = (const vertex_key *) key;
+
+    return hash_combine(hash_uint32((uint32) k->type),
+                        hash_bytes((const unsigned char *) k->value,
+                                   strlen(k->value)));
+}
+
+static int vertex_key_match(const void *key1, const void *key2, Size keysize)
+{
+    const vertex_key *k1 = (const vertex_key *) key1;
+    const vertex_key *k2 = (const vertex_key *) key2;
+
+    if (k1->type != k2->type)
+    {
+        return 1;
+    }
+
+    return strcmp(k1->value, k2->value);
+}
+
+/*
+ * Get the key of a vertex from its key property, which must be a string or
+ * an integer.
+ */
+static void agtype_value_to_vertex_key(agtype_value *value, char *key_property,
+                                       char *label_name, vertex_key *key)
+{
+    switch (value->type)
+    {
+    case AGTV_STRING:
+        key->type = AGTV_STRING;
+        key->value = pnstrdup(value->val.string.val, value->val.string.len);
+        break;
+    case AGTV_INTEGER:
+        key->type = AGTV_INTEGER;
+        key->value = psprintf(INT64_FORMAT, value->val.int_value);
+        break;
+    default:
+        ereport(ERROR,
+                (errcode(ERRCODE_DATATYPE_MISMATCH),
+                 errmsg("key property \"%s\" of label \"%s\" must be a "
+                        "string or an integer, not %s",
+                        key_property, label_name,
+                        agtype_value_type_to_string(value->type))));
+    }
+}
+
+/*
+ * Get the key in a CSV field, typed the way the loaders type the field as a
+ * property: a string, unless load_as_agtype parses it.
+ */
+void csv_field_to_vertex_key(char *field, bool load_as_agtype,
+                             char *key_property, vertex_key *key)
+{
+    agtype_value *value;
+
+    if (!load_as_agtype)
+    {
+        key->type = AGTV_STRING;
+        key->value = field;
+        return;
+    }
+
+    value = csv_value_to_agtype_value(field);
+    if (value->type != AGTV_STRING && value->type != AGTV_INTEGER)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_DATATYPE_MISMATCH),
+                 errmsg("key property \"%s\" value %s must be a string or "
+                        "an integer", key_property, field)));
+    }
+
+    agtype_value_to_vertex_key(value, key_property, NULL, key);
+}
+
+/*
+ * Check if an index expression is the key property of the vertex, that is
+ * properties.key_property, as agtype_access_operator(properties,
+ * '"key_property"'). The arguments may be in a variadic array.
+ */
+static bool is_key_property_expression(Node *expr, char *key_property)
+{
+    FuncExpr *func;
+    List *args;
+    Var *var;
+    Const *name;
+    agtype *name_agtype;
+    agtype_value *name_value;
+
+    if (!IsA(expr, FuncExpr))
+    {
+        return false;
+    }
+
+    func = (FuncExpr *) expr;
+    if (func->funcid != get_ag_func_oid("agtype_access_operator", 1,
+                                        AGTYPEARRAYOID))
+    {
+        return false;
+    }
+
+    args = func->args;
+    if (list_length(args) == 1 && IsA(linitial(args), ArrayExpr))
+    {
+        args = ((ArrayExpr *) linitial(args))->elements;
+    }
+    if (list_length(args) != 2 || !IsA(linitial(args), Var) ||
+        !IsA(lsecond(args), Const))
+    {
+        return false;
+    }
+
+    var = linitial(args);
+    name = lsecond(args);
+    if (var->varattno != Anum_ag_label_vertex_table_properties ||
+        name->constisnull || name->consttype != AGTYPEOID)
+    {
+        return false;
+    }
+
+    name_agtype = DATUM_GET_AGTYPE_P(name->constvalue);
+    if (!AGT_ROOT_IS_SCALAR(name_agtype))
+    {
+        return false;
+    }
+
+    name_value = get_ith_agtype_value_from_container(&name_agtype->root, 0);
+
+    return (name_value->type == AGTV_STRING &&
+            name_value->val.string.len == strlen(key_property) &&
+            strncmp(name_value->val.string.val, key_property,
+                    name_value->val.string.len) == 0);
+}
+
+/*
+ * Find a valid btree index of a vertex label whose first column is the key
+ * property, or return InvalidOid.
+ */
+static Oid find_key_property_index(Relation relation, char *key_property)
+{
+    List *index_list = RelationGetIndexList(relation);
+    ListCell *lc;
+    Oid index_oid = InvalidOid;
+
+    foreach(lc, index_list)
+    {
+        Relation index_relation = index_open(lfirst_oid(lc), AccessShareLock);
+        List *expressions;
+
+        if (index_relation->rd_index->indisvalid &&
+            index_relation->rd_rel->relam == BTREE_AM_OID &&
+            index_relation->rd_index->indkey.values[0] == 0 &&
+            RelationGetIndexPredicate(index_relation) == NIL)
+        {
+            expressions = RelationGetIndexExpressions(index_relation);
+
+            if (expressions != NIL &&
+                is_key_property_expression(linitial(expressions),
+                                           key_property))
+            {
+                index_oid = lfirst_oid(lc);
+            }
+        }
+
+        index_close(index_relation, AccessShareLock);
+
+        if (OidIsValid(index_oid))
+        {
+            break;
+        }
+    }
+
+    list_free(index_list);
+
+    return index_oid;
+}
+
+/* Add the key of every vertex of the label to the map, with one scan */
+static void read_vertex_keys(vertex_key_map *map, Relation relation)
+{
+    TupleTableSlot *slot;
+    TableScanDesc scan;
+    MemoryContext row_context;
+    MemoryContext old_context;
+    agtype_value key_name;
+
+    key_name.type = AGTV_STRING;
+    key_name.val.string.val = map->key_property;
+    key_name.val.string.len = strlen(map->key_property);
+
+    row_context = AllocSetContextCreate(CurrentMemoryContext,
+                                        "load vertex key row",
+                                        ALLOCSET_DEFAULT_SIZES);
+
+    slot = table_slot_create(relation, NULL);
+    scan = table_beginscan(relation, GetActiveSnapshot(), 0, NULL);
+
+    while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+    {
+        agtype *properties;
+        agtype_value *value;
+        vertex_key key;
+        graphid id;
+        bool isnull;
+        Datum datum;
+
+        CHECK_FOR_INTERRUPTS();
+
+        MemoryContextReset(row_context);
+        old_context = MemoryContextSwitchTo(row_context);
+
+        id = DATUM_GET_GRAPHID(slot_getattr(slot,
+                                            Anum_ag_label_vertex_table_id,
+                                            &isnull));
+        datum = slot_getattr(slot, Anum_ag_label_vertex_table_properties,
+                             &isnull);
+        if (isnull)
+        {
+            MemoryContextSwitchTo(old_context);
+            continue;
+        }
+
+        properties = DATUM_GET_AGTYPE_P(datum);
+        value = find_agtype_value_from_container(&properties->root,
+                                                 AGT_FOBJECT, &key_name);
+        if (value == NULL || value->type == AGTV_NULL)
+        {
+            MemoryContextSwitchTo(old_context);
+            continue;
+        }
+
+        agtype_value_to_vertex_key(value, map->key_property, map->label_name,
+                                   &key);
+
+        MemoryContextSwitchTo(old_context);
+
+        add_vertex_key(map, &key, id);
+    }
+
+    table_endscan(scan);
+    ExecDropSingleTupleTableSlot(slot);
+    MemoryContextDelete(row_context);
+}
+
+/*
+ * Map the key property of the vertices of a label to their graphids.
+ * Vertices without the property are left out; two vertices with the same key
+ * are an error, as a key could not tell them apart. The label is read
+ * directly, so callers check that it can be read as a whole.
+ *
+ * With a btree index on the key property, nothing is read up front. Each
+ * key is probed in the index the first time it is looked up, which touches
+ * a few pages per key instead of the whole label. Only the vertices with
+ * keys that are looked up are then checked for duplicates.
+ */
+vertex_key_map *create_vertex_key_map(Oid graph_oid, char *label_name,
+                                      char *key_property, MemoryContext mcxt)
+{
+    HASHCTL hash_ctl;
+    vertex_key_map *map;
+    MemoryContext old_context;
+    Relation relation;
+    Oid relid;
+    Oid index_oid;
+
+    relid = get_label_relation(label_name, graph_oid);
+    if (!OidIsValid(relid) ||
+        get_label_kind(label_name, graph_oid) != LABEL_KIND_VERTEX)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_OBJECT),
+                 errmsg("vertex label \"%s\" does not exist", label_name)));
+    }
+
+    old_context = MemoryContextSwitchTo(mcxt);
+
+    map = palloc0(sizeof(vertex_key_map));
+    map->mcxt = mcxt;
+    map->label_name = pstrdup(label_name);
+    map->key_property = pstrdup(key_property);
+
+    MemSet(&hash_ctl, 0, sizeof(hash_ctl));
+    hash_ctl.keysize = sizeof(vertex_key);
+    hash_ctl.entrysize = sizeof(vertex_key_entry);
+    hash_ctl.hash = vertex_key_hash;
+    hash_ctl.match = vertex_key_match;
+    hash_ctl.hcxt = mcxt;
+    map->keys = hash_create("load vertex keys", 1024, &hash_ctl,
+                            HASH_ELEM | HASH_FUNCTION | HASH_COMPARE |
+                            HASH_CONTEXT);
+
+    MemoryContextSwitchTo(old_context);
+
+    relation = table_open(relid, AccessShareLock);
+    index_oid = find_key_property_index(relation, key_property);
+
+    if (!OidIsValid(index_oid))
+    {
+        read_vertex_keys(map, relation);
+        table_close(relation, AccessShareLock);
+
+        return map;
+    }
+
+    map->relation = relation;
+    map->index_relation = index_open(index_oid, AccessShareLock);
+    map->eq_proc = get_opcode(
+        get_opfamily_member(map->index_relation->rd_opfamily[0],
+                            map->index_relation->rd_opcintype[0],
+                            map->index_relation->rd_opcintype[0],
+                            BTEqualStrategyNumber));
+    map->snapshot = RegisterSnapshot(GetActiveSnapshot());
+    map->slot = table_slot_create(relation, NULL);
+    map->index_scan = index_beginscan(relation, map->index_relation,
+                                      map->snapshot, NULL, 1, 0);
+    map->probe_context = AllocSetContextCreate(mcxt, "load vertex key probe",
+                                               ALLOCSET_DEFAULT_SIZES);
+
+    return map;
+}
+
+/*
+ * Look up the vertex with the given key in the index, and add it to the map
+ * if there is one.
+ */
+static vertex_key_entry *probe_vertex_key(vertex_key_map *map,
+                                          vertex_key *key)
+{
+    ScanKeyData scan_key;
+    MemoryContext old_context;
+    agtype_value key_name;
+    agtype_value *key_value;
+    graphid id = 0;
+    bool found = false;
+
+    MemoryContextReset(map->probe_context);
+    old_context = MemoryContextSwitchTo(map->probe_context);
+
+    key_name.type = AGTV_STRING;
+    key_name.val.string.val = map->key_property;
+    key_name.val.string.len = strlen(map->key_property);
+
+    key_value = (key->type == AGTV_STRING) ?
+        string_to_agtype_value(key->value) :
+        integer_to_agtype_value(pg_strtoint64(key->value));
+
+    ScanKeyInit(&scan_key, 1, BTEqualStrategyNumber, map->eq_proc,
+                AGTYPE_P_GET_DATUM(agtype_value_to_agtype(key_value)));
+    index_rescan(map->index_scan, &scan_key, 1, NULL, 0);
+
+    while (index_getnext_slot(map->index_scan, ForwardScanDirection,
+                              map->slot))
+    {
+        agtype *properties;
+        agtype_value *value;
+        vertex_key found_key;
+        bool isnull;
+        Datum datum;
+
+        CHECK_FOR_INTERRUPTS();
+
+        datum = slot_getattr(map->slot, Anum_ag_label_vertex_table_properties,
+                             &isnull);
+        if (isnull)
+        {
+            continue;
+        }
+
+        properties = DATUM_GET_AGTYPE_P(datum);
+        value = find_agtype_value_from_container(&properties->root,
+                                                 AGT_FOBJECT, &key_name);
+        if (value == NULL || value->type == AGTV_NULL)
+        {
+            continue;
+        }
+
+        /* the index compares numbers across types, the map doesn't */
+        agtype_value_to_vertex_key(value, map->key_property, map->label_name,
+                                   &found_key);
+        if (vertex_key_match(&found_key, key, sizeof(vertex_key)) != 0)
+        {
+            continue;
+        }
+
+        if (found)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_UNIQUE_VIOLATION),
+                     errmsg("key property \"%s\" of label \"%s\" has the "
+                            "duplicate value \"%s\"",
+                            map->key_property, map->label_name, key->value)));
+        }
+
+        id = DATUM_GET_GRAPHID(slot_getattr(map->slot,
+                                            Anum_ag_label_vertex_table_id,
+                                            &isnull));
+        found = true;
+    }
+
+    MemoryContextSwitchTo(old_context);
+
+    return found ? add_vertex_key(map, key, id) : NULL;
+}
+
+/*
+ * Find the vertex with the given key, or return NULL if there is none.
+ */
+vertex_key_entry *find_vertex_key(vertex_key_map *map, vertex_key *key)
+{
+    vertex_key_entry *entry;
+
+    entry = hash_search(map->keys, key, HASH_FIND, NULL);
+    if (entry == NULL && map->index_scan != NULL)
+    {
+        entry = probe_vertex_key(map, key);
+    }
+
+    return entry;
+}
+
+/*
+ * Add the vertex with the given key to the map. A key that is already in the
+ * map is an error.
+ */
+vertex_key_entry *add_vertex_key(vertex_key_map *map, vertex_key *key,
+                                 graphid id)
+{
+    vertex_key_entry *entry;
+    bool found;
+
+    entry = hash_search(map->keys, key, HASH_ENTER, &found);
+    if (found)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_UNIQUE_VIOLATION),
+                 errmsg("key property \"%s\" of label \"%s\" has the "
+                        "duplicate value \"%s\"",
+                        map->key_property, map->label_name, key->value)));
+    }
+
+    entry->key.type = key->type;
+    entry->key.value = MemoryContextStrdup(map->mcxt, key->value);
+    entry->id = id;
+
+    return entry;
+}
+
+/*
+ * End the index scan of a map, if it has one. The map's memory belongs to
+ * its memory context.
+ */
+void free_vertex_key_map(vertex_key_map *map)
+{
+    if (map->index_scan == NULL)
+    {
+        return;
+    }
+
+    index_endscan(map->index_scan);
+    ExecDropSingleTupleTableSlot(map->slot);
+    UnregisterSnapshot(map->snapshot);
+    index_close(map->index_relation, AccessShareLock);
+    table_close(map->relation, AccessShareLock);
+
+    map->index_scan = NULL;
+}
+
+/*
+ * Bulk write back of vertex properties, for age_write_vertex_property and
+ * upsert_labels_from_file.
+ *
+ * The updates are deduplicated, grouped by label (the label id is the high
+ * part of the graphid, so sorting by id groups them), located, and then
+ * applied in physical (TID) order. That way each heap page is visited once,
+ * and updates that leave the indexed columns alone can stay HOT.
+ */
+
+/* sort by vertex id, then input position */
+static int compare_vertex_property_update_ids(const void *a, const void *b)
+{
+    const vertex_property_update *ua = (const vertex_property_update *) a;
+    const vertex_property_update *ub = (const vertex_property_update *) b;
+
+    if (ua->vertex_id != ub->vertex_id)
+    {
+        return (ua->vertex_id < ub->vertex_id) ? -1 : 1;
+    }
+
+    if (ua->position != ub->position)
+    {
+        return (ua->position < ub->position) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/* sort or search by vertex id only */
+static int compare_vertex_property_update_id_only(const void *a, const void *b)
+{
+    const vertex_property_update *ua = (const vertex_property_update *) a;
+    const vertex_property_update *ub = (const vertex_property_update *) b;
+
+    if (ua->vertex_id != ub->vertex_id)
+    {
+        return (ua->vertex_id < ub->vertex_id) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+static int compare_vertex_property_update_tids(const void *a, const void *b)
+{
+    const vertex_property_update *ua = (const vertex_property_update *) a;
+    const vertex_property_update *ub = (const vertex_property_update *) b;
+
+    return ItemPointerCompare((ItemPointer) &ua->tid,
+                              (ItemPointer) &ub->tid);
+}
+
+/*
+ * Return a copy of the properties object with property_name set to value. A
+ * NULL value, or an agtype null, removes the property instead. The existing
+ * values are passed through without being deserialized.
+ */
+static agtype *set_agtype_property(agtype *properties, char *property_name,
+                                   agtype *value)
+{
+    agtype_iterator *it = NULL;
+    agtype_iterator_token tok = WAGT_DONE;
+    agtype_in_state result;
+    agtype_value r;
+    bool remove_property = (value == NULL || is_agtype_null(value));
+    int property_name_len = strlen(property_name);
+
+    memset(&result, 0, sizeof(agtype_in_state));
+
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                   NULL);
+
+    if (properties != NULL && AGT_ROOT_IS_OBJECT(properties))
+    {
+        it = agtype_iterator_init(&properties->root);
+
+        /* skip the begin object token */
+        tok = agtype_iterator_next(&it, &r, true);
+
+        while ((tok = agtype_iterator_next(&it, &r, true)) == WAGT_KEY)
+        {
+            bool is_property = (r.val.string.len == property_name_len &&
+                                strncmp(r.val.string.val, property_name,
+                                        property_name_len) == 0);
+
+            if (is_property)
+            {
+                /* skip the old value, the new one is added below */
+                tok = agtype_iterator_next(&it, &r, true);
+                continue;
+            }
+
+            result.res = push_agtype_value(&result.parse_state, WAGT_KEY, &r);
+            tok = agtype_iterator_next(&it, &r, true);
+            result.res = push_agtype_value(&result.parse_state, WAGT_VALUE,
+                                           &r);
+        }
+    }
+
+    if (!remove_property)
+    {
+        agtype_value *agtv_value = NULL;
+
+        result.res = push_agtype_value(&result.parse_state, WAGT_KEY,
+                                       string_to_agtype_value(property_name));
+
+        if (AGTYPE_CONTAINER_IS_SCALAR(&value->root))
+        {
+            agtv_value = get_ith_agtype_value_from_container(&value->root, 0);
+        }
+        else
         {
-            ereport(ERROR,
-                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-                     errmsg("label \"%s\" already exists as %s label",
-                            label_name, label_kind_full)));
+            agtv_value = agtype_composite_to_agtype_value_binary(value);
         }
+
+        result.res = push_agtype_value(&result.parse_state, WAGT_VALUE,
+                                       agtv_value);
     }
-    else
+
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT, NULL);
+
+    return agtype_value_to_agtype(result.res);
+}
+
+/*
+ * Return a copy of the properties object with the properties of
+ * new_properties added, replacing those with the same names, as SET += does.
+ */
+static agtype *merge_agtype_properties(agtype *properties,
+                                       agtype *new_properties)
+{
+    agtype_iterator *it = NULL;
+    agtype_iterator_token tok = WAGT_DONE;
+    agtype_in_state result;
+    agtype_value r;
+
+    memset(&result, 0, sizeof(agtype_in_state));
+
+    result.res = push_agtype_value(&result.parse_state, WAGT_BEGIN_OBJECT,
+                                   NULL);
+
+    if (properties != NULL && AGT_ROOT_IS_OBJECT(properties))
     {
-        /* Create a label */
-        RangeVar *rv;
-        List *parent;
-        char *default_label = (label_kind == LABEL_KIND_VERTEX)
-                               ? AG_DEFAULT_LABEL_VERTEX : AG_DEFAULT_LABEL_EDGE;
-        rv = get_label_range_var(graph_name, graph_oid, default_label);
-        parent = list_make1(rv);
+        it = agtype_iterator_init(&properties->root);
 
-        create_label(graph_name, label_name, label_kind, parent);
-        label_id = get_label_id(label_name, graph_oid);
+        /* skip the begin object token */
+        tok = agtype_iterator_next(&it, &r, true);
 
-        ereport(NOTICE,
-                (errmsg("VLabel \"%s\" has been created", label_name)));
+        while ((tok = agtype_iterator_next(&it, &r, true)) == WAGT_KEY)
+        {
+            if (find_agtype_value_from_container(&new_properties->root,
+                                                 AGT_FOBJECT, &r) != NULL)
+            {
+                /* skip the old value, the new one is added below */
+                tok = agtype_iterator_next(&it, &r, true);
+                continue;
+            }
+
+            result.res = push_agtype_value(&result.parse_state, WAGT_KEY, &r);
+            tok = agtype_iterator_next(&it, &r, true);
+            result.res = push_agtype_value(&result.parse_state, WAGT_VALUE,
+                                           &r);
+        }
     }
 
-    return label_id;
+    it = agtype_iterator_init(&new_properties->root);
+
+    /* skip the begin object token */
+    tok = agtype_iterator_next(&it, &r, true);
+
+    while ((tok = agtype_iterator_next(&it, &r, true)) == WAGT_KEY)
+    {
+        result.res = push_agtype_value(&result.parse_state, WAGT_KEY, &r);
+        tok = agtype_iterator_next(&it, &r, true);
+        result.res = push_agtype_value(&result.parse_state, WAGT_VALUE, &r);
+    }
+
+    result.res = push_agtype_value(&result.parse_state, WAGT_END_OBJECT, NULL);
+
+    return agtype_value_to_agtype(result.res);
 }
 
 /*
- * Initialize the batch insert state.
+ * Write the updates for one vertex label. The updates are sorted by vertex
+ * id on entry and are re-sorted by TID here. Returns the number of vertices
+ * updated. Updates for vertices that no longer exist are skipped, as SET
+ * would skip them.
  */
-void init_batch_insert(batch_insert_state **batch_state,
-                              char *label_name, Oid graph_oid)
+static int64 write_label_vertex_properties(label_cache_data *lcd,
+                                           char *property_name,
+                                           vertex_property_update *updates,
+                                           int64 num_updates)
 {
-    Relation relation;
-    Oid relid;
-    EState *estate;
-    ResultRelInfo *resultRelInfo;
-    RangeTblEntry *rte;
-    RTEPermissionInfo *perminfo;
-    List *range_table = NIL;
-    List *perminfos = NIL;
-    int i;
+    EState *estate = NULL;
+    ResultRelInfo *resultRelInfo = NULL;
+    Relation relation = NULL;
+    TupleTableSlot *old_slot = NULL;
+    TupleTableSlot *new_slot = NULL;
+    Snapshot snapshot = GetActiveSnapshot();
+    MemoryContext row_context = NULL;
+    MemoryContext old_context = NULL;
+    Oid index_oid = InvalidOid;
+    int natts = 0;
+    int64 num_found = 0;
+    int64 num_updated = 0;
+    int64 i = 0;
+
+    check_table_permissions(lcd->relation, ACL_UPDATE);
+
+    if (check_enable_rls(lcd->relation, InvalidOid, true) == RLS_ENABLED)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("write_vertex_property is not supported with row-level security"),
+                 errhint("Use Cypher SET clause instead.")));
+    }
 
-    /* Get the relation OID */
-    relid = get_label_relation(label_name, graph_oid);
+    estate = create_label_estate(lcd->relation, ACL_UPDATE, &resultRelInfo);
+    estate->es_snapshot = snapshot;
+    relation = resultRelInfo->ri_RelationDesc;
+    natts = RelationGetDescr(relation)->natts;
+
+    old_slot = table_slot_create(relation, NULL);
+    new_slot = MakeSingleTupleTableSlot(RelationGetDescr(relation),
+                                        &TTSOpsVirtual);
+
+    /*
+     * Locate the current tuples. Each index probe costs about one random page
+     * read, while a scan reads every page once, so the index is only used
+     * when there are fewer updates than pages.
+     */
+    index_oid = find_usable_btree_index_for_attr(relation,
+                                                 Anum_ag_label_vertex_table_id);
+
+    if (OidIsValid(index_oid) &&
+        num_updates < RelationGetNumberOfBlocks(relation))
+    {
+        Relation index_relation;
+        IndexScanDesc index_scan;
+        ScanKeyData scan_keys[1];
 
-    /* Initialize executor state */
-    estate = CreateExecutorState();
+        index_relation = index_open(index_oid, RowExclusiveLock);
+        index_scan = index_beginscan(relation, index_relation, snapshot,
+                                     NULL, 1, 0);
 
-    /* Create range table entry for ExecConstraints */
-    rte = makeNode(RangeTblEntry);
-    rte->rtekind = RTE_RELATION;
-    rte->relid = relid;
-    rte->relkind = RELKIND_RELATION;
-    rte->rellockmode = RowExclusiveLock;
-    rte->perminfoindex = 1;
-    range_table = list_make1(rte);
+        for (i = 0; i < num_updates; i++)
+        {
+            ScanKeyInit(&scan_keys[0], Anum_ag_label_vertex_table_id,
+                        BTEqualStrategyNumber, F_GRAPHIDEQ,
+                        GRAPHID_GET_DATUM(updates[i].vertex_id));
+            index_rescan(index_scan, scan_keys, 1, NULL, 0);
 
-    /* Create permission info */
-    perminfo = makeNode(RTEPermissionInfo);
-    perminfo->relid = relid;
-    perminfo->requiredPerms = ACL_INSERT;
-    perminfos = list_make1(perminfo);
+            if (index_getnext_slot(index_scan, ForwardScanDirection,
+                                   old_slot))
+            {
+                updates[i].tid = old_slot->tts_tid;
+            }
+        }
 
-    /* Initialize range table in executor state */
-    ExecInitRangeTable(estate, range_table, perminfos, NULL);
+        index_endscan(index_scan);
+        index_close(index_relation, RowExclusiveLock);
+    }
+    else
+    {
+        TableScanDesc scan;
 
-    /* Initialize resultRelInfo - this opens the relation */
-    resultRelInfo = makeNode(ResultRelInfo);
-    ExecInitResultRelation(estate, resultRelInfo, 1);
+        scan = table_beginscan(relation, snapshot, 0, NULL);
 
-    /* Get relation from resultRelInfo (opened by ExecInitResultRelation) */
-    relation = resultRelInfo->ri_RelationDesc;
+        while (table_scan_getnextslot(scan, ForwardScanDirection, old_slot))
+        {
+            vertex_property_update key;
+            vertex_property_update *update = NULL;
+            bool isnull;
 
-    /* Open the indices */
-    ExecOpenIndices(resultRelInfo, false);
+            CHECK_FOR_INTERRUPTS();
 
-    /* Initialize the batch insert state */
-    *batch_state = (batch_insert_state *) palloc0(sizeof(batch_insert_state));
-    (*batch_state)->slots = palloc(sizeof(TupleTableSlot *) * BATCH_SIZE);
-    (*batch_state)->estate = estate;
-    (*batch_state)->resultRelInfo = resultRelInfo;
-    (*batch_state)->num_tuples = 0;
-    (*batch_state)->buffered_bytes = 0;
-    (*batch_state)->bistate = GetBulkInsertState();
+            key.vertex_id = DATUM_GET_GRAPHID(
+                slot_getattr(old_slot, Anum_ag_label_vertex_table_id,
+                             &isnull));
+            key.position = 0;
 
-    /* Create slots */
-    for (i = 0; i < BATCH_SIZE; i++)
+            update = bsearch(&key, updates, num_updates,
+                             sizeof(vertex_property_update),
+                             compare_vertex_property_update_id_only);
+            if (update != NULL)
+            {
+                update->tid = old_slot->tts_tid;
+            }
+        }
+
+        table_endscan(scan);
+    }
+
+    /* keep the updates that were found, in TID order */
+    for (i = 0; i < num_updates; i++)
     {
-        (*batch_state)->slots[i] = MakeSingleTupleTableSlot(
-                                            RelationGetDescr(relation),
-                                            &TTSOpsHeapTuple);
+        if (ItemPointerIsValid(&updates[i].tid))
+        {
+            updates[num_found++] = updates[i];
+        }
+    }
+
+    qsort(updates, num_found, sizeof(vertex_property_update),
+          compare_vertex_property_update_tids);
+
+    row_context = AllocSetContextCreate(CurrentMemoryContext,
+                                        "write_vertex_property row",
+                                        ALLOCSET_DEFAULT_SIZES);
+
+    for (i = 0; i < num_found; i++)
+    {
+        vertex_property_update *update = &updates[i];
+        TU_UpdateIndexes update_indexes;
+        agtype *properties = NULL;
+        agtype *value = NULL;
+        Datum datum;
+        bool isnull;
+
+        CHECK_FOR_INTERRUPTS();
+
+        MemoryContextReset(row_context);
+        old_context = MemoryContextSwitchTo(row_context);
+
+        if (!table_tuple_fetch_row_version(relation, &update->tid, snapshot,
+                                           old_slot))
+        {
+            MemoryContextSwitchTo(old_context);
+            continue;
+        }
+
+        datum = slot_getattr(old_slot, Anum_ag_label_vertex_table_properties,
+                             &isnull);
+        if (!isnull)
+        {
+            properties = DATUM_GET_AGTYPE_P(datum);
+        }
+
+        if (!update->value_isnull)
+        {
+            value = DATUM_GET_AGTYPE_P(update->value);
+        }
+
+        /* the new tuple is the old one with only the properties replaced */
+        slot_getallattrs(old_slot);
+        ExecClearTuple(new_slot);
+        memcpy(new_slot->tts_values, old_slot->tts_values,
+               natts * sizeof(Datum));
+        memcpy(new_slot->tts_isnull, old_slot->tts_isnull,
+               natts * sizeof(bool));
+        if (property_name == NULL)
+        {
+            new_slot->tts_values[vertex_tuple_properties] =
+                AGTYPE_P_GET_DATUM(merge_agtype_properties(properties, value));
+        }
+        else
+        {
+            new_slot->tts_values[vertex_tuple_properties] =
+                AGTYPE_P_GET_DATUM(set_agtype_property(properties,
+                                                       property_name, value));
+        }
+        new_slot->tts_isnull[vertex_tuple_properties] = false;
+        ExecStoreVirtualTuple(new_slot);
+
+        if (relation->rd_att->constr != NULL)
+        {
+            if (relation->rd_att->constr->has_generated_stored)
+            {
+                new_slot->tts_tableOid = RelationGetRelid(relation);
+                ExecComputeStoredGenerated(resultRelInfo, estate, new_slot,
+                                           CMD_UPDATE);
+            }
+
+            ExecConstraints(resultRelInfo, new_slot, estate);
+        }
+
+        simple_table_tuple_update(relation, &update->tid, new_slot, snapshot,
+                                  &update_indexes);
+
+        /* HOT updates don't need new index entries */
+        if (resultRelInfo->ri_NumIndices > 0 && update_indexes != TU_None)
+        {
+            ExecInsertIndexTuples(resultRelInfo, new_slot, estate, true,
+                                  false, NULL, NIL,
+                                  (update_indexes == TU_Summarizing));
+        }
+
+        MemoryContextSwitchTo(old_context);
+
+        num_updated++;
     }
+
+    MemoryContextDelete(row_context);
+
+    ExecDropSingleTupleTableSlot(old_slot);
+    ExecDropSingleTupleTableSlot(new_slot);
+
+    ExecCloseResultRelations(estate);
+    ExecCloseRangeTableRelations(estate);
+    FreeExecutorState(estate);
+
+    return num_updated;
 }
 
+PG_FUNCTION_INFO_V1(age_write_vertex_property);
+
 /*
- * Finish the batch insert for vertices. Insert the
- * tuples remaining in the batch state and clean up.
+ * age_write_vertex_property(graph_name, property_name, vertex_ids,
+ *                           property_values)
+ *
+ * Sets property_name on each vertex in vertex_ids to the matching entry of
+ * property_values, in bulk. A NULL value removes the property. If a vertex id
+ * is repeated, the last value wins. Returns the number of vertices updated.
  */
-void finish_batch_insert(batch_insert_state **batch_state)
+Datum age_write_vertex_property(PG_FUNCTION_ARGS)
 {
-    int i;
+    Name graph_name;
+    char *property_name;
+    ArrayType *vertex_ids;
+    ArrayType *property_values;
+    Datum *id_datums;
+    bool *id_nulls;
+    Datum *value_datums;
+    bool *value_nulls;
+    int num_ids;
+    int num_values;
+    vertex_property_update *updates;
+    Oid graph_oid;
+    int64 num_updated = 0;
+    int64 i;
 
-    if ((*batch_state)->num_tuples > 0)
+    if (PG_ARGISNULL(0))
     {
-        insert_batch(*batch_state);
-        (*batch_state)->num_tuples = 0;
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("graph name must not be NULL")));
     }
 
-    /* Free slots */
-    for (i = 0; i < BATCH_SIZE; i++)
+    if (PG_ARGISNULL(1))
     {
-        ExecDropSingleTupleTableSlot((*batch_state)->slots[i]);
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("property name must not be NULL")));
     }
 
-    /* Free BulkInsertState */
-    FreeBulkInsertState((*batch_state)->bistate);
+    if (PG_ARGISNULL(2) || PG_ARGISNULL(3))
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("vertex ids and property values must not be NULL")));
+    }
 
-    /* Close result relations and range table relations */
-    ExecCloseResultRelations((*batch_state)->estate);
-    ExecCloseRangeTableRelations((*batch_state)->estate);
+    graph_name = PG_GETARG_NAME(0);
+    property_name = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    vertex_ids = PG_GETARG_ARRAYTYPE_P(2);
+    property_values = PG_GETARG_ARRAYTYPE_P(3);
 
-    /* Clean up executor state */
-    FreeExecutorState((*batch_state)->estate);
-    pfree((*batch_state)->slots);
-    pfree(*batch_state);
-    *batch_state = NULL;
+    if (strlen(property_name) == 0)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("property name must not be empty")));
+    }
+
+    graph_oid = get_graph_oid(NameStr(*graph_name));
+
+    if (!OidIsValid(graph_oid))
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_UNDEFINED_SCHEMA),
+                 errmsg("graph \"%s\" does not exist", NameStr(*graph_name))));
+    }
+
+    deconstruct_array(vertex_ids, GRAPHIDOID, sizeof(graphid),
+                      FLOAT8PASSBYVAL, TYPALIGN_DOUBLE, &id_datums, &id_nulls,
+                      &num_ids);
+    deconstruct_array(property_values, AGTYPEOID, -1, false, TYPALIGN_INT,
+                      &value_datums, &value_nulls, &num_values);
+
+    if (num_ids != num_values)
+    {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                errmsg("vertex ids and property values must have the same length")));
+    }
+
+    if (num_ids == 0)
+    {
+        PG_RETURN_INT64(0);
+    }
+
+    updates = palloc_extended(sizeof(vertex_property_update) * num_ids,
+                              MCXT_ALLOC_HUGE);
+
+    for (i = 0; i < num_ids; i++)
+    {
+        if (id_nulls[i])
+        {
+            ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("vertex ids must not contain NULL")));
+        }
+
+        updates[i].vertex_id = DATUM_GET_GRAPHID(id_datums[i]);
+        updates[i].position = i;
+        updates[i].value = value_datums[i];
+        updates[i].value_isnull = value_nulls[i];
+        ItemPointerSetInvalid(&updates[i].tid);
+    }
+
+    pfree(id_datums);
+    pfree(id_nulls);
+
+    num_updated = write_vertex_property_updates(graph_oid, property_name,
+                                                updates, num_ids);
+
+    pfree(updates);
+
+    if (num_updated > 0)
+    {
+        /*
+         * The tuples are updated directly, which fires no triggers, so the
+         * graph caches, which still point at the old tuples, are invalidated
+         * here.
+         */
+        increment_graph_version(graph_oid);
+    }
+
+    PG_RETURN_INT64(num_updated);
+}
+
+/*
+ * Apply vertex property updates, which may be in any order and for any
+ * vertex labels of the graph. With a NULL property_name, each value is an
+ * object of properties merged into the vertex's. If a vertex is updated more
+ * than once, the last update wins. Returns the number of vertices updated,
+ * and makes the updates visible.
+ */
+int64 write_vertex_property_updates(Oid graph_oid, char *property_name,
+                                    vertex_property_update *updates,
+                                    int64 num_input)
+{
+    int64 num_updates = 0;
+    int64 num_updated = 0;
+    int64 start = 0;
+    int64 i;
+
+    /* sort by id and keep only the last update of each vertex */
+    qsort(updates, num_input, sizeof(vertex_property_update),
+          compare_vertex_property_update_ids);
+
+    for (i = 0; i < num_input; i++)
+    {
+        if (i + 1 < num_input &&
+            updates[i + 1].vertex_id == updates[i].vertex_id)
+        {
+            continue;
+        }
+
+        updates[num_updates++] = updates[i];
+    }
+
+    /* write each label's run of updates */
+    while (start < num_updates)
+    {
+        int32 label_id = get_graphid_label_id(updates[start].vertex_id);
+        label_cache_data *lcd = NULL;
+        int64 end = start + 1;
+
+        while (end < num_updates &&
+               get_graphid_label_id(updates[end].vertex_id) == label_id)
+        {
+            end++;
+        }
+
+        lcd = search_label_graph_oid_cache(graph_oid, label_id);
+
+        if (lcd != NULL && lcd->kind != LABEL_KIND_VERTEX)
+        {
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("%ld is not a vertex id",
+                            updates[start].vertex_id)));
+        }
+
+        /* there are no vertices to update in a label that doesn't exist */
+        if (lcd != NULL)
+        {
+            num_updated += write_label_vertex_properties(lcd, property_name,
+                                                         &updates[start],
+                                                         end - start);
+        }
+
+        start = end;
+    }
+
+    if (num_updated > 0)
+    {
+        /* make the updates visible */
+        CommandCounterIncrement();
+    }
+
+    return num_updated;
 }
@@ -39,6 +39,14 @@
  */
 extern bool age_enable_containment;
 
+/*
+ * The whole-graph algorithms that can run in parallel only do so for graphs
+ * of at least this many vertices plus edges (after the edge type filter).
+ * Below it, starting the workers and copying the graph into shared memory
+ * costs more than the algorithm itself.
+ */
+extern int age_min_parallel_graph_size;
+
 void define_config_params(void);
 
 #endif
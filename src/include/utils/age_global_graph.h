@@ -55,6 +55,30 @@ typedef struct edge_entry edge_entry;
 
 typedef struct GRAPH_global_context GRAPH_global_context;
 
+/* bitset helpers for per edge state indexed by the dense edge index */
+#define EDGE_BITSET_BYTES(num_edges) ((Size) (((num_edges) + 7) / 8))
+#define EDGE_BITSET_TEST(bits, idx) \
+    (((bits)[(idx) >> 3] & (1 << ((idx) & 7))) != 0)
+#define EDGE_BITSET_SET(bits, idx) ((bits)[(idx) >> 3] |= (1 << ((idx) & 7)))
+#define EDGE_BITSET_CLEAR(bits, idx) \
+    ((bits)[(idx) >> 3] &= ~(1 << ((idx) & 7)))
+
+/*
+ * Memoized VLE edge match results for one edge constraint set, indexed by
+ * the dense edge index. An edge's bit in matched is only meaningful once its
+ * bit in checked is set.
+ */
+typedef struct EdgeMatchMemo
+{
+    Oid label_oid;                 /* edge label table oid, or InvalidOid */
+    bool label_missing;            /* a label was given but doesn't exist */
+    Datum constraint;              /* property constraint (agtype) */
+    uint32 constraint_hash;        /* datum_image_hash of the constraint */
+    bits8 *checked;                /* has the edge been tested */
+    bits8 *matched;                /* did the edge match */
+    struct EdgeMatchMemo *next;    /* next memo for this graph */
+} EdgeMatchMemo;
+
 /* GRAPH global context functions */
 GRAPH_global_context *manage_GRAPH_global_contexts(char *graph_name,
                                                    Oid graph_oid);
@@ -68,8 +92,8 @@ edge_entry *get_edge_entry(GRAPH_global_context *ggctx, graphid edge_id);
 
 /*
  * Variant of get_edge_entry that accepts a precomputed hash value, allowing
- * the same hash to be reused across multiple lookups of the same graphid
- * (e.g. edge_state_hashtable + edge_hashtable in the VLE DFS hot loop).
+ * the hash to be computed ahead of the lookup (e.g. for a batch of edges in
+ * the VLE DFS hot loop).
  */
 edge_entry *get_edge_entry_with_hash(GRAPH_global_context *ggctx,
                                      graphid edge_id, uint32 hashvalue);
@@ -92,6 +116,18 @@ Oid get_edge_entry_label_table_oid(edge_entry *ee);
 Datum get_edge_entry_properties(edge_entry *ee);
 graphid get_edge_entry_start_vertex_id(edge_entry *ee);
 graphid get_edge_entry_end_vertex_id(edge_entry *ee);
+uint32 get_edge_entry_index(edge_entry *ee);
+int64 get_graph_num_edges(GRAPH_global_context *ggctx);
+uint64 get_graph_build_number(GRAPH_global_context *ggctx);
+
+/* VLE edge match memo functions */
+EdgeMatchMemo *get_edge_match_memo(GRAPH_global_context *ggctx, Oid label_oid,
+                                   bool label_missing, Datum constraint,
+                                   uint32 constraint_hash);
+EdgeMatchMemo *create_edge_match_memo(int64 num_edges, Oid label_oid,
+                                      bool label_missing, Datum constraint,
+                                      uint32 constraint_hash);
+void free_edge_match_memo(EdgeMatchMemo *memo);
 
 /* Graph version counter functions — shared memory (DSM or shmem) */
 uint64 get_graph_version(Oid graph_oid);
@@ -0,0 +1,82 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef AG_AGE_GRAPH_CSR_H
+#define AG_AGE_GRAPH_CSR_H
+
+#include "utils/agtype.h"
+#include "utils/age_global_graph.h"
+
+/*
+ * A compressed sparse row (CSR) copy of the cached graph for the whole-graph
+ * algorithms. Vertices are numbered densely, 0 .. num_vertices - 1, in the
+ * order of the cached vertex list, so per vertex state can live in flat
+ * arrays instead of hashtables keyed by graphid. Edges are kept in both
+ * directions: the out edges of vertex v are out_targets[out_offsets[v]] ..
+ * out_targets[out_offsets[v + 1] - 1] and likewise for the in edges. A self
+ * loop is both an out and an in edge of its vertex. A weighted copy also
+ * has the weight of each edge in out_weights and in_weights, parallel to
+ * out_targets and in_sources; they are NULL in an unweighted copy.
+ *
+ * The undirected neighbor lists are optional and are only filled in by
+ * build_graph_csr_neighbors: the distinct vertices adjacent to v in either
+ * direction, excluding v itself, sorted ascending, are neighbors[
+ * neighbor_offsets[v]] .. neighbors[neighbor_offsets[v + 1] - 1].
+ *
+ * The copy is a snapshot of the cache and is allocated in the memory context
+ * that is current when it is built. For the parallel algorithms it can be
+ * flattened into dynamic shared memory with store_graph_csr_shared, and a
+ * worker then reads it in place through attach_graph_csr_shared.
+ */
+typedef struct GraphCSR
+{
+    int32 num_vertices;            /* number of vertices */
+    graphid *vertex_ids;           /* dense vertex index -> vertex id */
+    int64 num_edges;               /* number of edges kept */
+    int64 *out_offsets;            /* num_vertices + 1 out edge offsets */
+    int32 *out_targets;            /* target vertex index of each out edge */
+    int64 *in_offsets;             /* num_vertices + 1 in edge offsets */
+    int32 *in_sources;             /* source vertex index of each in edge */
+    float8 *out_weights;           /* weight of each out edge, or NULL */
+    float8 *in_weights;            /* weight of each in edge, or NULL */
+    int64 *neighbor_offsets;       /* num_vertices + 1 neighbor offsets */
+    int32 *neighbors;              /* sorted undirected neighbor lists */
+    HTAB *vertex_index;            /* vertex id -> dense vertex index */
+} GraphCSR;
+
+#define GRAPH_CSR_OUT_DEGREE(csr, v) \
+    ((csr)->out_offsets[(v) + 1] - (csr)->out_offsets[(v)])
+#define GRAPH_CSR_IN_DEGREE(csr, v) \
+    ((csr)->in_offsets[(v) + 1] - (csr)->in_offsets[(v)])
+#define GRAPH_CSR_NEIGHBOR_COUNT(csr, v) \
+    ((csr)->neighbor_offsets[(v) + 1] - (csr)->neighbor_offsets[(v)])
+
+Oid *get_edge_type_label_oids(agtype *edge_types, Oid graph_oid, char *fname,
+                              int *num_label_oids);
+GraphCSR *build_graph_csr(char *graph_name, agtype *edge_types,
+                          char *weight_property, char *fname);
+void build_graph_csr_neighbors(GraphCSR *csr);
+int compare_graph_csr_vertex_index(const void *a, const void *b);
+int32 get_graph_csr_vertex_index(GraphCSR *csr, graphid vertex_id);
+void free_graph_csr(GraphCSR *csr);
+Size estimate_graph_csr_shared(GraphCSR *csr);
+void store_graph_csr_shared(GraphCSR *csr, void *space);
+GraphCSR *attach_graph_csr_shared(void *space);
+
+#endif
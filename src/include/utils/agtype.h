@@ -691,6 +691,7 @@ agtype_value *alter_property_value(agtype_value *properties, char *var_name,
 void remove_null_from_agtype_object(agtype_value *object);
 agtype_value *alter_properties(agtype_value *original_properties,
                                agtype *new_properties);
+agtype_value *agtype_composite_to_agtype_value_binary(agtype *a);
 agtype *get_one_agtype_from_variadic_args(FunctionCallInfo fcinfo,
                                           int variadic_offset,
                                           int expected_nargs);
@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef AG_EXPORT_H
+#define AG_EXPORT_H
+
+#include "utils/load/age_load.h"
+
+/* A label of a graph being exported */
+typedef struct graph_export_label
+{
+    NameData name;
+    int32 id;
+    char kind;
+    Oid relid;
+} graph_export_label;
+
+/* What was written for a label, or for a part of one */
+typedef struct graph_export_result
+{
+    int label_index;        /* the label's index in the labels exported */
+    char *file_path;
+    int64 num_rows;
+    int num_columns;
+    char **column_names;    /* including the id columns */
+} graph_export_result;
+
+/*
+ * Get the labels of a graph in label id order, leaving out the default edge
+ * label, which never has rows of its own.
+ */
+graph_export_label *get_graph_export_labels(Oid graph_oid, int *num_labels);
+
+/*
+ * Export the vertices and edges of each label to a file named after the
+ * label in directory, in the layout the loaders read.
+ *
+ * The rows are read straight from the label tables, and their properties
+ * are written without building agtype vertices and edges. Each top-level
+ * property key of a label becomes a column, in byte order, and a row
+ * without a key gets a NULL. Vertex files start with an __id__ column
+ * holding the entry id, which the vertex loaders store as the __id__
+ * property, so the __id__ property itself isn't exported; edge files start
+ * with start_id, start_vertex_type, end_id and end_vertex_type.
+ *
+ * CSV files (.csv) have a header and hold the values as agtype text, to be
+ * loaded with load_as_agtype. Binary files (.bin) are in PostgreSQL's
+ * binary COPY format, with bigint ids, text label names and agtype values,
+ * to be loaded with the binary loaders.
+ *
+ * Parameters:
+ *   directory        - The directory to write to (must be in /tmp/age/)
+ *   labels           - The labels to export
+ *   num_labels       - Number of labels
+ *   binary           - If true, write binary files instead of CSV files
+ *   parallel_workers - The number of workers to request; the labels are
+ *                      handed out to the workers and the leader, largest
+ *                      first, and each is exported with one scan per pass.
+ *                      Labels too big for one process are split into ranges
+ *                      of blocks, each written to <label>.<part>.csv (or
+ *                      .bin) with the columns of its own rows
+ *   num_results      - Set to the number of files written
+ *
+ * Returns what was written for each file, in the order of labels and then
+ * of parts.
+ */
+graph_export_result *export_graph_labels(char *directory,
+                                         graph_export_label *labels,
+                                         int num_labels, bool binary,
+                                         int parallel_workers,
+                                         int *num_results);
+
+#endif /* AG_EXPORT_H */
@@ -0,0 +1,55 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef AG_LOAD_BINARY_H
+#define AG_LOAD_BINARY_H
+
+#include "utils/load/age_load.h"
+
+/*
+ * Load vertices or edges from a file in PostgreSQL's binary COPY format,
+ * as written by COPY ... TO ... WITH (FORMAT binary).
+ *
+ * The format has no column names and its fields are only decodable with
+ * their types, so both are given by the caller. Each field is read with its
+ * type's binary receive function and mapped straight to an agtype scalar,
+ * without going through text. Vertex rows may start with an integer id
+ * column; edge rows start with start_id, start_vertex_type, end_id and
+ * end_vertex_type, as in the CSV format.
+ *
+ * Parameters:
+ *   file_path       - Path to the file (must be in /tmp/age/)
+ *   graph_oid       - OID of the graph
+ *   label_name      - Name of the label
+ *   label_id        - ID of the label
+ *   label_kind      - LABEL_KIND_VERTEX or LABEL_KIND_EDGE
+ *   id_field_exists - For vertices, if the first column is the vertex ID
+ *   column_names    - Property name of each column
+ *   column_types    - Type of each column
+ *   num_columns     - Number of columns
+ *
+ * Returns EXIT_SUCCESS on success.
+ */
+int create_entities_from_binary_file(char *file_path, Oid graph_oid,
+                                     char *label_name, int label_id,
+                                     char label_kind, bool id_field_exists,
+                                     char **column_names, Oid *column_types,
+                                     int num_columns);
+
+#endif /* AG_LOAD_BINARY_H */
@@ -22,23 +22,76 @@
 
 #include "utils/load/age_load.h"
 
+/* Natural key to graphid maps of the endpoint labels of an edge load */
+typedef struct edge_endpoint_keys edge_endpoint_keys;
+
+/* How an edge load checks that the endpoints of its edges exist */
+typedef enum edge_endpoint_validation
+{
+    EDGE_ENDPOINT_VALIDATION_NONE,      /* don't check */
+    EDGE_ENDPOINT_VALIDATION_ERROR,     /* fail on a missing endpoint */
+    EDGE_ENDPOINT_VALIDATION_SKIP       /* skip edges with missing endpoints */
+} edge_endpoint_validation;
+
+/* The vertex ids of the endpoint labels of an edge load, for validation */
+typedef struct edge_endpoint_check edge_endpoint_check;
+
 /*
  * Load edges from a CSV file using pg's COPY infrastructure.
  *
  * CSV format: start_id, start_vertex_type, end_id, end_vertex_type, [properties...]
  *
  * Parameters:
- *   file_path       - Path to the CSV file (must be in /tmp/age/)
+ *   file_path       - Path to the CSV file (must be in /tmp/age/), or NULL
+ *                     to read the CSV data from the client as COPY FROM STDIN
  *   graph_name      - Name of the graph
  *   graph_oid       - OID of the graph
  *   label_name      - Name of the edge label
  *   label_id        - ID of the label
  *   load_as_agtype  - If true, parse CSV values as agtype (JSON-like)
+ *   delimiter       - The CSV delimiter
+ *   deferred_indexes - If true, don't maintain the label's indexes; the
+ *                      caller rebuilds them after the load
+ *   key_property    - If not NULL, start_id and end_id are values of this
+ *                     property of the endpoint vertices instead of entry ids
+ *   validation      - How to check that the endpoints exist
  *
  * Returns EXIT_SUCCESS on success.
  */
 int create_edges_from_csv_file(char *file_path, char *graph_name, Oid graph_oid,
                                char *label_name, int label_id,
-                               bool load_as_agtype, char delimiter);
+                               bool load_as_agtype, char delimiter,
+                               bool deferred_indexes, char *key_property,
+                               edge_endpoint_validation validation);
+
+/* Raise an error for an edge file header without the 4 fixed columns */
+void check_edge_file_header(int header_count);
+
+/*
+ * Check an edge row's width and return the graphids of its start and end
+ * vertices. With keys, the ids in the row are resolved as natural keys.
+ */
+void get_edge_row_endpoints(char **fields, int nfields, int header_count,
+                            Oid graph_oid, edge_endpoint_keys *keys,
+                            graphid *start_vertex_graph_id,
+                            graphid *end_vertex_graph_id);
+
+/*
+ * Start checking edge endpoints against the vertices of the graph. Returns
+ * NULL for EDGE_ENDPOINT_VALIDATION_NONE.
+ */
+edge_endpoint_check *create_edge_endpoint_check(
+    Oid graph_oid, edge_endpoint_validation validation);
+
+/*
+ * Check that the start and end vertices of an edge exist. Returns false for
+ * an edge to skip, or raises an error, depending on the validation mode. The
+ * error names the edge's line of the file, if line_number isn't 0.
+ */
+bool check_edge_endpoints(edge_endpoint_check *check, graphid start_id,
+                          graphid end_id, int64 line_number);
+
+/* Report the skipped edges, if any, and free the check */
+void finish_edge_endpoint_check(edge_endpoint_check *check);
 
 #endif /* AG_LOAD_EDGES_H */
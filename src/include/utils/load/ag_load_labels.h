@@ -27,19 +27,42 @@
  * CSV format: [id,] [properties...]
  *
  * Parameters:
- *   file_path       - Path to the CSV file (must be in /tmp/age/)
+ *   file_path       - Path to the CSV file (must be in /tmp/age/), or NULL
+ *                     to read the CSV data from the client as COPY FROM STDIN
  *   graph_name      - Name of the graph
  *   graph_oid       - OID of the graph
  *   label_name      - Name of the vertex label
  *   label_id        - ID of the label
  *   id_field_exists - If true, first CSV column contains the vertex ID
  *   load_as_agtype  - If true, parse CSV values as agtype (JSON-like)
+ *   delimiter       - The CSV delimiter
+ *   deferred_indexes - If true, don't maintain the label's indexes; the
+ *                      caller rebuilds them after the load
  *
  * Returns EXIT_SUCCESS on success.
  */
 int create_labels_from_csv_file(char *file_path, char *graph_name, Oid graph_oid,
                                 char *label_name, int label_id,
                                 bool id_field_exists, bool load_as_agtype,
+                                char delimiter, bool deferred_indexes);
+
+/*
+ * Insert or update vertices from a CSV file, matching them on a key property.
+ * A row whose key_property value is the key of a vertex of the label updates
+ * that vertex's properties, as SET += would; other rows are inserted as new
+ * vertices. The CSV has no id column.
+ *
+ * New rows are inserted in batches. Updates are queued and written in
+ * groups, in physical order.
+ *
+ * Returns EXIT_SUCCESS on success.
+ */
+int upsert_labels_from_csv_file(char *file_path, char *graph_name,
+                                Oid graph_oid, char *label_name, int label_id,
+                                char *key_property, bool load_as_agtype,
                                 char delimiter);
 
+/* Raise an error for a vertex row with more columns than the header */
+void check_label_file_row(int nfields, int header_count);
+
 #endif /* AG_LOAD_LABELS_H */
@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef AG_LOAD_PARALLEL_H
+#define AG_LOAD_PARALLEL_H
+
+#include "utils/load/ag_load_edges.h"
+
+/*
+ * Load a vertex or edge CSV file with parallel workers.
+ *
+ * The file is split into chunks on record boundaries and the chunks are
+ * handed out to the workers, which parse them and build the properties. The
+ * rows are sent back to the leader, which inserts them, since tuples can't be
+ * inserted by a parallel worker. The entry ids of the rows are reserved up
+ * front, one range per chunk in file order, so they come out the same as
+ * with the serial loaders. As the leader does all of the inserts, the
+ * workers speed up the parsing but not the writing, and a load can go no
+ * faster than one backend inserts. Files whose rows end in a bare carriage
+ * return can't be split and are loaded serially.
+ *
+ * Parameters:
+ *   file_path        - Path to the CSV file (must be in /tmp/age/)
+ *   graph_name       - Name of the graph
+ *   graph_oid        - OID of the graph
+ *   label_name       - Name of the label
+ *   label_id         - ID of the label
+ *   label_kind       - LABEL_KIND_VERTEX or LABEL_KIND_EDGE
+ *   id_field_exists  - For vertices, if the first CSV column is the id
+ *   load_as_agtype   - If true, parse CSV values as agtype (JSON-like)
+ *   delimiter        - The CSV delimiter
+ *   parallel_workers - The number of workers to request
+ *   deferred_indexes - If true, don't maintain the label's indexes; the
+ *                      caller rebuilds them after the load
+ *   validation       - For edges, how to check that the endpoints exist
+ *
+ * Returns EXIT_SUCCESS on success.
+ */
+int create_entities_from_csv_file_parallel(char *file_path, char *graph_name,
+                                           Oid graph_oid, char *label_name,
+                                           int label_id, char label_kind,
+                                           bool id_field_exists,
+                                           bool load_as_agtype, char delimiter,
+                                           int parallel_workers,
+                                           bool deferred_indexes,
+                                           edge_endpoint_validation validation);
+
+#endif /* AG_LOAD_PARALLEL_H */
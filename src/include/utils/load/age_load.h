@@ -20,9 +20,11 @@
 #ifndef AG_LOAD_H
 #define AG_LOAD_H
 
+#include "access/genam.h"
 #include "access/heapam.h"
 #include "commands/sequence.h"
 #include "utils/builtins.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
 
 #include "catalog/ag_graph.h"
@@ -30,6 +32,7 @@
 #include "commands/label_commands.h"
 #include "commands/graph_commands.h"
 #include "utils/ag_cache.h"
+#include "utils/agtype.h"
 
 #define BATCH_SIZE 1000
 #define MAX_BUFFERED_BYTES 65535  /* 64KB, same as pg COPY */
@@ -42,8 +45,73 @@ typedef struct batch_insert_state
     int num_tuples;
     size_t buffered_bytes;
     BulkInsertState bistate;
+    bool defer_indexes;    /* leave index maintenance to a rebuild */
 } batch_insert_state;
 
+/*
+ * Entry ids for a bulk load, reserved from the label's sequence BATCH_SIZE
+ * at a time so that the sequence is written once per block, not per row.
+ * When a block can't be reserved without waiting, the ids are drawn one at
+ * a time instead; see reserve_label_entry_ids.
+ */
+typedef struct entry_id_block
+{
+    Oid label_seq_relid;
+    int64 next_id;     /* next id to hand out */
+    int64 last_id;     /* last id of the block, next_id - 1 when used up */
+    int64 unreserved;  /* ids to draw one at a time before trying again */
+} entry_id_block;
+
+/*
+ * The value of a vertex's key property. Keys are strings or integers, and a
+ * string never matches an integer, so the integer 5 is not the string "5".
+ */
+typedef struct vertex_key
+{
+    enum agtype_value_type type;   /* AGTV_STRING or AGTV_INTEGER */
+    char *value;                   /* the string, or the integer as text */
+} vertex_key;
+
+/* An entry of a vertex key map, see create_vertex_key_map */
+typedef struct vertex_key_entry
+{
+    vertex_key key; /* hash key, the value is in the map's context */
+    graphid id;
+} vertex_key_entry;
+
+/*
+ * The vertices of a label by their key property. If the label has a btree
+ * index on the property, the keys are probed in it as they are looked up,
+ * through one index scan kept open until free_vertex_key_map; otherwise
+ * the label is read up front.
+ */
+typedef struct vertex_key_map
+{
+    HTAB *keys;                    /* vertex_key_entry entries */
+    MemoryContext mcxt;
+    char *label_name;
+    char *key_property;
+
+    /* only set when the keys are probed in an index */
+    Relation relation;
+    Relation index_relation;
+    IndexScanDesc index_scan;
+    TupleTableSlot *slot;
+    Snapshot snapshot;
+    RegProcedure eq_proc;          /* the index's agtype equality */
+    MemoryContext probe_context;
+} vertex_key_map;
+
+/* A vertex property update, see write_vertex_property_updates */
+typedef struct vertex_property_update
+{
+    graphid vertex_id;             /* vertex to update */
+    int64 position;                /* position in the input */
+    Datum value;                   /* new value */
+    bool value_isnull;             /* SQL NULL removes the property */
+    ItemPointerData tid;           /* current tuple, invalid if not found */
+} vertex_property_update;
+
 agtype *create_empty_agtype(void);
 agtype *create_agtype_from_list(char **header, char **fields,
                                 size_t fields_len, int64 vertex_id,
@@ -63,6 +131,24 @@ void init_batch_insert(batch_insert_state **batch_state,
 void insert_batch(batch_insert_state *batch_state);
 void finish_batch_insert(batch_insert_state **batch_state);
 
+List *create_csv_copy_options(char delimiter);
+int64 reserve_label_entry_ids(Oid label_seq_relid, int64 count);
+void init_entry_id_block(entry_id_block *block, Oid label_seq_relid);
+int64 next_entry_id_from_block(entry_id_block *block);
+void release_entry_id_block(entry_id_block *block);
+
+vertex_key_map *create_vertex_key_map(Oid graph_oid, char *label_name,
+                                      char *key_property, MemoryContext mcxt);
+vertex_key_entry *find_vertex_key(vertex_key_map *map, vertex_key *key);
+vertex_key_entry *add_vertex_key(vertex_key_map *map, vertex_key *key,
+                                 graphid id);
+void free_vertex_key_map(vertex_key_map *map);
+void csv_field_to_vertex_key(char *field, bool load_as_agtype,
+                             char *key_property, vertex_key *key);
+int64 write_vertex_property_updates(Oid graph_oid, char *property_name,
+                                    vertex_property_update *updates,
+                                    int64 num_input);
+
 char *trim_whitespace(const char *str);
 
 #endif /* AG_LOAD_H */